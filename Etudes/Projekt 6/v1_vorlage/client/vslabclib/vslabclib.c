@@ -1,21 +1,55 @@
 /**
- *	\file vslabclib.c 
+ *	\file vslabclib.c
  *	\author Marc Juettner, marc.juettner@juettner-itconsult.de
  *	\author Manuel Gaiser, manuel.gaiser@hs-pforzheim.de
- *	\version 1.0
+ *	\version 1.10
  *	\brief A library that implements access to a remote vslab server
- *	
+ *
  *	\defgroup vslabclib VSLab client library
  *	\{
  * \par Prerequisites
- * This library needs a running vslab server deamon on a properly configured hardware platform 
+ * This library needs a running vslab server deamon on a properly configured hardware platform
  * before running any application that uses it.
  *
- * \warning This library is not thread-safe!
- * It is impossible to access the vslab client library from multiple applications 
- * simultaneously as multiple parallel calls to vslcl_call_function() would cause 
- * received packets not to be assigned properly to the process or thread that expects it. 
- * There is much to do to make this library useable in multithreaded applications!
+ * \par Contexts
+ * All state lives in a context (vslcl_ctx) opened by vslcl_open_ctx(). A context may be
+ * used by any number of threads at the same time: every request carries a request ID
+ * that the server echoes, so replies are matched to their requests by ID instead of by
+ * arrival order and many requests can be in flight on the context's single socket.
+ * Whichever waiting thread finds nobody receiving becomes the receiver, hands replies
+ * for other requests to their threads and passes the role on when its own reply
+ * arrived.
+ *
+ * \par Retransmission
+ * UDP loses datagrams, so a request without reply is sent again after a retransmission
+ * timeout derived from its server's measured round trip times, with exponential backoff
+ * and at most VSLCL_MAX_RETRIES times. With hedging on (vslcl_set_hedging()), a request
+ * slower than 95 % of its server's replies also goes to a second server.
+ *
+ * \par Vector requests
+ * Operands of vector and matrix functions (vslcl_ctx_vector_function()) go out as a
+ * series of fragments, the results come back the same way. A retransmission tells the
+ * server which result fragments arrived, so it sends only the others again, and repeats
+ * the operands as long as no result arrived - the server keeps the fragments it has and
+ * only fills the gaps. A request failing over to another server starts again under a
+ * new ID.
+ *
+ * \par Aggregation streams
+ * A stream (vslcl_open_stream()) hands any number of values to one server, which folds
+ * them into count, sum, minimum, maximum and histogram as they arrive and never stores
+ * them. Values go out in windows of up to PL_STREAM_WINDOW chunks; a write returns once
+ * the server acknowledged its last window, chunks reported missing are sent again. A
+ * stream stays with the server it was opened on, it can't fail over.
+ *
+ * \par Typed requests
+ * Functions on 64 bit integers or floating point operands (vslcl_ctx_typed_function())
+ * go out as typed requests of up to PL_TYPED_MAX_ENTRIES operations on operands of one
+ * type. They are retransmitted and fail over like single requests, but never batched or
+ * duplicated.
+ *
+ * The original functions (vslcl_Open(), vslcl_Multiply(), ...) work on a default
+ * context and are thread-safe as well, apart from vslcl_Open() and vslcl_Close()
+ * themselves.
  * \}
  */
 #include "vslabclib.h"
@@ -27,131 +61,2467 @@
  */
 
 /**
- *	Declaration of static variables that work across library functions - don't attempt to 
+ *	Declaration of static variables that work across library functions - don't attempt to
  *	use them outside the library!
  */
 
 /**
- *	\brief The socket descriptor for remote vslab server access.
+ *	\brief The default context.
+ *
+ *	vslcl_default holds the context used by vslcl_Open(), vslcl_call_function() and the
+ *	other functions without context parameter. It is NULL while the library is closed.
+ */
+static vslcl_ctx *vslcl_default = NULL;
+
+/**
+ *	\brief Remote system IP addresses
+ *
+ *	Unicast_addr holds the unicast addresses of the remote systems being used by the library.
+ *	A call to vslcl_SetUnicastAddress() BEFORE vslcl_Open() gives us the ability to
+ *	override the default setting of VSLS_UNICAST_ADDRESS for the default context,
+ *	vslcl_AddUnicastAddress() adds further servers.
+ */
+static char unicast_addr[VSLCL_MAX_SERVERS][IP_ADDR_LEN] = { VSLS_UNICAST_ADDRESS };
+
+/**
+ *	\brief Number of remote systems
+ */
+static int iUnicastCount = 1;
+
+/**
+ *	\}
+ */
+
+/**
+ *	\ingroup vslabclib
+ *	\defgroup vslcl_ctxdef Contexts
+ *	\{
+ */
+
+/**
+ *	\brief Operands and results of a vector request
+ */
+struct vslcl_vector {
+	unsigned int dim[PL_VEC_DIMS];	/**< \brief Shape of the operands. */
+	const int *a;			/**< \brief Operand A, owned by the caller. */
+	const int *b;			/**< \brief Operand B, owned by the caller. */
+	unsigned int uA;		/**< \brief Elements of A. */
+	unsigned int uB;		/**< \brief Elements of B. */
+	int *result;			/**< \brief Receives the results, owned by the caller. */
+	unsigned int uResults;		/**< \brief Number of results. */
+	unsigned int uReceived;		/**< \brief Result fragments received. */
+	unsigned int *map;		/**< \brief One bit per received result fragment, see PL_PTYPE_VACK. */
+};
+
+/**
+ *	\brief An aggregation stream
+ */
+struct vslcl_stream {
+	vslcl_ctx *ctx;			/**< \brief Context the stream was opened on. */
+	unsigned int uStreamId;		/**< \brief Stream ID, the request ID of the open request. */
+	int iServer;			/**< \brief Server aggregating the stream. */
+	unsigned int uNext;		/**< \brief Number of the next chunk. */
+	int iLo;			/**< \brief Lower bound of the histogram. */
+	unsigned int uWidth;		/**< \brief Bucket width. */
+	unsigned int uBuckets;		/**< \brief Number of buckets. */
+	int iFailed;			/**< \brief Error code of the first failed operation, zero if none. */
+};
+
+/**
+ *	\brief An operation on an aggregation stream
+ *
+ *	Opens or closes the stream or sends one window of chunks.
+ */
+struct vslcl_stream_op {
+	struct vslcl_stream *stream;	/**< \brief The stream. */
+	unsigned int type;		/**< \brief PL_PTYPE_SOPEN, PL_PTYPE_SDATA or PL_PTYPE_SCLOSE. */
+	const int *values;		/**< \brief Values of the window, owned by the caller. */
+	unsigned int uFirst;		/**< \brief Number of the window's first chunk. */
+	unsigned int uEnd;		/**< \brief Number of the chunk after the window. */
+	unsigned int uValues;		/**< \brief Number of values in the window. */
+	unsigned int uBase;		/**< \brief Chunks acknowledged in a row. */
+	unsigned int map[PL_STREAM_WINDOW / 32];	/**< \brief Chunks acknowledged after \a uBase, see PL_PTYPE_SACK. */
+	struct pl_aggregate *result;	/**< \brief Receives the result of a close request. */
+	int iFast;			/**< \brief Set once missing chunks were sent again on an acknowledgment. */
+	int iFastDue;			/**< \brief Set while those chunks wait for the waiting thread to send them. */
+};
+
+/**
+ *	\brief Operands and results of a typed request
+ */
+struct vslcl_typed {
+	unsigned int otype;		/**< \brief Operand type, PL_OTYPE_XXX. */
+	const union pl_value *op1;	/**< \brief First operands, owned by the caller. */
+	const union pl_value *op2;	/**< \brief Second operands, owned by the caller, NULL for zeros. */
+	union pl_value *result;		/**< \brief Receives the results, owned by the caller. */
+	int *status;			/**< \brief Receives the status of each operation, NULL if not wanted. */
+	unsigned int n;			/**< \brief Number of operations, at most PL_TYPED_MAX_ENTRIES. */
+	int iAnswered;			/**< \brief Set once a typed response filled in the results. */
+};
+
+/**
+ *	\brief A request in flight
+ */
+struct vslcl_pending {
+	unsigned int uRequestId;	/**< \brief Request ID, 0 if the slot is free. */
+	int iDone;			/**< \brief Set when the reply arrived. */
+	struct pl_data reply;		/**< \brief The reply. */
+	vslcl_callback cb;		/**< \brief Completion callback, NULL for blocking calls. */
+	void *user;			/**< \brief Argument for \a cb. */
+	int iStatus;			/**< \brief Result of an asynchronous request. */
+	int iNext;			/**< \brief Next slot in the completion queue, -1 at the end. */
+	struct timespec deadline;	/**< \brief When the request is given up. */
+	struct pl_batch_entry entry;	/**< \brief Function id and operands of the request. */
+	const unsigned char *payload;	/**< \brief Bytes sent behind the request ID, owned by the caller. */
+	unsigned int uPayloadLen;	/**< \brief Number of bytes in \a payload. */
+	struct vslcl_vector *vector;	/**< \brief Operands and results of a vector request, NULL for others. */
+	struct vslcl_stream_op *stream;	/**< \brief Operation of an aggregation stream, NULL for others. */
+	struct vslcl_typed *typed;	/**< \brief Operands and results of a typed request, NULL for others. */
+	int iQueued;			/**< \brief Set while the request waits in the open batch. */
+	int iBatchNext;			/**< \brief Next slot of the same batch, -1 at the end. */
+	unsigned int uBatchId;		/**< \brief Request ID of the batch the request was sent in. */
+	int iServer;			/**< \brief Server the request was sent to, -1 if none. */
+	struct timespec sent;		/**< \brief When the request was sent. */
+	int iProbe;			/**< \brief Set for probes, nobody waits for them. */
+	int iRetries;			/**< \brief Number of retransmissions. */
+	struct timespec resend;		/**< \brief When the request is sent again. */
+	int iHedgeServer;		/**< \brief Server a duplicate was sent to, -1 if none. */
+	int iHedged;			/**< \brief Set once a duplicate was sent. */
+	int iHedgeArmed;		/**< \brief Set if a duplicate is due at \a hedge. */
+	struct timespec hedge;		/**< \brief When a duplicate is sent. */
+};
+
+/**
+ *	\brief A server of a context
+ */
+struct vslcl_server {
+	struct sockaddr_in addr;	/**< \brief Server address. */
+	int iOutstanding;		/**< \brief Requests sent and not yet answered. */
+	long lSrtt;			/**< \brief Smoothed round trip time in microseconds. */
+	long lRttvar;			/**< \brief Round trip time variation in microseconds. */
+	int iSampled;			/**< \brief Set once the round trip time was measured. */
+	unsigned short hist[VSLCL_HIST_BUCKETS];	/**< \brief Round trip time histogram. */
+	unsigned int uHistTotal;	/**< \brief Samples in \a hist. */
+	int iFailures;			/**< \brief Timeouts since the last reply. */
+	int iEjected;			/**< \brief Set while the server only gets probes. */
+	struct timespec ejected;	/**< \brief When the server was ejected. */
+	int iProbeSlot;			/**< \brief Slot of the probe in flight, -1 if none. */
+	struct timespec probe;		/**< \brief Next probe or timeout of the probe in flight. */
+};
+
+/**
+ *	\brief Client context
+ *
+ *	Slot i of \a pending holds the request whose ID is congruent i modulo
+ *	VSLCL_MAX_INFLIGHT, so a reply finds its request without searching. Completed
+ *	asynchronous requests are queued through their \a iNext fields until vslcl_poll()
+ *	runs their callbacks.
+ *
+ *	With batching enabled, requests are collected in the open batch, linked through
+ *	their \a iBatchNext fields, and sent together in one batch packet. The batch packet
+ *	carries the request ID of its first request, its reply is taken apart along the same
+ *	links.
+ *
+ *	Every request (or batch) goes to one of the servers, see vslcl_choose(). Requests
+ *	without reply are sent again after the server's retransmission timeout, see
+ *	vslcl_resend().
+ */
+struct vslcl_ctx {
+	int iSocket;					/**< \brief The context's socket. */
+	pthread_mutex_t lock;				/**< \brief Protects everything below. */
+	pthread_cond_t cond;				/**< \brief Signals replies and free slots. */
+	int iReceiving;					/**< \brief Set while a thread receives. */
+	int iInFlight;					/**< \brief Number of used slots. */
+	int iAsync;					/**< \brief Asynchronous requests not yet completed. */
+	int iDoneHead;					/**< \brief First completed asynchronous request. */
+	int iDoneTail;					/**< \brief Last completed asynchronous request. */
+	int iEvent;					/**< \brief Signals queued completions, -1 if unused. */
+	int iPollFd;					/**< \brief Pollable descriptor, see vslcl_fd(). */
+	unsigned int uNextId;				/**< \brief Next request ID to try. */
+	unsigned int uRandom;				/**< \brief State of the server choice. */
+	int iServerCount;				/**< \brief Number of servers. */
+	struct vslcl_server servers[VSLCL_MAX_SERVERS];	/**< \brief The servers. */
+	int iBatchWindow;				/**< \brief Batching window in microseconds, 0 if off. */
+	int iBatchMax;					/**< \brief Requests that fill a batch. */
+	int iBatchCount;				/**< \brief Requests in the open batch. */
+	int iBatchHead;					/**< \brief First request of the open batch. */
+	int iBatchTail;					/**< \brief Last request of the open batch. */
+	struct timespec batchDeadline;			/**< \brief When the open batch is sent. */
+	int iHedging;					/**< \brief Set if slow requests are duplicated. */
+	struct vslcl_pending pending[VSLCL_MAX_INFLIGHT];	/**< \brief Requests in flight. */
+};
+
+/**
+ *	\brief Get a point in time on the monotonic clock
+ *	\param ts	Receives the time
+ *	\param lUs	Microseconds from now
+ */
+static void vslcl_deadline_us(struct timespec *ts, long lUs)
+{
+	clock_gettime(CLOCK_MONOTONIC, ts);
+	ts->tv_sec += lUs / 1000000L;
+	ts->tv_nsec += (lUs % 1000000L) * 1000L;
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+/**
+ *	\brief Get a point in time on the monotonic clock
+ *	\param ts	Receives the time
+ *	\param iMs	Milliseconds from now
+ */
+static void vslcl_deadline(struct timespec *ts, int iMs)
+{
+	vslcl_deadline_us(ts, (long)iMs * 1000L);
+}
+
+/**
+ *	\brief Get the microseconds left until a point in time
+ *	\param ts	The point in time on the monotonic clock
+ *	\return		Microseconds left, zero if it has passed
+ */
+static long vslcl_remaining_us(struct timespec *ts)
+{
+	struct timespec now;
+	long lUs;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	lUs = (ts->tv_sec - now.tv_sec) * 1000000L + (ts->tv_nsec - now.tv_nsec) / 1000L;
+	return (lUs > 0) ? lUs : 0;
+}
+
+/**
+ *	\brief Get the milliseconds left until a point in time
+ *	\param ts	The point in time on the monotonic clock
+ *	\return		Milliseconds left, zero if it has passed
+ */
+static int vslcl_remaining(struct timespec *ts)
+{
+	return (int)(vslcl_remaining_us(ts) / 1000L);
+}
+
+/**
+ *	\brief Set up a server entry
+ *	\param srv	The entry
+ *	\param address	Server IPv4 address in dotted notation
+ *	\param port	Server port
+ */
+static void vslcl_init_server(struct vslcl_server *srv, const char *address, unsigned short port)
+{
+	memset(srv, 0x00, sizeof(struct vslcl_server));
+	srv->iProbeSlot = -1;
+	// a guess until the first reply, so an unknown server doesn't look best
+	srv->lSrtt = VSLCL_LATENCY_GUESS_US;
+
+	// initialize server structure - there's nothing to be done by OS, we have to set it
+	// "at our own risk"...
+	srv->addr.sin_family = AF_INET;			// Ethernet
+	srv->addr.sin_addr.s_addr = inet_addr(address);
+	srv->addr.sin_port = htons(port);
+	memset(&(srv->addr.sin_zero), 0x00, 8);
+}
+
+/**
+ *	\brief Create a context
+ *	\param address	Server IPv4 address in dotted notation
+ *	\param port	Server port
+ *	\param error	Receives the error code if the context couldn't be created
+ *	\return		The context, NULL on error
+ */
+static vslcl_ctx *vslcl_create_ctx(const char *address, unsigned short port, int *error)
+{
+	vslcl_ctx *ctx;
+	struct sockaddr_in vsls_local;
+	pthread_condattr_t attr;
+	int iRcvBuf;
+
+	if (address == NULL) {
+		*error = -EVSLCL_NULLPTR;
+		return NULL;
+	}
+	ctx = calloc(1, sizeof(vslcl_ctx));
+	if (ctx == NULL) {
+		*error = -EVSLCL_NOMEM;
+		return NULL;
+	}
+
+	//get socket descriptor
+	ctx->iSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (ctx->iSocket < 0)
+	{
+		free(ctx);
+		*error = -EVSLCL_SOCKET;
+		return NULL;
+	}
+
+   	// initialize client structure - that's me
+   	vsls_local.sin_family = AF_INET;			// Ethernet
+   	vsls_local.sin_addr.s_addr = htonl(INADDR_ANY);	// automatically insert own address
+   	vsls_local.sin_port = htons(0);			// let the OS choose our port
+   	memset(&(vsls_local.sin_zero), 0x00, 8);		// set remaining bytes to 0x0
+
+	vslcl_init_server(&ctx->servers[0], address, port);
+	ctx->iServerCount = 1;
+
+	// bind socket
+	if (bind(ctx->iSocket, (struct sockaddr *)&vsls_local, sizeof(struct sockaddr)) < 0)
+	{
+		close(ctx->iSocket);
+		free(ctx);
+		*error = -EVSLCL_BIND;
+		return NULL;
+	}
+
+	// room for the result stream of a vector request
+	iRcvBuf = VSLCL_RCVBUF;
+	setsockopt(ctx->iSocket, SOL_SOCKET, SO_RCVBUF, &iRcvBuf, sizeof(iRcvBuf));
+
+	pthread_mutex_init(&ctx->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&ctx->cond, &attr);
+	pthread_condattr_destroy(&attr);
+	ctx->uNextId = 1;
+	ctx->uRandom = (unsigned int)time(NULL) ^ (unsigned int)(unsigned long)ctx;
+	if (ctx->uRandom == 0) ctx->uRandom = 1;
+	ctx->iDoneHead = ctx->iDoneTail = -1;
+	ctx->iBatchHead = ctx->iBatchTail = -1;
+	ctx->iBatchMax = 1;
+	ctx->iEvent = -1;
+	ctx->iPollFd = ctx->iSocket;
+
+#if defined VSLCL_HAVE_EVENTFD
+	// one descriptor that is readable on replies as well as on completions
+	// received by other threads
+	ctx->iEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	ctx->iPollFd = epoll_create1(EPOLL_CLOEXEC);
+	if ((ctx->iEvent >= 0) && (ctx->iPollFd >= 0)) {
+		struct epoll_event ev;
+
+		memset(&ev, 0x00, sizeof(ev));
+		ev.events = EPOLLIN;
+		if ((epoll_ctl(ctx->iPollFd, EPOLL_CTL_ADD, ctx->iSocket, &ev) < 0) ||
+		    (epoll_ctl(ctx->iPollFd, EPOLL_CTL_ADD, ctx->iEvent, &ev) < 0)) {
+			close(ctx->iPollFd);
+			ctx->iPollFd = -1;
+		}
+	}
+	if ((ctx->iEvent < 0) || (ctx->iPollFd < 0)) {
+		if (ctx->iEvent >= 0) close(ctx->iEvent);
+		if (ctx->iPollFd >= 0) close(ctx->iPollFd);
+		ctx->iEvent = -1;
+		ctx->iPollFd = ctx->iSocket;
+	}
+#endif
+
+	*error = EVSLCL_NOERROR;
+	return ctx;
+}
+
+/**
+ *	\brief Reserve a slot and request ID for a new request
+ *	\param ctx	The context, locked by the caller
+ *	\param iWait	Wait for a free slot if nonzero
+ *	\return		The slot, its uRequestId field holds the new request ID, NULL if all
+ *			VSLCL_MAX_INFLIGHT slots are in use and \a iWait is zero
+ *
+ *	ID 0 is never used, it marks packets without request ID.
+ */
+static struct vslcl_pending *vslcl_reserve(vslcl_ctx *ctx, int iWait)
+{
+	struct vslcl_pending *slot;
+
+	while (ctx->iInFlight == VSLCL_MAX_INFLIGHT) {
+		if (!iWait) return NULL;
+		pthread_cond_wait(&ctx->cond, &ctx->lock);
+	}
+
+	for (;;) {
+		if (ctx->uNextId == 0) ctx->uNextId++;
+		slot = &ctx->pending[ctx->uNextId % VSLCL_MAX_INFLIGHT];
+		if (slot->uRequestId == 0) break;
+		ctx->uNextId++;
+	}
+	slot->uRequestId = ctx->uNextId++;
+	slot->iDone = 0;
+	slot->cb = NULL;
+	slot->iQueued = 0;
+	slot->iBatchNext = -1;
+	slot->uBatchId = 0;
+	slot->iServer = -1;
+	slot->iProbe = 0;
+	slot->iRetries = 0;
+	slot->iHedgeServer = -1;
+	slot->iHedged = 0;
+	slot->iHedgeArmed = 0;
+	slot->payload = NULL;
+	slot->uPayloadLen = 0;
+	slot->vector = NULL;
+	slot->stream = NULL;
+	slot->typed = NULL;
+	ctx->iInFlight++;
+	return slot;
+}
+
+/**
+ *	\brief Release a slot
+ *	\param ctx	The context, locked by the caller
+ *	\param slot	A slot returned by vslcl_reserve()
+ */
+static void vslcl_release(vslcl_ctx *ctx, struct vslcl_pending *slot)
+{
+	slot->uRequestId = 0;
+	ctx->iInFlight--;
+	pthread_cond_broadcast(&ctx->cond);
+}
+
+/**
+ *	\brief Get the histogram bucket of a round trip time
+ *	\param lUs	Round trip time in microseconds
+ *	\return		Bucket index
+ *
+ *	Four buckets per power of two, so a bucket's bounds are at most 25 % apart.
+ */
+static int vslcl_hist_bucket(long lUs)
+{
+	int iMsb = 0, iBucket;
+
+	if (lUs < 4) return (lUs < 0) ? 0 : (int)lUs;
+	while ((lUs >> (iMsb + 1)) != 0) iMsb++;
+	iBucket = (iMsb - 1) * 4 + (int)((lUs >> (iMsb - 2)) & 3);
+	return (iBucket < VSLCL_HIST_BUCKETS) ? iBucket : VSLCL_HIST_BUCKETS - 1;
+}
+
+/**
+ *	\brief Get the lower bound of a histogram bucket
+ *	\param iBucket	Bucket index
+ *	\return		Smallest round trip time in microseconds counted in the bucket
+ */
+static long vslcl_hist_bound(int iBucket)
+{
+	if (iBucket < 4) return iBucket;
+	return (long)(4 + iBucket % 4) << (iBucket / 4 - 1);
+}
+
+/**
+ *	\brief Take a round trip time sample
+ *	\param srv	The server
+ *	\param lUs	Round trip time in microseconds
+ *
+ *	Jacobson/Karels: the smoothed round trip time follows the samples with gain 1/8, the
+ *	variation follows their deviation from it with gain 1/4. The histogram for
+ *	vslcl_p95() is halved every VSLCL_HIST_SAMPLES samples, so it follows changes too.
+ */
+static void vslcl_rtt_sample(struct vslcl_server *srv, long lUs)
+{
+	long lDelta;
+	int i;
+
+	if (!srv->iSampled) {
+		srv->lSrtt = lUs;
+		srv->lRttvar = lUs / 2;
+		srv->iSampled = 1;
+	}
+	else {
+		lDelta = lUs - srv->lSrtt;
+		srv->lSrtt += lDelta / 8;
+		if (lDelta < 0) lDelta = -lDelta;
+		srv->lRttvar += (lDelta - srv->lRttvar) / 4;
+	}
+
+	if (srv->uHistTotal >= VSLCL_HIST_SAMPLES) {
+		srv->uHistTotal = 0;
+		for (i = 0; i < VSLCL_HIST_BUCKETS; i++) {
+			srv->hist[i] /= 2;
+			srv->uHistTotal += srv->hist[i];
+		}
+	}
+	srv->hist[vslcl_hist_bucket(lUs)]++;
+	srv->uHistTotal++;
+}
+
+/**
+ *	\brief Get the retransmission timeout of a server
+ *	\param srv	The server
+ *	\return		Timeout in microseconds
+ *
+ *	Smoothed round trip time plus four times its variation, within VSLCL_RTO_MIN_MS and
+ *	VSLCL_RTO_MAX_MS; VSLCL_RTO_INIT_MS until the first sample.
+ */
+static long vslcl_rto(struct vslcl_server *srv)
+{
+	long lUs;
+
+	if (!srv->iSampled) return VSLCL_RTO_INIT_MS * 1000L;
+	lUs = srv->lSrtt + 4 * srv->lRttvar;
+	if (lUs < VSLCL_RTO_MIN_MS * 1000L) return VSLCL_RTO_MIN_MS * 1000L;
+	if (lUs > VSLCL_RTO_MAX_MS * 1000L) return VSLCL_RTO_MAX_MS * 1000L;
+	return lUs;
+}
+
+/**
+ *	\brief Get the 95th percentile of a server's round trip times
+ *	\param srv	The server
+ *	\return		Round trip time in microseconds, -1 with fewer than
+ *			VSLCL_HEDGE_MIN_SAMPLES samples
+ */
+static long vslcl_p95(struct vslcl_server *srv)
+{
+	unsigned int uAbove = 0;
+	int i;
+
+	if (srv->uHistTotal < VSLCL_HEDGE_MIN_SAMPLES) return -1;
+	for (i = VSLCL_HIST_BUCKETS - 1; i > 0; i--) {
+		uAbove += srv->hist[i];
+		if (uAbove * 20 > srv->uHistTotal) break;
+	}
+	// upper bound of the bucket
+	return vslcl_hist_bound(i + 1);
+}
+
+/**
+ *	\brief Account for the end of a request at its servers
+ *	\param ctx	The context, locked by the caller
+ *	\param slot	The request's slot
+ *	\param iFrom	Index of the server that replied, -1 on timeout
+ *
+ *	A reply takes the server back if it was ejected. It gives a round trip time sample
+ *	only if it came from the server of a request that wasn't retransmitted (Karn), since
+ *	otherwise it can't be told which transmission it answers, and if it isn't a vector
+ *	or stream request, whose time is mostly transfer. VSLCL_EJECT_FAILURES
+ *	timeouts in a row eject a server.
+ */
+static void vslcl_settle(vslcl_ctx *ctx, struct vslcl_pending *slot, int iFrom)
+{
+	struct vslcl_server *srv;
+	struct timespec now;
+	int iServer = slot->iServer;
+
+	if (slot->iHedgeServer >= 0) {
+		ctx->servers[slot->iHedgeServer].iOutstanding--;
+		slot->iHedgeServer = -1;
+	}
+	if (iServer < 0) return;
+	srv = &ctx->servers[iServer];
+	slot->iServer = -1;
+	srv->iOutstanding--;
+
+	if (iFrom >= 0) {
+		if ((iFrom == iServer) && (slot->iRetries == 0) && (slot->vector == NULL) && (slot->stream == NULL)) {
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			vslcl_rtt_sample(srv, (now.tv_sec - slot->sent.tv_sec) * 1000000L +
+					      (now.tv_nsec - slot->sent.tv_nsec) / 1000L);
+		}
+		ctx->servers[iFrom].iFailures = 0;
+		ctx->servers[iFrom].iEjected = 0;
+	}
+	else if ((++srv->iFailures >= VSLCL_EJECT_FAILURES) && !srv->iEjected) {
+		srv->iEjected = 1;
+		clock_gettime(CLOCK_MONOTONIC, &srv->ejected);
+		vslcl_deadline(&srv->probe, VSLCL_PROBE_MS);
+	}
+}
+
+/**
+ *	\brief Send the operands of a vector request
+ *	\param ctx	The context
+ *	\param srv	The server
+ *	\param uRequestId	Request ID
+ *	\param fid	Function id
+ *	\param vector	Operands
+ *
+ *	A and B are sent as one sequence of words, split into fragments of PL_VEC_WORDS.
+ */
+static void vslcl_send_vector(vslcl_ctx *ctx, struct sockaddr_in *srv, unsigned int uRequestId, unsigned int fid,
+			      struct vslcl_vector *vector)
+{
+	unsigned int i, uPos, uWords = vector->uA + vector->uB, words[PL_VEC_WORDS];
+	struct pl_vector hdr;
+	char sndpacket[PL_MAX_DATAGRAM];
+
+	memset(&hdr, 0x00, sizeof(hdr));
+	hdr.type = PL_PTYPE_VREQ;
+	hdr.mode = PL_MODE_CLN;
+	hdr.function_id = fid;
+	hdr.request_id = uRequestId;
+	hdr.total = PL_VEC_FRAGMENTS(uWords);
+	memcpy(hdr.dim, vector->dim, sizeof(hdr.dim));
+
+	for (hdr.seq = 0; hdr.seq < hdr.total; hdr.seq++) {
+		uPos = hdr.seq * PL_VEC_WORDS;
+		hdr.count = (uWords - uPos < PL_VEC_WORDS) ? uWords - uPos : PL_VEC_WORDS;
+		for (i = 0; i < hdr.count; i++, uPos++)
+			words[i] = (uPos < vector->uA) ? vector->a[uPos] : vector->b[uPos - vector->uA];
+		pl_make_vector(&hdr, words, sndpacket, PL_MAX_DATAGRAM);
+		sendto(ctx->iSocket, sndpacket, PL_VEC_PACKETSIZE(hdr.count), 0, (struct sockaddr*)srv, sizeof(struct sockaddr));
+	}
+}
+
+/**
+ *	\brief Ask for the result fragments of a vector request not received yet
+ *	\param ctx	The context
+ *	\param srv	The server
+ *	\param uRequestId	Request ID
+ *	\param fid	Function id
+ *	\param vector	Operands and results received
+ */
+static void vslcl_send_ack(vslcl_ctx *ctx, struct sockaddr_in *srv, unsigned int uRequestId, unsigned int fid,
+			   struct vslcl_vector *vector)
+{
+	struct pl_vector hdr;
+	char sndpacket[PL_MAX_DATAGRAM];
+
+	memset(&hdr, 0x00, sizeof(hdr));
+	hdr.type = PL_PTYPE_VACK;
+	hdr.mode = PL_MODE_CLN;
+	hdr.function_id = fid;
+	hdr.request_id = uRequestId;
+	hdr.total = PL_VEC_FRAGMENTS(vector->uResults);
+	hdr.count = (hdr.total + 31) / 32;
+	memcpy(hdr.dim, vector->dim, sizeof(hdr.dim));
+	pl_make_vector(&hdr, vector->map, sndpacket, PL_MAX_DATAGRAM);
+	sendto(ctx->iSocket, sndpacket, PL_VEC_PACKETSIZE(hdr.count), 0, (struct sockaddr*)srv, sizeof(struct sockaddr));
+}
+
+/**
+ *	\brief Send a packet of an aggregation stream
+ *	\param ctx	The context
+ *	\param srv	The server
+ *	\param uRequestId	Request ID
+ *	\param op	The stream operation
+ *	\param uBase	Chunks acknowledged in a row, see struct vslcl_stream_op
+ *	\param map	Chunks acknowledged after \a uBase
+ *
+ *	Of a window, the chunks the server acknowledged are left out; the last one always
+ *	goes out, so the server answers with an acknowledgment. Without the lock, \a uBase
+ *	and \a map must be a copy, the receiver updates those of \a op.
+ */
+static void vslcl_send_stream(vslcl_ctx *ctx, struct sockaddr_in *srv, unsigned int uRequestId, const struct vslcl_stream_op *op,
+			      unsigned int uBase, const unsigned int *map)
+{
+	struct vslcl_stream *stream = op->stream;
+	unsigned int uOffset, uPos, words[PL_STREAM_OPEN_WORDS];
+	struct pl_stream hdr;
+	char sndpacket[PL_MAX_DATAGRAM];
+
+	memset(&hdr, 0x00, sizeof(hdr));
+	hdr.type = op->type;
+	hdr.mode = PL_MODE_CLN;
+	hdr.function_id = PL_FID_AGGREGATE;
+	hdr.request_id = uRequestId;
+	hdr.stream_id = stream->uStreamId;
+
+	if (op->type != PL_PTYPE_SDATA) {
+		if (op->type == PL_PTYPE_SOPEN) {
+			words[0] = (unsigned int)stream->iLo;
+			words[1] = stream->uWidth;
+			words[2] = stream->uBuckets;
+			hdr.count = PL_STREAM_OPEN_WORDS;
+		}
+		else hdr.seq = stream->uNext;
+		pl_make_stream(&hdr, words, sndpacket, PL_MAX_DATAGRAM);
+		sendto(ctx->iSocket, sndpacket, PL_STREAM_PACKETSIZE(hdr.count), 0, (struct sockaddr*)srv, sizeof(struct sockaddr));
+		return;
+	}
+
+	hdr.end = op->uEnd;
+	for (hdr.seq = op->uFirst; hdr.seq < op->uEnd; hdr.seq++) {
+		uOffset = hdr.seq - uBase;
+		if ((int)uOffset < 0) continue;
+		if ((uOffset < PL_STREAM_WINDOW) && (map[uOffset / 32] & (1U << (uOffset % 32))) && (hdr.seq + 1 < op->uEnd)) continue;
+		uPos = (hdr.seq - op->uFirst) * PL_STREAM_WORDS;
+		hdr.count = (op->uValues - uPos < PL_STREAM_WORDS) ? op->uValues - uPos : PL_STREAM_WORDS;
+		pl_make_stream(&hdr, (const unsigned int *)&op->values[uPos], sndpacket, PL_MAX_DATAGRAM);
+		sendto(ctx->iSocket, sndpacket, PL_STREAM_PACKETSIZE(hdr.count), 0, (struct sockaddr*)srv, sizeof(struct sockaddr));
+	}
+}
+
+/**
+ *	\brief Send a typed request
+ *	\param ctx	The context
+ *	\param srv	The server
+ *	\param uRequestId	Request ID
+ *	\param fid	Function id
+ *	\param typed	Operands
+ */
+static void vslcl_send_typed(vslcl_ctx *ctx, struct sockaddr_in *srv, unsigned int uRequestId, unsigned int fid,
+			     struct vslcl_typed *typed)
+{
+	struct pl_typed packet;
+	char sndpacket[PL_MAX_DATAGRAM];
+	unsigned int i;
+
+	packet.count = typed->n;
+	packet.request_id = uRequestId;
+	packet.otype = typed->otype;
+	pl_create_typed_request(&packet);
+	for (i = 0; i < typed->n; i++) {
+		packet.entry[i].function_id = fid;
+		memset(packet.entry[i].data, 0x00, sizeof(packet.entry[i].data));
+		packet.entry[i].data[0] = typed->op1[i];
+		if (typed->op2 != NULL) packet.entry[i].data[1] = typed->op2[i];
+	}
+	pl_make_typed(&packet, sndpacket, PL_MAX_DATAGRAM);
+	sendto(ctx->iSocket, sndpacket, PL_TYPED_PACKETSIZE(typed->n), 0, (struct sockaddr*)srv, sizeof(struct sockaddr));
+}
+
+/**
+ *	\brief Send a request
+ *	\param ctx	The context
+ *	\param srv	The server
+ *	\param uRequestId	Request ID
+ *	\param entry	Function id and operands
+ *	\param payload	Bytes sent behind the request ID, NULL for none
+ *	\param len	Number of bytes in \a payload, at most PL_MAX_DATAGRAM - PL_PACKETSIZE
+ *	\param vector	Operands of a vector request, NULL for others
+ */
+static void vslcl_send(vslcl_ctx *ctx, struct sockaddr_in *srv, unsigned int uRequestId, struct pl_batch_entry *entry,
+		       const unsigned char *payload, unsigned int len, struct vslcl_vector *vector)
+{
+	unsigned int i = 0;
+	struct pl_data vsls_data;
+	char sndpacket[PL_MAX_DATAGRAM];
+
+	if (vector != NULL) {
+		vslcl_send_vector(ctx, srv, uRequestId, entry->function_id, vector);
+		return;
+	}
+
+	// create request packet...
+	pl_create_request(&vsls_data);
+
+	// set function id and request id
+	PLM_FUNCTION_ID(vsls_data) = entry->function_id;
+	PLM_REQUEST_ID(vsls_data) = uRequestId;
+
+	// set operands
+	for (i=0; i < PL_OPERAND_COUNT; i++) PLM_OPERAND(vsls_data, i) = entry->data[i];
+
+	// serialize packet and send it
+	pl_make_packet(&vsls_data, sndpacket, PL_PACKETSIZE);
+	if (payload != NULL) memcpy(&sndpacket[PL_PACKETSIZE], payload, len);
+	else len = 0;
+	sendto(ctx->iSocket, sndpacket, PL_PACKETSIZE + len, 0, (struct sockaddr*)srv, sizeof(struct sockaddr));
+}
+
+/**
+ *	\brief Probe an ejected server
+ *	\param ctx	The context, locked by the caller
+ *	\param iServer	Index of the server
+ *
+ *	Every VSLCL_PROBE_MS an ejected server gets a probe, a multiplication nobody waits
+ *	for, so no caller has to sit out a timeout on it. A reply takes the server back (see
+ *	vslcl_deliver()), a probe still unanswered at the next probe time counts as timeout.
+ *	Probes are checked here only, i.e. whenever a request is sent.
+ */
+static void vslcl_probe(vslcl_ctx *ctx, int iServer)
+{
+	struct vslcl_server *srv = &ctx->servers[iServer];
+	struct vslcl_pending *slot;
+	struct pl_batch_entry entry;
+
+	if (vslcl_remaining_us(&srv->probe) > 0) return;
+
+	if (srv->iProbeSlot >= 0) {
+		slot = &ctx->pending[srv->iProbeSlot];
+		srv->iProbeSlot = -1;
+		vslcl_settle(ctx, slot, -1);
+		vslcl_release(ctx, slot);
+	}
+
+	vslcl_deadline(&srv->probe, VSLCL_PROBE_MS);
+	slot = vslcl_reserve(ctx, 0);
+	if (slot == NULL) return;
+	slot->iProbe = 1;
+	slot->iServer = iServer;
+	clock_gettime(CLOCK_MONOTONIC, &slot->sent);
+	srv->iOutstanding++;
+	srv->iProbeSlot = slot - ctx->pending;
+
+	memset(&entry, 0x00, sizeof(entry));
+	entry.type = PL_PTYPE_REQ;
+	entry.function_id = PL_FID_MUL;
+	vslcl_send(ctx, &srv->addr, slot->uRequestId, &entry, NULL, 0, NULL);
+}
+
+/**
+ *	\brief Choose the server for the next request
+ *	\param ctx	The context, locked by the caller
+ *	\return		Index of the server
+ *
+ *	Power of two choices: of two servers picked at random, the one with fewer requests
+ *	outstanding, weighted by its reply time, gets the request. That spreads load almost
+ *	as well as asking every server, at constant cost. Ejected servers only get probes; if
+ *	all servers are ejected, the one ejected longest ago is used.
+ */
+static int vslcl_choose(vslcl_ctx *ctx)
+{
+	struct vslcl_server *srv, *oldest = NULL;
+	int i, a, b, iCount = 0, iOldest = -1;
+	int candidate[VSLCL_MAX_SERVERS];
+	long lScoreA, lScoreB;
+
+	if (ctx->iServerCount == 1) return 0;
+
+	for (i = 0; i < ctx->iServerCount; i++) {
+		srv = &ctx->servers[i];
+		if (!srv->iEjected) {
+			candidate[iCount++] = i;
+			continue;
+		}
+		vslcl_probe(ctx, i);
+		if ((oldest == NULL) || (srv->ejected.tv_sec < oldest->ejected.tv_sec) ||
+		    ((srv->ejected.tv_sec == oldest->ejected.tv_sec) && (srv->ejected.tv_nsec < oldest->ejected.tv_nsec))) {
+			oldest = srv;
+			iOldest = i;
+		}
+	}
+	if (iCount == 0) return iOldest;
+	if (iCount == 1) return candidate[0];
+
+	// xorshift32
+	ctx->uRandom ^= ctx->uRandom << 13;
+	ctx->uRandom ^= ctx->uRandom >> 17;
+	ctx->uRandom ^= ctx->uRandom << 5;
+	a = ctx->uRandom % iCount;
+	b = (a + 1 + (ctx->uRandom >> 16) % (iCount - 1)) % iCount;
+	a = candidate[a];
+	b = candidate[b];
+
+	lScoreA = (ctx->servers[a].iOutstanding + 1) * (ctx->servers[a].lSrtt + 1);
+	lScoreB = (ctx->servers[b].iOutstanding + 1) * (ctx->servers[b].lSrtt + 1);
+	return (lScoreB < lScoreA) ? b : a;
+}
+
+/**
+ *	\brief Choose the server for a duplicate of a request
+ *	\param ctx	The context, locked by the caller
+ *	\param iServer	Index of the server the request went to
+ *	\return		Index of the best other server that isn't ejected, -1 if there is none
+ */
+static int vslcl_choose_other(vslcl_ctx *ctx, int iServer)
+{
+	struct vslcl_server *srv;
+	int i, iBest = -1;
+	long lScore, lBest = 0;
+
+	for (i = 0; i < ctx->iServerCount; i++) {
+		srv = &ctx->servers[i];
+		if ((i == iServer) || srv->iEjected) continue;
+		lScore = (srv->iOutstanding + 1) * (srv->lSrtt + 1);
+		if ((iBest < 0) || (lScore < lBest)) {
+			iBest = i;
+			lBest = lScore;
+		}
+	}
+	return iBest;
+}
+
+/**
+ *	\brief Set the timers of a request that was just sent
+ *	\param ctx	The context, locked by the caller
+ *	\param slot	The request's slot
+ *
+ *	The retransmission timeout doubles with every retransmission, vector requests and
+ *	windows of stream chunks get VSLCL_VEC_FRAGMENT_US per fragment or chunk on top. A
+ *	duplicate is due once the first transmission took longer than 95 % of the server's
+ *	replies, if hedging is on and there is another server; vector, stream and typed
+ *	requests aren't duplicated.
+ */
+static void vslcl_arm(vslcl_ctx *ctx, struct vslcl_pending *slot)
+{
+	struct vslcl_server *srv = &ctx->servers[slot->iServer];
+	struct vslcl_vector *vector = slot->vector;
+	long lUs = vslcl_rto(srv) << slot->iRetries, lP95;
+
+	if (lUs > VSLCL_RTO_MAX_MS * 1000L) lUs = VSLCL_RTO_MAX_MS * 1000L;
+	if (vector != NULL)
+		lUs += (long)(PL_VEC_FRAGMENTS(vector->uA + vector->uB) + PL_VEC_FRAGMENTS(vector->uResults)) * VSLCL_VEC_FRAGMENT_US;
+	if (slot->stream != NULL) lUs += (long)(slot->stream->uEnd - slot->stream->uFirst) * VSLCL_VEC_FRAGMENT_US;
+	slot->resend = slot->sent;
+	slot->resend.tv_sec += lUs / 1000000L;
+	slot->resend.tv_nsec += (lUs % 1000000L) * 1000L;
+	if (slot->resend.tv_nsec >= 1000000000L) {
+		slot->resend.tv_sec++;
+		slot->resend.tv_nsec -= 1000000000L;
+	}
+
+	slot->iHedgeArmed = 0;
+	if (!ctx->iHedging || slot->iHedged || (slot->iRetries > 0) || (ctx->iServerCount < 2) || (vector != NULL) ||
+	    (slot->stream != NULL) || (slot->typed != NULL)) return;
+	lP95 = vslcl_p95(srv);
+	if ((lP95 < 0) || (lP95 >= lUs)) return;
+	slot->hedge = slot->sent;
+	slot->hedge.tv_nsec += lP95 * 1000L;
+	slot->hedge.tv_sec += slot->hedge.tv_nsec / 1000000000L;
+	slot->hedge.tv_nsec %= 1000000000L;
+	slot->iHedgeArmed = 1;
+}
+
+/**
+ *	\brief Get the next point in time a request needs attention
+ *	\param slot	The request's slot
+ *	\param next	Receives the earliest of deadline, retransmission and duplicate
+ */
+static void vslcl_next(struct vslcl_pending *slot, struct timespec *next)
+{
+	*next = slot->deadline;
+	if (slot->iServer < 0) return;
+	if ((slot->resend.tv_sec < next->tv_sec) ||
+	    ((slot->resend.tv_sec == next->tv_sec) && (slot->resend.tv_nsec < next->tv_nsec))) *next = slot->resend;
+	if (!slot->iHedgeArmed) return;
+	if ((slot->hedge.tv_sec < next->tv_sec) ||
+	    ((slot->hedge.tv_sec == next->tv_sec) && (slot->hedge.tv_nsec < next->tv_nsec))) *next = slot->hedge;
+}
+
+/**
+ *	\brief Start a vector request again under a new ID
+ *	\param ctx	The context, locked by the caller
+ *	\param slot	The request's slot
+ *
+ *	The new server doesn't know the request, and fragments of the old one may still
+ *	arrive. The new ID maps to the same slot, and the context's next ID moves beyond it
+ *	so it isn't handed out again soon.
+ */
+static void vslcl_vector_restart(vslcl_ctx *ctx, struct vslcl_pending *slot)
+{
+	slot->uRequestId += VSLCL_MAX_INFLIGHT;
+	if (slot->uRequestId == 0) slot->uRequestId += VSLCL_MAX_INFLIGHT;
+	if ((int)(ctx->uNextId - slot->uRequestId) <= 0) ctx->uNextId = slot->uRequestId + 1;
+	slot->vector->uReceived = 0;
+	memset(slot->vector->map, 0x00, (PL_VEC_FRAGMENTS(slot->vector->uResults) + 31) / 32 * sizeof(unsigned int));
+}
+
+/**
+ *	\brief Retransmit or duplicate a request whose time has come
+ *	\param ctx	The context, locked by the caller
+ *	\param slot	The request's slot, sent and not answered yet
+ *
+ *	A retransmission counts as timeout at the server the request went to and goes to a
+ *	server chosen anew, so requests fail over to other servers. After VSLCL_MAX_RETRIES
+ *	retransmissions the request just waits for its deadline. A duplicate goes to the best
+ *	other server; the first reply wins, the other one is dropped.
+ *
+ *	A vector request keeps its ID, and so the fragments and results the server has
+ *	already, unless it moves to another server, see vslcl_vector_restart(). Its
+ *	retransmission is an acknowledgment followed by the operands if no result arrived.
+ *	A stream request stays with the stream's server, it is sent again as a whole except
+ *	for the chunks acknowledged already.
+ */
+static void vslcl_resend(vslcl_ctx *ctx, struct vslcl_pending *slot)
+{
+	int iServer;
+
+	if (slot->iHedgeArmed && (vslcl_remaining_us(&slot->hedge) == 0)) {
+		slot->iHedgeArmed = 0;
+		slot->iHedged = 1;
+		iServer = vslcl_choose_other(ctx, slot->iServer);
+		if (iServer >= 0) {
+			slot->iHedgeServer = iServer;
+			ctx->servers[iServer].iOutstanding++;
+			vslcl_send(ctx, &ctx->servers[iServer].addr, slot->uRequestId, &slot->entry, slot->payload, slot->uPayloadLen, NULL);
+		}
+	}
+
+	if (vslcl_remaining_us(&slot->resend) > 0) return;
+	if (slot->iRetries >= VSLCL_MAX_RETRIES) {
+		slot->resend = slot->deadline;
+		return;
+	}
+	iServer = slot->iServer;
+	vslcl_settle(ctx, slot, -1);
+	slot->iRetries++;
+	slot->iServer = (slot->stream != NULL) ? slot->stream->stream->iServer : vslcl_choose(ctx);
+	if ((slot->vector != NULL) && (slot->iServer != iServer)) vslcl_vector_restart(ctx, slot);
+	ctx->servers[slot->iServer].iOutstanding++;
+	clock_gettime(CLOCK_MONOTONIC, &slot->sent);
+	vslcl_arm(ctx, slot);
+	if (slot->stream != NULL) {
+		vslcl_send_stream(ctx, &ctx->servers[slot->iServer].addr, slot->uRequestId, slot->stream, slot->stream->uBase,
+				  slot->stream->map);
+		return;
+	}
+	if (slot->typed != NULL) {
+		vslcl_send_typed(ctx, &ctx->servers[slot->iServer].addr, slot->uRequestId, slot->entry.function_id, slot->typed);
+		return;
+	}
+	if (slot->vector != NULL) {
+		vslcl_send_ack(ctx, &ctx->servers[slot->iServer].addr, slot->uRequestId, slot->entry.function_id, slot->vector);
+		if (slot->vector->uReceived > 0) return;
+	}
+	vslcl_send(ctx, &ctx->servers[slot->iServer].addr, slot->uRequestId, &slot->entry, slot->payload, slot->uPayloadLen,
+		   slot->vector);
+}
+
+/**
+ *	\brief Queue a completed asynchronous request
+ *	\param ctx	The context, locked by the caller
+ *	\param slot	The request's slot
+ *	\param iStatus	Zero or an error code
+ *
+ *	The first completion in an empty queue makes the context's descriptor readable.
+ */
+static void vslcl_complete(vslcl_ctx *ctx, struct vslcl_pending *slot, int iStatus)
+{
+	int iSlot = slot - ctx->pending;
+
+	slot->iDone = 1;
+	slot->iStatus = iStatus;
+	slot->iNext = -1;
+	ctx->iAsync--;
+	if (ctx->iDoneTail < 0) {
+		ctx->iDoneHead = iSlot;
+#if defined VSLCL_HAVE_EVENTFD
+		if (ctx->iEvent >= 0) eventfd_write(ctx->iEvent, 1);
+#endif
+	}
+	else ctx->pending[ctx->iDoneTail].iNext = iSlot;
+	ctx->iDoneTail = iSlot;
+}
+
+/**
+ *	\brief Run the timers of asynchronous requests
+ *	\param ctx	The context, locked by the caller
+ *	\return		Milliseconds until the next timer, at most VSLCL_TIMEOUT_MS
+ *
+ *	Requests whose deadline has passed complete with a timeout, others are retransmitted
+ *	or duplicated when due, see vslcl_resend().
+ */
+static int vslcl_timers(vslcl_ctx *ctx)
+{
+	struct vslcl_pending *slot;
+	struct timespec next;
+	long lUs, lNext = VSLCL_TIMEOUT_MS * 1000L;
+	int i;
+
+	if (ctx->iAsync == 0) return VSLCL_TIMEOUT_MS;
+	for (i = 0; i < VSLCL_MAX_INFLIGHT; i++) {
+		slot = &ctx->pending[i];
+		// requests in the open batch are linked there, their timers start once sent
+		if ((slot->uRequestId == 0) || (slot->cb == NULL) || slot->iDone || slot->iQueued) continue;
+		if (vslcl_remaining_us(&slot->deadline) == 0) {
+			vslcl_settle(ctx, slot, -1);
+			vslcl_complete(ctx, slot, -EVSLCL_NET_TIMEOUT);
+			continue;
+		}
+		vslcl_next(slot, &next);
+		if (vslcl_remaining_us(&next) == 0) {
+			vslcl_resend(ctx, slot);
+			vslcl_next(slot, &next);
+		}
+		lUs = vslcl_remaining_us(&next);
+		if (lUs < lNext) lNext = lUs;
+	}
+	// round up, waking early would only spin
+	return (int)((lNext + 999) / 1000);
+}
+
+/**
+ *	\brief Get the status of a reply
+ *	\param reply	The reply
+ *	\return		Zero for a response, the negated error code of an error packet
+ */
+static int vslcl_status(struct pl_data reply)
+{
+	if (PLM_PACKET_TYPE(reply) == PL_PTYPE_ERR) return -PLM_OPERAND(reply, 0);
+	if (PLM_PACKET_TYPE(reply) == PL_PTYPE_RSP) return EVSLCL_NOERROR;
+	return -EVSLCL_UNKNOWN_ERROR;
+}
+
+/**
+ *	\brief Send the open batch
+ *	\param ctx	The context, locked by the caller
+ *
+ *	The lock is dropped while sending, callers have to check the context's state again
+ *	afterwards.
+ */
+static void vslcl_flush_batch(vslcl_ctx *ctx)
+{
+	struct pl_batch batch;
+	struct vslcl_pending *slot;
+	struct sockaddr_in addr;
+	struct timespec now;
+	char sndpacket[PL_MAX_DATAGRAM];
+	unsigned int uBatchId;
+	int i, iLen, iServer;
+
+	if (ctx->iBatchCount == 0) return;
+
+	// the batch packet gets the first request's ID and goes to one server
+	uBatchId = ctx->pending[ctx->iBatchHead].uRequestId;
+	iServer = vslcl_choose(ctx);
+	addr = ctx->servers[iServer].addr;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	batch.count = 0;
+	for (i = ctx->iBatchHead; i >= 0; i = slot->iBatchNext) {
+		slot = &ctx->pending[i];
+		batch.entry[batch.count++] = slot->entry;
+		slot->iQueued = 0;
+		slot->uBatchId = uBatchId;
+		slot->iServer = iServer;
+		slot->sent = now;
+		vslcl_arm(ctx, slot);
+	}
+	ctx->servers[iServer].iOutstanding += batch.count;
+	ctx->iBatchCount = 0;
+	ctx->iBatchHead = ctx->iBatchTail = -1;
+	pl_create_batch_request(&batch);
+	PLM_REQUEST_ID(batch) = uBatchId;
+	iLen = PL_BATCH_PACKETSIZE(batch.count);
+	pl_make_batch(&batch, sndpacket, PL_MAX_DATAGRAM);
+
+	pthread_mutex_unlock(&ctx->lock);
+	sendto(ctx->iSocket, sndpacket, iLen, 0, (struct sockaddr*)&addr, sizeof(struct sockaddr));
+	pthread_mutex_lock(&ctx->lock);
+}
+
+/**
+ *	\brief Send a packet of an aggregation stream without the lock
+ *	\param ctx	The context, locked by the caller
+ *	\param slot	The stream request's slot
+ *
+ *	The acknowledged chunks are copied first, the receiver may update them while the
+ *	lock is dropped for sending, see vslcl_flush_batch().
+ */
+static void vslcl_send_stream_unlocked(vslcl_ctx *ctx, struct vslcl_pending *slot)
+{
+	struct vslcl_stream_op *op = slot->stream;
+	struct sockaddr_in addr = ctx->servers[slot->iServer].addr;
+	unsigned int uRequestId = slot->uRequestId, uBase = op->uBase, map[PL_STREAM_WINDOW / 32];
+
+	memcpy(map, op->map, sizeof(map));
+	pthread_mutex_unlock(&ctx->lock);
+	vslcl_send_stream(ctx, &addr, uRequestId, op, uBase, map);
+	pthread_mutex_lock(&ctx->lock);
+}
+
+/**
+ *	\brief Send a request now or add it to the open batch
+ *	\param ctx	The context, locked by the caller
+ *	\param slot	The request's slot
+ *	\param fid	Function id
+ *	\param param	PL_OPERAND_COUNT operands
+ *
+ *	The lock is dropped while sending, see vslcl_flush_batch(). Requests with payload,
+ *	vector, stream and typed requests don't fit into batch entries and are always sent
+ *	alone, stream requests to the stream's server.
+ */
+static void vslcl_submit(vslcl_ctx *ctx, struct vslcl_pending *slot, int fid, int *param)
+{
+	unsigned int i = 0, uRequestId = slot->uRequestId;
+	struct pl_batch_entry entry;
+	struct sockaddr_in addr;
+
+	entry.type = PL_PTYPE_REQ;
+	entry.function_id = fid;
+	for (i=0; i < PL_OPERAND_COUNT; i++) entry.data[i] = param[i];
+	slot->entry = entry;
+
+	if ((ctx->iBatchWindow == 0) || (slot->payload != NULL) || (slot->vector != NULL) || (slot->stream != NULL) ||
+	    (slot->typed != NULL)) {
+		slot->iServer = (slot->stream != NULL) ? slot->stream->stream->iServer : vslcl_choose(ctx);
+		ctx->servers[slot->iServer].iOutstanding++;
+		clock_gettime(CLOCK_MONOTONIC, &slot->sent);
+		vslcl_arm(ctx, slot);
+		if (slot->stream != NULL) {
+			vslcl_send_stream_unlocked(ctx, slot);
+			return;
+		}
+		addr = ctx->servers[slot->iServer].addr;
+		pthread_mutex_unlock(&ctx->lock);
+		if (slot->typed != NULL) vslcl_send_typed(ctx, &addr, uRequestId, fid, slot->typed);
+		else vslcl_send(ctx, &addr, uRequestId, &entry, slot->payload, slot->uPayloadLen, slot->vector);
+		pthread_mutex_lock(&ctx->lock);
+		return;
+	}
+
+	// the first request opens the batch and starts the window
+	slot->iQueued = 1;
+	if (ctx->iBatchCount == 0) {
+		ctx->iBatchHead = slot - ctx->pending;
+		vslcl_deadline_us(&ctx->batchDeadline, ctx->iBatchWindow);
+	}
+	else ctx->pending[ctx->iBatchTail].iBatchNext = slot - ctx->pending;
+	ctx->iBatchTail = slot - ctx->pending;
+	ctx->iBatchCount++;
+	if (ctx->iBatchCount >= ctx->iBatchMax) vslcl_flush_batch(ctx);
+}
+
+/**
+ *	\brief Hand a reply to its request
+ *	\param ctx	The context, locked by the caller
+ *	\param slot	The request's slot
+ *	\param reply	The reply
+ *	\param iFrom	Index of the server that sent the reply
+ */
+static void vslcl_deliver(vslcl_ctx *ctx, struct vslcl_pending *slot, struct pl_data *reply, int iFrom)
+{
+	if (slot->iProbe) {
+		ctx->servers[slot->iServer].iProbeSlot = -1;
+		vslcl_settle(ctx, slot, iFrom);
+		vslcl_release(ctx, slot);
+		return;
+	}
+	vslcl_settle(ctx, slot, iFrom);
+	slot->reply = *reply;
+	if (slot->cb != NULL) vslcl_complete(ctx, slot, vslcl_status(*reply));
+	else slot->iDone = 1;
+}
+
+/**
+ *	\brief Hand the entries of a batch reply to their requests
+ *	\param ctx	The context, locked by the caller
+ *	\param batch	The batch reply
+ *	\param iFrom	Index of the server that sent the reply
+ *
+ *	Entries are matched along the batch's links. A request that was given up and whose
+ *	slot was reused since ends the walk, the remaining requests are retransmitted.
+ */
+static void vslcl_deliver_batch(vslcl_ctx *ctx, struct pl_batch *batch, int iFrom)
+{
+	unsigned int i = 0, j = 0, uBatchId = batch->request_id;
+	struct vslcl_pending *slot;
+	struct pl_data reply;
+	int iSlot = uBatchId % VSLCL_MAX_INFLIGHT;
+
+	if ((uBatchId == 0) || (ctx->pending[iSlot].uRequestId != uBatchId)) return;
+	for (i = 0; (i < batch->count) && (iSlot >= 0); i++, iSlot = slot->iBatchNext) {
+		slot = &ctx->pending[iSlot];
+		if ((slot->uRequestId == 0) || (slot->uBatchId != uBatchId)) break;
+		if (slot->iDone) continue;
+		reply.type = batch->entry[i].type;
+		reply.mode = batch->mode;
+		reply.function_id = batch->entry[i].function_id;
+		for (j = 0; j < PL_OPERAND_COUNT; j++) PLM_OPERAND(reply, j) = batch->entry[i].data[j];
+		reply.request_id = slot->uRequestId;
+		vslcl_deliver(ctx, slot, &reply, iFrom);
+	}
+}
+
+/**
+ *	\brief Take a result fragment of a vector request
+ *	\param ctx	The context, locked by the caller
+ *	\param slot	The request's slot
+ *	\param hdr	Header of the fragment
+ *	\param words	The results it carries
+ *	\param iFrom	Index of the server that sent the fragment
+ *
+ *	Fragments that don't fit the request and duplicates are dropped. The last missing
+ *	fragment completes the request like a response packet.
+ */
+static void vslcl_deliver_vector(vslcl_ctx *ctx, struct vslcl_pending *slot, struct pl_vector *hdr, unsigned int *words, int iFrom)
+{
+	struct vslcl_vector *vector = slot->vector;
+	unsigned int uTotal = PL_VEC_FRAGMENTS(vector->uResults);
+	struct pl_data reply;
+
+	if ((hdr->total != uTotal) || (hdr->seq >= uTotal) || (hdr->function_id != slot->entry.function_id)) return;
+	if (hdr->count != ((hdr->seq + 1 < uTotal) ? PL_VEC_WORDS : vector->uResults - hdr->seq * PL_VEC_WORDS)) return;
+	if (vector->map[hdr->seq / 32] & (1U << (hdr->seq % 32))) return;
+	vector->map[hdr->seq / 32] |= 1U << (hdr->seq % 32);
+	memcpy(&vector->result[hdr->seq * PL_VEC_WORDS], words, hdr->count * sizeof(unsigned int));
+	if (++vector->uReceived < uTotal) return;
+
+	memset(&reply, 0x00, sizeof(reply));
+	reply.type = PL_PTYPE_RSP;
+	reply.mode = PL_MODE_SRV;
+	reply.function_id = hdr->function_id;
+	reply.request_id = hdr->request_id;
+	vslcl_deliver(ctx, slot, &reply, iFrom);
+}
+
+/**
+ *	\brief Take the reply to a stream request
+ *	\param ctx	The context, locked by the caller
+ *	\param slot	The request's slot
+ *	\param hdr	Header of the reply
+ *	\param words	Its words
+ *	\param iFrom	Index of the server that sent the reply
+ *
+ *	An open request is done with its acknowledgment, a window once all its chunks were
+ *	acknowledged and a close request with the result. An acknowledgment reporting gaps in
+ *	the window gets the missing chunks sent again right away, once per window, by the
+ *	thread waiting for the window, see vslcl_wait(); later gaps are left to the
+ *	retransmission timeout. Replies that don't fit are dropped.
+ */
+static void vslcl_deliver_stream(vslcl_ctx *ctx, struct vslcl_pending *slot, struct pl_stream *hdr, unsigned int *words, int iFrom)
+{
+	struct vslcl_stream_op *op = slot->stream;
+	struct pl_data reply;
+
+	if ((hdr->function_id != PL_FID_AGGREGATE) || (hdr->stream_id != op->stream->uStreamId) || (iFrom != op->stream->iServer)) return;
+	if (hdr->type == PL_PTYPE_SRSP) {
+		if ((op->type != PL_PTYPE_SCLOSE) || (pl_unpack_aggregate(words, hdr->count, op->result) < 0)) return;
+	}
+	else if (hdr->count < PL_STREAM_WINDOW / 32) return;
+	else if (op->type == PL_PTYPE_SDATA) {
+		// acknowledgments may overtake each other, an older one tells nothing new
+		if ((int)(hdr->seq - op->uBase) < 0) return;
+		op->uBase = hdr->seq;
+		memcpy(op->map, words, sizeof(op->map));
+		if ((int)(op->uBase - op->uEnd) < 0) {
+			if (!op->iFast) op->iFast = op->iFastDue = 1;
+			return;
+		}
+	}
+	else if (op->type != PL_PTYPE_SOPEN) return;
+
+	memset(&reply, 0x00, sizeof(reply));
+	reply.type = PL_PTYPE_RSP;
+	reply.mode = PL_MODE_SRV;
+	reply.function_id = hdr->function_id;
+	reply.request_id = hdr->request_id;
+	vslcl_deliver(ctx, slot, &reply, iFrom);
+}
+
+/**
+ *	\brief Take the reply to a typed request
+ *	\param ctx	The context, locked by the caller
+ *	\param slot	The request's slot
+ *	\param reply	The typed response
+ *	\param iFrom	Index of the server that sent the reply
+ *
+ *	Results and statuses are copied straight into place, the request completes like a
+ *	response packet. Replies that don't fit the request are dropped.
+ */
+static void vslcl_deliver_typed(vslcl_ctx *ctx, struct vslcl_pending *slot, struct pl_typed *reply, int iFrom)
+{
+	struct vslcl_typed *typed = slot->typed;
+	struct pl_data data;
+	unsigned int i;
+
+	if ((reply->otype != typed->otype) || (reply->count != typed->n)) return;
+	for (i = 0; i < reply->count; i++)
+		if (reply->entry[i].function_id != slot->entry.function_id) return;
+
+	memset(&data, 0x00, sizeof(data));
+	data.type = PL_PTYPE_RSP;
+	for (i = 0; i < reply->count; i++) {
+		if (reply->entry[i].type == PL_PTYPE_RSP) {
+			typed->result[i] = reply->entry[i].data[0];
+			if (typed->status != NULL) typed->status[i] = EVSLCL_NOERROR;
+			continue;
+		}
+		// the request fails with the error of its first failed operation
+		memset(&typed->result[i], 0x00, sizeof(union pl_value));
+		if (typed->status != NULL) typed->status[i] = -reply->entry[i].data[0].i32;
+		if (data.type == PL_PTYPE_RSP) {
+			data.type = PL_PTYPE_ERR;
+			data.data[0] = reply->entry[i].data[0].i32;
+		}
+	}
+	typed->iAnswered = 1;
+	data.mode = PL_MODE_SRV;
+	data.function_id = slot->entry.function_id;
+	data.request_id = reply->request_id;
+	vslcl_deliver(ctx, slot, &data, iFrom);
+}
+
+/**
+ *	\brief Find the server a datagram comes from
+ *	\param ctx	The context, locked by the caller
+ *	\param from	Sender address
+ *	\return		Index of the server, -1 if \a from is none of the context's servers
+ */
+static int vslcl_find_server(vslcl_ctx *ctx, struct sockaddr_in *from)
+{
+	int i;
+
+	for (i = 0; i < ctx->iServerCount; i++)
+		if ((from->sin_addr.s_addr == ctx->servers[i].addr.sin_addr.s_addr) &&
+		    (from->sin_port == ctx->servers[i].addr.sin_port)) return i;
+	return -1;
+}
+
+/**
+ *	\brief Receive replies and hand them to their requests
+ *	\param ctx	The context, NOT locked by the caller
+ *	\param iMs	Maximum time to wait for the first reply in milliseconds
+ *	\return		Zero if a datagram was received, an error code otherwise
+ *
+ *	Once a reply arrived, up to VSLCL_RECV_BUDGET replies already waiting are taken as
+ *	well. Replies nobody waits for any more (e.g. after a timeout) and datagrams from
+ *	hosts that aren't servers of the context are dropped.
+ */
+static int vslcl_receive(vslcl_ctx *ctx, int iMs)
+{
+	struct pollfd pfd;
+	struct sockaddr_in from;
+	socklen_t fromlen;
+	struct pl_data reply;
+	struct pl_batch batch;
+	struct pl_vector hdr;
+	struct pl_stream shdr;
+	struct pl_typed typed;
+	struct vslcl_pending *slot;
+	char rcvpacket[PL_MAX_DATAGRAM];
+	unsigned int words[PL_VEC_WORDS], swords[PL_STREAM_WORDS];
+	int i, iRcvLen, iFrom, iType;
+
+	pfd.fd = ctx->iSocket;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, iMs) <= 0) return -EVSLCL_NET_TIMEOUT;
+
+	for (i = 0; i < VSLCL_RECV_BUDGET; i++) {
+		fromlen = sizeof(from);
+		iRcvLen = recvfrom(ctx->iSocket, rcvpacket, PL_MAX_DATAGRAM, MSG_DONTWAIT, (struct sockaddr*)&from, &fromlen);
+		if (iRcvLen < 0) break;
+
+		iType = pl_peek_type(rcvpacket, iRcvLen);
+		if ((iType == PL_PTYPE_SACK) || (iType == PL_PTYPE_SRSP)) {
+			if (pl_extr_stream(rcvpacket, &shdr, swords, iRcvLen) < 0) continue;
+			pthread_mutex_lock(&ctx->lock);
+			slot = &ctx->pending[shdr.request_id % VSLCL_MAX_INFLIGHT];
+			iFrom = vslcl_find_server(ctx, &from);
+			if ((shdr.request_id != 0) && (slot->uRequestId == shdr.request_id) && (slot->stream != NULL) &&
+			    !slot->iDone && (iFrom >= 0)) {
+				vslcl_deliver_stream(ctx, slot, &shdr, swords, iFrom);
+				if (slot->iDone || slot->stream->iFastDue) pthread_cond_broadcast(&ctx->cond);
+			}
+			pthread_mutex_unlock(&ctx->lock);
+			continue;
+		}
+		if (iType == PL_PTYPE_TRSP) {
+			if (pl_extr_typed(rcvpacket, &typed, iRcvLen) < 0) continue;
+			pthread_mutex_lock(&ctx->lock);
+			slot = &ctx->pending[typed.request_id % VSLCL_MAX_INFLIGHT];
+			iFrom = vslcl_find_server(ctx, &from);
+			if ((typed.request_id != 0) && (slot->uRequestId == typed.request_id) && (slot->typed != NULL) &&
+			    !slot->iDone && (iFrom >= 0)) {
+				vslcl_deliver_typed(ctx, slot, &typed, iFrom);
+				if (slot->iDone) pthread_cond_broadcast(&ctx->cond);
+			}
+			pthread_mutex_unlock(&ctx->lock);
+			continue;
+		}
+		if (iType == PL_PTYPE_BRSP) {
+			if (pl_extr_batch(rcvpacket, &batch, iRcvLen) < 0) continue;
+			pthread_mutex_lock(&ctx->lock);
+			iFrom = vslcl_find_server(ctx, &from);
+			if (iFrom >= 0) vslcl_deliver_batch(ctx, &batch, iFrom);
+			pthread_cond_broadcast(&ctx->cond);
+			pthread_mutex_unlock(&ctx->lock);
+			continue;
+		}
+		if (iType == PL_PTYPE_VRSP) {
+			if (pl_extr_vector(rcvpacket, &hdr, words, iRcvLen) < 0) continue;
+			pthread_mutex_lock(&ctx->lock);
+			slot = &ctx->pending[hdr.request_id % VSLCL_MAX_INFLIGHT];
+			iFrom = vslcl_find_server(ctx, &from);
+			if ((hdr.request_id != 0) && (slot->uRequestId == hdr.request_id) && (slot->vector != NULL) &&
+			    !slot->iDone && (iFrom >= 0)) {
+				vslcl_deliver_vector(ctx, slot, &hdr, words, iFrom);
+				if (slot->iDone) pthread_cond_broadcast(&ctx->cond);
+			}
+			pthread_mutex_unlock(&ctx->lock);
+			continue;
+		}
+		if (pl_extr_packet(rcvpacket, &reply, iRcvLen) < 0) continue;
+
+		pthread_mutex_lock(&ctx->lock);
+		slot = &ctx->pending[PLM_REQUEST_ID(reply) % VSLCL_MAX_INFLIGHT];
+		iFrom = vslcl_find_server(ctx, &from);
+		if ((PLM_REQUEST_ID(reply) != 0) && (slot->uRequestId == PLM_REQUEST_ID(reply)) && (iFrom >= 0)) {
+			// a batch the server couldn't take apart is answered with one error packet,
+			// unless its first request was retransmitted alone and this is its reply
+			if ((slot->uBatchId == PLM_REQUEST_ID(reply)) && (PLM_PACKET_TYPE(reply) == PL_PTYPE_ERR) && (slot->iRetries == 0)) {
+				for (; slot != NULL; slot = (slot->iBatchNext >= 0) ? &ctx->pending[slot->iBatchNext] : NULL) {
+					if ((slot->uRequestId == 0) || (slot->uBatchId != PLM_REQUEST_ID(reply))) break;
+					if (!slot->iDone) vslcl_deliver(ctx, slot, &reply, iFrom);
+				}
+			}
+			else if (!slot->iDone) vslcl_deliver(ctx, slot, &reply, iFrom);
+			pthread_cond_broadcast(&ctx->cond);
+		}
+		pthread_mutex_unlock(&ctx->lock);
+	}
+	return (i > 0) ? EVSLCL_NOERROR : -EVSLCL_NET_TIMEOUT;
+}
+
+/**
+ *	\brief Wait for the reply to a request
+ *	\param ctx	The context, locked by the caller
+ *	\param slot	The request's slot
+ *	\return		Zero if the reply arrived, -EVSLCL_NET_TIMEOUT otherwise
+ *
+ *	If no other thread is receiving, the caller becomes the receiver until its own reply
+ *	arrived, otherwise it sleeps until the receiver hands over the reply or the role.
+ *	Either way it wakes up to retransmit or duplicate its request when due, or to send
+ *	the chunks of its stream window an acknowledgment reported missing. While the
+ *	request waits in the open batch, the caller sends the batch when its window has
+ *	passed.
+ */
+static int vslcl_wait(vslcl_ctx *ctx, struct vslcl_pending *slot)
+{
+	struct timespec next;
+	long lUs;
+
+	while (!slot->iDone) {
+		if (slot->iQueued) {
+			if ((vslcl_remaining_us(&ctx->batchDeadline) == 0) || (vslcl_remaining_us(&slot->deadline) == 0))
+				vslcl_flush_batch(ctx);
+			else pthread_cond_timedwait(&ctx->cond, &ctx->lock, &ctx->batchDeadline);
+			continue;
+		}
+		if (vslcl_remaining_us(&slot->deadline) == 0) return -EVSLCL_NET_TIMEOUT;
+		if ((slot->stream != NULL) && slot->stream->iFastDue) {
+			slot->stream->iFastDue = 0;
+			vslcl_send_stream_unlocked(ctx, slot);
+			continue;
+		}
+		vslcl_next(slot, &next);
+		lUs = vslcl_remaining_us(&next);
+		if (lUs == 0) {
+			vslcl_resend(ctx, slot);
+			continue;
+		}
+		if (!ctx->iReceiving) {
+			ctx->iReceiving = 1;
+			pthread_mutex_unlock(&ctx->lock);
+			vslcl_receive(ctx, (int)((lUs + 999) / 1000));
+			pthread_mutex_lock(&ctx->lock);
+			ctx->iReceiving = 0;
+			// let a waiting thread take over receiving
+			pthread_cond_broadcast(&ctx->cond);
+		}
+		else pthread_cond_timedwait(&ctx->cond, &ctx->lock, &next);
+	}
+	return EVSLCL_NOERROR;
+}
+
+/**
+ *	\brief Execute a function and wait for the reply
+ *	\param ctx	The context, NOT locked by the caller
+ *	\param fid	Function id
+ *	\param param	PL_OPERAND_COUNT operands, receive the operands of the reply
+ *	\param payload	Bytes sent behind the request ID, NULL for none
+ *	\param len	Number of bytes in \a payload
+ *	\return		Zero if the function executed successfully, error code otherwise
+ */
+static int vslcl_call(vslcl_ctx *ctx, int fid, int *param, const unsigned char *payload, unsigned int len)
+{
+	unsigned int i = 0;
+	int iReturn = 0;
+	struct pl_data vsls_data;
+	struct vslcl_pending *slot;
+
+	if ((ctx == NULL) || (param == NULL)) return -EVSLCL_NULLPTR;
+
+	// reserve a request ID, send packet and wait for the matching reply
+	pthread_mutex_lock(&ctx->lock);
+	slot = vslcl_reserve(ctx, 1);
+	vslcl_deadline(&slot->deadline, VSLCL_TIMEOUT_MS);
+	slot->payload = payload;
+	slot->uPayloadLen = len;
+	vslcl_submit(ctx, slot, fid, param);
+	iReturn = vslcl_wait(ctx, slot);
+	if (iReturn < 0) vslcl_settle(ctx, slot, -1);
+	vsls_data = slot->reply;
+	vslcl_release(ctx, slot);
+	pthread_mutex_unlock(&ctx->lock);
+	if (iReturn < 0) return iReturn;
+
+	// copy returned values...
+	for (i=0; i < PL_OPERAND_COUNT; i++) param[i] = PLM_OPERAND(vsls_data, i);
+
+	// create return value according to the returned packet...
+	return vslcl_status(vsls_data);
+}
+
+/**
+ *	\}
+ */
+
+/**
+ *	\ingroup vslabclib
+ *	\defgroup vslcl_func Library functions
+ *	\{
+ */
+
+/**
+ *	\brief Open a context
+ *	\param address	Server IPv4 address in dotted notation
+ *	\param port	Server port, usually VSLS_PORT
+ *	\return		The context, NULL on error
+ *
+ *	The context has its own socket and may be shared by any number of threads.
+ */
+vslcl_ctx *vslcl_open_ctx(const char *address, unsigned short port)
+{
+	int iError;
+
+	return vslcl_create_ctx(address, port, &iError);
+}
+
+/**
+ *	\brief Close a context
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\return		Zero if successful, an error code otherwise
+ *
+ *	No thread may use the context any more. Callbacks of asynchronous requests still
+ *	in flight are not called.
+ */
+int vslcl_close_ctx(vslcl_ctx *ctx)
+{
+	if (ctx == NULL) return -EVSLCL_NULLPTR;
+
+	if (ctx->iPollFd != ctx->iSocket) close(ctx->iPollFd);
+	if (ctx->iEvent >= 0) close(ctx->iEvent);
+	close(ctx->iSocket);
+	pthread_cond_destroy(&ctx->cond);
+	pthread_mutex_destroy(&ctx->lock);
+	free(ctx);
+	return EVSLCL_NOERROR;
+}
+
+/**
+ *	\brief Add a server to a context
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param address	Server IPv4 address in dotted notation
+ *	\param port	Server port
+ *	\return		Zero if successful, error code otherwise
+ *
+ *	Requests are spread over all servers of a context, servers that stop answering are
+ *	left out until they answer a probe again.
+ */
+int vslcl_add_server(vslcl_ctx *ctx, const char *address, unsigned short port)
+{
+	if ((ctx == NULL) || (address == NULL)) return -EVSLCL_NULLPTR;
+
+	pthread_mutex_lock(&ctx->lock);
+	if (ctx->iServerCount == VSLCL_MAX_SERVERS) {
+		pthread_mutex_unlock(&ctx->lock);
+		return -EVSLCL_INVALIDARG;
+	}
+	vslcl_init_server(&ctx->servers[ctx->iServerCount], address, port);
+	ctx->iServerCount++;
+	pthread_mutex_unlock(&ctx->lock);
+	return EVSLCL_NOERROR;
+}
+
+/**
+ *	\brief Execute function on remote node using a context
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param fid 	An integer value specifying the requested function id
+ *	\param param	An integer pointer pointing to an array of integer values representing
+ *			the operands required for the function call. One has to assure that
+ *			there is enough space (i.e. PL_OPERAND_COUNT elements) for the array!
+ *	\return		Zero if function executed successfully, error code otherwise
+ *
+ */
+int vslcl_ctx_call_function(vslcl_ctx *ctx, int fid, int *param)
+{
+	return vslcl_call(ctx, fid, param, NULL, 0);
+}
+
+/**
+ *	\brief	Call multiply function using a context
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param op1	Operand 1, an integer value
+ *	\param op2	Operand 2, an integer value
+ *	\param result	An integer pointer pointing to a variable the result
+ *			is to be written to
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ */
+int vslcl_ctx_Multiply(vslcl_ctx *ctx, int op1, int op2, int *result)
+{
+	int iReturn = 0, params[PL_OPERAND_COUNT];
+	unsigned int i = 0;
+
+	if (result == NULL) return -EVSLCL_NULLPTR;
+
+	// set operands
+	params[0] = op1;
+	params[1] = op2;
+	for (i = 2; i < PL_OPERAND_COUNT; i++) params[i] = 0;
+
+	// call vslab server function
+	iReturn = vslcl_ctx_call_function(ctx, PL_FID_MUL, params);
+
+	// set return values
+	if (iReturn<0) return iReturn;
+	*result = params[0];
+	return iReturn;
+}
+
+/**
+ *	\brief	Call divide function using a context
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param op1	Operand 1, an integer value
+ *	\param op2	Operand 2, an integer value
+ *	\param result	An integer pointer pointing to a variable the result
+ *			is to be written to
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ */
+int vslcl_ctx_Divide(vslcl_ctx *ctx, int op1, int op2, int *result)
+{
+	int iReturn = 0, params[PL_OPERAND_COUNT];
+	unsigned int i = 0;
+
+	if (result == NULL) return -EVSLCL_NULLPTR;
+
+	// set operands
+	params[0] = op1;
+	params[1] = op2;
+	for (i = 2; i < PL_OPERAND_COUNT; i++) params[i] = 0;
+
+	// call vslab server function
+	iReturn = vslcl_ctx_call_function(ctx, PL_FID_DIV, params);
+
+	// set return values
+	if (iReturn<0) return iReturn;
+	*result = params[0];
+	return iReturn;
+}
+
+/**
+ *	\brief	Run a program using a context
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param code	The program, see PL_OP_XXX in packetlib.h
+ *	\param len	Size of the program in bytes, at most PL_PROG_MAX_CODE
+ *	\param r0	Initial value of register 0
+ *	\param r1	Initial value of register 1
+ *	\param result	An integer pointer pointing to a variable the result
+ *			is to be written to
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ *	The whole program is executed by the server in one round trip. Malformed programs
+ *	fail with -PL_ERR_INVALIDPROGRAM, programs running too long with -PL_ERR_BUDGET.
+ */
+int vslcl_ctx_RunProgram(vslcl_ctx *ctx, const unsigned char *code, int len, int r0, int r1, int *result)
+{
+	int iReturn = 0, params[PL_OPERAND_COUNT];
+	unsigned int i = 0;
+
+	if ((code == NULL) || (result == NULL)) return -EVSLCL_NULLPTR;
+	if ((len <= 0) || (len > (int)PL_PROG_MAX_CODE)) return -EVSLCL_INVALIDARG;
+
+	// registers 0 and 1 are the operands
+	params[0] = r0;
+	params[1] = r1;
+	for (i = 2; i < PL_OPERAND_COUNT; i++) params[i] = 0;
+
+	// call vslab server function
+	iReturn = vslcl_call(ctx, PL_FID_PROGRAM, params, code, len);
+
+	// set return values
+	if (iReturn<0) return iReturn;
+	*result = params[0];
+	return iReturn;
+}
+
+/**
+ *	\brief	Call a vector or matrix function using a context
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param fid	PL_FID_VADD, PL_FID_VSUB, PL_FID_VMUL, PL_FID_VDOT, PL_FID_MATMUL or
+ *			PL_FID_SCRAMBLE
+ *	\param dim	PL_VEC_DIMS dimensions, see packetlib.h
+ *	\param a	Operand A
+ *	\param b	Operand B
+ *	\param result	An integer pointer pointing to an array the results are to be
+ *			written to, dim[0] elements for the element-wise functions and
+ *			PL_FID_SCRAMBLE, one for PL_FID_VDOT and dim[0] x dim[2] for
+ *			PL_FID_MATMUL
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ *	Operands and results travel as fragments, see packetlib.h. The server refuses
+ *	shapes it doesn't know with -PL_ERR_INVALIDSHAPE; operands beyond its size limit
+ *	(option -v of vslabd) as well. \a result is undefined if the call fails.
+ */
+int vslcl_ctx_vector_function(vslcl_ctx *ctx, int fid, const unsigned int *dim, const int *a, const int *b, int *result)
+{
+	int iReturn = 0, params[PL_OPERAND_COUNT];
+	struct vslcl_vector vector;
+	struct vslcl_pending *slot;
+	struct pl_data vsls_data;
+
+	if ((ctx == NULL) || (dim == NULL) || (a == NULL) || (b == NULL) || (result == NULL)) return -EVSLCL_NULLPTR;
+
+	memset(&vector, 0x00, sizeof(vector));
+	if (pl_vector_size(fid, dim, &vector.uA, &vector.uB, &vector.uResults) < 0) return -EVSLCL_INVALIDARG;
+	memcpy(vector.dim, dim, sizeof(vector.dim));
+	vector.a = a;
+	vector.b = b;
+	vector.result = result;
+	vector.map = calloc((PL_VEC_FRAGMENTS(vector.uResults) + 31) / 32, sizeof(unsigned int));
+	if (vector.map == NULL) return -EVSLCL_NOMEM;
+	memset(params, 0x00, sizeof(params));
+
+	// like vslcl_call(), the results are copied straight into place by the receiver
+	pthread_mutex_lock(&ctx->lock);
+	slot = vslcl_reserve(ctx, 1);
+	vslcl_deadline(&slot->deadline, VSLCL_TIMEOUT_MS);
+	slot->vector = &vector;
+	vslcl_submit(ctx, slot, fid, params);
+	iReturn = vslcl_wait(ctx, slot);
+	if (iReturn < 0) vslcl_settle(ctx, slot, -1);
+	vsls_data = slot->reply;
+	vslcl_release(ctx, slot);
+	pthread_mutex_unlock(&ctx->lock);
+	free(vector.map);
+	if (iReturn < 0) return iReturn;
+
+	return vslcl_status(vsls_data);
+}
+
+/**
+ *	\brief	Compute a dot product using a context
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param a	First vector
+ *	\param b	Second vector
+ *	\param n	Number of elements of each vector
+ *	\param result	An integer pointer pointing to a variable the result
+ *			is to be written to
+ *	\return 	Zero if successfully executed, error code otherwise
+ */
+int vslcl_ctx_Dot(vslcl_ctx *ctx, const int *a, const int *b, unsigned int n, int *result)
+{
+	unsigned int dim[PL_VEC_DIMS] = { n, 0, 0 };
+
+	return vslcl_ctx_vector_function(ctx, PL_FID_VDOT, dim, a, b, result);
+}
+
+/**
+ *	\brief	Multiply two matrices using a context
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param a	m x k matrix, row by row
+ *	\param b	k x n matrix, row by row
+ *	\param m	Rows of \a a
+ *	\param k	Columns of \a a, rows of \a b
+ *	\param n	Columns of \a b
+ *	\param c	An integer pointer pointing to an array of m x n elements the
+ *			product is to be written to, row by row
+ *	\return 	Zero if successfully executed, error code otherwise
+ */
+int vslcl_ctx_MatMul(vslcl_ctx *ctx, const int *a, const int *b, unsigned int m, unsigned int k, unsigned int n, int *c)
+{
+	unsigned int dim[PL_VEC_DIMS] = { m, k, n };
+
+	return vslcl_ctx_vector_function(ctx, PL_FID_MATMUL, dim, a, b, c);
+}
+
+/**
+ *	\brief	Scramble a block of words using a context
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param polynom	Generator polynom
+ *	\param in	Words to scramble
+ *	\param out	An integer pointer pointing to an array of n words the scrambled
+ *			words are to be written to
+ *	\param n	Number of words
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ *	The words travel as a vector request and reach the server's scrambler as blocks.
+ *	Servers without scrambler answer -PL_ERR_NOSUCHFUNCTION.
+ */
+int vslcl_ctx_Scramble(vslcl_ctx *ctx, int polynom, const int *in, int *out, unsigned int n)
+{
+	unsigned int dim[PL_VEC_DIMS] = { n, 0, 0 };
+
+	return vslcl_ctx_vector_function(ctx, PL_FID_SCRAMBLE, dim, in, &polynom, out);
+}
+
+/**
+ *	\brief	Call a function on typed operands using a context
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param otype	Operand type, PL_OTYPE_INT32, PL_OTYPE_INT64, PL_OTYPE_FLOAT32 or
+ *			PL_OTYPE_FLOAT64
+ *	\param fid	Function id, e.g. PL_FID_MUL or PL_FID_DIV
+ *	\param op1	First operands, n of type \a otype
+ *	\param op2	Second operands, NULL for functions of one operand
+ *	\param result	An array of n values the results are to be written to
+ *	\param status	An array of n integers the status of each operation is to be
+ *			written to (zero or an error code), NULL if not wanted
+ *	\param n	Number of operations
+ *	\return 	Zero if all operations succeeded, the error code of the first failed
+ *			one otherwise
+ *
+ *	The operations go out in typed requests of up to PL_TYPED_MAX_ENTRIES each, one at a
+ *	time. Integer division fails on a zero divisor or an overflowing quotient with
+ *	-PL_ERR_FUNCEXECERROR, floating point division follows IEEE 754. Servers without
+ *	a kernel of the type for \a fid answer -PL_ERR_NOSUCHFUNCTION, older ones refuse the
+ *	request. Results of operations that failed are zero.
+ */
+int vslcl_ctx_typed_function(vslcl_ctx *ctx, unsigned int otype, int fid, const union pl_value *op1,
+			     const union pl_value *op2, union pl_value *result, int *status, unsigned int n)
+{
+	int iReturn = 0, iFirst = 0, params[PL_OPERAND_COUNT];
+	struct vslcl_typed typed;
+	struct vslcl_pending *slot;
+	struct pl_data vsls_data;
+	unsigned int uPos = 0, i = 0;
+
+	if ((ctx == NULL) || (op1 == NULL) || (result == NULL)) return -EVSLCL_NULLPTR;
+	if ((otype == 0) || (otype >= PL_OTYPE_COUNT)) return -EVSLCL_INVALIDARG;
+	memset(params, 0x00, sizeof(params));
+
+	for (uPos = 0; uPos < n; uPos += typed.n) {
+		typed.otype = otype;
+		typed.op1 = &op1[uPos];
+		typed.op2 = (op2 != NULL) ? &op2[uPos] : NULL;
+		typed.result = &result[uPos];
+		typed.status = (status != NULL) ? &status[uPos] : NULL;
+		typed.n = (n - uPos < PL_TYPED_MAX_ENTRIES) ? n - uPos : PL_TYPED_MAX_ENTRIES;
+		typed.iAnswered = 0;
+
+		pthread_mutex_lock(&ctx->lock);
+		slot = vslcl_reserve(ctx, 1);
+		vslcl_deadline(&slot->deadline, VSLCL_TIMEOUT_MS);
+		slot->typed = &typed;
+		vslcl_submit(ctx, slot, fid, params);
+		iReturn = vslcl_wait(ctx, slot);
+		if (iReturn < 0) vslcl_settle(ctx, slot, -1);
+		vsls_data = slot->reply;
+		vslcl_release(ctx, slot);
+		pthread_mutex_unlock(&ctx->lock);
+
+		if (iReturn == 0) iReturn = vslcl_status(vsls_data);
+		if ((iReturn < 0) && (iFirst == 0)) iFirst = iReturn;
+		// a request that failed as a whole fails all its operations
+		if (!typed.iAnswered) {
+			for (i = 0; i < typed.n; i++) {
+				memset(&typed.result[i], 0x00, sizeof(union pl_value));
+				if (status != NULL) typed.status[i] = iReturn;
+			}
+		}
+	}
+	return iFirst;
+}
+
+/**
+ *	\brief	Multiply two 64 bit integers using a context
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param op1	First operand
+ *	\param op2	Second operand
+ *	\param result	A pointer to a variable the product is to be written to, the low
+ *			64 bits of the full product
+ *	\return 	Zero if successfully executed, error code otherwise
+ */
+int vslcl_ctx_Multiply64(vslcl_ctx *ctx, long long op1, long long op2, long long *result)
+{
+	union pl_value a, b, r;
+	int iReturn = 0;
+
+	if (result == NULL) return -EVSLCL_NULLPTR;
+	a.i64 = op1;
+	b.i64 = op2;
+	iReturn = vslcl_ctx_typed_function(ctx, PL_OTYPE_INT64, PL_FID_MUL, &a, &b, &r, NULL, 1);
+	if (iReturn < 0) return iReturn;
+	*result = r.i64;
+	return iReturn;
+}
+
+/**
+ *	\brief	Multiply two doubles using a context
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param op1	First operand
+ *	\param op2	Second operand
+ *	\param result	A pointer to a variable the product is to be written to
+ *	\return 	Zero if successfully executed, error code otherwise
+ */
+int vslcl_ctx_MultiplyDouble(vslcl_ctx *ctx, double op1, double op2, double *result)
+{
+	union pl_value a, b, r;
+	int iReturn = 0;
+
+	if (result == NULL) return -EVSLCL_NULLPTR;
+	a.f64 = op1;
+	b.f64 = op2;
+	iReturn = vslcl_ctx_typed_function(ctx, PL_OTYPE_FLOAT64, PL_FID_MUL, &a, &b, &r, NULL, 1);
+	if (iReturn < 0) return iReturn;
+	*result = r.f64;
+	return iReturn;
+}
+
+/**
+ *	\brief	Divide two doubles using a context
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param op1	Dividend
+ *	\param op2	Divisor, zero gives an infinity or NaN
+ *	\param result	A pointer to a variable the quotient is to be written to
+ *	\return 	Zero if successfully executed, error code otherwise
+ */
+int vslcl_ctx_DivideDouble(vslcl_ctx *ctx, double op1, double op2, double *result)
+{
+	union pl_value a, b, r;
+	int iReturn = 0;
+
+	if (result == NULL) return -EVSLCL_NULLPTR;
+	a.f64 = op1;
+	b.f64 = op2;
+	iReturn = vslcl_ctx_typed_function(ctx, PL_OTYPE_FLOAT64, PL_FID_DIV, &a, &b, &r, NULL, 1);
+	if (iReturn < 0) return iReturn;
+	*result = r.f64;
+	return iReturn;
+}
+
+/**
+ *	\brief Run an operation on an aggregation stream and wait for it
+ *	\param stream	The stream
+ *	\param op	The operation
+ *	\return		Zero if successful, error code otherwise
+ *
+ *	The open request chooses the stream's server and gives the stream its ID. A failed
+ *	operation fails the stream.
+ */
+static int vslcl_stream_call(vslcl_stream *stream, struct vslcl_stream_op *op)
+{
+	vslcl_ctx *ctx = stream->ctx;
+	int iReturn = 0, params[PL_OPERAND_COUNT];
+	struct vslcl_pending *slot;
+	struct pl_data vsls_data;
+
+	memset(params, 0x00, sizeof(params));
+	op->stream = stream;
+	op->uBase = op->uFirst;
+	memset(op->map, 0x00, sizeof(op->map));
+	op->iFast = op->iFastDue = 0;
+
+	pthread_mutex_lock(&ctx->lock);
+	slot = vslcl_reserve(ctx, 1);
+	vslcl_deadline(&slot->deadline, VSLCL_TIMEOUT_MS);
+	slot->stream = op;
+	if (op->type == PL_PTYPE_SOPEN) {
+		stream->uStreamId = slot->uRequestId;
+		stream->iServer = vslcl_choose(ctx);
+	}
+	vslcl_submit(ctx, slot, PL_FID_AGGREGATE, params);
+	iReturn = vslcl_wait(ctx, slot);
+	if (iReturn < 0) vslcl_settle(ctx, slot, -1);
+	vsls_data = slot->reply;
+	vslcl_release(ctx, slot);
+	pthread_mutex_unlock(&ctx->lock);
+
+	if (iReturn == 0) iReturn = vslcl_status(vsls_data);
+	if (iReturn < 0) stream->iFailed = iReturn;
+	return iReturn;
+}
+
+/**
+ *	\brief	Open an aggregation stream using a context
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param lo	Lower bound of the histogram
+ *	\param width	Bucket width, value v falls into bucket (v - lo) / width
+ *	\param buckets	Number of buckets, at most PL_STREAM_MAX_BUCKETS, zero for no
+ *			histogram
+ *	\param stream	Receives the stream, NULL if the call fails
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ *	The stream is written with vslcl_stream_write() and has to be closed with
+ *	vslcl_close_stream(). A stream may only be used by one thread at a time, the context
+ *	by any number of threads and streams. The server refuses streams beyond its limit
+ *	(option -s of vslabd) with -PL_ERR_BUSY.
+ */
+int vslcl_open_stream(vslcl_ctx *ctx, int lo, unsigned int width, unsigned int buckets, vslcl_stream **stream)
+{
+	struct vslcl_stream_op op;
+	int iReturn = 0;
+
+	if ((ctx == NULL) || (stream == NULL)) return -EVSLCL_NULLPTR;
+	*stream = NULL;
+	if ((buckets > PL_STREAM_MAX_BUCKETS) || ((buckets > 0) && (width == 0))) return -EVSLCL_INVALIDARG;
+
+	*stream = calloc(1, sizeof(struct vslcl_stream));
+	if (*stream == NULL) return -EVSLCL_NOMEM;
+	(*stream)->ctx = ctx;
+	(*stream)->iLo = lo;
+	(*stream)->uWidth = width;
+	(*stream)->uBuckets = buckets;
+
+	memset(&op, 0x00, sizeof(op));
+	op.type = PL_PTYPE_SOPEN;
+	iReturn = vslcl_stream_call(*stream, &op);
+	if (iReturn < 0) {
+		free(*stream);
+		*stream = NULL;
+	}
+	return iReturn;
+}
+
+/**
+ *	\brief	Write values to an aggregation stream
+ *
+ *	\param stream	A stream opened by vslcl_open_stream()
+ *	\param values	The values
+ *	\param n	Number of values
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ *	Returns once the server took all values, \a values may be reused then. Once a write
+ *	failed, the stream only returns that error.
+ */
+int vslcl_stream_write(vslcl_stream *stream, const int *values, unsigned int n)
+{
+	struct vslcl_stream_op op;
+	unsigned int uChunks;
+	int iReturn = 0;
+
+	if ((stream == NULL) || ((values == NULL) && (n > 0))) return -EVSLCL_NULLPTR;
+	if (stream->iFailed < 0) return stream->iFailed;
+
+	memset(&op, 0x00, sizeof(op));
+	op.type = PL_PTYPE_SDATA;
+	while (n > 0) {
+		uChunks = (n + PL_STREAM_WORDS - 1) / PL_STREAM_WORDS;
+		if (uChunks > PL_STREAM_WINDOW) uChunks = PL_STREAM_WINDOW;
+		op.values = values;
+		op.uFirst = stream->uNext;
+		op.uEnd = stream->uNext + uChunks;
+		op.uValues = (n < uChunks * PL_STREAM_WORDS) ? n : uChunks * PL_STREAM_WORDS;
+		iReturn = vslcl_stream_call(stream, &op);
+		if (iReturn < 0) return iReturn;
+		stream->uNext += uChunks;
+		values += op.uValues;
+		n -= op.uValues;
+	}
+	return EVSLCL_NOERROR;
+}
+
+/**
+ *	\brief	Close an aggregation stream and get its result
  *
- *	iVSLSocket will hold the socket descriptor returned by socket() to easily access
- *	the remote device once it is opened. Remember that the socket descriptor is not the only
- *	way to identify a remote system - here the socket descriptor is used only as a 
- *	descriptor refering to ONE socket that is used for any server the library communicates 
- *	with.
+ *	\param stream	A stream opened by vslcl_open_stream(), freed by the call
+ *	\param result	Receives count, sum, minimum, maximum and histogram of all values
+ *			written, NULL if only the stream is to be closed
+ *	\return 	Zero if successfully executed, error code otherwise
  *
+ *	A failed stream isn't closed at the server, it is dropped there once its lifetime is
+ *	over.
  */
-static int iVSLSocket = 0;
+int vslcl_close_stream(vslcl_stream *stream, struct pl_aggregate *result)
+{
+	struct vslcl_stream_op op;
+	struct pl_aggregate agg;
+	int iReturn = 0;
+
+	if (stream == NULL) return -EVSLCL_NULLPTR;
+
+	iReturn = stream->iFailed;
+	if (iReturn == 0) {
+		memset(&op, 0x00, sizeof(op));
+		op.type = PL_PTYPE_SCLOSE;
+		op.result = (result != NULL) ? result : &agg;
+		iReturn = vslcl_stream_call(stream, &op);
+	}
+	free(stream);
+	return iReturn;
+}
 
 /**
- *	\brief The library status.
+ *	\brief Submit a function call without waiting for the reply
  *
- * 	iVSLCLStatus will hold information on the library's operating status. Any function 
- *	that requires proper initialization of the library will first check this variable and 
- *	return with an error code if accessing the library would create an error.
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param fid 	An integer value specifying the requested function id
+ *	\param param	PL_OPERAND_COUNT operands, only read during the call
+ *	\param cb	Callback run by vslcl_poll() when the reply arrived or timed out
+ *	\param user	Argument for \a cb
+ *	\return		Zero if the request was sent, error code otherwise
  *
+ *	Returns -EVSLCL_BUSY if VSLCL_MAX_INFLIGHT requests are in flight already. The
+ *	callback gets zero or the error code the blocking call would have returned, and the
+ *	first operand of the reply as result.
  */
-static int iVSLCLStatus = VSLCL_STATUS_OFF;
+int vslcl_submit_function(vslcl_ctx *ctx, int fid, int *param, vslcl_callback cb, void *user)
+{
+	struct vslcl_pending *slot;
+
+	if ((ctx == NULL) || (param == NULL) || (cb == NULL)) return -EVSLCL_NULLPTR;
+
+	pthread_mutex_lock(&ctx->lock);
+	slot = vslcl_reserve(ctx, 0);
+	if (slot == NULL) {
+		pthread_mutex_unlock(&ctx->lock);
+		return -EVSLCL_BUSY;
+	}
+	slot->cb = cb;
+	slot->user = user;
+	vslcl_deadline(&slot->deadline, VSLCL_TIMEOUT_MS);
+	ctx->iAsync++;
+	vslcl_submit(ctx, slot, fid, param);
+	pthread_mutex_unlock(&ctx->lock);
+	return EVSLCL_NOERROR;
+}
 
 /**
- *	\brief Local socket information.
+ *	\brief Submit a multiplication without waiting for the reply
  *
- *	vsls_local holds information about the local system.
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param op1	Operand 1, an integer value
+ *	\param op2	Operand 2, an integer value
+ *	\param cb	Callback receiving the product
+ *	\param user	Argument for \a cb
+ *	\return 	Zero if the request was sent, error code otherwise
  */
-static struct sockaddr_in	vsls_local;
+int vslcl_submit_mul(vslcl_ctx *ctx, int op1, int op2, vslcl_callback cb, void *user)
+{
+	int params[PL_OPERAND_COUNT];
+	unsigned int i = 0;
+
+	params[0] = op1;
+	params[1] = op2;
+	for (i = 2; i < PL_OPERAND_COUNT; i++) params[i] = 0;
+	return vslcl_submit_function(ctx, PL_FID_MUL, params, cb, user);
+}
 
 /**
- *	\brief Remote socket information.
+ *	\brief Submit a division without waiting for the reply
  *
- *	vsls_remote holds information about the remote system.
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param op1	Operand 1, an integer value
+ *	\param op2	Operand 2, an integer value
+ *	\param cb	Callback receiving the quotient
+ *	\param user	Argument for \a cb
+ *	\return 	Zero if the request was sent, error code otherwise
  */
-static struct sockaddr_in	vsls_remote;
+int vslcl_submit_div(vslcl_ctx *ctx, int op1, int op2, vslcl_callback cb, void *user)
+{
+	int params[PL_OPERAND_COUNT];
+	unsigned int i = 0;
+
+	params[0] = op1;
+	params[1] = op2;
+	for (i = 2; i < PL_OPERAND_COUNT; i++) params[i] = 0;
+	return vslcl_submit_function(ctx, PL_FID_DIV, params, cb, user);
+}
 
 /**
- *	\brief Hold packets being sent by library functions.
+ *	\brief Run callbacks of completed asynchronous requests
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param timeout	Milliseconds to wait for a completion, zero to only take what has
+ *			arrived, negative to wait until one completes
+ *	\return		Number of callbacks run, error code otherwise
+ *
+ *	Callbacks run in the calling thread without any lock held, so they may submit new
+ *	requests. Returns right away if no asynchronous request is in flight.
  *
+ *	A caller that is willing to wait has nothing to add to the open batch, so with a
+ *	nonzero \a timeout the open batch is sent right away. With a zero \a timeout it is only
+ *	sent once its window has passed.
  */
-static char sndpacket[PL_PACKETSIZE];
+int vslcl_poll(vslcl_ctx *ctx, int timeout)
+{
+	struct vslcl_done {
+		vslcl_callback cb;
+		void *user;
+		int iStatus;
+		int iResult;
+	} done[VSLCL_MAX_INFLIGHT];
+	struct vslcl_pending *slot;
+	struct timespec ts, tw;
+	int i, iNext, iMs, iLeft, iCount = 0, iWaited = 0;
+#if defined VSLCL_HAVE_EVENTFD
+	eventfd_t value;
+#endif
+
+	if (ctx == NULL) return -EVSLCL_NULLPTR;
+	if (timeout >= 0) vslcl_deadline(&ts, timeout);
+
+	pthread_mutex_lock(&ctx->lock);
+	for (;;) {
+		if ((ctx->iBatchCount > 0) && ((timeout != 0) || (vslcl_remaining_us(&ctx->batchDeadline) == 0))) {
+			vslcl_flush_batch(ctx);
+			continue;
+		}
+		iMs = vslcl_timers(ctx);
+		if ((ctx->iDoneHead >= 0) || (ctx->iAsync == 0)) break;
+		if (timeout >= 0) {
+			iLeft = vslcl_remaining(&ts);
+			if (iWaited && (iLeft == 0)) break;
+			if (iLeft < iMs) iMs = iLeft;
+		}
+		iWaited = 1;
+		if (!ctx->iReceiving) {
+			ctx->iReceiving = 1;
+			pthread_mutex_unlock(&ctx->lock);
+			vslcl_receive(ctx, iMs);
+			pthread_mutex_lock(&ctx->lock);
+			ctx->iReceiving = 0;
+			pthread_cond_broadcast(&ctx->cond);
+		}
+		else {
+			vslcl_deadline(&tw, iMs);
+			pthread_cond_timedwait(&ctx->cond, &ctx->lock, &tw);
+		}
+	}
+
+	// take the whole completion queue
+	for (i = ctx->iDoneHead; i >= 0; i = iNext) {
+		slot = &ctx->pending[i];
+		iNext = slot->iNext;
+		done[iCount].cb = slot->cb;
+		done[iCount].user = slot->user;
+		done[iCount].iStatus = slot->iStatus;
+		done[iCount].iResult = (slot->iStatus < 0) ? 0 : PLM_OPERAND(slot->reply, 0);
+		iCount++;
+		vslcl_release(ctx, slot);
+	}
+	ctx->iDoneHead = ctx->iDoneTail = -1;
+#if defined VSLCL_HAVE_EVENTFD
+	if (ctx->iEvent >= 0) eventfd_read(ctx->iEvent, &value);
+#endif
+	pthread_mutex_unlock(&ctx->lock);
+
+	for (i = 0; i < iCount; i++) done[i].cb(done[i].user, done[i].iStatus, done[i].iResult);
+	return iCount;
+}
 
 /**
- *	\brief Hold packets being received by library functions.
+ *	\brief Get a descriptor to wait for asynchronous completions
  *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\return		A file descriptor, error code otherwise
+ *
+ *	The descriptor becomes readable when replies arrived or completions are queued, then
+ *	vslcl_poll(ctx, 0) runs the callbacks. It may be added to the caller's own poll() or
+ *	epoll set. Timeouts and retransmissions are only handled by vslcl_poll(), so the
+ *	caller should not wait longer than vslcl_next_timeout() says.
+ *
+ *	Without eventfd support this is the context's socket: completions received by
+ *	blocking calls of other threads then don't make it readable.
+ *
+ *	The end of a batching window doesn't make the descriptor readable either, event loops
+ *	using batching should call vslcl_flush() once they submitted what they have.
  */
-static char rcvpacket[PL_PACKETSIZE];
+int vslcl_fd(vslcl_ctx *ctx)
+{
+	if (ctx == NULL) return -EVSLCL_NULLPTR;
+	return ctx->iPollFd;
+}
 
 /**
- *	\brief Remote system IP address
+ *	\brief Switch hedging on or off
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param on	Nonzero to duplicate slow requests
+ *	\return		Zero if successful, error code otherwise
  *
- *	Unicast_addr holds the unicast address of the remote system being used by the library. 
- *	As this library does not support multiple server nodes, a call to this function BEFORE 
- *	vslcl_Open() gives us the ability to override the default setting of VSLS_UNICAST_ADDRESS.
+ *	With hedging on, a request that takes longer than 95 % of its server's replies is
+ *	sent to a second server as well and the first reply is taken. This cuts the latency
+ *	tail caused by lost datagrams and slow servers for about 5 % more requests. Needs at
+ *	least two servers, see vslcl_add_server().
  */
-static char unicast_addr[IP_ADDR_LEN] = VSLS_UNICAST_ADDRESS;
+int vslcl_set_hedging(vslcl_ctx *ctx, int on)
+{
+	if (ctx == NULL) return -EVSLCL_NULLPTR;
+
+	pthread_mutex_lock(&ctx->lock);
+	ctx->iHedging = on;
+	pthread_mutex_unlock(&ctx->lock);
+	return EVSLCL_NOERROR;
+}
 
 /**
- *	\brief Target node data structure
+ *	\brief Get the time until asynchronous requests need vslcl_poll() again
  *
- *	vsls_data is an instance of struct pl_data (see packetlib.h) that is mainly used 
- *	by vslcl_call_function() to communicate with the target node.
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\return		Milliseconds until the next retransmission or timeout, error code
+ *			otherwise
+ *
+ *	Event loops waiting on vslcl_fd() should wait at most this long.
  */
-static struct pl_data vsls_data;
+int vslcl_next_timeout(vslcl_ctx *ctx)
+{
+	struct vslcl_pending *slot;
+	struct timespec next;
+	long lUs, lNext = VSLCL_TIMEOUT_MS * 1000L;
+	int i;
+
+	if (ctx == NULL) return -EVSLCL_NULLPTR;
+
+	pthread_mutex_lock(&ctx->lock);
+	for (i = 0; (ctx->iAsync > 0) && (i < VSLCL_MAX_INFLIGHT); i++) {
+		slot = &ctx->pending[i];
+		if ((slot->uRequestId == 0) || (slot->cb == NULL) || slot->iDone || slot->iQueued) continue;
+		vslcl_next(slot, &next);
+		lUs = vslcl_remaining_us(&next);
+		if (lUs < lNext) lNext = lUs;
+	}
+	if (ctx->iBatchCount > 0) {
+		lUs = vslcl_remaining_us(&ctx->batchDeadline);
+		if (lUs < lNext) lNext = lUs;
+	}
+	pthread_mutex_unlock(&ctx->lock);
+	return (int)((lNext + 999) / 1000);
+}
 
 /**
- *	\}
+ *	\brief Set up batching of requests
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\param window	Microseconds a request may wait for others to share its datagram,
+ *			zero to switch batching off
+ *	\param max_ops	Number of requests that fill a batch, at most PL_BATCH_MAX_ENTRIES
+ *	\return		Zero if successful, error code otherwise
+ *
+ *	With batching on, blocking and asynchronous requests are collected and sent as one
+ *	batch packet when the first of them has waited \a window microseconds, when \a max_ops
+ *	requests are collected or when vslcl_flush() is called. The window adds up to
+ *	\a window microseconds of latency to every request, in exchange for far fewer
+ *	datagrams when many threads or asynchronous requests use the context.
  */
+int vslcl_set_batching(vslcl_ctx *ctx, int window, int max_ops)
+{
+	if (ctx == NULL) return -EVSLCL_NULLPTR;
+	if ((window < 0) || (max_ops < 1)) return -EVSLCL_INVALIDARG;
+
+	pthread_mutex_lock(&ctx->lock);
+	vslcl_flush_batch(ctx);
+	ctx->iBatchWindow = window;
+	ctx->iBatchMax = (max_ops > PL_BATCH_MAX_ENTRIES) ? PL_BATCH_MAX_ENTRIES : max_ops;
+	pthread_mutex_unlock(&ctx->lock);
+	return EVSLCL_NOERROR;
+}
 
 /**
- *	\ingroup vslabclib
- *	\defgroup vslcl_func Library functions
- *	\{
+ *	\brief Send the open batch now
+ *
+ *	\param ctx	A context opened by vslcl_open_ctx()
+ *	\return		Zero if successful, error code otherwise
  */
+int vslcl_flush(vslcl_ctx *ctx)
+{
+	if (ctx == NULL) return -EVSLCL_NULLPTR;
+
+	pthread_mutex_lock(&ctx->lock);
+	vslcl_flush_batch(ctx);
+	pthread_mutex_unlock(&ctx->lock);
+	return EVSLCL_NOERROR;
+}
 
 /**
  *	\brief Initialize vslab client library.
  *	\return Zero if successfully opened socket, error code otherwise
  *
- *	vslcl_Open() will start initialization of the vslab client library and should be called at 
- *	the beginning of any program that wants to access the remote node. vslcl_Open() will  
+ *	vslcl_Open() will start initialization of the vslab client library and should be called at
+ *	the beginning of any program that wants to access the remote node. It opens the default
+ *	context used by the functions without context parameter. vslcl_Open() will
  *	return zero if successfully executed and an error code less than zero otherwise.
  */
 int vslcl_Open(void)
 {
-	int iReturn = 0;
-	
-	//get socket descriptor
-	iVSLSocket=socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-	if (iVSLSocket < 0)
-	{
-		iVSLCLStatus = VSLCL_STATUS_OFF;
-		return -EVSLCL_SOCKET;
-	}
+	int iReturn = 0, i;
 
-   	// initialize client structure - that's me
-   	vsls_local.sin_family = AF_INET;			// Ethernet
-   	vsls_local.sin_addr.s_addr = htonl(INADDR_ANY);	// automatically insert own address
-   	vsls_local.sin_port = htons(0);			// set vslab server port
-   	memset(&(vsls_local.sin_zero), 0x00, 8);		// set remaining bytes to 0x0
-
-	// initialize server structure - there's nothing to be done by OS, we have to set it
-	// "at our own risk"...
-	vsls_remote.sin_family = AF_INET;			// Ethernet
-	vsls_remote.sin_addr.s_addr = inet_addr(unicast_addr);
-	vsls_remote.sin_port = htons(VSLS_PORT);
-	memset(&(vsls_remote.sin_zero), 0x00, 8);
-
-	// bind socket
-	iReturn = bind(iVSLSocket, (struct sockaddr *)&vsls_local, sizeof(struct sockaddr));
-	if (iReturn < 0)
-	{
-		close(iVSLSocket);
-		iVSLCLStatus = VSLCL_STATUS_OFF;
-		return -EVSLCL_BIND;
-	}
-
-	// set library status
-	iVSLCLStatus = VSLCL_STATUS_ON;
-
-	return EVSLCL_NOERROR;
+	if (vslcl_default != NULL) return -EVSLCL_STATUS_ON;
+	vslcl_default = vslcl_create_ctx(unicast_addr[0], VSLS_PORT, &iReturn);
+	for (i = 1; (vslcl_default != NULL) && (i < iUnicastCount); i++)
+		vslcl_add_server(vslcl_default, unicast_addr[i], VSLS_PORT);
+	return iReturn;
 }
 
 
@@ -160,22 +2530,19 @@ int vslcl_Open(void)
  *
  * 	\return Zero if successfully closed library, nonzero otherwise
  *
- *	vslcl_Close() will close the library if it was previuosly opened and sets 
- *	iVSLCLStatus to OFF. If the library is not already opened, vslcl_Close() 
- *	will return an error code.
+ *	vslcl_Close() will close the default context if it was previuosly opened. If the
+ *	library is not already opened, vslcl_Close() will return an error code.
  */
 int vslcl_Close(void)
 {
-	// check library status
-	if (iVSLCLStatus != VSLCL_STATUS_ON) return -EVSLCL_STATUS_OFF;
-
-	// close socket
-	close (iVSLSocket);
+	int iReturn = 0;
 
-	// set library status
-	iVSLCLStatus = VSLCL_STATUS_OFF;
+	// check library status
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
 
-	return EVSLCL_NOERROR;
+	iReturn = vslcl_close_ctx(vslcl_default);
+	vslcl_default = NULL;
+	return iReturn;
 }
 
 
@@ -184,116 +2551,271 @@ int vslcl_Close(void)
  *
  *	\param fid 	An integer value specifying the requested function id
  *	\param param	An integer pointer pointing to an array of integer values representing
- *			the operands required for the function call. One has to assure that 
+ *			the operands required for the function call. One has to assure that
  *			there is enough space (i.e. PL_OPERAND_COUNT elements) for the array!
  *	\return		Zero if function executed successfully, error code otherwise
  *
+ *	Same as vslcl_ctx_call_function() on the default context.
  */
 int vslcl_call_function(int fid, int *param)
 {
-	unsigned int i = 0, iSndLen = 0, iRcvLen = 0;
+	// check library status
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
 
-	// create request packet...
-	pl_create_request(&vsls_data);
+	return vslcl_ctx_call_function(vslcl_default, fid, param);
+}
 
-	// set function id
-	PLM_FUNCTION_ID(vsls_data) = fid;
 
-	// set operands
-	for (i=0; i < PL_OPERAND_COUNT; i++) PLM_OPERAND(vsls_data, i) = param[i];
+/**
+ *	\brief	Call multiply function
+ *
+ *	\param op1	Operand 1, an integer value
+ *	\param op2	Operand 2, an integer value
+ *	\param result	An integer pointer pointing to a variable the result
+ *			is to be written to
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ */
+int vslcl_Multiply(int op1, int op2, int *result)
+{
+	// check library status
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
 
-	// serialize packet
-	pl_make_packet(&vsls_data, sndpacket, PL_PACKETSIZE);
+	return vslcl_ctx_Multiply(vslcl_default, op1, op2, result);
+}
 
-	// send packet
-	iSndLen = sendto(iVSLSocket, &sndpacket, PL_PACKETSIZE, 0, (struct sockaddr*)&vsls_remote, sizeof(struct sockaddr));
 
-	// receive packet and check for timeout error
-	i = sizeof(struct sockaddr);
-	tol_start_timeout(5);
-	iRcvLen = recvfrom(iVSLSocket, &rcvpacket, PL_PACKETSIZE, 0, (struct sockaddr*)&vsls_remote, &i);
-	tol_stop_timeout();
-	if (tol_is_timed_out()) {
-		return -EVSLCL_NET_TIMEOUT;
-	}
+/**
+ *	\brief	Call divide function
+ *
+ *	\param op1	Operand 1, an integer value
+ *	\param op2	Operand 2, an integer value
+ *	\param result	An integer pointer pointing to a variable the result
+ *			is to be written to
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ */
+int vslcl_Divide(int op1, int op2, int *result)
+{
+	// check library status
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
 
-	// extract packet received
-	pl_extr_packet(rcvpacket, &vsls_data, iRcvLen);
+	return vslcl_ctx_Divide(vslcl_default, op1, op2, result);
+}
 
-	// copy returned values...
-	for (i=0; i < PL_OPERAND_COUNT; i++) param[i] = PLM_OPERAND(vsls_data, i);
 
-	// create return value according to the returned packet...	
-	if (PLM_PACKET_TYPE(vsls_data) == PL_PTYPE_ERR) return -PLM_OPERAND(vsls_data, 0);
-	if (PLM_PACKET_TYPE(vsls_data) == PL_PTYPE_RSP) return EVSLCL_NOERROR;
-	return -EVSLCL_UNKNOWN_ERROR;
+/**
+ *	\brief	Run a program
+ *
+ *	\param code	The program, see PL_OP_XXX in packetlib.h
+ *	\param len	Size of the program in bytes
+ *	\param r0	Initial value of register 0
+ *	\param r1	Initial value of register 1
+ *	\param result	An integer pointer pointing to a variable the result
+ *			is to be written to
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ */
+int vslcl_RunProgram(const unsigned char *code, int len, int r0, int r1, int *result)
+{
+	// check library status
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
+
+	return vslcl_ctx_RunProgram(vslcl_default, code, len, r0, r1, result);
 }
 
+/**
+ *	\brief	Call a vector or matrix function
+ *
+ *	\param fid	Function id, see vslcl_ctx_vector_function()
+ *	\param dim	PL_VEC_DIMS dimensions
+ *	\param a	Operand A
+ *	\param b	Operand B
+ *	\param result	An integer pointer pointing to an array the results are to be
+ *			written to
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ */
+int vslcl_vector_function(int fid, const unsigned int *dim, const int *a, const int *b, int *result)
+{
+	// check library status
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
+
+	return vslcl_ctx_vector_function(vslcl_default, fid, dim, a, b, result);
+}
 
 /**
- *	\brief	Call multiply function
+ *	\brief	Compute a dot product
  *
- *	\param op1	Operand 1, an integer value
- *	\param op2	Operand 2, an integer value
- *	\param result	An integer pointer pointing to a variable the result 
+ *	\param a	First vector
+ *	\param b	Second vector
+ *	\param n	Number of elements of each vector
+ *	\param result	An integer pointer pointing to a variable the result
  *			is to be written to
  *	\return 	Zero if successfully executed, error code otherwise
  *
  */
-int vslcl_Multiply(int op1, int op2, int *result)
+int vslcl_Dot(const int *a, const int *b, unsigned int n, int *result)
 {
-	int iReturn = 0, params[PL_OPERAND_COUNT];
-	unsigned int i = 0;
+	// check library status
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
+
+	return vslcl_ctx_Dot(vslcl_default, a, b, n, result);
+}
 
+/**
+ *	\brief	Multiply two matrices
+ *
+ *	\param a	m x k matrix, row by row
+ *	\param b	k x n matrix, row by row
+ *	\param m	Rows of \a a
+ *	\param k	Columns of \a a, rows of \a b
+ *	\param n	Columns of \a b
+ *	\param c	An integer pointer pointing to an array of m x n elements the
+ *			product is to be written to
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ */
+int vslcl_MatMul(const int *a, const int *b, unsigned int m, unsigned int k, unsigned int n, int *c)
+{
 	// check library status
-	if (iVSLCLStatus != VSLCL_STATUS_ON) return -EVSLCL_STATUS_OFF;
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
 
-	// set operands
-	params[0] = op1;
-	params[1] = op2;
-	for (i = 2; i < PL_OPERAND_COUNT; i++) params[i] = 0;
+	return vslcl_ctx_MatMul(vslcl_default, a, b, m, k, n, c);
+}
 
-	// call vslab server function
-	iReturn = vslcl_call_function(PL_FID_MUL, params);
+/**
+ *	\brief	Scramble a block of words
+ *
+ *	\param polynom	Generator polynom
+ *	\param in	Words to scramble
+ *	\param out	An integer pointer pointing to an array of n words the scrambled
+ *			words are to be written to
+ *	\param n	Number of words
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ */
+int vslcl_Scramble(int polynom, const int *in, int *out, unsigned int n)
+{
+	// check library status
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
 
-	// set return values
-	if (iReturn<0) return iReturn;
-	*result = params[0];
-	return iReturn;
+	return vslcl_ctx_Scramble(vslcl_default, polynom, in, out, n);
+}
+
+/**
+ *	\brief	Call a function on typed operands
+ *
+ *	\param otype	Operand type, PL_OTYPE_XXX
+ *	\param fid	Function id
+ *	\param op1	First operands
+ *	\param op2	Second operands, NULL for functions of one operand
+ *	\param result	An array of n values the results are to be written to
+ *	\param status	An array of n integers the status of each operation is to be
+ *			written to, NULL if not wanted
+ *	\param n	Number of operations
+ *	\return 	Zero if all operations succeeded, error code otherwise
+ *
+ *	See vslcl_ctx_typed_function().
+ */
+int vslcl_typed_function(unsigned int otype, int fid, const union pl_value *op1, const union pl_value *op2,
+			 union pl_value *result, int *status, unsigned int n)
+{
+	// check library status
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
 
+	return vslcl_ctx_typed_function(vslcl_default, otype, fid, op1, op2, result, status, n);
 }
 
+/**
+ *	\brief	Multiply two 64 bit integers
+ *
+ *	\param op1	First operand
+ *	\param op2	Second operand
+ *	\param result	A pointer to a variable the product is to be written to
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ */
+int vslcl_Multiply64(long long op1, long long op2, long long *result)
+{
+	// check library status
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
+
+	return vslcl_ctx_Multiply64(vslcl_default, op1, op2, result);
+}
 
 /**
- *	\brief	Call divide function
+ *	\brief	Multiply two doubles
  *
- *	\param op1	Operand 1, an integer value
- *	\param op2	Operand 2, an integer value
- *	\param result	An integer pointer pointing to a variable the result 
- *			is to be written to
+ *	\param op1	First operand
+ *	\param op2	Second operand
+ *	\param result	A pointer to a variable the product is to be written to
  *	\return 	Zero if successfully executed, error code otherwise
  *
  */
-int vslcl_Divide(int op1, int op2, int *result)
+int vslcl_MultiplyDouble(double op1, double op2, double *result)
 {
-	int iReturn = 0, params[PL_OPERAND_COUNT];
+	// check library status
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
+
+	return vslcl_ctx_MultiplyDouble(vslcl_default, op1, op2, result);
+}
 
+/**
+ *	\brief	Divide two doubles
+ *
+ *	\param op1	Dividend
+ *	\param op2	Divisor
+ *	\param result	A pointer to a variable the quotient is to be written to
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ */
+int vslcl_DivideDouble(double op1, double op2, double *result)
+{
 	// check library status
-	if (iVSLCLStatus != VSLCL_STATUS_ON) return -EVSLCL_STATUS_OFF;
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
 
-	// set operands
-	params[0] = op1;
-	params[1] = op2;
-	for (iReturn = 2; iReturn < PL_OPERAND_COUNT; iReturn++) params[iReturn] = 0;
+	return vslcl_ctx_DivideDouble(vslcl_default, op1, op2, result);
+}
 
-	// call vslab server function
-	iReturn = vslcl_call_function(PL_FID_DIV, params);
 
-	// set return values
-	if (iReturn<0) return iReturn;
-	*result = params[0];
-	return iReturn;
+/**
+ *	\brief	Open an aggregation stream
+ *
+ *	\param lo	Lower bound of the histogram
+ *	\param width	Bucket width
+ *	\param buckets	Number of buckets, zero for no histogram
+ *	\param stream	Receives the stream
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ *	See vslcl_open_stream(), the stream lives on the default context and has to be
+ *	closed before vslcl_Close().
+ */
+int vslcl_OpenStream(int lo, unsigned int width, unsigned int buckets, vslcl_stream **stream)
+{
+	// check library status
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
+
+	return vslcl_open_stream(vslcl_default, lo, width, buckets, stream);
+}
+
+/**
+ *	\brief Set up batching for the library functions
+ *
+ *	\param window	Microseconds a request may wait for others, zero to switch batching off
+ *	\param max_ops	Number of requests that fill a batch
+ *	\return 	Zero if successfully executed, error code otherwise
+ *
+ *	Same as vslcl_set_batching() on the default context, so existing callers of
+ *	vslcl_Multiply() and vslcl_Divide() in several threads share datagrams without
+ *	changes. It has to be called AFTER vslcl_Open().
+ */
+int vslcl_SetBatching(int window, int max_ops)
+{
+	// check library status
+	if (vslcl_default == NULL) return -EVSLCL_STATUS_OFF;
 
+	return vslcl_set_batching(vslcl_default, window, max_ops);
 }
 
 
@@ -304,15 +2826,36 @@ int vslcl_Divide(int op1, int op2, int *result)
  *			vslcl_Open().
  *	\return 	Zero if successfully executed, nonzero otherwise
  *
- *	vslcl_SetUnicastAddress() sets the unicast address used by the library. It has to be 
- *	called BEFOFE vslcl_Open()! The function returns zero if successfully executed and an 
+ *	vslcl_SetUnicastAddress() sets the unicast address used by the library. It has to be
+ *	called BEFOFE vslcl_Open()! The function returns zero if successfully executed and an
  *	error code otherwise.
  */
 int vslcl_SetUnicastAddress(char *address) {
 
 	if (address == NULL) return -EVSLCL_NULLPTR;
-	if (strlen(address) > IP_ADDR_LEN) return -EVSLCL_WRONGADDRLEN;
-	strncpy(unicast_addr, address, IP_ADDR_LEN);
+	if (strlen(address) >= IP_ADDR_LEN) return -EVSLCL_WRONGADDRLEN;
+	strncpy(unicast_addr[0], address, IP_ADDR_LEN);
+	iUnicastCount = 1;
+	return EVSLCL_NOERROR;
+}
+
+
+/**
+ *	\brief Add a remote unicast address
+ *
+ *	\param address	A string representing the unicast address of a further server
+ *	\return 	Zero if successfully executed, nonzero otherwise
+ *
+ *	vslcl_AddUnicastAddress() adds a server to the ones used by the library, requests are
+ *	then spread over all of them. It has to be called BEFORE vslcl_Open() and after
+ *	vslcl_SetUnicastAddress(), which resets the list to one server.
+ */
+int vslcl_AddUnicastAddress(char *address) {
+
+	if (address == NULL) return -EVSLCL_NULLPTR;
+	if (strlen(address) >= IP_ADDR_LEN) return -EVSLCL_WRONGADDRLEN;
+	if (iUnicastCount == VSLCL_MAX_SERVERS) return -EVSLCL_INVALIDARG;
+	strncpy(unicast_addr[iUnicastCount++], address, IP_ADDR_LEN);
 	return EVSLCL_NOERROR;
 }
 
@@ -3,7 +3,7 @@
  *	\brief Definitions for vslab client lib
  *	\author Marc Juettner, marc.juettner@juettner-itconsult.de
  *	\author Manuel Gaiser, manuel.gaiser@hs-pforzheim.de
- *	\version 1.0
+ *	\version 1.10
  *
  */
 #if !defined _vslabclib_h_
@@ -15,6 +15,18 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdlib.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+
+// eventfd and epoll make asynchronous completions pollable, the uClinux toolchain has
+// neither
+#if defined(__linux__) && !defined(__UCLIBC__)
+#define VSLCL_HAVE_EVENTFD
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#endif
 
 
 // defines for use within the vslab client library...
@@ -37,6 +49,108 @@
  */
 #define IP_ADDR_LEN		16
 
+/** \brief Requests in flight per context.
+ *
+ * Maximum number of requests a context waits for at the same time, further callers block
+ * until a reply arrived or a request timed out.
+ */
+#define VSLCL_MAX_INFLIGHT	256
+
+/** \brief Network timeout.
+ *
+ * Milliseconds to wait for a reply.
+ */
+#define VSLCL_TIMEOUT_MS	5000
+
+/** \brief Servers per context.
+ *
+ * Maximum number of servers a context spreads its requests over.
+ */
+#define VSLCL_MAX_SERVERS	8
+
+/** \brief Timeouts before ejection.
+ *
+ * A server that let this many requests in a row time out gets no more requests except
+ * for probes.
+ */
+#define VSLCL_EJECT_FAILURES	3
+
+/** \brief Probe interval.
+ *
+ * Milliseconds between probe requests to an ejected server, also the time a probe may take.
+ */
+#define VSLCL_PROBE_MS		1000
+
+/** \brief Initial reply time.
+ *
+ * Microseconds assumed as reply time of a server until it answered.
+ */
+#define VSLCL_LATENCY_GUESS_US	1000
+
+/** \brief Initial retransmission timeout.
+ *
+ * Milliseconds to wait before a request is sent again while its server wasn't measured yet.
+ */
+#define VSLCL_RTO_INIT_MS	200
+
+/** \brief Minimum retransmission timeout.
+ *
+ * Lower bound of the measured retransmission timeout in milliseconds, so scheduling
+ * delays on a fast network don't cause spurious retransmissions.
+ */
+#define VSLCL_RTO_MIN_MS	10
+
+/** \brief Maximum retransmission timeout.
+ *
+ * Upper bound of the retransmission timeout in milliseconds, also after backoff.
+ */
+#define VSLCL_RTO_MAX_MS	1000
+
+/** \brief Retransmissions per request.
+ *
+ * A request is sent at most this many times again, each time after twice the previous
+ * timeout, then its reply is awaited until VSLCL_TIMEOUT_MS have passed.
+ */
+#define VSLCL_MAX_RETRIES	3
+
+/** \brief Vector fragment allowance.
+ *
+ * Microseconds added to the retransmission timeout of a vector request per fragment of
+ * operands and results, so a long transfer isn't taken for a loss.
+ */
+#define VSLCL_VEC_FRAGMENT_US	20
+
+/** \brief Socket receive buffer.
+ *
+ * Requested size of a context's receive buffer in bytes, it has to take the result
+ * stream of a vector request. The system may grant less.
+ */
+#define VSLCL_RCVBUF		(4 << 20)
+
+/** \brief Round trip time histogram size.
+ *
+ * Number of buckets, four per power of two microseconds.
+ */
+#define VSLCL_HIST_BUCKETS	96
+
+/** \brief Round trip time histogram length.
+ *
+ * The histogram is halved when it holds this many samples, so old samples fade out.
+ */
+#define VSLCL_HIST_SAMPLES	4096
+
+/** \brief Samples before hedging.
+ *
+ * Requests to a server are only duplicated once this many of its replies were measured.
+ */
+#define VSLCL_HEDGE_MIN_SAMPLES	32
+
+/** \brief Receive budget.
+ *
+ * Maximum number of replies taken from the socket in one go.
+ */
+#define VSLCL_RECV_BUDGET	64
+
 
 // vslab client library states
 /** \brief Library status. 
@@ -100,12 +214,94 @@
  */
 #define EVSLCL_STATUS_ON	108
 
+/** \brief Out of memory.
+ *
+ * A context couldn't be allocated.
+ */
+#define EVSLCL_NOMEM		109
+
+/** \brief Too many requests.
+ *
+ * VSLCL_MAX_INFLIGHT requests are in flight already.
+ */
+#define EVSLCL_BUSY		110
+
+/** \brief Invalid argument.
+ *
+ * An argument is out of range.
+ */
+#define EVSLCL_INVALIDARG	111
+
+
+/** \brief Client context.
+ *
+ * Opaque handle holding a socket and the requests in flight on it, see vslcl_open_ctx().
+ */
+typedef struct vslcl_ctx vslcl_ctx;
+
+/** \brief Aggregation stream.
+ *
+ * Opaque handle of a stream of values aggregated by a server, see vslcl_open_stream().
+ */
+typedef struct vslcl_stream vslcl_stream;
+
+/** \brief Completion callback.
+ *
+ * Called by vslcl_poll() with the argument given at submission, zero or an error code
+ * and the result.
+ */
+typedef void (*vslcl_callback)(void *user, int status, int result);
+
 
 // vslab client library function prototypes
 int vslcl_Open(void);
 int vslcl_Close(void);
 int vslcl_Multiply(int op1, int op2, int *result);
 int vslcl_Divide(int op1, int op2, int *result);
+int vslcl_RunProgram(const unsigned char *code, int len, int r0, int r1, int *result);
+int vslcl_vector_function(int fid, const unsigned int *dim, const int *a, const int *b, int *result);
+int vslcl_Dot(const int *a, const int *b, unsigned int n, int *result);
+int vslcl_MatMul(const int *a, const int *b, unsigned int m, unsigned int k, unsigned int n, int *c);
+int vslcl_Scramble(int polynom, const int *in, int *out, unsigned int n);
+int vslcl_OpenStream(int lo, unsigned int width, unsigned int buckets, vslcl_stream **stream);
+int vslcl_typed_function(unsigned int otype, int fid, const union pl_value *op1, const union pl_value *op2,
+			 union pl_value *result, int *status, unsigned int n);
+int vslcl_Multiply64(long long op1, long long op2, long long *result);
+int vslcl_MultiplyDouble(double op1, double op2, double *result);
+int vslcl_DivideDouble(double op1, double op2, double *result);
 int vslcl_SetUnicastAddress(char *address);
+int vslcl_SetBatching(int window, int max_ops);
+int vslcl_AddUnicastAddress(char *address);
+
+vslcl_ctx *vslcl_open_ctx(const char *address, unsigned short port);
+int vslcl_close_ctx(vslcl_ctx *ctx);
+int vslcl_add_server(vslcl_ctx *ctx, const char *address, unsigned short port);
+int vslcl_ctx_call_function(vslcl_ctx *ctx, int fid, int *param);
+int vslcl_ctx_Multiply(vslcl_ctx *ctx, int op1, int op2, int *result);
+int vslcl_ctx_Divide(vslcl_ctx *ctx, int op1, int op2, int *result);
+int vslcl_ctx_RunProgram(vslcl_ctx *ctx, const unsigned char *code, int len, int r0, int r1, int *result);
+int vslcl_ctx_vector_function(vslcl_ctx *ctx, int fid, const unsigned int *dim, const int *a, const int *b, int *result);
+int vslcl_ctx_Dot(vslcl_ctx *ctx, const int *a, const int *b, unsigned int n, int *result);
+int vslcl_ctx_MatMul(vslcl_ctx *ctx, const int *a, const int *b, unsigned int m, unsigned int k, unsigned int n, int *c);
+int vslcl_ctx_Scramble(vslcl_ctx *ctx, int polynom, const int *in, int *out, unsigned int n);
+int vslcl_ctx_typed_function(vslcl_ctx *ctx, unsigned int otype, int fid, const union pl_value *op1,
+			     const union pl_value *op2, union pl_value *result, int *status, unsigned int n);
+int vslcl_ctx_Multiply64(vslcl_ctx *ctx, long long op1, long long op2, long long *result);
+int vslcl_ctx_MultiplyDouble(vslcl_ctx *ctx, double op1, double op2, double *result);
+int vslcl_ctx_DivideDouble(vslcl_ctx *ctx, double op1, double op2, double *result);
+int vslcl_open_stream(vslcl_ctx *ctx, int lo, unsigned int width, unsigned int buckets, vslcl_stream **stream);
+int vslcl_stream_write(vslcl_stream *stream, const int *values, unsigned int n);
+int vslcl_close_stream(vslcl_stream *stream, struct pl_aggregate *result);
+
+int vslcl_submit_function(vslcl_ctx *ctx, int fid, int *param, vslcl_callback cb, void *user);
+int vslcl_submit_mul(vslcl_ctx *ctx, int op1, int op2, vslcl_callback cb, void *user);
+int vslcl_submit_div(vslcl_ctx *ctx, int op1, int op2, vslcl_callback cb, void *user);
+int vslcl_poll(vslcl_ctx *ctx, int timeout);
+int vslcl_fd(vslcl_ctx *ctx);
+int vslcl_next_timeout(vslcl_ctx *ctx);
+
+int vslcl_set_batching(vslcl_ctx *ctx, int window, int max_ops);
+int vslcl_flush(vslcl_ctx *ctx);
+int vslcl_set_hedging(vslcl_ctx *ctx, int on);
 
 #endif //#define _vslabclib_h_
@@ -0,0 +1,484 @@
+/**
+ *	\file vslabclib.hpp
+ *	\brief C++20 coroutine interface for the vslab client library
+ *	\version 1.0
+ *
+ *	\par Overview
+ *	Header-only layer over the asynchronous functions of vslabclib (vslcl_submit_function(),
+ *	vslcl_poll()). A coroutine awaiting vsl::multiply() or vsl::divide() is suspended until
+ *	the reply arrived, so thousands of remote calls can be in flight without a thread or a
+ *	callback per call:
+ *
+ *	\code
+ *	vsl::task<int> sum(vsl::context &ctx)
+ *	{
+ *		std::vector<vsl::task<vsl::result>> calls;
+ *		for (int i = 0; i < 1000; i++) calls.push_back(vsl::multiply(ctx, i, i));
+ *		int s = 0;
+ *		for (vsl::result r : co_await vsl::when_all(std::move(calls))) s += r.value;
+ *		co_return s;
+ *	}
+ *
+ *	vsl::context ctx("141.47.69.14");
+ *	int s = vsl::sync_wait(ctx, sum(ctx));
+ *	\endcode
+ *
+ *	\par Threading
+ *	A vsl::context is driven by one reactor thread calling context::run() (or sync_wait(),
+ *	which calls it). All coroutines using the context are resumed in that thread, so they
+ *	need no locking among themselves. Requests beyond VSLCL_MAX_INFLIGHT are queued and
+ *	sent as earlier ones complete.
+ *
+ *	\par Build
+ *	Needs a C++20 compiler (g++ -std=c++20) and vslabclib, packetlib and timeoutlib linked
+ *	as for C clients.
+ */
+#if !defined _vslabclib_hpp_
+#define _vslabclib_hpp_
+
+extern "C" {
+#include "vslabclib.h"
+}
+
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace vsl {
+
+/**
+ *	\brief Outcome of a remote call
+ */
+struct result {
+	int status = EVSLCL_NOERROR;	/**< \brief Zero or the error code the C call would return. */
+	int value = 0;			/**< \brief Result, valid if status is zero. */
+
+	/** \brief True if the call succeeded. */
+	explicit operator bool() const { return status == EVSLCL_NOERROR; }
+};
+
+template <class T> class task;
+
+namespace detail {
+
+/**
+ *	\brief Promise parts shared by all task types
+ *
+ *	A task starts when it is awaited and resumes its awaiter when it finishes.
+ */
+struct promise_base {
+	std::coroutine_handle<> continuation = std::noop_coroutine();
+	std::exception_ptr error;
+
+	struct final_awaiter {
+		bool await_ready() noexcept { return false; }
+		template <class P>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+		{
+			return h.promise().continuation;
+		}
+		void await_resume() noexcept {}
+	};
+
+	std::suspend_always initial_suspend() noexcept { return {}; }
+	final_awaiter final_suspend() noexcept { return {}; }
+	void unhandled_exception() { error = std::current_exception(); }
+};
+
+template <class T>
+struct promise : promise_base {
+	std::optional<T> value;
+
+	task<T> get_return_object();
+	template <class U> void return_value(U &&v) { value.emplace(std::forward<U>(v)); }
+	T take()
+	{
+		if (error) std::rethrow_exception(error);
+		return std::move(*value);
+	}
+};
+
+template <>
+struct promise<void> : promise_base {
+	task<void> get_return_object();
+	void return_void() {}
+	void take()
+	{
+		if (error) std::rethrow_exception(error);
+	}
+};
+
+} // namespace detail
+
+/**
+ *	\brief A lazily started coroutine producing a T
+ *
+ *	Awaiting the task starts it, the awaiter is resumed with its result when it is done.
+ */
+template <class T = void>
+class task {
+public:
+	using promise_type = detail::promise<T>;
+	using handle_type = std::coroutine_handle<promise_type>;
+
+	explicit task(handle_type h) : h_(h) {}
+	task(task &&other) noexcept : h_(std::exchange(other.h_, nullptr)) {}
+	task &operator=(task &&other) noexcept
+	{
+		if (this != &other) {
+			if (h_) h_.destroy();
+			h_ = std::exchange(other.h_, nullptr);
+		}
+		return *this;
+	}
+	task(const task &) = delete;
+	task &operator=(const task &) = delete;
+	~task()
+	{
+		if (h_) h_.destroy();
+	}
+
+	bool await_ready() const noexcept { return !h_ || h_.done(); }
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+	{
+		h_.promise().continuation = awaiter;
+		return h_;
+	}
+	T await_resume() { return h_.promise().take(); }
+
+private:
+	handle_type h_;
+};
+
+namespace detail {
+
+template <class T>
+task<T> promise<T>::get_return_object()
+{
+	return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline task<void> promise<void>::get_return_object()
+{
+	return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+class call;
+
+} // namespace detail
+
+/**
+ *	\brief A vslab client context driven by one reactor thread
+ */
+class context {
+public:
+	/**
+	 *	\brief Open a context
+	 *	\param address	Server IPv4 address in dotted notation
+	 *	\param port	Server port
+	 */
+	explicit context(const char *address, unsigned short port = VSLS_PORT)
+		: ctx_(vslcl_open_ctx(address, port))
+	{
+		if (ctx_ == nullptr) throw std::runtime_error("vslcl_open_ctx() failed");
+	}
+	context(const context &) = delete;
+	context &operator=(const context &) = delete;
+	~context() { vslcl_close_ctx(ctx_); }
+
+	/** \brief The underlying C context. */
+	vslcl_ctx *get() const { return ctx_; }
+
+	/** \brief Pollable descriptor, see vslcl_fd(). */
+	int fd() const { return vslcl_fd(ctx_); }
+
+	/**
+	 *	\brief Send queued requests and resume coroutines whose replies arrived
+	 *	\param timeout	Milliseconds to wait as for vslcl_poll()
+	 *	\return		Number of completions handled, error code otherwise
+	 *
+	 *	For reactors with their own event loop: call it when fd() is readable.
+	 */
+	int poll(int timeout = 0);
+
+	/**
+	 *	\brief Run until no call is in flight or queued any more
+	 */
+	void run()
+	{
+		while (busy()) poll(-1);
+	}
+
+	/** \brief True while calls are in flight or queued. */
+	bool busy() const { return inflight_ > 0 || !backlog_.empty(); }
+
+private:
+	friend class detail::call;
+
+	void submit(detail::call *c);
+	void flush();
+
+	vslcl_ctx *ctx_;
+	std::size_t inflight_ = 0;
+	std::deque<detail::call *> backlog_;
+};
+
+namespace detail {
+
+/**
+ *	\brief Awaitable for one remote function call
+ */
+class call {
+public:
+	call(context &ctx, int fid, int op1, int op2) : ctx_(ctx), fid_(fid)
+	{
+		for (int i = 0; i < PL_OPERAND_COUNT; i++) param_[i] = 0;
+		param_[0] = op1;
+		param_[1] = op2;
+	}
+
+	bool await_ready() const noexcept { return false; }
+	bool await_suspend(std::coroutine_handle<> h)
+	{
+		h_ = h;
+		ctx_.submit(this);
+		// an error on submission completes the call right away
+		return res_.status == EVSLCL_NOERROR;
+	}
+	result await_resume() const noexcept { return res_; }
+
+private:
+	friend class vsl::context;
+
+	static void done(void *user, int status, int value)
+	{
+		call *c = static_cast<call *>(user);
+
+		c->ctx_.inflight_--;
+		c->res_.status = status;
+		c->res_.value = value;
+		c->h_.resume();
+	}
+
+	// Zero if sent or queued, an error code otherwise.
+	int send()
+	{
+		int iReturn = vslcl_submit_function(ctx_.get(), fid_, param_, &call::done, this);
+
+		if (iReturn == EVSLCL_NOERROR) ctx_.inflight_++;
+		return iReturn;
+	}
+
+	context &ctx_;
+	int fid_;
+	int param_[PL_OPERAND_COUNT];
+	result res_;
+	std::coroutine_handle<> h_;
+};
+
+/**
+ *	\brief Counts down finished parts of a when_all() and resumes its awaiter
+ */
+struct latch {
+	std::size_t count;
+	std::coroutine_handle<> waiter;
+};
+
+/**
+ *	\brief Eagerly started coroutine that reports to a latch when it finishes
+ */
+struct part {
+	struct promise_type {
+		latch *l = nullptr;
+
+		part get_return_object()
+		{
+			return part{std::coroutine_handle<promise_type>::from_promise(*this)};
+		}
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		auto final_suspend() noexcept
+		{
+			struct awaiter {
+				bool await_ready() noexcept { return false; }
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+				{
+					latch *l = h.promise().l;
+					if (--l->count == 0) return l->waiter;
+					return std::noop_coroutine();
+				}
+				void await_resume() noexcept {}
+			};
+			return awaiter{};
+		}
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+
+	std::coroutine_handle<promise_type> h;
+
+	part(part &&other) noexcept : h(std::exchange(other.h, nullptr)) {}
+	explicit part(std::coroutine_handle<promise_type> handle) : h(handle) {}
+	~part()
+	{
+		if (h) h.destroy();
+	}
+};
+
+template <class T>
+part run_part(task<T> &t, std::optional<T> &out)
+{
+	out.emplace(co_await t);
+}
+
+inline part run_part(task<void> &t)
+{
+	co_await t;
+}
+
+} // namespace detail
+
+inline void context::submit(detail::call *c)
+{
+	// keep the order of calls, queued ones go first
+	if (backlog_.empty()) {
+		c->res_.status = c->send();
+		if (c->res_.status != -EVSLCL_BUSY) return;
+	}
+	c->res_.status = EVSLCL_NOERROR;
+	backlog_.push_back(c);
+}
+
+inline void context::flush()
+{
+	detail::call *c;
+
+	while (!backlog_.empty()) {
+		c = backlog_.front();
+		c->res_.status = c->send();
+		if (c->res_.status == -EVSLCL_BUSY) {
+			c->res_.status = EVSLCL_NOERROR;
+			return;
+		}
+		backlog_.pop_front();
+		if (c->res_.status != EVSLCL_NOERROR) c->h_.resume();
+	}
+}
+
+inline int context::poll(int timeout)
+{
+	int iReturn;
+
+	flush();
+	iReturn = vslcl_poll(ctx_, timeout);
+	flush();
+	return iReturn;
+}
+
+/**
+ *	\brief Multiply on the server
+ *	\param ctx	The context
+ *	\param op1	Operand 1
+ *	\param op2	Operand 2
+ *	\return		Task yielding the product
+ */
+inline task<result> multiply(context &ctx, int op1, int op2)
+{
+	co_return co_await detail::call(ctx, PL_FID_MUL, op1, op2);
+}
+
+/**
+ *	\brief Divide on the server
+ *	\param ctx	The context
+ *	\param op1	Operand 1
+ *	\param op2	Operand 2
+ *	\return		Task yielding the quotient
+ */
+inline task<result> divide(context &ctx, int op1, int op2)
+{
+	co_return co_await detail::call(ctx, PL_FID_DIV, op1, op2);
+}
+
+/**
+ *	\brief Run tasks concurrently
+ *	\param tasks	The tasks
+ *	\return		Task yielding the results in the order of \a tasks
+ */
+template <class T>
+task<std::vector<T>> when_all(std::vector<task<T>> tasks)
+{
+	struct awaiter {
+		std::vector<task<T>> &tasks;
+		std::vector<std::optional<T>> &out;
+		std::vector<detail::part> &parts;
+		detail::latch l;
+
+		bool await_ready() const noexcept { return tasks.empty(); }
+		bool await_suspend(std::coroutine_handle<> h)
+		{
+			l.count = tasks.size() + 1;
+			l.waiter = h;
+			for (std::size_t i = 0; i < tasks.size(); i++) {
+				parts.push_back(detail::run_part(tasks[i], out[i]));
+				parts.back().h.promise().l = &l;
+			}
+			// parts finishing right away must not resume us before all are started
+			for (detail::part &p : parts) p.h.resume();
+			return --l.count > 0;
+		}
+		void await_resume() noexcept {}
+	};
+	std::vector<std::optional<T>> out(tasks.size());
+	std::vector<detail::part> parts;
+	std::vector<T> values;
+
+	parts.reserve(tasks.size());
+	co_await awaiter{tasks, out, parts, {}};
+	values.reserve(out.size());
+	for (std::optional<T> &v : out) values.push_back(std::move(*v));
+	co_return values;
+}
+
+/**
+ *	\brief Run a task to completion on the calling thread
+ *	\param ctx	The context the task uses
+ *	\param t	The task
+ *	\return		The task's result
+ *
+ *	The calling thread becomes the context's reactor until the task is done.
+ */
+template <class T>
+T sync_wait(context &ctx, task<T> t)
+{
+	std::optional<T> out;
+	detail::latch l{2, std::noop_coroutine()};
+	detail::part p = detail::run_part(t, out);
+
+	p.h.promise().l = &l;
+	p.h.resume();
+	while (l.count > 1) ctx.poll(-1);
+	return std::move(*out);
+}
+
+/**
+ *	\brief Run a task without result to completion on the calling thread
+ *	\param ctx	The context the task uses
+ *	\param t	The task
+ */
+inline void sync_wait(context &ctx, task<void> t)
+{
+	detail::latch l{2, std::noop_coroutine()};
+	detail::part p = detail::run_part(t);
+
+	p.h.promise().l = &l;
+	p.h.resume();
+	while (l.count > 1) ctx.poll(-1);
+}
+
+} // namespace vsl
+
+#endif //#define _vslabclib_hpp_
@@ -3,7 +3,7 @@
  *	\brief Function definitions for packet handling
  *	\author Marc Juettner, marc.juettner@juettner-itconsult.de
  *	\author Manuel Gaiser, manuel.gaiser@hs-pforzheim.de
- *	\version 1.1
+ *	\version 1.9
  */
 #include "packetlib.h"
 
@@ -35,6 +35,7 @@ int pl_make_packet(struct pl_data *data, char* packet, unsigned int len)
 	*(int*)(&packet[PL_PIDX_MODE]) = htonl(data->mode);
 	*(int*)(&packet[PL_PIDX_FID]) = htonl(data->function_id);
 	for (i = 0; i<PL_OPERAND_COUNT; i++) *(int*)(&packet[PL_PIDX_OP(i)]) = htonl(data->data[i]);
+	*(int*)(&packet[PL_PIDX_RID]) = htonl(data->request_id);
 
 	return E_PL_NOERROR;
 }
@@ -46,6 +47,8 @@ int pl_make_packet(struct pl_data *data, char* packet, unsigned int len)
  *			unserialized.
  *	\param len	The size of the source buffer given by \a packet
  *	\return		E_PL_NOERROR if successful, an error code otherwise
+ *
+ *	Packets of PL_PACKETSIZE_V1 bytes are accepted as well, their request ID is 0.
  */
 int pl_extr_packet(char* packet, struct pl_data *data, unsigned int len)
 {
@@ -56,12 +59,13 @@ int pl_extr_packet(char* packet, struct pl_data *data, unsigned int len)
 		printf("Error extracting packet!\n");
 		return -E_PL_NULLPTR;
 	}
-	if (len < PL_PACKETSIZE) return -E_PL_INSUFFICIENTBUFFER;
+	if (len < PL_PACKETSIZE_V1) return -E_PL_INSUFFICIENTBUFFER;
 
 	data->type = ntohl(*(int*)(&packet[PL_PIDX_TYPE]));
 	data->mode = ntohl(*(int*)(&packet[PL_PIDX_MODE]));
 	data->function_id = ntohl(*(int*)(&packet[PL_PIDX_FID]));
 	for (i = 0; i<PL_OPERAND_COUNT; i++) data->data[i] = ntohl(*(int*)(&packet[PL_PIDX_OP(i)]));
+	data->request_id = (len < PL_PACKETSIZE) ? 0 : ntohl(*(int*)(&packet[PL_PIDX_RID]));
 	
 	return E_PL_NOERROR;
 }
@@ -125,6 +129,609 @@ int pl_create_error(struct pl_data *data, int errorcode)
 }
 
 
+/**
+ *	\brief Get the type of a serialized packet
+ *	\param packet	A pointer to a source character buffer
+ *	\param len	The size of the source buffer given by \a packet
+ *	\return		The packet type if successful, an error code otherwise
+ *
+ *	Single and batch packets share the type field, so the receiver can decide which
+ *	extraction function to use before unserializing the packet.
+ */
+int pl_peek_type(char *packet, unsigned int len)
+{
+	if (packet == NULL) return -E_PL_NULLPTR;
+	if (len < sizeof(unsigned int)) return -E_PL_INSUFFICIENTBUFFER;
+
+	return (int)ntohl(*(int*)(&packet[PL_PIDX_TYPE]));
+}
+
+/**
+ *	\brief Get the request ID of a serialized packet
+ *	\param packet	A pointer to a source character buffer
+ *	\param len	The size of the source buffer given by \a packet
+ *	\return		The request ID of a single, batch, vector or stream packet, zero if the packet carries none
+ *
+ *	Lets the receiver recognize a request it has seen before without unserializing it.
+ */
+unsigned int pl_peek_request_id(char *packet, unsigned int len)
+{
+	int iType = pl_peek_type(packet, len);
+
+	if (packet == NULL) return 0;
+
+	if ((len >= PL_BATCH_HDRSIZE) && (iType == PL_PTYPE_BREQ))
+		return ntohl(*(unsigned int*)(&packet[PL_PIDX_BRID]));
+	if ((len >= PL_TYPED_HDRSIZE) && ((iType == PL_PTYPE_TREQ) || (iType == PL_PTYPE_TRSP)))
+		return ntohl(*(unsigned int*)(&packet[PL_PIDX_TRID]));
+	if ((len >= PL_VEC_HDRSIZE) && ((iType == PL_PTYPE_VREQ) || (iType == PL_PTYPE_VRSP) || (iType == PL_PTYPE_VACK)))
+		return ntohl(*(unsigned int*)(&packet[PL_PIDX_VRID]));
+	if ((len >= PL_STREAM_HDRSIZE) && (iType >= PL_PTYPE_SOPEN) && (iType <= PL_PTYPE_SRSP))
+		return ntohl(*(unsigned int*)(&packet[PL_PIDX_SRID]));
+	if (len >= PL_PACKETSIZE) return ntohl(*(unsigned int*)(&packet[PL_PIDX_RID]));
+	return 0;
+}
+
+/**
+ *	\brief Serialize a batch packet structure
+ *	\param data	A pointer to a struct pl_batch containing the data to be
+ *			serialized.
+ *	\param packet	A pointer to a target character buffer
+ *	\param len	The size of the target buffer given by \a packet, it has to hold 
+ *			at least PL_BATCH_PACKETSIZE(data->count) bytes
+ *	\return		E_PL_NOERROR if successful, an error code otherwise
+ */
+int pl_make_batch(struct pl_batch *data, char *packet, unsigned int len)
+{
+	unsigned int i = 0, j = 0;
+	char *entry;
+
+	if ((data == NULL) || (packet == NULL)) 
+	{
+		printf("Error creating batch packet!\n");
+		return -E_PL_NULLPTR;
+	}
+	if (data->count > PL_BATCH_MAX_ENTRIES) return -E_PL_INVALIDCOUNT;
+	if (len < PL_BATCH_PACKETSIZE(data->count)) return -E_PL_INSUFFICIENTBUFFER;
+
+	*(int*)(&packet[PL_PIDX_TYPE]) = htonl(data->type);
+	*(int*)(&packet[PL_PIDX_MODE]) = htonl(data->mode);
+	*(int*)(&packet[PL_PIDX_BCOUNT]) = htonl(data->count);
+	*(int*)(&packet[PL_PIDX_BRID]) = htonl(data->request_id);
+	for (i = 0; i < data->count; i++) {
+		entry = &packet[PL_PIDX_BENTRY(i)];
+		*(int*)(&entry[PL_EIDX_TYPE]) = htonl(data->entry[i].type);
+		*(int*)(&entry[PL_EIDX_FID]) = htonl(data->entry[i].function_id);
+		for (j = 0; j<PL_OPERAND_COUNT; j++) *(int*)(&entry[PL_EIDX_OP(j)]) = htonl(data->entry[i].data[j]);
+	}
+
+	return E_PL_NOERROR;
+}
+
+/**
+ *	\brief Unserialize a batch packet structure
+ *	\param packet	A pointer to a source character buffer
+ *	\param data	A pointer to a struct pl_batch for the data to be
+ *			unserialized.
+ *	\param len	The size of the source buffer given by \a packet
+ *	\return		E_PL_NOERROR if successful, an error code otherwise
+ *
+ *	The entry count is taken from the packet header and checked against 
+ *	PL_BATCH_MAX_ENTRIES and \a len before any entry is read.
+ */
+int pl_extr_batch(char *packet, struct pl_batch *data, unsigned int len)
+{
+	unsigned int i = 0, j = 0;
+	char *entry;
+
+	if ((data == NULL) || (packet == NULL)) 
+	{
+		printf("Error extracting batch packet!\n");
+		return -E_PL_NULLPTR;
+	}
+	if (len < PL_BATCH_HDRSIZE) return -E_PL_INSUFFICIENTBUFFER;
+
+	data->type = ntohl(*(int*)(&packet[PL_PIDX_TYPE]));
+	data->mode = ntohl(*(int*)(&packet[PL_PIDX_MODE]));
+	data->count = ntohl(*(int*)(&packet[PL_PIDX_BCOUNT]));
+	data->request_id = ntohl(*(int*)(&packet[PL_PIDX_BRID]));
+	if ((data->count > PL_BATCH_MAX_ENTRIES) || (len < PL_BATCH_PACKETSIZE(data->count))) {
+		data->count = 0;
+		return -E_PL_INVALIDCOUNT;
+	}
+	for (i = 0; i < data->count; i++) {
+		entry = &packet[PL_PIDX_BENTRY(i)];
+		data->entry[i].type = ntohl(*(int*)(&entry[PL_EIDX_TYPE]));
+		data->entry[i].function_id = ntohl(*(int*)(&entry[PL_EIDX_FID]));
+		for (j = 0; j<PL_OPERAND_COUNT; j++) data->entry[i].data[j] = ntohl(*(int*)(&entry[PL_EIDX_OP(j)]));
+	}
+
+	return E_PL_NOERROR;
+}
+
+/**
+ *	\brief Create a batch request packet
+ *	\param data	A pointer to a struct pl_batch for the data to be
+ *			filled in.
+ *	\return		E_PL_NOERROR if successful, an error code otherwise
+ *
+ *	The function sets the header fields according to the requirements for a batch 
+ *	request packet and marks all \a count entries as requests.
+ */
+int pl_create_batch_request(struct pl_batch *data)
+{
+	unsigned int i = 0;
+
+	if (data == NULL) return -E_PL_NULLPTR;
+	if (data->count > PL_BATCH_MAX_ENTRIES) return -E_PL_INVALIDCOUNT;
+
+	data->type = PL_PTYPE_BREQ;
+	data->mode = PL_MODE_CLN;
+	for (i = 0; i < data->count; i++) data->entry[i].type = PL_PTYPE_REQ;
+
+	return E_PL_NOERROR;
+}
+
+/**
+ *	\brief Create a batch response packet
+ *	\param data	A pointer to a struct pl_batch for the data to be
+ *			filled in.
+ *	\return		E_PL_NOERROR if successful, an error code otherwise
+ *
+ *	The function sets the header fields according to the requirements for a batch 
+ *	response packet. The entries are left untouched, each of them carries its own 
+ *	response or error type.
+ */
+int pl_create_batch_response(struct pl_batch *data)
+{
+	if (data == NULL) return -E_PL_NULLPTR;
+
+	data->type = PL_PTYPE_BRSP;
+	data->mode = PL_MODE_SRV;
+
+	return E_PL_NOERROR;
+}
+
+/**
+ *	\brief Serialize a vector packet
+ *	\param data	A pointer to a struct pl_vector holding the header, \a count gives
+ *			the number of words
+ *	\param words	The words of the fragment
+ *	\param packet	A pointer to a target character buffer
+ *	\param len	The size of the target buffer given by \a packet, it has to hold 
+ *			at least PL_VEC_PACKETSIZE(data->count) bytes
+ *	\return		E_PL_NOERROR if successful, an error code otherwise
+ */
+int pl_make_vector(struct pl_vector *data, const unsigned int *words, char *packet, unsigned int len)
+{
+	unsigned int i = 0;
+
+	if ((data == NULL) || (words == NULL) || (packet == NULL)) 
+	{
+		printf("Error creating vector packet!\n");
+		return -E_PL_NULLPTR;
+	}
+	if (data->count > PL_VEC_WORDS) return -E_PL_INVALIDCOUNT;
+	if (len < PL_VEC_PACKETSIZE(data->count)) return -E_PL_INSUFFICIENTBUFFER;
+
+	*(int*)(&packet[PL_PIDX_TYPE]) = htonl(data->type);
+	*(int*)(&packet[PL_PIDX_MODE]) = htonl(data->mode);
+	*(int*)(&packet[PL_PIDX_FID]) = htonl(data->function_id);
+	*(int*)(&packet[PL_PIDX_VRID]) = htonl(data->request_id);
+	*(int*)(&packet[PL_PIDX_VSEQ]) = htonl(data->seq);
+	*(int*)(&packet[PL_PIDX_VTOTAL]) = htonl(data->total);
+	for (i = 0; i < PL_VEC_DIMS; i++) *(int*)(&packet[PL_PIDX_VDIM(i)]) = htonl(data->dim[i]);
+	for (i = 0; i < data->count; i++) *(int*)(&packet[PL_PIDX_VWORD(i)]) = htonl(words[i]);
+
+	return E_PL_NOERROR;
+}
+
+/**
+ *	\brief Unserialize a vector packet
+ *	\param packet	A pointer to a source character buffer
+ *	\param data	A pointer to a struct pl_vector for the header
+ *	\param words	Receives the words, NULL to only read the header. It has to hold
+ *			PL_VEC_WORDS words.
+ *	\param len	The size of the source buffer given by \a packet
+ *	\return		E_PL_NOERROR if successful, an error code otherwise
+ *
+ *	The number of words follows from \a len, which must leave no partial word.
+ */
+int pl_extr_vector(char *packet, struct pl_vector *data, unsigned int *words, unsigned int len)
+{
+	unsigned int i = 0;
+
+	if ((data == NULL) || (packet == NULL)) 
+	{
+		printf("Error extracting vector packet!\n");
+		return -E_PL_NULLPTR;
+	}
+	if (len < PL_VEC_HDRSIZE) return -E_PL_INSUFFICIENTBUFFER;
+	if (((len - PL_VEC_HDRSIZE) % 4 != 0) || (len > PL_VEC_PACKETSIZE(PL_VEC_WORDS))) return -E_PL_INVALIDCOUNT;
+
+	data->type = ntohl(*(int*)(&packet[PL_PIDX_TYPE]));
+	data->mode = ntohl(*(int*)(&packet[PL_PIDX_MODE]));
+	data->function_id = ntohl(*(int*)(&packet[PL_PIDX_FID]));
+	data->request_id = ntohl(*(int*)(&packet[PL_PIDX_VRID]));
+	data->seq = ntohl(*(int*)(&packet[PL_PIDX_VSEQ]));
+	data->total = ntohl(*(int*)(&packet[PL_PIDX_VTOTAL]));
+	for (i = 0; i < PL_VEC_DIMS; i++) data->dim[i] = ntohl(*(int*)(&packet[PL_PIDX_VDIM(i)]));
+	data->count = (len - PL_VEC_HDRSIZE) / 4;
+	if (words != NULL) for (i = 0; i < data->count; i++) words[i] = ntohl(*(int*)(&packet[PL_PIDX_VWORD(i)]));
+
+	return E_PL_NOERROR;
+}
+
+/**
+ *	\brief Get the sizes of a bulk function's operands and results
+ *	\param fid	Function id
+ *	\param dim	PL_VEC_DIMS dimensions
+ *	\param a	Receives the number of elements of operand A
+ *	\param b	Receives the number of elements of operand B
+ *	\param results	Receives the number of results
+ *	\return		E_PL_NOERROR if successful, an error code otherwise
+ *
+ *	Sizes that don't fit into 32 bits and results of more than PL_VEC_MAX_FRAGMENTS
+ *	fragments are rejected like unknown functions and shapes.
+ */
+int pl_vector_size(unsigned int fid, const unsigned int *dim, unsigned int *a, unsigned int *b, unsigned int *results)
+{
+	unsigned long long ullA, ullB, ullResults;
+
+	if ((dim == NULL) || (a == NULL) || (b == NULL) || (results == NULL)) return -E_PL_NULLPTR;
+
+	switch (fid) {
+	case PL_FID_VADD:
+	case PL_FID_VSUB:
+	case PL_FID_VMUL:
+	case PL_FID_VDOT:
+		if ((dim[0] == 0) || (dim[1] != 0) || (dim[2] != 0)) return -E_PL_INVALIDSHAPE;
+		ullA = ullB = dim[0];
+		ullResults = (fid == PL_FID_VDOT) ? 1 : dim[0];
+		break;
+	case PL_FID_MATMUL:
+		if ((dim[0] == 0) || (dim[1] == 0) || (dim[2] == 0)) return -E_PL_INVALIDSHAPE;
+		ullA = (unsigned long long)dim[0] * dim[1];
+		ullB = (unsigned long long)dim[1] * dim[2];
+		ullResults = (unsigned long long)dim[0] * dim[2];
+		break;
+	case PL_FID_SCRAMBLE:
+		if ((dim[0] == 0) || (dim[1] != 0) || (dim[2] != 0)) return -E_PL_INVALIDSHAPE;
+		ullA = ullResults = dim[0];
+		ullB = 1;
+		break;
+	default:
+		return -E_PL_INVALIDSHAPE;
+	}
+	if ((ullA + ullB > 0xffffffffULL) || (ullResults > (unsigned long long)PL_VEC_MAX_FRAGMENTS * PL_VEC_WORDS))
+		return -E_PL_INVALIDSHAPE;
+
+	*a = (unsigned int)ullA;
+	*b = (unsigned int)ullB;
+	*results = (unsigned int)ullResults;
+	return E_PL_NOERROR;
+}
+
+
+/**
+ *	\brief Serialize a typed operand
+ *	\param value	The operand
+ *	\param otype	Its type
+ *	\param word	Receives the two words, high word first, in network byte order
+ */
+static void pl_put_value(const union pl_value *value, unsigned int otype, char *word)
+{
+	unsigned long long ullBits = 0;
+	unsigned int uBits = 0;
+
+	switch (otype) {
+		case PL_OTYPE_INT32:
+			ullBits = (unsigned long long)(long long)value->i32;
+			break;
+		case PL_OTYPE_FLOAT32:
+			memcpy(&uBits, &value->f32, sizeof(uBits));
+			ullBits = uBits;
+			break;
+		case PL_OTYPE_INT64:
+			ullBits = (unsigned long long)value->i64;
+			break;
+		case PL_OTYPE_FLOAT64:
+			memcpy(&ullBits, &value->f64, sizeof(ullBits));
+			break;
+	}
+	*(int*)(&word[0]) = htonl((unsigned int)(ullBits >> 32));
+	*(int*)(&word[4]) = htonl((unsigned int)ullBits);
+}
+
+/**
+ *	\brief Unserialize a typed operand
+ *	\param word	The two words, high word first, in network byte order
+ *	\param otype	The operand's type
+ *	\param value	Receives the operand
+ */
+static void pl_get_value(const char *word, unsigned int otype, union pl_value *value)
+{
+	unsigned long long ullBits = ((unsigned long long)ntohl(*(unsigned int*)(&word[0])) << 32) |
+				     ntohl(*(unsigned int*)(&word[4]));
+	unsigned int uBits = (unsigned int)ullBits;
+
+	memset(value, 0x00, sizeof(union pl_value));
+	switch (otype) {
+		case PL_OTYPE_INT32:
+			value->i32 = (int)uBits;
+			break;
+		case PL_OTYPE_FLOAT32:
+			memcpy(&value->f32, &uBits, sizeof(uBits));
+			break;
+		case PL_OTYPE_INT64:
+			value->i64 = (long long)ullBits;
+			break;
+		case PL_OTYPE_FLOAT64:
+			memcpy(&value->f64, &ullBits, sizeof(ullBits));
+			break;
+	}
+}
+
+/**
+ *	\brief Serialize a typed packet structure
+ *	\param data	A pointer to a struct pl_typed containing the data to be
+ *			serialized.
+ *	\param packet	A pointer to a target character buffer
+ *	\param len	The size of the target buffer given by \a packet, it has to hold 
+ *			at least PL_TYPED_PACKETSIZE(data->count) bytes
+ *	\return		E_PL_NOERROR if successful, an error code otherwise
+ *
+ *	Operand 0 of error entries is serialized as int32, whatever the packet's type.
+ */
+int pl_make_typed(struct pl_typed *data, char *packet, unsigned int len)
+{
+	unsigned int i = 0, j = 0;
+	char *entry;
+
+	if ((data == NULL) || (packet == NULL)) 
+	{
+		printf("Error creating typed packet!\n");
+		return -E_PL_NULLPTR;
+	}
+	if (data->count > PL_TYPED_MAX_ENTRIES) return -E_PL_INVALIDCOUNT;
+	if (len < PL_TYPED_PACKETSIZE(data->count)) return -E_PL_INSUFFICIENTBUFFER;
+
+	*(int*)(&packet[PL_PIDX_TYPE]) = htonl(data->type);
+	*(int*)(&packet[PL_PIDX_MODE]) = htonl(data->mode);
+	*(int*)(&packet[PL_PIDX_TCOUNT]) = htonl(data->count);
+	*(int*)(&packet[PL_PIDX_TRID]) = htonl(data->request_id);
+	*(int*)(&packet[PL_PIDX_TTYPE]) = htonl(data->otype);
+	for (i = 0; i < data->count; i++) {
+		entry = &packet[PL_PIDX_TENTRY(i)];
+		*(int*)(&entry[PL_EIDX_TYPE]) = htonl(data->entry[i].type);
+		*(int*)(&entry[PL_EIDX_FID]) = htonl(data->entry[i].function_id);
+		for (j = 0; j < PL_OPERAND_COUNT; j++)
+			pl_put_value(&data->entry[i].data[j], ((j == 0) && (data->entry[i].type == PL_PTYPE_ERR)) ? PL_OTYPE_INT32 : data->otype,
+				     &entry[PL_EIDX_TOP(j)]);
+	}
+
+	return E_PL_NOERROR;
+}
+
+/**
+ *	\brief Unserialize a typed packet structure
+ *	\param packet	A pointer to a source character buffer
+ *	\param data	A pointer to a struct pl_typed for the data to be
+ *			unserialized.
+ *	\param len	The size of the source buffer given by \a packet
+ *	\return		E_PL_NOERROR if successful, an error code otherwise
+ *
+ *	The entry count is checked like that of batch packets. A packet of unknown operand
+ *	type gives -E_PL_INVALIDTYPE, with the header extracted but no entries.
+ */
+int pl_extr_typed(char *packet, struct pl_typed *data, unsigned int len)
+{
+	unsigned int i = 0, j = 0;
+	char *entry;
+
+	if ((data == NULL) || (packet == NULL)) 
+	{
+		printf("Error extracting typed packet!\n");
+		return -E_PL_NULLPTR;
+	}
+	if (len < PL_TYPED_HDRSIZE) return -E_PL_INSUFFICIENTBUFFER;
+
+	data->type = ntohl(*(int*)(&packet[PL_PIDX_TYPE]));
+	data->mode = ntohl(*(int*)(&packet[PL_PIDX_MODE]));
+	data->count = ntohl(*(int*)(&packet[PL_PIDX_TCOUNT]));
+	data->request_id = ntohl(*(int*)(&packet[PL_PIDX_TRID]));
+	data->otype = ntohl(*(int*)(&packet[PL_PIDX_TTYPE]));
+	if ((data->count > PL_TYPED_MAX_ENTRIES) || (len < PL_TYPED_PACKETSIZE(data->count))) {
+		data->count = 0;
+		return -E_PL_INVALIDCOUNT;
+	}
+	if ((data->otype == 0) || (data->otype >= PL_OTYPE_COUNT)) {
+		data->count = 0;
+		return -E_PL_INVALIDTYPE;
+	}
+	for (i = 0; i < data->count; i++) {
+		entry = &packet[PL_PIDX_TENTRY(i)];
+		data->entry[i].type = ntohl(*(int*)(&entry[PL_EIDX_TYPE]));
+		data->entry[i].function_id = ntohl(*(int*)(&entry[PL_EIDX_FID]));
+		for (j = 0; j < PL_OPERAND_COUNT; j++)
+			pl_get_value(&entry[PL_EIDX_TOP(j)], ((j == 0) && (data->entry[i].type == PL_PTYPE_ERR)) ? PL_OTYPE_INT32 : data->otype,
+				     &data->entry[i].data[j]);
+	}
+
+	return E_PL_NOERROR;
+}
+
+/**
+ *	\brief Create a typed request packet
+ *	\param data	A pointer to a struct pl_typed for the data to be
+ *			filled in.
+ *	\return		E_PL_NOERROR if successful, an error code otherwise
+ *
+ *	Like pl_create_batch_request(), \a otype is left to the caller.
+ */
+int pl_create_typed_request(struct pl_typed *data)
+{
+	unsigned int i = 0;
+
+	if (data == NULL) return -E_PL_NULLPTR;
+	if (data->count > PL_TYPED_MAX_ENTRIES) return -E_PL_INVALIDCOUNT;
+
+	data->type = PL_PTYPE_TREQ;
+	data->mode = PL_MODE_CLN;
+	for (i = 0; i < data->count; i++) data->entry[i].type = PL_PTYPE_REQ;
+
+	return E_PL_NOERROR;
+}
+
+/**
+ *	\brief Create a typed response packet
+ *	\param data	A pointer to a struct pl_typed for the data to be
+ *			filled in.
+ *	\return		E_PL_NOERROR if successful, an error code otherwise
+ *
+ *	Like pl_create_batch_response(), the entries are left untouched.
+ */
+int pl_create_typed_response(struct pl_typed *data)
+{
+	if (data == NULL) return -E_PL_NULLPTR;
+
+	data->type = PL_PTYPE_TRSP;
+	data->mode = PL_MODE_SRV;
+
+	return E_PL_NOERROR;
+}
+
+/**
+ *	\brief Serialize a stream packet
+ *	\param data	A pointer to a struct pl_stream holding the header, \a count gives
+ *			the number of words
+ *	\param words	The words of the packet, may be NULL if \a count is zero
+ *	\param packet	A pointer to a target character buffer
+ *	\param len	The size of the target buffer given by \a packet, it has to hold 
+ *			at least PL_STREAM_PACKETSIZE(data->count) bytes
+ *	\return		E_PL_NOERROR if successful, an error code otherwise
+ */
+int pl_make_stream(struct pl_stream *data, const unsigned int *words, char *packet, unsigned int len)
+{
+	unsigned int i = 0;
+
+	if ((data == NULL) || (packet == NULL) || ((words == NULL) && (data->count > 0))) 
+	{
+		printf("Error creating stream packet!\n");
+		return -E_PL_NULLPTR;
+	}
+	if (data->count > PL_STREAM_WORDS) return -E_PL_INVALIDCOUNT;
+	if (len < PL_STREAM_PACKETSIZE(data->count)) return -E_PL_INSUFFICIENTBUFFER;
+
+	*(int*)(&packet[PL_PIDX_TYPE]) = htonl(data->type);
+	*(int*)(&packet[PL_PIDX_MODE]) = htonl(data->mode);
+	*(int*)(&packet[PL_PIDX_FID]) = htonl(data->function_id);
+	*(int*)(&packet[PL_PIDX_SRID]) = htonl(data->request_id);
+	*(int*)(&packet[PL_PIDX_SSID]) = htonl(data->stream_id);
+	*(int*)(&packet[PL_PIDX_SSEQ]) = htonl(data->seq);
+	*(int*)(&packet[PL_PIDX_SEND]) = htonl(data->end);
+	for (i = 0; i < data->count; i++) *(int*)(&packet[PL_PIDX_SWORD(i)]) = htonl(words[i]);
+
+	return E_PL_NOERROR;
+}
+
+/**
+ *	\brief Unserialize a stream packet
+ *	\param packet	A pointer to a source character buffer
+ *	\param data	A pointer to a struct pl_stream for the header
+ *	\param words	Receives the words, NULL to only read the header. It has to hold
+ *			PL_STREAM_WORDS words.
+ *	\param len	The size of the source buffer given by \a packet
+ *	\return		E_PL_NOERROR if successful, an error code otherwise
+ *
+ *	The number of words follows from \a len, which must leave no partial word.
+ */
+int pl_extr_stream(char *packet, struct pl_stream *data, unsigned int *words, unsigned int len)
+{
+	unsigned int i = 0;
+
+	if ((data == NULL) || (packet == NULL)) 
+	{
+		printf("Error extracting stream packet!\n");
+		return -E_PL_NULLPTR;
+	}
+	if (len < PL_STREAM_HDRSIZE) return -E_PL_INSUFFICIENTBUFFER;
+	if (((len - PL_STREAM_HDRSIZE) % 4 != 0) || (len > PL_STREAM_PACKETSIZE(PL_STREAM_WORDS))) return -E_PL_INVALIDCOUNT;
+
+	data->type = ntohl(*(int*)(&packet[PL_PIDX_TYPE]));
+	data->mode = ntohl(*(int*)(&packet[PL_PIDX_MODE]));
+	data->function_id = ntohl(*(int*)(&packet[PL_PIDX_FID]));
+	data->request_id = ntohl(*(int*)(&packet[PL_PIDX_SRID]));
+	data->stream_id = ntohl(*(int*)(&packet[PL_PIDX_SSID]));
+	data->seq = ntohl(*(int*)(&packet[PL_PIDX_SSEQ]));
+	data->end = ntohl(*(int*)(&packet[PL_PIDX_SEND]));
+	data->count = (len - PL_STREAM_HDRSIZE) / 4;
+	if (words != NULL) for (i = 0; i < data->count; i++) words[i] = ntohl(*(int*)(&packet[PL_PIDX_SWORD(i)]));
+
+	return E_PL_NOERROR;
+}
+
+/**
+ *	\brief Store a stream aggregate in the words of a result packet
+ *	\param data	The aggregate, data->buckets at most PL_STREAM_MAX_BUCKETS
+ *	\param words	Receives PL_AGG_WORDS(data->buckets) words
+ *	\return		The number of words stored
+ */
+unsigned int pl_pack_aggregate(const struct pl_aggregate *data, unsigned int *words)
+{
+	unsigned int i = 0;
+
+	words[PL_AIDX_COUNT] = (unsigned int)(data->count >> 32);
+	words[PL_AIDX_COUNT + 1] = (unsigned int)data->count;
+	words[PL_AIDX_SUM] = (unsigned int)((unsigned long long)data->sum >> 32);
+	words[PL_AIDX_SUM + 1] = (unsigned int)data->sum;
+	words[PL_AIDX_MIN] = (unsigned int)data->min;
+	words[PL_AIDX_MAX] = (unsigned int)data->max;
+	words[PL_AIDX_LO] = (unsigned int)data->lo;
+	words[PL_AIDX_WIDTH] = data->width;
+	words[PL_AIDX_BUCKETS] = data->buckets;
+	words[PL_AIDX_BELOW] = (unsigned int)(data->below >> 32);
+	words[PL_AIDX_BELOW + 1] = (unsigned int)data->below;
+	words[PL_AIDX_ABOVE] = (unsigned int)(data->above >> 32);
+	words[PL_AIDX_ABOVE + 1] = (unsigned int)data->above;
+	for (i = 0; i < data->buckets; i++) {
+		words[PL_AIDX_HIST(i)] = (unsigned int)(data->hist[i] >> 32);
+		words[PL_AIDX_HIST(i) + 1] = (unsigned int)data->hist[i];
+	}
+	return PL_AGG_WORDS(data->buckets);
+}
+
+/**
+ *	\brief Get a stream aggregate from the words of a result packet
+ *	\param words	The words
+ *	\param count	Number of words
+ *	\param data	Receives the aggregate
+ *	\return		E_PL_NOERROR if successful, an error code otherwise
+ */
+int pl_unpack_aggregate(const unsigned int *words, unsigned int count, struct pl_aggregate *data)
+{
+	unsigned int i = 0;
+
+	if ((words == NULL) || (data == NULL)) return -E_PL_NULLPTR;
+	if ((count < PL_AGG_WORDS(0)) || (words[PL_AIDX_BUCKETS] > PL_STREAM_MAX_BUCKETS) ||
+	    (count != PL_AGG_WORDS(words[PL_AIDX_BUCKETS]))) return -E_PL_INVALIDCOUNT;
+
+	data->count = ((unsigned long long)words[PL_AIDX_COUNT] << 32) | words[PL_AIDX_COUNT + 1];
+	data->sum = (long long)(((unsigned long long)words[PL_AIDX_SUM] << 32) | words[PL_AIDX_SUM + 1]);
+	data->min = (int)words[PL_AIDX_MIN];
+	data->max = (int)words[PL_AIDX_MAX];
+	data->lo = (int)words[PL_AIDX_LO];
+	data->width = words[PL_AIDX_WIDTH];
+	data->buckets = words[PL_AIDX_BUCKETS];
+	data->below = ((unsigned long long)words[PL_AIDX_BELOW] << 32) | words[PL_AIDX_BELOW + 1];
+	data->above = ((unsigned long long)words[PL_AIDX_ABOVE] << 32) | words[PL_AIDX_ABOVE + 1];
+	for (i = 0; i < data->buckets; i++)
+		data->hist[i] = ((unsigned long long)words[PL_AIDX_HIST(i)] << 32) | words[PL_AIDX_HIST(i) + 1];
+
+	return E_PL_NOERROR;
+}
+
+
 /**
  *	\}
  */
@@ -3,7 +3,7 @@
  *	\brief Definitions for packet handling
  *	\author Marc Juettner, marc.juettner@juettner-itconsult.de
  *	\author Manuel Gaiser, manuel.gaiser@hs-pforzheim.de
- *	\version 1.1
+ *	\version 1.9
  *
  */
 #if !defined _packetlib_h_
@@ -13,6 +13,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <stdio.h>
+#include <string.h>
 
 // packet types
 /** \brief Request operation */
@@ -21,6 +22,30 @@
 #define PL_PTYPE_RSP	2
 /** \brief Error packet */
 #define PL_PTYPE_ERR	3
+/** \brief Batch request, carries several operations */
+#define PL_PTYPE_BREQ	4
+/** \brief Respond to batch request */
+#define PL_PTYPE_BRSP	5
+/** \brief Vector request fragment, carries part of the operands of a bulk function */
+#define PL_PTYPE_VREQ	6
+/** \brief Vector response fragment, carries part of the results */
+#define PL_PTYPE_VRSP	7
+/** \brief Vector acknowledgment, asks for the result fragments not received yet */
+#define PL_PTYPE_VACK	8
+/** \brief Open an aggregation stream */
+#define PL_PTYPE_SOPEN	9
+/** \brief Stream chunk, carries values to aggregate */
+#define PL_PTYPE_SDATA	10
+/** \brief Close a stream and ask for its result */
+#define PL_PTYPE_SCLOSE	11
+/** \brief Stream acknowledgment, tells which chunks arrived */
+#define PL_PTYPE_SACK	12
+/** \brief Stream result */
+#define PL_PTYPE_SRSP	13
+/** \brief Typed request, carries operations on operands of one type */
+#define PL_PTYPE_TREQ	14
+/** \brief Respond to typed request */
+#define PL_PTYPE_TRSP	15
 
 // packet modes
 /** \brief Client mode */
@@ -33,6 +58,23 @@
 #define PL_FID_MUL		1	
 /** \brief Division */
 #define PL_FID_DIV		2
+/** \brief Program, see PL_OP_XXX */
+#define PL_FID_PROGRAM		3
+// bulk functions, sent as vector packets or, for one element, as single requests
+/** \brief Element-wise sum of two vectors */
+#define PL_FID_VADD		4
+/** \brief Element-wise difference of two vectors */
+#define PL_FID_VSUB		5
+/** \brief Element-wise product of two vectors */
+#define PL_FID_VMUL		6
+/** \brief Dot product of two vectors */
+#define PL_FID_VDOT		7
+/** \brief Product of two matrices */
+#define PL_FID_MATMUL		8
+/** \brief Count, sum, minimum, maximum and histogram of a stream of values */
+#define PL_FID_AGGREGATE	9
+/** \brief Scrambling by the FPGA, operand 0 is scrambled with generator polynom operand 1 */
+#define PL_FID_SCRAMBLE		10
 
 // error codes in server packets
 /** \brief General error. */
@@ -45,6 +87,18 @@
 #define PL_ERR_FUNCEXECERROR	4
 /** \brief No such function. */
 #define PL_ERR_NOSUCHFUNCTION	5
+/** \brief Malformed program. */
+#define PL_ERR_INVALIDPROGRAM	6
+/** \brief Program exceeded the instruction budget. */
+#define PL_ERR_BUDGET		7
+/** \brief Too many requests in progress, try again later. */
+#define PL_ERR_BUSY		8
+/** \brief Operands too large or of invalid shape. */
+#define PL_ERR_INVALIDSHAPE	9
+/** \brief Stream unknown or expired. */
+#define PL_ERR_NOSUCHSTREAM	10
+/** \brief Operand type unknown. */
+#define PL_ERR_NOSUCHTYPE	11
 
 // error codes of packetlib functions
 /** \brief No error. */
@@ -57,6 +111,18 @@
  * Buffer size not sufficient.
  */
 #define E_PL_INSUFFICIENTBUFFER		2
+/** \brief Invalid entry count. 
+ * Batch entry count exceeds PL_BATCH_MAX_ENTRIES or the packet length.
+ */
+#define E_PL_INVALIDCOUNT		3
+/** \brief Invalid shape. 
+ * Function id and dimensions of a vector packet don't fit together.
+ */
+#define E_PL_INVALIDSHAPE		4
+/** \brief Invalid operand type. 
+ * The operand type of a typed packet is none of PL_OTYPE_XXX.
+ */
+#define E_PL_INVALIDTYPE		5
 
 
 // indices for packet content byte adressing
@@ -64,11 +130,216 @@
 #define PL_PIDX_MODE	(1*4)
 #define PL_PIDX_FID	(2*4)
 #define PL_PIDX_OP(x)	((3+x)*4)
+#define PL_PIDX_RID	PL_PIDX_OP(PL_OPERAND_COUNT)
 
 
 // definitions for operand count and packet size
 #define PL_OPERAND_COUNT	2
 #define PL_PACKETSIZE		(sizeof(struct pl_data))
+/** \brief Size of version 1.2 packets which carry no request ID */
+#define PL_PACKETSIZE_V1	PL_PIDX_RID
+
+
+// indices for batch packet content byte adressing
+#define PL_PIDX_BCOUNT		(2*4)
+#define PL_PIDX_BRID		(3*4)
+#define PL_PIDX_BENTRY(x)	(PL_BATCH_HDRSIZE + (x)*PL_BATCH_ENTRYSIZE)
+// indices within a batch entry
+#define PL_EIDX_TYPE		0
+#define PL_EIDX_FID		(1*4)
+#define PL_EIDX_OP(x)		((2+x)*4)
+
+
+// definitions for batch packet size
+/** \brief Largest datagram payload that fits into one Ethernet frame (MTU - IP/UDP header). */
+#define PL_MAX_DATAGRAM		1472
+#define PL_BATCH_HDRSIZE	(4*4)
+#define PL_BATCH_ENTRYSIZE	((2+PL_OPERAND_COUNT)*4)
+#define PL_BATCH_MAX_ENTRIES	((PL_MAX_DATAGRAM - PL_BATCH_HDRSIZE) / PL_BATCH_ENTRYSIZE)
+/** \brief Serialized size of a batch packet holding \a n entries */
+#define PL_BATCH_PACKETSIZE(n)	(PL_BATCH_HDRSIZE + (n)*PL_BATCH_ENTRYSIZE)
+
+
+// vector packets
+// The operands of a bulk function, the elements of A followed by those of B, are split
+// into fragments of PL_VEC_WORDS words (the last one may be shorter) that are numbered
+// from zero and sent in vector request packets with the same request ID. The server
+// answers with the results split the same way into vector response packets, or with a
+// single error packet. For PL_FID_MATMUL, A is a dim[0] x dim[1] and B a dim[1] x dim[2]
+// matrix, both row by row; PL_FID_SCRAMBLE takes a vector of dim[0] elements as A and the
+// generator polynom as the only element of B; the other functions take two vectors of
+// dim[0] elements. All but PL_FID_MATMUL need dim[1] and dim[2] to be zero.
+// A client missing result fragments sends a vector acknowledgment with the request's ID,
+// shape and number of result fragments whose words are a bitmap of the fragments it
+// has (fragment i is bit i % 32 of word i / 32); the server sends the others again as
+// long as it still has the results.
+#define PL_PIDX_VRID		(3*4)
+#define PL_PIDX_VSEQ		(4*4)
+#define PL_PIDX_VTOTAL		(5*4)
+#define PL_PIDX_VDIM(x)		((6+x)*4)
+#define PL_PIDX_VWORD(x)	(PL_VEC_HDRSIZE + (x)*4)
+/** \brief Number of dimensions in a vector packet */
+#define PL_VEC_DIMS		3
+#define PL_VEC_HDRSIZE		((6+PL_VEC_DIMS)*4)
+/** \brief Words per fragment */
+#define PL_VEC_WORDS		((PL_MAX_DATAGRAM - PL_VEC_HDRSIZE) / 4)
+/** \brief Serialized size of a vector packet holding \a n words */
+#define PL_VEC_PACKETSIZE(n)	(PL_VEC_HDRSIZE + (n)*4)
+/** \brief Number of fragments of \a n words */
+#define PL_VEC_FRAGMENTS(n)	(((n) + PL_VEC_WORDS - 1) / PL_VEC_WORDS)
+/** \brief Maximum number of result fragments, the bitmap of an acknowledgment fills one packet */
+#define PL_VEC_MAX_FRAGMENTS	(PL_VEC_WORDS * 32)
+
+
+// typed packets
+// A typed request carries up to PL_TYPED_MAX_ENTRIES operations like a batch request,
+// but with operands of the type given in its header instead of unsigned 32 bit words.
+// Every operand takes two words, high word first: 64 bit types fill both, 32 bit types
+// the low word with the high word holding the sign extension (int32) or zero (float32).
+// The server answers with a typed response of the same type whose entries are
+// PL_PTYPE_RSP with the result in operand 0, or PL_PTYPE_ERR with the PL_ERR_XXX code
+// as int32 operand 0. A request the server can't take apart gets a single error packet.
+#define PL_PIDX_TCOUNT		(2*4)
+#define PL_PIDX_TRID		(3*4)
+#define PL_PIDX_TTYPE		(4*4)
+#define PL_PIDX_TENTRY(x)	(PL_TYPED_HDRSIZE + (x)*PL_TYPED_ENTRYSIZE)
+// indices within a typed entry, PL_EIDX_TYPE and PL_EIDX_FID as in batch entries
+#define PL_EIDX_TOP(x)		((2+2*(x))*4)
+#define PL_TYPED_HDRSIZE	(5*4)
+#define PL_TYPED_ENTRYSIZE	((2+2*PL_OPERAND_COUNT)*4)
+#define PL_TYPED_MAX_ENTRIES	((PL_MAX_DATAGRAM - PL_TYPED_HDRSIZE) / PL_TYPED_ENTRYSIZE)
+/** \brief Serialized size of a typed packet holding \a n entries */
+#define PL_TYPED_PACKETSIZE(n)	(PL_TYPED_HDRSIZE + (n)*PL_TYPED_ENTRYSIZE)
+
+// operand types
+/** \brief Signed 32 bit integer */
+#define PL_OTYPE_INT32		1
+/** \brief Signed 64 bit integer */
+#define PL_OTYPE_INT64		2
+/** \brief IEEE 754 single precision */
+#define PL_OTYPE_FLOAT32	3
+/** \brief IEEE 754 double precision */
+#define PL_OTYPE_FLOAT64	4
+/** \brief Number of operand types plus one, types are numbered from one */
+#define PL_OTYPE_COUNT		5
+
+
+// stream packets (PL_FID_AGGREGATE)
+// A client opens a stream with an ID of its choice, sends the values in numbered chunks
+// of up to PL_STREAM_WORDS words and closes the stream. The server folds every chunk into
+// the stream's aggregate when it arrives and keeps nothing else, so a stream may carry
+// any number of values. PL_PTYPE_SOPEN carries the histogram parameters: lower bound,
+// bucket width and number of buckets (zero for no histogram). Values are signed 32 bit
+// integers; value v falls into bucket (v - lower bound) / width.
+// Chunks are sent in windows of at most PL_STREAM_WINDOW chunks, \a end being the number
+// of the first chunk after the window. The server acknowledges the open request, the
+// last chunk of a window and the chunk that completes a window with a PL_PTYPE_SACK whose
+// \a seq is the number of chunks received in a row from zero and whose words are a bitmap
+// of the PL_STREAM_WINDOW chunks after those (chunk seq + i is bit i % 32 of word i / 32).
+// PL_PTYPE_SCLOSE carries the number of chunks in \a seq; if all of them arrived the
+// server answers with PL_PTYPE_SRSP, words as given by PL_AIDX_XXX, otherwise with an
+// acknowledgment. Replies carry the request ID of the packet they answer, errors come as
+// single error packets.
+#define PL_PIDX_SRID		(3*4)
+#define PL_PIDX_SSID		(4*4)
+#define PL_PIDX_SSEQ		(5*4)
+#define PL_PIDX_SEND		(6*4)
+#define PL_PIDX_SWORD(x)	(PL_STREAM_HDRSIZE + (x)*4)
+#define PL_STREAM_HDRSIZE	(7*4)
+/** \brief Words per chunk */
+#define PL_STREAM_WORDS		((PL_MAX_DATAGRAM - PL_STREAM_HDRSIZE) / 4)
+/** \brief Serialized size of a stream packet holding \a n words */
+#define PL_STREAM_PACKETSIZE(n)	(PL_STREAM_HDRSIZE + (n)*4)
+/** \brief Chunks per window, a multiple of 32 */
+#define PL_STREAM_WINDOW	64
+/** \brief Maximum number of histogram buckets */
+#define PL_STREAM_MAX_BUCKETS	128
+/** \brief Words of a PL_PTYPE_SOPEN packet */
+#define PL_STREAM_OPEN_WORDS	3
+
+// words of a stream result, 64 bit values high word first
+#define PL_AIDX_COUNT		0
+#define PL_AIDX_SUM		2
+#define PL_AIDX_MIN		4
+#define PL_AIDX_MAX		5
+#define PL_AIDX_LO		6
+#define PL_AIDX_WIDTH		7
+#define PL_AIDX_BUCKETS		8
+#define PL_AIDX_BELOW		9
+#define PL_AIDX_ABOVE		11
+#define PL_AIDX_HIST(x)		(13 + 2*(x))
+/** \brief Words of a stream result with \a n buckets */
+#define PL_AGG_WORDS(n)		PL_AIDX_HIST(n)
+
+
+// programs (PL_FID_PROGRAM)
+// A program request is a request packet followed by the program's code. Operands 0 and
+// 1 are the initial values of registers 0 and 1, the others start at zero. Execution
+// ends with PL_OP_HALT or at the end of the code; the response carries the top of the
+// stack (register 0 if the stack is empty) as operand 0 and the number of instructions
+// executed as operand 1. Error packets carry the offset of the failing instruction as
+// operand 1. All values are unsigned 32 bit integers, immediates are in network byte
+// order. The stack must have the same depth whenever an instruction is reached.
+/** \brief Offset of the code in a program request */
+#define PL_PIDX_CODE		PL_PACKETSIZE
+/** \brief Maximum code size */
+#define PL_PROG_MAX_CODE	(PL_MAX_DATAGRAM - PL_PIDX_CODE)
+/** \brief Number of registers */
+#define PL_PROG_REGISTERS	8
+/** \brief Maximum stack depth */
+#define PL_PROG_STACK		32
+
+// program opcodes, followed by their immediate operand if any
+/** \brief Stop, the top of the stack is the result */
+#define PL_OP_HALT		0x00
+/** \brief Push a 4 byte immediate */
+#define PL_OP_PUSH		0x01
+/** \brief Push a 1 byte immediate */
+#define PL_OP_PUSHB		0x02
+/** \brief Push the register given by a 1 byte immediate */
+#define PL_OP_LOAD		0x03
+/** \brief Pop into the register given by a 1 byte immediate */
+#define PL_OP_STORE		0x04
+/** \brief Duplicate the top of the stack */
+#define PL_OP_DUP		0x05
+/** \brief Pop and discard */
+#define PL_OP_DROP		0x06
+/** \brief Exchange the two topmost values */
+#define PL_OP_SWAP		0x07
+/** \brief Push a copy of the second value */
+#define PL_OP_OVER		0x08
+// binary operations pop b, then a, and push a op b
+/** \brief a + b */
+#define PL_OP_ADD		0x10
+/** \brief a - b */
+#define PL_OP_SUB		0x11
+/** \brief a * b */
+#define PL_OP_MUL		0x12
+/** \brief a / b, PL_ERR_FUNCEXECERROR if b is zero */
+#define PL_OP_DIV		0x13
+/** \brief a % b, PL_ERR_FUNCEXECERROR if b is zero */
+#define PL_OP_MOD		0x14
+/** \brief a & b */
+#define PL_OP_AND		0x15
+/** \brief a | b */
+#define PL_OP_OR		0x16
+/** \brief a ^ b */
+#define PL_OP_XOR		0x17
+/** \brief a << (b & 31) */
+#define PL_OP_SHL		0x18
+/** \brief a >> (b & 31) */
+#define PL_OP_SHR		0x19
+/** \brief 1 if a < b, else 0 */
+#define PL_OP_LT		0x1a
+/** \brief 1 if a == b, else 0 */
+#define PL_OP_EQ		0x1b
+// jumps take a 2 byte code offset, conditional jumps pop their condition
+/** \brief Jump */
+#define PL_OP_JMP		0x20
+/** \brief Jump if zero */
+#define PL_OP_JZ		0x21
+/** \brief Jump if not zero */
+#define PL_OP_JNZ		0x22
 
 
 // Some macros that shall make the daemon code more readable
@@ -102,15 +373,151 @@
  */
 #define PLM_OPERAND(x, y)	x.data[y]
 
+/** 
+ *      \brief Get the packet request ID
+ *	\param x	An instance of struct pl_data or struct pl_batch
+ *	\return		request id
+ */
+#define PLM_REQUEST_ID(x)	x.request_id
+
+/** 
+ *	\brief Get the number of entries of a batch packet
+ *	\param x	An instance of struct pl_batch
+ *	\return		entry count
+ */
+#define PLM_BATCH_COUNT(x)	x.count
+
+/** 
+ *	\brief Return a batch entry
+ *	\param x	An instance of struct pl_batch
+ *	\param y	The requested entry
+ *	\return		The requested entry (a struct pl_batch_entry).
+ */
+#define PLM_BATCH_ENTRY(x, y)	x.entry[y]
+
 /**
  *	\brief packet data structure
  *	This structure represents the core data structure of the protocol.
+ *	The request ID lets a client match replies to requests when several of them are in 
+ *	flight. It follows the operands, so packets without it (PL_PACKETSIZE_V1 bytes) are 
+ *	still understood and carry request ID 0.
  */
 struct pl_data {
 	unsigned int type;			/**< \brief The packet type. */
 	unsigned int mode;			/**< \brief The packet mode. */
 	unsigned int function_id;		/**< \brief The function ID. */
 	unsigned int data[PL_OPERAND_COUNT];	/**< \brief The packet's operands. */
+	unsigned int request_id;		/**< \brief Chosen by the client, echoed by the server. */
+};
+
+/**
+ *	\brief batch entry data structure
+ *	One operation of a batch packet. In requests \a type is PL_PTYPE_REQ, in responses
+ *	it is PL_PTYPE_RSP or PL_PTYPE_ERR and \a data is set as in a single response or 
+ *	error packet.
+ */
+struct pl_batch_entry {
+	unsigned int type;			/**< \brief The entry type. */
+	unsigned int function_id;		/**< \brief The function ID. */
+	unsigned int data[PL_OPERAND_COUNT];	/**< \brief The entry's operands. */
+};
+
+/**
+ *	\brief batch packet data structure
+ *	A batch packet carries up to PL_BATCH_MAX_ENTRIES operations in one datagram. Only
+ *	the first \a count entries are serialized.
+ */
+struct pl_batch {
+	unsigned int type;			/**< \brief The packet type. */
+	unsigned int mode;			/**< \brief The packet mode. */
+	unsigned int count;			/**< \brief Number of valid entries. */
+	unsigned int request_id;		/**< \brief Chosen by the client, echoed by the server. */
+	struct pl_batch_entry entry[PL_BATCH_MAX_ENTRIES];	/**< \brief The operations. */
+};
+
+/**
+ *	\brief typed operand
+ *	The member given by the operand type of the packet is valid.
+ */
+union pl_value {
+	int i32;				/**< \brief PL_OTYPE_INT32 */
+	long long i64;				/**< \brief PL_OTYPE_INT64 */
+	float f32;				/**< \brief PL_OTYPE_FLOAT32 */
+	double f64;				/**< \brief PL_OTYPE_FLOAT64 */
+};
+
+/**
+ *	\brief typed entry data structure
+ *	One operation of a typed packet, like a batch entry with typed operands. Error
+ *	entries carry their PL_ERR_XXX code in data[0].i32.
+ */
+struct pl_typed_entry {
+	unsigned int type;			/**< \brief The entry type. */
+	unsigned int function_id;		/**< \brief The function ID. */
+	union pl_value data[PL_OPERAND_COUNT];	/**< \brief The entry's operands. */
+};
+
+/**
+ *	\brief typed packet data structure
+ *	Up to PL_TYPED_MAX_ENTRIES operations on operands of type \a otype. Only the first 
+ *	\a count entries are serialized.
+ */
+struct pl_typed {
+	unsigned int type;			/**< \brief The packet type. */
+	unsigned int mode;			/**< \brief The packet mode. */
+	unsigned int count;			/**< \brief Number of valid entries. */
+	unsigned int request_id;		/**< \brief Chosen by the client, echoed by the server. */
+	unsigned int otype;			/**< \brief Operand type, one of PL_OTYPE_XXX. */
+	struct pl_typed_entry entry[PL_TYPED_MAX_ENTRIES];	/**< \brief The operations. */
+};
+
+/**
+ *	\brief vector packet data structure
+ *	The header of one fragment of a bulk function's operands or results. The words 
+ *	themselves are serialized from and unserialized into a separate array.
+ */
+struct pl_vector {
+	unsigned int type;			/**< \brief The packet type. */
+	unsigned int mode;			/**< \brief The packet mode. */
+	unsigned int function_id;		/**< \brief The function ID. */
+	unsigned int request_id;		/**< \brief Chosen by the client, the same for all fragments. */
+	unsigned int seq;			/**< \brief Number of the fragment, from zero. */
+	unsigned int total;			/**< \brief Number of fragments. */
+	unsigned int dim[PL_VEC_DIMS];		/**< \brief Shape of the operands. */
+	unsigned int count;			/**< \brief Number of words, not serialized. */
+};
+
+/**
+ *	\brief stream packet data structure
+ *	The header of a stream packet, the words are serialized from and unserialized into 
+ *	a separate array like those of vector packets.
+ */
+struct pl_stream {
+	unsigned int type;			/**< \brief The packet type. */
+	unsigned int mode;			/**< \brief The packet mode. */
+	unsigned int function_id;		/**< \brief The function ID. */
+	unsigned int request_id;		/**< \brief Chosen by the client, echoed by the server. */
+	unsigned int stream_id;			/**< \brief Chosen by the client when opening the stream. */
+	unsigned int seq;			/**< \brief Chunk number, see above. */
+	unsigned int end;			/**< \brief End of the window of a chunk. */
+	unsigned int count;			/**< \brief Number of words, not serialized. */
+};
+
+/**
+ *	\brief aggregate of a stream
+ *	Minimum and maximum of a stream without values are INT_MAX and INT_MIN.
+ */
+struct pl_aggregate {
+	unsigned long long count;		/**< \brief Number of values. */
+	long long sum;				/**< \brief Sum of the values. */
+	int min;				/**< \brief Smallest value. */
+	int max;				/**< \brief Largest value. */
+	int lo;					/**< \brief Lower bound of the histogram. */
+	unsigned int width;			/**< \brief Bucket width. */
+	unsigned int buckets;			/**< \brief Number of buckets. */
+	unsigned long long below;		/**< \brief Values below the histogram. */
+	unsigned long long above;		/**< \brief Values above the histogram. */
+	unsigned long long hist[PL_STREAM_MAX_BUCKETS];	/**< \brief Values per bucket. */
 };
 
 // Function prototypes
@@ -119,5 +526,22 @@ int pl_extr_packet(char*, struct pl_data *, unsigned int);
 int pl_create_response(struct pl_data *);
 int pl_create_request(struct pl_data *);
 int pl_create_error(struct pl_data *, int);
+int pl_peek_type(char *, unsigned int);
+unsigned int pl_peek_request_id(char *, unsigned int);
+int pl_make_batch(struct pl_batch *, char *, unsigned int);
+int pl_extr_batch(char *, struct pl_batch *, unsigned int);
+int pl_create_batch_request(struct pl_batch *);
+int pl_create_batch_response(struct pl_batch *);
+int pl_make_vector(struct pl_vector *, const unsigned int *, char *, unsigned int);
+int pl_extr_vector(char *, struct pl_vector *, unsigned int *, unsigned int);
+int pl_vector_size(unsigned int, const unsigned int *, unsigned int *, unsigned int *, unsigned int *);
+int pl_make_typed(struct pl_typed *, char *, unsigned int);
+int pl_extr_typed(char *, struct pl_typed *, unsigned int);
+int pl_create_typed_request(struct pl_typed *);
+int pl_create_typed_response(struct pl_typed *);
+int pl_make_stream(struct pl_stream *, const unsigned int *, char *, unsigned int);
+int pl_extr_stream(char *, struct pl_stream *, unsigned int *, unsigned int);
+unsigned int pl_pack_aggregate(const struct pl_aggregate *, unsigned int *);
+int pl_unpack_aggregate(const unsigned int *, unsigned int, struct pl_aggregate *);
 
 #endif //#define _packetlib_h_
@@ -2,9 +2,14 @@
  *	\file 7seg.c Sevensegment display access
  *	\brief Functions to access the sevensegment display
  *	\author Marc Juettner, marc.juettner@juettner-itconsult.de
- *	\version 1.0
+ *	\version 1.2
  *
- *	\warning These functions are NOT thread-safe!
+ *	sevenseg_setch() only remembers the latest character, in a variable written
+ *	atomically, so it may be called from several threads for every request without a
+ *	lock or a system call. A thread started by sevenseg_open() writes that character to
+ *	the display every SEVENSEG_REFRESH_MS milliseconds if it changed; characters set in
+ *	between are never shown, nobody could read them anyway. Without a display (null
+ *	backend) there is no thread and characters are only remembered.
  */
 #include "7seg.h"
 
@@ -14,41 +19,113 @@
  *
  * 	\{
  */
-static int iFileDesc = 0;
+static int iFileDesc = -1;
+static pthread_mutex_t sevenseg_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sevenseg_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t sevenseg_thread;
+static int iRunning = 0;
+static int iStop = 0;
+static int iLatest = -1;
+static int iShown = -1;
+
+/**
+ *	\brief Write the latest character to the display if it changed
+ *
+ *	Called by the display thread only. A failed write closes the display, the null
+ *	backend takes over.
+ */
+static void sevenseg_flush(void)
+{
+	int iChar = __atomic_load_n(&iLatest, __ATOMIC_RELAXED);
+	char ch = (char)iChar;
+
+	if ((iChar < 0) || (iChar == iShown) || (iFileDesc < 0)) return;
+	if ( write(iFileDesc,&ch,1) < 0 )
+	{
+		printf("Fehler beim Schreiben auf die Ausgabedatei.\n");
+		close(iFileDesc);
+		__atomic_store_n(&iFileDesc, -1, __ATOMIC_RELAXED);
+		return;
+	}
+	iShown = iChar;
+}
+
+/**
+ *	\brief Main function of the display thread
+ *	\param arg	Unused
+ *	\return		NULL
+ *
+ *	Flushes once more after sevenseg_close() asked it to end, so the display shows the
+ *	last character set.
+ */
+static void *sevenseg_main(void *arg)
+{
+	struct timespec deadline;
+
+	pthread_mutex_lock(&sevenseg_lock);
+	for (;;) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += SEVENSEG_REFRESH_MS * 1000000L;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+		while (!iStop && (pthread_cond_timedwait(&sevenseg_cond, &sevenseg_lock, &deadline) == 0));
+		pthread_mutex_unlock(&sevenseg_lock);
+		sevenseg_flush();
+		pthread_mutex_lock(&sevenseg_lock);
+		if (iStop) break;
+	}
+	pthread_mutex_unlock(&sevenseg_lock);
+	return NULL;
+}
 
 /** 
  *	\brief Write character to sevensegment display
  *	\param ch	Character to write (0-9, A-F)
- *	\return		Zero if successful, negative value otherwise.
+ *	\return		Zero if a display is open, negative value otherwise.
  *
  *	This function prints the given character to the sevensegment display if the
  *	character is displayable. Characters from binary 0 to binary 15 are converted
  *	to output of character '0' to 'f', e.g. writing 10 prints 'a' and so on.
+ *	The character is shown within SEVENSEG_REFRESH_MS milliseconds unless another one
+ *	is set before; setting the character shown already costs a load only.
  */
 int sevenseg_setch(char ch) {
-	
-	if ( write(iFileDesc,&ch,1) < 0 )
-	{
-		printf("Fehler beim Schreiben auf die Ausgabedatei.\n");
-		close(iFileDesc);
-		return -3;
-	}
-	return 0;	
+
+	if ( __atomic_load_n(&iLatest, __ATOMIC_RELAXED) != (unsigned char)ch )
+		__atomic_store_n(&iLatest, (unsigned char)ch, __ATOMIC_RELAXED);
+	return ( __atomic_load_n(&iFileDesc, __ATOMIC_RELAXED) < 0 ) ? -2 : 0;
 }
 
 /** 
  *	\brief Open sevensegment display
  *	\return	Zero if successful, negative value otherwise
  *
- *	Opens the sevensegment display and stores the resulting file descriptor
- *	globally (implying that these functions are NOT thread-safe!).
+ *	Opens the sevensegment display, stores the resulting file descriptor
+ *	globally and starts the display thread. Writing to a display that could not be
+ *	opened fails silently.
  *	\note	The device file /dev/7segment has to exist and the corresponding
  *		driver has to be loaded.
  */
 int sevenseg_open(void) {
 	
-	iFileDesc=open("/dev/7segment",O_WRONLY);
-	if ( iFileDesc < 0 )
+	int iDesc = open("/dev/7segment",O_WRONLY);
+
+	pthread_mutex_lock(&sevenseg_lock);
+	if ( (iDesc >= 0) && !iRunning )
+	{
+		__atomic_store_n(&iFileDesc, iDesc, __ATOMIC_RELAXED);
+		iShown = -1;
+		iStop = 0;
+		if ( pthread_create(&sevenseg_thread, NULL, sevenseg_main, NULL) == 0 ) iRunning = 1;
+		else
+		{
+			close(iDesc);
+			__atomic_store_n(&iFileDesc, -1, __ATOMIC_RELAXED);
+			iDesc = -1;
+		}
+	}
+	pthread_mutex_unlock(&sevenseg_lock);
+	if ( iDesc < 0 )
 	{	//Fehler beim �ffnen der Datei
 		printf("Fehler beim oeffnen von /dev/7segment.\n");
 		return -2;
@@ -61,10 +138,28 @@ int sevenseg_open(void) {
  *	\brief Open sevensegment display
  *	\return	Zero
  *
- *	Closes the sevensegment display.
+ *	Shows the last character set, ends the display thread and closes the
+ *	sevensegment display.
  */
 int sevenseg_close(void) {
-	close(iFileDesc);
+	int iJoin = 0;
+
+	pthread_mutex_lock(&sevenseg_lock);
+	if ( iRunning )
+	{
+		iStop = 1;
+		pthread_cond_signal(&sevenseg_cond);
+		iJoin = 1;
+	}
+	pthread_mutex_unlock(&sevenseg_lock);
+	if ( iJoin ) pthread_join(sevenseg_thread, NULL);
+
+	pthread_mutex_lock(&sevenseg_lock);
+	iRunning = 0;
+	iStop = 0;
+	if ( iFileDesc >= 0 ) close(iFileDesc);
+	__atomic_store_n(&iFileDesc, -1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&sevenseg_lock);
 	return 0;
 }
 /**
@@ -3,7 +3,7 @@
  *	\brief Functions to access the sevensegment display
  *	
  *	\author Marc Juettner, marc.juettner@juettner-itconsult.de
- *	\version 1.0
+ *	\version 1.2
  *
  */
 #if !defined _7seg_h_
@@ -14,6 +14,14 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+/** \brief Refresh interval.
+ *
+ * Milliseconds between two writes to the display at most.
+ */
+#define SEVENSEG_REFRESH_MS	100
 
 int sevenseg_setch(char ch);
 int sevenseg_open(void);
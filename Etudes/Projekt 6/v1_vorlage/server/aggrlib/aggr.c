@@ -0,0 +1,272 @@
+/**
+ *	\file aggr.c
+ *	\brief Aggregation of values streamed in many datagrams
+ *	\version 1.0
+ *
+ *	\par Overview
+ *	A stream's values arrive as numbered chunks, in any order and possibly more than
+ *	once. Each new chunk is folded into the stream's count, sum, minimum, maximum and
+ *	histogram right away and then forgotten; only which chunks arrived is kept, as the
+ *	number received in a row plus a bitmap of the AG_WINDOW chunks after them. Senders
+ *	must not run further ahead, chunks beyond the window are refused. Streams are keyed
+ *	by sender address, port and stream ID. A stream that gets no packet within the
+ *	lifetime is dropped, a closed one remembers its result until then so a repeated
+ *	close gets the same answer.
+ *
+ *	\warning A table must only be used by one thread.
+ */
+#include "aggr.h"
+
+/**
+ *	\ingroup vslabdaemon
+ *	\defgroup aggr Aggregation streams
+ *
+ * 	\{
+ */
+
+/**
+ *	\brief Check whether two socket addresses are the same sender
+ *	\param a	Stored address
+ *	\param b	Address of a received datagram
+ *	\return		Nonzero if family, address and port are equal
+ */
+static int ag_same(struct sockaddr_storage *a, struct sockaddr *b)
+{
+	struct sockaddr_in *a4 = (struct sockaddr_in *)a, *b4 = (struct sockaddr_in *)b;
+	struct sockaddr_in6 *a6 = (struct sockaddr_in6 *)a, *b6 = (struct sockaddr_in6 *)b;
+
+	if (a->ss_family != b->sa_family) return 0;
+	if (b->sa_family == AF_INET)
+		return (a4->sin_port == b4->sin_port) && (a4->sin_addr.s_addr == b4->sin_addr.s_addr);
+	if (b->sa_family == AF_INET6)
+		return (a6->sin6_port == b6->sin6_port) &&
+		       (memcmp(&a6->sin6_addr, &b6->sin6_addr, sizeof(struct in6_addr)) == 0);
+	return 0;
+}
+
+/**
+ *	\brief Fold values into the histogram of a stream
+ *	\param stream	The stream, with buckets
+ *	\param values	The values
+ *	\param n	Number of values
+ *
+ *	The distance of a value from the lower bound always fits into 32 unsigned bits,
+ *	so the bucket is found by the stream's magic number instead of a division.
+ */
+static void ag_histogram(struct ag_stream *stream, const unsigned int *values, unsigned int n)
+{
+	unsigned int i, uBucket;
+	long long llDist;
+
+	for (i = 0; i < n; i++) {
+		llDist = (long long)(int)values[i] - stream->iLo;
+		if (llDist < 0) {
+			stream->ullBelow++;
+			continue;
+		}
+		uBucket = fdiv_apply(&stream->width, (unsigned int)llDist);
+		if (uBucket < stream->uBuckets) stream->hist[uBucket]++;
+		else stream->ullAbove++;
+	}
+}
+
+/**
+ *	\brief Move the window of a stream past the chunks received in a row
+ *	\param stream	The stream
+ */
+static void ag_advance(struct ag_stream *stream)
+{
+	unsigned int i;
+
+	while (stream->map[0] & 1) {
+		for (i = 0; i + 1 < AG_WINDOW / 32; i++) stream->map[i] = (stream->map[i] >> 1) | (stream->map[i + 1] << 31);
+		stream->map[i] >>= 1;
+		stream->uBase++;
+	}
+}
+
+/**
+ *	\brief Set up an aggregation table
+ *	\param table	The table to initialize
+ *	\param streams	Number of streams aggregated at the same time
+ *	\param maxbuckets	Largest histogram accepted
+ *	\param lifetime	Milliseconds a stream waits for its next packet
+ *	\return		Zero if successful, an error code otherwise
+ *
+ *	The buckets of all streams are allocated here, so serving a stream allocates nothing.
+ */
+int ag_init(struct ag_table *table, unsigned int streams, unsigned int maxbuckets, unsigned long lifetime)
+{
+	unsigned int i;
+
+	memset(table, 0x00, sizeof(struct ag_table));
+
+	table->streams = calloc(streams, sizeof(struct ag_stream));
+	table->hist = calloc((size_t)streams * (maxbuckets ? maxbuckets : 1), sizeof(unsigned long long));
+	if ((table->streams == NULL) || (table->hist == NULL)) {
+		free(table->streams);
+		free(table->hist);
+		table->streams = NULL;
+		table->hist = NULL;
+		return -EAG_NOMEM;
+	}
+	for (i = 0; i < streams; i++) table->streams[i].hist = &table->hist[(size_t)i * maxbuckets];
+	table->uStreams = streams;
+	table->uMaxBuckets = maxbuckets;
+	table->ulLifetime = lifetime;
+	return EAG_NOERROR;
+}
+
+/**
+ *	\brief Free an aggregation table
+ *	\param table	A table set up by ag_init()
+ */
+void ag_free(struct ag_table *table)
+{
+	free(table->streams);
+	free(table->hist);
+	table->streams = NULL;
+	table->hist = NULL;
+}
+
+/**
+ *	\brief Open a stream
+ *	\param table	The table
+ *	\param remote	Sender of the open request
+ *	\param uStreamId	Stream ID
+ *	\param lo	Lower bound of the histogram
+ *	\param width	Bucket width, not zero if there are buckets
+ *	\param buckets	Number of buckets, zero for no histogram
+ *	\param now	Current time, see rc_now()
+ *	\param stream	Receives the stream
+ *	\return		Zero if the stream was opened or already open with the same
+ *			parameters, -EAG_INVALID if the parameters don't fit the table or
+ *			the open stream, -EAG_BUSY if all streams are in use
+ *
+ *	Closed streams are reused only if there is no unused one.
+ */
+int ag_open(struct ag_table *table, struct sockaddr *remote, unsigned int uStreamId, int lo, unsigned int width,
+	    unsigned int buckets, unsigned long now, struct ag_stream **stream)
+{
+	struct ag_stream *s = ag_find(table, remote, uStreamId, now), *free_stream = NULL, *done_stream = NULL;
+	unsigned int i;
+
+	*stream = NULL;
+	if ((buckets > table->uMaxBuckets) || ((buckets > 0) && (width == 0))) return -EAG_INVALID;
+
+	// a repeated open request
+	if (s != NULL) {
+		if ((s->iLo != lo) || (s->uBuckets != buckets) || (s->uWidth != (buckets ? width : 0))) return -EAG_INVALID;
+		*stream = s;
+		return EAG_NOERROR;
+	}
+
+	for (i = 0; i < table->uStreams; i++) {
+		if (table->streams[i].remote.ss_family == AF_UNSPEC) {
+			free_stream = &table->streams[i];
+			break;
+		}
+		if (table->streams[i].iDone && (done_stream == NULL)) done_stream = &table->streams[i];
+	}
+	if (free_stream == NULL) free_stream = done_stream;
+	if (free_stream == NULL) return -EAG_BUSY;
+
+	s = free_stream;
+	memset(&s->remote, 0x00, sizeof(s->remote));
+	memcpy(&s->remote, remote, (remote->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+	s->uStreamId = uStreamId;
+	s->iDone = 0;
+	s->ulExpiry = now + table->ulLifetime;
+	s->uBase = 0;
+	memset(s->map, 0x00, sizeof(s->map));
+	s->ullCount = 0;
+	s->llSum = 0;
+	s->iMin = INT_MAX;
+	s->iMax = INT_MIN;
+	s->iLo = lo;
+	s->uWidth = buckets ? width : 0;
+	if (buckets > 0) fdiv_gen(&s->width, width);
+	s->uBuckets = buckets;
+	s->ullBelow = 0;
+	s->ullAbove = 0;
+	memset(s->hist, 0x00, buckets * sizeof(unsigned long long));
+	table->ulOpened++;
+	*stream = s;
+	return EAG_NOERROR;
+}
+
+/**
+ *	\brief Find a stream
+ *	\param table	The table
+ *	\param remote	Sender of the stream
+ *	\param uStreamId	Stream ID
+ *	\param now	Current time, see rc_now()
+ *	\return		The stream, NULL if it isn't open or was dropped
+ *
+ *	Streams whose lifetime is over are dropped on the way.
+ */
+struct ag_stream *ag_find(struct ag_table *table, struct sockaddr *remote, unsigned int uStreamId, unsigned long now)
+{
+	struct ag_stream *s;
+	unsigned int i;
+
+	for (i = 0; i < table->uStreams; i++) {
+		s = &table->streams[i];
+		if (s->remote.ss_family == AF_UNSPEC) continue;
+		if ((long)(now - s->ulExpiry) >= 0) {
+			if (!s->iDone) table->ulExpired++;
+			s->remote.ss_family = AF_UNSPEC;
+			continue;
+		}
+		if ((s->uStreamId == uStreamId) && ag_same(&s->remote, remote)) return s;
+	}
+	return NULL;
+}
+
+/**
+ *	\brief Fold a chunk into a stream
+ *	\param table	The table
+ *	\param stream	The stream, found by ag_find() and not closed
+ *	\param seq	Number of the chunk
+ *	\param values	The chunk's values
+ *	\param n	Number of values
+ *	\param now	Current time, see rc_now()
+ *	\return		One if the chunk was new, zero for a duplicate, -EAG_WINDOW if it is
+ *			beyond the window
+ */
+int ag_add(struct ag_table *table, struct ag_stream *stream, unsigned int seq, const unsigned int *values,
+	   unsigned int n, unsigned long now)
+{
+	unsigned int uOffset = seq - stream->uBase;
+
+	stream->ulExpiry = now + table->ulLifetime;
+	if ((int)uOffset < 0) return 0;
+	if (uOffset >= AG_WINDOW) return -EAG_WINDOW;
+	if (stream->map[uOffset / 32] & (1U << (uOffset % 32))) return 0;
+	stream->map[uOffset / 32] |= 1U << (uOffset % 32);
+
+	stream->ullCount += n;
+	krn.stat(values, n, &stream->llSum, &stream->iMin, &stream->iMax);
+	if (stream->uBuckets > 0) ag_histogram(stream, values, n);
+	ag_advance(stream);
+	return 1;
+}
+
+/**
+ *	\brief Close a stream
+ *	\param table	The table
+ *	\param stream	The stream
+ *
+ *	The stream keeps its aggregate for repeated close requests until its lifetime is
+ *	over or it is needed for another stream.
+ */
+void ag_close(struct ag_table *table, struct ag_stream *stream)
+{
+	if (stream->iDone) return;
+	stream->iDone = 1;
+	table->ulClosed++;
+}
+
+/**
+ *	\}
+ */
@@ -0,0 +1,83 @@
+/**
+ *	\file aggr.h
+ *	\brief Aggregation of values streamed in many datagrams (header)
+ *	\version 1.0
+ *
+ */
+#if !defined _aggr_h_
+#define _aggr_h_
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "../kernellib/kernel.h"
+#include "../kernellib/fastdiv.h"
+
+//ERROR CODES for aggregation functions
+#define EAG_NOERROR		0
+#define EAG_NOMEM		1
+#define EAG_BUSY		2
+#define EAG_INVALID		3
+#define EAG_WINDOW		4
+
+/** \brief Window size.
+ *
+ * Number of chunks beyond the ones received in a row that a stream keeps track of, a
+ * multiple of 32.
+ */
+#define AG_WINDOW		64
+
+/**
+ *	\brief A stream being aggregated
+ */
+struct ag_stream {
+	struct sockaddr_storage remote;	/**< \brief Sender, family AF_UNSPEC if the stream is unused. */
+	unsigned int uStreamId;		/**< \brief Stream ID chosen by the sender. */
+	int iDone;			/**< \brief Set by ag_close(), the stream only answers duplicates. */
+	unsigned long ulExpiry;		/**< \brief Milliseconds timestamp the stream is dropped at. */
+	unsigned int uBase;		/**< \brief Number of chunks received in a row from zero. */
+	unsigned int map[AG_WINDOW / 32];	/**< \brief Chunk uBase + i received: bit i % 32 of word i / 32. */
+	unsigned long long ullCount;	/**< \brief Number of values. */
+	long long llSum;		/**< \brief Sum of the values. */
+	int iMin;			/**< \brief Smallest value, INT_MAX if there is none. */
+	int iMax;			/**< \brief Largest value, INT_MIN if there is none. */
+	int iLo;			/**< \brief Lower bound of the histogram. */
+	unsigned int uWidth;		/**< \brief Bucket width. */
+	struct fdiv_magic width;	/**< \brief Magic number dividing by \a uWidth. */
+	unsigned int uBuckets;		/**< \brief Number of buckets, zero for no histogram. */
+	unsigned long long ullBelow;	/**< \brief Values below the histogram. */
+	unsigned long long ullAbove;	/**< \brief Values above the histogram. */
+	unsigned long long *hist;	/**< \brief Values per bucket, part of the table's allocation. */
+};
+
+/**
+ *	\brief An aggregation table
+ *
+ *	A fixed number of streams with a fixed maximum number of buckets, so memory is
+ *	bounded however many values or senders there are.
+ */
+struct ag_table {
+	struct ag_stream *streams;	/**< \brief The streams. */
+	unsigned int uStreams;		/**< \brief Number of streams. */
+	unsigned int uMaxBuckets;	/**< \brief Largest histogram accepted. */
+	unsigned long ulLifetime;	/**< \brief Milliseconds a stream waits for its next packet. */
+	unsigned long long *hist;	/**< \brief Buckets of all streams. */
+	unsigned long ulOpened;		/**< \brief Streams opened. */
+	unsigned long ulClosed;		/**< \brief Streams closed. */
+	unsigned long ulExpired;	/**< \brief Streams dropped before they were closed. */
+};
+
+int ag_init(struct ag_table *table, unsigned int streams, unsigned int maxbuckets, unsigned long lifetime);
+void ag_free(struct ag_table *table);
+int ag_open(struct ag_table *table, struct sockaddr *remote, unsigned int uStreamId, int lo, unsigned int width,
+	    unsigned int buckets, unsigned long now, struct ag_stream **stream);
+struct ag_stream *ag_find(struct ag_table *table, struct sockaddr *remote, unsigned int uStreamId, unsigned long now);
+int ag_add(struct ag_table *table, struct ag_stream *stream, unsigned int seq, const unsigned int *values,
+	   unsigned int n, unsigned long now);
+void ag_close(struct ag_table *table, struct ag_stream *stream);
+
+#endif //#define _aggr_h_
@@ -0,0 +1,343 @@
+/**
+ *	\file binlog.c
+ *	\brief Asynchronous binary log
+ *	\version 1.0
+ *
+ *	\par Overview
+ *	BL_LOG() doesn't format anything. It stores a record of the time, the message (a
+ *	static struct bl_event, whose address is the event ID) and the raw arguments in a
+ *	buffer of the calling thread, which only that thread writes and only the log thread
+ *	reads, so neither takes a lock. Every BL_FLUSH_MS milliseconds the log thread
+ *	formats the records of all buffers in the order of their times and prints them with
+ *	one stdio lock and write per flush instead of one per message. A thread whose
+ *	buffer is full drops its messages rather than wait; the log thread reports how many.
+ *
+ *	\par Arguments
+ *	The format tells how to fetch each argument, as printf() does: integers of any
+ *	length modifier, doubles, and pointers for "%s" and "%p". Strings are printed when
+ *	the record is formatted, so they must still be valid then. Field widths given as
+ *	'*' are not supported.
+ *
+ *	\par Levels
+ *	Messages below BL_LEVEL are compiled out; those below the level set by
+ *	bl_set_level() cost one comparison. Before bl_open() and after bl_close() messages
+ *	are printed right away.
+ */
+#include "binlog.h"
+
+/**
+ *	\ingroup vslabdaemon
+ *	\defgroup binlog Binary log
+ *
+ * 	\{
+ */
+
+//ARGUMENT TYPES of format conversions
+#define BL_ARG_INT		0
+#define BL_ARG_LONG		1
+#define BL_ARG_LLONG		2
+#define BL_ARG_SIZE		3
+#define BL_ARG_PTR		4
+#define BL_ARG_DOUBLE		5
+
+/** \brief Messages below this level are dropped, set by bl_set_level(). */
+int bl_level = BL_TRACE;
+
+static pthread_key_t bl_key;
+static struct bl_ring *bl_rings = NULL;
+static pthread_mutex_t bl_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bl_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t bl_thread;
+static int iRunning = 0;
+static int iStop = 0;
+static struct timespec bl_start;
+
+/**
+ *	\brief Nanoseconds since bl_open()
+ */
+static unsigned long long bl_now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long)(now.tv_sec - bl_start.tv_sec) * 1000000000ULL + now.tv_nsec - bl_start.tv_nsec;
+}
+
+/**
+ *	\brief Find the next conversion of a format that takes an argument
+ *	\param format	Position in the format
+ *	\param type	Receives the argument's type, BL_ARG_XXX
+ *	\param end	Receives the position after the conversion
+ *	\return		Position of the conversion's '%', NULL if there is none
+ */
+static const char *bl_next(const char *format, int *type, const char **end)
+{
+	const char *p = format, *q = NULL;
+	int iLong = 0;
+
+	for (; (p = strchr(p, '%')) != NULL; p = q + 1) {
+		q = p + 1 + strspn(p + 1, "-+ #0123456789.");
+		if (*q == '%') continue;
+		for (iLong = 0; (*q == 'l') || (*q == 'h') || (*q == 'z') || (*q == 'L'); q++) {
+			if (*q == 'l') iLong++;
+			if (*q == 'z') iLong = 3;
+		}
+		if (*q == '\0') return NULL;
+		if ((*q == 's') || (*q == 'p')) *type = BL_ARG_PTR;
+		else if (strchr("fFeEgGaA", *q) != NULL) *type = BL_ARG_DOUBLE;
+		else if (iLong == 3) *type = BL_ARG_SIZE;
+		else if (iLong == 2) *type = BL_ARG_LLONG;
+		else if (iLong == 1) *type = BL_ARG_LONG;
+		else *type = BL_ARG_INT;
+		*end = q + 1;
+		return p;
+	}
+	return NULL;
+}
+
+/**
+ *	\brief Fetch the arguments of a message
+ *	\param format	The message's format
+ *	\param ap	The arguments
+ *	\param args	Receives up to BL_MAX_ARGS arguments
+ */
+static void bl_args(const char *format, va_list ap, unsigned long long *args)
+{
+	const char *end = NULL;
+	double d = 0;
+	int i, type = 0;
+
+	for (i = 0; (i < BL_MAX_ARGS) && ((format = bl_next(format, &type, &end)) != NULL); i++, format = end) {
+		switch (type) {
+		case BL_ARG_LONG: args[i] = va_arg(ap, unsigned long); break;
+		case BL_ARG_LLONG: args[i] = va_arg(ap, unsigned long long); break;
+		case BL_ARG_SIZE: args[i] = va_arg(ap, size_t); break;
+		case BL_ARG_PTR: args[i] = (uintptr_t)va_arg(ap, const void *); break;
+		case BL_ARG_DOUBLE:
+			d = va_arg(ap, double);
+			memcpy(&args[i], &d, sizeof(d));
+			break;
+		default: args[i] = va_arg(ap, unsigned int);
+		}
+	}
+}
+
+/**
+ *	\brief Print the text between conversions, "%%" as '%'
+ */
+static void bl_literal(const char *from, const char *to, FILE *out)
+{
+	for (; from < to; from++) {
+		if ((from[0] == '%') && (from + 1 < to) && (from[1] == '%')) from++;
+		putc_unlocked(*from, out);
+	}
+}
+
+/**
+ *	\brief Format a record
+ *	\param rec	The record
+ *	\param out	The stream to print to, locked by the caller
+ */
+static void bl_format(const struct bl_record *rec, FILE *out)
+{
+	const char *format = rec->event->format, *p = NULL, *end = NULL;
+	char spec[32];
+	double d = 0;
+	int i, type = 0;
+
+	fprintf(out, "[%5llu.%06llu] ", rec->ullTime / 1000000000ULL, (rec->ullTime / 1000ULL) % 1000000ULL);
+	for (i = 0; (i < BL_MAX_ARGS) && ((p = bl_next(format, &type, &end)) != NULL); i++, format = end) {
+		bl_literal(format, p, out);
+		if ((size_t)(end - p) >= sizeof(spec)) continue;
+		memcpy(spec, p, end - p);
+		spec[end - p] = '\0';
+		switch (type) {
+		case BL_ARG_LONG: fprintf(out, spec, (unsigned long)rec->args[i]); break;
+		case BL_ARG_LLONG: fprintf(out, spec, rec->args[i]); break;
+		case BL_ARG_SIZE: fprintf(out, spec, (size_t)rec->args[i]); break;
+		case BL_ARG_PTR: fprintf(out, spec, (const void *)(uintptr_t)rec->args[i]); break;
+		case BL_ARG_DOUBLE:
+			memcpy(&d, &rec->args[i], sizeof(d));
+			fprintf(out, spec, d);
+			break;
+		default: fprintf(out, spec, (unsigned int)rec->args[i]);
+		}
+	}
+	bl_literal(format, format + strlen(format), out);
+}
+
+/**
+ *	\brief Get the buffer of the calling thread
+ *	\return		The buffer, NULL if there is no memory for it
+ *
+ *	Buffers are created at the first message of a thread and kept until bl_close().
+ */
+static struct bl_ring *bl_ring(void)
+{
+	struct bl_ring *ring = pthread_getspecific(bl_key);
+
+	if (ring != NULL) return ring;
+	ring = calloc(1, sizeof(struct bl_ring));
+	if (ring == NULL) return NULL;
+	pthread_setspecific(bl_key, ring);
+	pthread_mutex_lock(&bl_lock);
+	ring->next = bl_rings;
+	__atomic_store_n(&bl_rings, ring, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&bl_lock);
+	return ring;
+}
+
+/**
+ *	\brief Print the records of all buffers
+ *
+ *	Takes the oldest record of all buffers each time, at most as many as there were to
+ *	begin with, so threads that keep logging can't hold the log thread up.
+ */
+static void bl_drain(void)
+{
+	struct bl_ring *ring = NULL, *oldest = NULL, *rings = __atomic_load_n(&bl_rings, __ATOMIC_ACQUIRE);
+	unsigned long ulCount = 0, ulDropped = 0;
+
+	for (ring = rings; ring != NULL; ring = ring->next)
+		ulCount += __atomic_load_n(&ring->uHead, __ATOMIC_ACQUIRE) - ring->uTail;
+
+	flockfile(stdout);
+	for (; ulCount > 0; ulCount--) {
+		oldest = NULL;
+		for (ring = rings; ring != NULL; ring = ring->next) {
+			if (__atomic_load_n(&ring->uHead, __ATOMIC_ACQUIRE) == ring->uTail) continue;
+			if ((oldest == NULL) || (ring->records[ring->uTail % BL_RING_RECORDS].ullTime <
+						 oldest->records[oldest->uTail % BL_RING_RECORDS].ullTime)) oldest = ring;
+		}
+		if (oldest == NULL) break;
+		bl_format(&oldest->records[oldest->uTail % BL_RING_RECORDS], stdout);
+		__atomic_store_n(&oldest->uTail, oldest->uTail + 1, __ATOMIC_RELEASE);
+	}
+	for (ring = rings; ring != NULL; ring = ring->next) {
+		ulDropped = __atomic_load_n(&ring->ulDropped, __ATOMIC_RELAXED);
+		if (ulDropped == ring->ulReported) continue;
+		fprintf(stdout, "binlog: %lu messages dropped.\n", ulDropped - ring->ulReported);
+		ring->ulReported = ulDropped;
+	}
+	fflush(stdout);
+	funlockfile(stdout);
+}
+
+/**
+ *	\brief Main function of the log thread
+ *	\param arg	Unused
+ *	\return		NULL
+ *
+ *	Drains once more after bl_close() asked it to end.
+ */
+static void *bl_main(void *arg)
+{
+	struct timespec deadline;
+
+	pthread_mutex_lock(&bl_lock);
+	for (;;) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += BL_FLUSH_MS * 1000000L;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+		while (!iStop && (pthread_cond_timedwait(&bl_cond, &bl_lock, &deadline) == 0));
+		pthread_mutex_unlock(&bl_lock);
+		bl_drain();
+		pthread_mutex_lock(&bl_lock);
+		if (iStop) break;
+	}
+	pthread_mutex_unlock(&bl_lock);
+	return NULL;
+}
+
+/**
+ *	\brief Start the log thread
+ *	\return		Zero if successful, -EBL_NOTHREAD if messages stay printed right away
+ *
+ *	Call once, before the threads that log are started.
+ */
+int bl_open(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &bl_start);
+	if (pthread_key_create(&bl_key, NULL) != 0) return -EBL_NOTHREAD;
+	if (pthread_create(&bl_thread, NULL, bl_main, NULL) != 0) {
+		pthread_key_delete(bl_key);
+		return -EBL_NOTHREAD;
+	}
+	__atomic_store_n(&iRunning, 1, __ATOMIC_RELEASE);
+	return EBL_NOERROR;
+}
+
+/**
+ *	\brief Print what is left and end the log thread
+ *
+ *	Call after the threads that log have ended.
+ */
+void bl_close(void)
+{
+	struct bl_ring *ring = NULL;
+
+	if (!__atomic_load_n(&iRunning, __ATOMIC_ACQUIRE)) return;
+	pthread_mutex_lock(&bl_lock);
+	iStop = 1;
+	pthread_cond_signal(&bl_cond);
+	pthread_mutex_unlock(&bl_lock);
+	pthread_join(bl_thread, NULL);
+	__atomic_store_n(&iRunning, 0, __ATOMIC_RELEASE);
+	iStop = 0;
+
+	while ((ring = bl_rings) != NULL) {
+		bl_rings = ring->next;
+		free(ring);
+	}
+	pthread_key_delete(bl_key);
+}
+
+/**
+ *	\brief Set the level below which messages are dropped
+ *	\param level	One of BL_XXX
+ *
+ *	Call before the threads that log are started.
+ */
+void bl_set_level(int level)
+{
+	bl_level = level;
+}
+
+/**
+ *	\brief Log a message, see BL_LOG()
+ *	\param event	The message
+ */
+void bl_write(const struct bl_event *event, ...)
+{
+	struct bl_record one, *rec = &one;
+	struct bl_ring *ring = NULL;
+	va_list ap;
+
+	if (__atomic_load_n(&iRunning, __ATOMIC_ACQUIRE)) {
+		ring = bl_ring();
+		if (ring == NULL) return;
+		if (ring->uHead - __atomic_load_n(&ring->uTail, __ATOMIC_ACQUIRE) >= BL_RING_RECORDS) {
+			__atomic_store_n(&ring->ulDropped, ring->ulDropped + 1, __ATOMIC_RELAXED);
+			return;
+		}
+		rec = &ring->records[ring->uHead % BL_RING_RECORDS];
+	}
+
+	rec->ullTime = bl_now();
+	rec->event = event;
+	va_start(ap, event);
+	bl_args(event->format, ap, rec->args);
+	va_end(ap);
+
+	if (ring != NULL) __atomic_store_n(&ring->uHead, ring->uHead + 1, __ATOMIC_RELEASE);
+	else {
+		flockfile(stdout);
+		bl_format(rec, stdout);
+		funlockfile(stdout);
+	}
+}
+
+/**
+ *	\}
+ */
@@ -0,0 +1,104 @@
+/**
+ *	\file binlog.h
+ *	\brief Asynchronous binary log (header)
+ *	\version 1.0
+ *
+ */
+#if !defined _binlog_h_
+#define _binlog_h_
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+//ERROR CODES for binary log functions
+#define EBL_NOERROR		0
+#define EBL_NOTHREAD		1
+
+//LOG LEVELS
+#define BL_TRACE		0	/**< \brief Every request. */
+#define BL_DEBUG		1	/**< \brief Protocol events: streams, retransmissions. */
+#define BL_INFO			2	/**< \brief Rare events: timeouts, counters. */
+#define BL_OFF			3	/**< \brief Nothing. */
+
+/** \brief Compiled level.
+ *
+ * Messages below this level are compiled out, e.g. -DBL_LEVEL=BL_INFO for the boards.
+ */
+#if !defined BL_LEVEL
+#define BL_LEVEL		BL_TRACE
+#endif
+
+/** \brief Arguments per message. */
+#define BL_MAX_ARGS		6
+
+/** \brief Records per thread, a power of two.
+ *
+ * Messages of a thread whose buffer is full are dropped and counted.
+ */
+#define BL_RING_RECORDS		1024
+
+/** \brief Flush interval.
+ *
+ * Milliseconds between two looks of the log thread at the buffers.
+ */
+#define BL_FLUSH_MS		50
+
+/**
+ *	\brief A message of the source, the event ID of its records
+ */
+struct bl_event {
+	int iLevel;			/**< \brief Level, one of BL_XXX. */
+	const char *format;		/**< \brief printf() format. */
+};
+
+/**
+ *	\brief A message as logged, formatted by the log thread
+ */
+struct bl_record {
+	unsigned long long ullTime;	/**< \brief Nanoseconds since bl_open(). */
+	const struct bl_event *event;	/**< \brief The message. */
+	unsigned long long args[BL_MAX_ARGS];	/**< \brief Arguments, as picked by the format. */
+};
+
+/**
+ *	\brief The buffer of a thread
+ *
+ *	Written by its thread only, read by the log thread only.
+ */
+struct bl_ring {
+	unsigned int uHead;		/**< \brief Records written, by the thread. */
+	unsigned int uTail;		/**< \brief Records formatted, by the log thread. */
+	unsigned long ulDropped;	/**< \brief Records dropped for a full buffer. */
+	unsigned long ulReported;	/**< \brief Drops reported by the log thread. */
+	struct bl_ring *next;		/**< \brief Next buffer of the list. */
+	struct bl_record records[BL_RING_RECORDS];	/**< \brief Record i at i % BL_RING_RECORDS. */
+};
+
+/**
+ *	\brief Log a message
+ *	\param level	Level, one of BL_XXX, a constant
+ *	\param format	printf() format, a literal; "%s" arguments must stay valid until they
+ *			are printed, like literals and names of static tables
+ *
+ *	Costs a comparison below the level set by bl_set_level() and nothing below
+ *	BL_LEVEL.
+ */
+#define BL_LOG(level, format, ...)											\
+	do {														\
+		static const struct bl_event bl_event_ = { (level), format };						\
+		if (((level) >= BL_LEVEL) && ((level) >= bl_level)) bl_write(&bl_event_, ##__VA_ARGS__);		\
+	} while (0)
+
+extern int bl_level;
+
+int bl_open(void);
+void bl_close(void);
+void bl_set_level(int level);
+void bl_write(const struct bl_event *event, ...);
+
+#endif //#define _binlog_h_
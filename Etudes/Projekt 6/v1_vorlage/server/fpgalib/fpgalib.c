@@ -1,7 +1,7 @@
 /**
  *	\file fpgalib.c 
  *	\author Marc Juettner, marc.juettner@juettner-itconsult.de
- *	\version 1.0
+ *	\version 1.2
  *	\brief An FPGA access library that implements access to a scrambler functionality 
  *		within an FPGA.
  *	\defgroup fpga FPGA
@@ -14,6 +14,36 @@
  *	via read(), write() and ioctl() system calls on /dev/scrambler, see fpgalib.h for 
  *	further details.
  *
+ *	\par Blocks
+ *	FPGA_Scramble() costs a write() and a read() per word. FPGA_ScrambleBlock() hands
+ *	the driver FPGA_BLOCK_WORDS words per write() and read() instead, or, if the driver
+ *	lets the device file be mapped, goes through the ring shared with the driver
+ *	(struct scrambler_ring) with one ioctl() per SCRAMBLER_RING_WORDS words.
+ *
+ *	\par Handles
+ *	The device belongs to a thread of the library, started by FPGA_OpenDevice(). Any
+ *	number of threads open a handle each (FPGA_OpenHandle()), set its generator polynom
+ *	and submit jobs (FPGA_Submit()) without waiting for the device. The device thread
+ *	takes the jobs from the submission queue in order, sets the polynom of the job's
+ *	handle if the scrambler has another one, scrambles the job's block and puts the job
+ *	into the completion ring of its handle, where FPGA_Complete() finds it. A ring has
+ *	one writer, the device thread, and one reader, the handle's owner, so it needs no
+ *	lock; a semaphore lets the owner sleep until something arrives, and an eventfd lets
+ *	an owner with an event loop of its own poll for it instead (FPGA_HandleEvent()). A
+ *	failed transfer fails its job only, the device is opened again for the next one.
+ *	FPGA_SetGeneratorPolynom(), FPGA_Scramble() and FPGA_ScrambleBlock() do the same
+ *	with a handle of the library and wait for the result.
+ *
+ *	\par Stand-in
+ *	FPGA_OpenDevice(FPGA_STANDIN) opens a stand-in instead of the device: one end of a
+ *	socket pair whose other end is served by a thread of the library, so read() and
+ *	write() behave as with the device and everything can be tested without hardware.
+ *	The stand-in scrambles each word on its own, most significant bit first, with a
+ *	multiplicative scrambler: every output bit is the input bit xor the parity of the
+ *	last 16 output bits of the word masked with the generator polynom, where bit j of
+ *	the polynom taps the output bit j + 1 bits back. The polynom 0 leaves words as they
+ *	are. It uses lfsr_reference(), the software scrambler's model of the device.
+ *
  *	\par Prerequisites
  *	The following files should be available on your system:
  *	\li scrambler.exp: An FPGA design containing a scrambler implementation
@@ -23,22 +53,24 @@
  *
  *	\par Static variables
  *	\li iFPGAFileDesc will hold the device file descriptor returned by open() to easily 
- *	access the device once it is opened.
+ *	access the device once it is opened. Only the device thread uses it while it runs.
  *	\li iFPGAStatus will hold information on the library's operating status. Any function 
  *	that requires proper initialization of the FPGA device file(s) will first check this 
  *	variable and return with an error code (see fpgalib.h for details) if accessing the 
- *	device file would create a file not open error.
+ *	device file would create a file not open error. It is OFF if the device could not be
+ *	opened again after an error.
+ *	\li The submission queue and iFPGAStop are protected by FPGAQueueLock.
  *
  *	\warning Don't attempt to use the statically declared variables outside the library!
- *	\warning This library is NOT thread-safe. This implies that it is impossible to access 
- *	the FPGA from multiple applications simultaneously as the FPGA will remain
- *	opened between calls of FPGA_Open() and FPGA_Close(). As a workaround a userspace 
- *	application has to call FPGA_Open() before and FPGA_Close() after each access to the 
- *	FPGA. Be aware of the non-reentrancy of the library code! You won't be able to use it 
- *	in multithreaded applications without modification!
+ *	\warning Handles are thread-safe, a handle itself is not: it must be used by one
+ *	thread at a time. FPGA_OpenDevice() and FPGA_Close() must not run concurrently with
+ *	anything else. It is still impossible to access the FPGA from multiple applications
+ *	simultaneously as the FPGA will remain opened between calls of FPGA_Open() and
+ *	FPGA_Close().
  *	\}
  */
 #include "fpgalib.h"
+#include "../kernellib/lfsr.h"
 
 /**
  *	\ingroup fpga
@@ -49,25 +81,145 @@
 
 static int iFPGAFileDesc = 0;
 static int iFPGAStatus = FPGA_STATUS_OFF;
+static struct scrambler_ring *pFPGARing = NULL;
+static int iFPGAStandIn = 0;
+static pthread_t FPGAStandInThread;
+static unsigned int uStandInPolynom = DEFAULT_GENERATOR_POLYNOM;
+static char *pFPGADevice = NULL;
+static unsigned int uFPGAPolynom = DEFAULT_GENERATOR_POLYNOM;
+static int iFPGARunning = 0;
+static pthread_t FPGADeviceThread;
+static pthread_mutex_t FPGAQueueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t FPGAQueueCond = PTHREAD_COND_INITIALIZER;
+static struct fpga_job *pFPGAQueueHead = NULL;
+static struct fpga_job *pFPGAQueueTail = NULL;
+static int iFPGAStop = 0;
+static size_t uFPGABacklog = 0;
+static struct fpga_handle FPGADefaultHandle;
+static pthread_mutex_t FPGADefaultLock = PTHREAD_MUTEX_INITIALIZER;
 
 /**
- *	\brief Open and initialize the FPGA library
- *	\return Zero if successfully opened FPGA, nonzero otherwise
- *	\see 	fpgalib.h
+ *	\brief Transfer a buffer to or from a file descriptor completely
+ *	\param iDesc	The file descriptor
+ *	\param buf	The buffer
+ *	\param len	Number of bytes
+ *	\param iWrite	Nonzero to write, zero to read
+ *	\return		Zero if all bytes were transferred, -1 otherwise
+ */
+static int fpga_transfer(int iDesc, void *buf, size_t len, int iWrite)
+{
+	char *p = buf;
+	ssize_t iReturn = 0;
+
+	while (len > 0) {
+		iReturn = iWrite ? write(iDesc, p, len) : read(iDesc, p, len);
+		if ((iReturn < 0) && (errno == EINTR)) continue;
+		if (iReturn <= 0) return -1;
+		p += iReturn;
+		len -= iReturn;
+	}
+	return 0;
+}
+
+/**
+ *	\brief Main function of the stand-in's thread
+ *	\param arg	The stand-in's end of the socket pair
+ *	\return		NULL
  *
- *	The function starts initialization of the FPGA library and should be called at the 
- *	beginning of any program that wants to access the FPGA design via device files. 
+ *	Scrambles whatever words arrive and sends them back, until the library's end is
+ *	closed.
  */
-int FPGA_Open(void) 
+static void *fpga_standin_main(void *arg)
+{
+	int iDesc = (int)(long)arg;
+	unsigned char buf[FPGA_BLOCK_WORDS * 4];
+	unsigned int uWord = 0, uPolynom = 0;
+	size_t i = 0, uHave = 0;
+	ssize_t iReturn = 0;
+
+	for (;;) {
+		iReturn = read(iDesc, buf + uHave, sizeof(buf) - uHave);
+		if ((iReturn < 0) && (errno == EINTR)) continue;
+		if (iReturn <= 0) break;
+		uHave += iReturn;
+		uPolynom = __atomic_load_n(&uStandInPolynom, __ATOMIC_ACQUIRE);
+		for (i = 0; i + 4 <= uHave; i += 4) {
+			memcpy(&uWord, buf + i, 4);
+			uWord = lfsr_reference(uPolynom, uWord);
+			memcpy(buf + i, &uWord, 4);
+		}
+		if (fpga_transfer(iDesc, buf, i, 1) < 0) break;
+		memmove(buf, buf + i, uHave - i);
+		uHave -= i;
+	}
+	close(iDesc);
+	return NULL;
+}
+
+/**
+ *	\brief Open the stand-in
+ *	\return Zero if successful, an error code otherwise
+ */
+static int fpga_standin_open(void)
+{
+	int iPair[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, iPair) < 0) return -EFPGA_FILE_OPEN_ERROR;
+	uStandInPolynom = DEFAULT_GENERATOR_POLYNOM;
+	if (pthread_create(&FPGAStandInThread, NULL, fpga_standin_main, (void *)(long)iPair[1]) != 0) {
+		close(iPair[0]);
+		close(iPair[1]);
+		return -EFPGA_NOMEM;
+	}
+	iFPGAFileDesc = iPair[0];
+	iFPGAStandIn = 1;
+	return EFPGA_NOERROR;
+}
+
+/**
+ *	\brief Scramble a block through the ring shared with the driver
+ *	\param in	Words to scramble
+ *	\param out	Receives the scrambled words
+ *	\param n	Number of words
+ *	\return		Zero if successful, an error code otherwise
+ */
+static int fpga_ring_block(const int *in, int *out, size_t n)
+{
+	unsigned int uHead = 0, i = 0, k = 0;
+	size_t uPos = 0;
+
+	for (uPos = 0; uPos < n; uPos += k) {
+		k = (n - uPos < SCRAMBLER_RING_WORDS) ? n - uPos : SCRAMBLER_RING_WORDS;
+		uHead = pFPGARing->head;
+		for (i = 0; i < k; i++) pFPGARing->in[(uHead + i) % SCRAMBLER_RING_WORDS] = in[uPos + i];
+		pFPGARing->head = uHead + k;
+		if ((ioctl(iFPGAFileDesc, IOCTL_RING_KICK) < 0) || (pFPGARing->tail != uHead + k)) return -EIOCTL_ERROR;
+		for (i = 0; i < k; i++) out[uPos + i] = pFPGARing->out[(uHead + i) % SCRAMBLER_RING_WORDS];
+	}
+	return EFPGA_NOERROR;
+}
+
+/**
+ *	\brief Open the device, or the stand-in
+ *	\param device	Path of the device file or FPGA_STANDIN
+ *	\return		Zero if successful, an error code otherwise
+ *
+ *	Leaves iFPGAStatus alone, the callers set it.
+ */
+static int fpga_device_open(const char *device)
 {
 	int iReturn = 0;
+	void *ring;
+
+	iFPGAStandIn = 0;
+	pFPGARing = NULL;
+	uFPGAPolynom = DEFAULT_GENERATOR_POLYNOM;
+	if (strcmp(device, FPGA_STANDIN) == 0) return fpga_standin_open();
 
 	//get file descriptor for scrambler device file
-	iFPGAFileDesc = open(FPGA_DEVICEFILE, O_RDWR);
+	iFPGAFileDesc = open(device, O_RDWR);
 	if( iFPGAFileDesc < 0 ) {
 		//error opening device - break and exit with return code
-		close(iFPGAFileDesc);
-		iFPGAStatus = FPGA_STATUS_OFF;
 		return -EFPGA_FILE_OPEN_ERROR;
 	}
 
@@ -76,11 +228,190 @@ int FPGA_Open(void)
 	if( iReturn < 0 ) {
 		//error initializing device - break and exit with return code
 		close(iFPGAFileDesc);
-		iFPGAStatus = FPGA_STATUS_OFF;
 		return -EIOCTL_ERROR;
 	}
 
+	//drivers without mmap() support are fine, blocks are written and read then
+	ring = mmap(NULL, sizeof(struct scrambler_ring), PROT_READ | PROT_WRITE, MAP_SHARED, iFPGAFileDesc, 0);
+	if (ring != MAP_FAILED) pFPGARing = ring;
+
+	return EFPGA_NOERROR;
+}
+
+/**
+ *	\brief Close the device, or the stand-in
+ */
+static void fpga_device_shut(void)
+{
+	if (pFPGARing != NULL) munmap(pFPGARing, sizeof(struct scrambler_ring));
+	pFPGARing = NULL;
+	close (iFPGAFileDesc);
+	//the stand-in's thread ends once it sees our end closed
+	if (iFPGAStandIn) pthread_join(FPGAStandInThread, NULL);
+	iFPGAStandIn = 0;
+	iFPGAFileDesc = 0;
+}
+
+/**
+ *	\brief Set the generator polynom of the device
+ *	\param GP	The generator polynom
+ *	\return		Zero if successful, an error code otherwise
+ */
+static int fpga_polynom(int GP)
+{
+	if (iFPGAStandIn) {
+		__atomic_store_n(&uStandInPolynom, (unsigned int)GP, __ATOMIC_RELEASE);
+		return EFPGA_NOERROR;
+	}
+	if (ioctl(iFPGAFileDesc, IOCTL_INIT_POLYGEN, GP) < 0) return -EIOCTL_ERROR;
+	return EFPGA_NOERROR;
+}
+
+/**
+ *	\brief Scramble a block on the device
+ *	\param in	Words to scramble
+ *	\param out	Receives the scrambled words
+ *	\param n	Number of words
+ *	\return		Zero if successful, an error code otherwise
+ *
+ *	One write() and one read() per FPGA_BLOCK_WORDS words, or one ioctl() per
+ *	SCRAMBLER_RING_WORDS words if the ring is mapped.
+ */
+static int fpga_block(const int *in, int *out, size_t n)
+{
+	size_t uPos = 0, k = 0;
+
+	if (pFPGARing != NULL) return fpga_ring_block(in, out, n);
+
+	for (uPos = 0; uPos < n; uPos += k) {
+		k = (n - uPos < FPGA_BLOCK_WORDS) ? n - uPos : FPGA_BLOCK_WORDS;
+		if (fpga_transfer(iFPGAFileDesc, (void *)&in[uPos], k * sizeof(int), 1) < 0) return -EFPGA_WRITE_ERROR;
+		if (fpga_transfer(iFPGAFileDesc, &out[uPos], k * sizeof(int), 0) < 0) return -EFPGA_READ_ERROR;
+	}
+	return EFPGA_NOERROR;
+}
+
+/**
+ *	\brief Run a job on the device
+ *	\param job	The job
+ *	\return		Zero if successful, an error code otherwise
+ *
+ *	After an error the device is closed and opened again, so only this job fails. If it
+ *	can't be opened, the library's status is OFF and no more jobs are accepted.
+ */
+static int fpga_run(struct fpga_job *job)
+{
+	int iReturn = EFPGA_NOERROR;
+
+	if (iFPGAStatus != FPGA_STATUS_ON) return -EFPGA_STATUS_OFF;
+	if (job->uPolynom != uFPGAPolynom) {
+		iReturn = fpga_polynom((int)job->uPolynom);
+		if (iReturn == EFPGA_NOERROR) uFPGAPolynom = job->uPolynom;
+	}
+	if (iReturn == EFPGA_NOERROR) iReturn = fpga_block(job->in, job->out, job->n);
+	if (iReturn < 0) {
+		fpga_device_shut();
+		if (fpga_device_open(pFPGADevice) < 0) {
+			pthread_mutex_lock(&FPGAQueueLock);
+			iFPGAStatus = FPGA_STATUS_OFF;
+			pthread_mutex_unlock(&FPGAQueueLock);
+		}
+	}
+	return iReturn;
+}
+
+/**
+ *	\brief Main function of the device thread
+ *	\param arg	Unused
+ *	\return		NULL
+ *
+ *	Runs the submitted jobs in order and hands each back through the completion ring of
+ *	its handle. The job is published, the semaphore posted and the event signalled
+ *	with FPGAQueueLock held, so FPGA_CloseHandle() can make sure the thread is done with
+ *	the handle. Ends once FPGA_Close() asked for it and the queue is empty, so every
+ *	submitted job is completed.
+ */
+static void *fpga_device_main(void *arg)
+{
+	struct fpga_job *job = NULL;
+	struct fpga_handle *handle = NULL;
+	uint64_t ullOne = 1;
+
+	pthread_mutex_lock(&FPGAQueueLock);
+	for (;;) {
+		while ((pFPGAQueueHead == NULL) && !iFPGAStop) pthread_cond_wait(&FPGAQueueCond, &FPGAQueueLock);
+		if (pFPGAQueueHead == NULL) break;
+		job = pFPGAQueueHead;
+		pFPGAQueueHead = job->next;
+		if (pFPGAQueueHead == NULL) pFPGAQueueTail = NULL;
+		pthread_mutex_unlock(&FPGAQueueLock);
+
+		job->iResult = fpga_run(job);
+		__atomic_fetch_sub(&uFPGABacklog, job->n, __ATOMIC_RELAXED);
+		handle = job->handle;
+
+		pthread_mutex_lock(&FPGAQueueLock);
+		handle->done[handle->uHead % FPGA_HANDLE_JOBS] = job;
+		__atomic_store_n(&handle->uHead, handle->uHead + 1, __ATOMIC_RELEASE);
+		sem_post(&handle->ready);
+		//a full eventfd refuses the write, but it is readable then anyway
+		if (handle->iEvent >= 0) while ((write(handle->iEvent, &ullOne, sizeof(ullOne)) < 0) && (errno == EINTR));
+	}
+	pthread_mutex_unlock(&FPGAQueueLock);
+	return NULL;
+}
+
+/**
+ *	\brief Open and initialize the FPGA library
+ *	\return Zero if successfully opened FPGA, nonzero otherwise
+ *	\see 	fpgalib.h
+ *
+ *	The function starts initialization of the FPGA library and should be called at the 
+ *	beginning of any program that wants to access the FPGA design via device files. 
+ */
+int FPGA_Open(void) 
+{
+	return FPGA_OpenDevice(FPGA_DEVICEFILE);
+}
+
+/**
+ *	\brief Open and initialize the FPGA library on a given device
+ *	\param device	Path of the scrambler's device file, NULL for FPGA_DEVICEFILE, or
+ *			FPGA_STANDIN for the stand-in
+ *	\return Zero if successfully opened FPGA, nonzero otherwise
+ *
+ *	Like FPGA_Open(). The ring shared with the driver is mapped if the driver allows it,
+ *	otherwise blocks are written and read. Starts the device thread; opening an open
+ *	library does nothing.
+ */
+int FPGA_OpenDevice(const char *device)
+{
+	int iReturn = 0;
+
+	if (device == NULL) device = FPGA_DEVICEFILE;
+	if (iFPGARunning) return EFPGA_NOERROR;
+
+	pFPGADevice = strdup(device);
+	if (pFPGADevice == NULL) return -EFPGA_NOMEM;
+	iReturn = fpga_device_open(device);
+	if (iReturn < 0) {
+		free(pFPGADevice);
+		pFPGADevice = NULL;
+		iFPGAStatus = FPGA_STATUS_OFF;
+		return iReturn;
+	}
+
 	iFPGAStatus = FPGA_STATUS_ON;
+	if ((FPGA_OpenHandle(&FPGADefaultHandle) < 0) ||
+	    (pthread_create(&FPGADeviceThread, NULL, fpga_device_main, NULL) != 0)) {
+		FPGA_CloseHandle(&FPGADefaultHandle);
+		fpga_device_shut();
+		free(pFPGADevice);
+		pFPGADevice = NULL;
+		iFPGAStatus = FPGA_STATUS_OFF;
+		return -EFPGA_NOMEM;
+	}
+	iFPGARunning = 1;
 
 	return EFPGA_NOERROR;
 }
@@ -92,13 +423,24 @@ int FPGA_Open(void)
  *
  *	The function will close the FPGA device file if it was previuosly opened and sets 
  *	iFPGAStatus to OFF. If the FPGA device is not already opened, the function will 
- *	return an error code.
+ *	return an error code. Jobs submitted before are still run; handles stay open but
+ *	their jobs are refused until the library is opened again.
  */
 int FPGA_Close(void) {
 	
-	if (iFPGAStatus != FPGA_STATUS_ON) return -EFPGA_STATUS_OFF;
-	close (iFPGAFileDesc);
-	iFPGAFileDesc = 0;
+	if (!iFPGARunning) return -EFPGA_STATUS_OFF;
+	pthread_mutex_lock(&FPGAQueueLock);
+	iFPGAStop = 1;
+	pthread_cond_signal(&FPGAQueueCond);
+	pthread_mutex_unlock(&FPGAQueueLock);
+	pthread_join(FPGADeviceThread, NULL);
+
+	FPGA_CloseHandle(&FPGADefaultHandle);
+	if (iFPGAStatus == FPGA_STATUS_ON) fpga_device_shut();
+	free(pFPGADevice);
+	pFPGADevice = NULL;
+	iFPGAStop = 0;
+	iFPGARunning = 0;
 	iFPGAStatus = FPGA_STATUS_OFF;
 	return EFPGA_NOERROR;
 }
@@ -111,21 +453,15 @@ int FPGA_Close(void) {
  *	\see 		fpgalib.h
  *
  *	The function will set the scrambler's generator polynom for further use 
- *	with FPGA_Scramble().
+ *	with FPGA_Scramble() and FPGA_ScrambleBlock(). Other handles keep their polynom.
  */
 int FPGA_SetGeneratorPolynom(int GP)
 {
-	int iReturn = 0;
-	
 	if (iFPGAStatus != FPGA_STATUS_ON) return -EFPGA_STATUS_OFF;
 
-	iReturn = ioctl(iFPGAFileDesc, IOCTL_INIT_POLYGEN, GP);
-	if( iReturn < 0 ) {
-		//error initializing device - break and exit with return code
-		close(iFPGAFileDesc);
-		iFPGAStatus = FPGA_STATUS_OFF;
-		return -EIOCTL_ERROR;
-	}
+	pthread_mutex_lock(&FPGADefaultLock);
+	FPGA_SetHandlePolynom(&FPGADefaultHandle, GP);
+	pthread_mutex_unlock(&FPGADefaultLock);
 
 	return EFPGA_NOERROR;
 }
@@ -144,28 +480,198 @@ int FPGA_SetGeneratorPolynom(int GP)
  */
 int FPGA_Scramble(int operand, int *result) {
 
+	return FPGA_ScrambleBlock(&operand, result, 1);
+}
+
+/**
+ *	\brief Scramble a block of data
+ *
+ *	\param in	Words to scramble
+ *	\param out	An integer pointer pointing to an array of n words the scrambler
+ *			results are to be written to, may be \a in
+ *	\param n	Number of words
+ *	\return 	Zero if successfully executed, nonzero otherwise
+ *	\see 		fpgalib.h
+ *
+ *	Same results as FPGA_Scramble() for every word, but with one write() and one read()
+ *	per FPGA_BLOCK_WORDS words, or one ioctl() per SCRAMBLER_RING_WORDS words if the ring
+ *	is mapped. Runs as a job of the library's handle and waits for it.
+ */
+int FPGA_ScrambleBlock(const int *in, int *out, size_t n)
+{
+	struct fpga_job job, *done = NULL;
 	int iReturn = 0;
 
-	if (iFPGAStatus != FPGA_STATUS_ON) return -EFPGA_STATUS_OFF;
+	pthread_mutex_lock(&FPGADefaultLock);
+	iReturn = FPGA_Submit(&FPGADefaultHandle, &job, in, out, n);
+	if (iReturn == EFPGA_NOERROR) {
+		done = FPGA_Complete(&FPGADefaultHandle, 1);
+		iReturn = (done != NULL) ? done->iResult : -EFPGA_READ_ERROR;
+	}
+	pthread_mutex_unlock(&FPGADefaultLock);
 
-	iReturn = write(iFPGAFileDesc, (char *)&operand, sizeof(operand));
-	if( iReturn < 0 ) {
-		//error writing to device - break and exit with return code
-		FPGA_Close();
-		return -EFPGA_WRITE_ERROR;
+	return iReturn;
+}
+
+/**
+ *	\brief Open a handle
+ *	\param handle	The handle
+ *	\return		Zero if successful, an error code otherwise
+ *
+ *	The handle starts with the DEFAULT_GENERATOR_POLYNOM. It may be opened before the
+ *	library, jobs are accepted while the library is open.
+ */
+int FPGA_OpenHandle(struct fpga_handle *handle)
+{
+	memset(handle, 0x00, sizeof(struct fpga_handle));
+	if (sem_init(&handle->ready, 0, 0) < 0) return -EFPGA_NOMEM;
+	handle->iEvent = -1;
+#if defined FPGA_HAVE_EVENTFD
+	handle->iEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (handle->iEvent < 0) {
+		sem_destroy(&handle->ready);
+		return -EFPGA_NOMEM;
 	}
+#endif
+	handle->uPolynom = DEFAULT_GENERATOR_POLYNOM;
+	handle->iOpen = 1;
+	return EFPGA_NOERROR;
+}
 
-	iReturn = read(iFPGAFileDesc, (char *)result, sizeof(int));
+/**
+ *	\brief Close a handle
+ *	\param handle	The handle
+ *	\return		Zero if successful, -EFPGA_STATUS_OFF if it wasn't open
+ *
+ *	Waits for the jobs that were not taken back yet, and for the device thread to be
+ *	done with the handle.
+ */
+int FPGA_CloseHandle(struct fpga_handle *handle)
+{
+	if (!handle->iOpen) return -EFPGA_STATUS_OFF;
+	while (FPGA_Complete(handle, 1) != NULL);
+	//the last job was published under the lock, along with its post and event
+	pthread_mutex_lock(&FPGAQueueLock);
+	pthread_mutex_unlock(&FPGAQueueLock);
+	sem_destroy(&handle->ready);
+	if (handle->iEvent >= 0) close(handle->iEvent);
+	handle->iEvent = -1;
+	handle->iOpen = 0;
+	return EFPGA_NOERROR;
+}
 
-	if( iReturn < 0 ) {
-		//error reading from device - break and exit with return code
-		FPGA_Close();
-		return -EFPGA_READ_ERROR;
+/**
+ *	\brief Set the generator polynom of a handle
+ *	\param handle	The handle
+ *	\param GP	The generator polynom, used for jobs submitted from now on
+ */
+void FPGA_SetHandlePolynom(struct fpga_handle *handle, int GP)
+{
+	handle->uPolynom = (unsigned int)GP;
+}
+
+/**
+ *	\brief Submit a scramble job
+ *	\param handle	The handle
+ *	\param job	The job, filled in here
+ *	\param in	Words to scramble
+ *	\param out	Receives the scrambled words, may be \a in
+ *	\param n	Number of words
+ *	\return		Zero if the job was queued, -EFPGA_BUSY if the handle has
+ *			FPGA_HANDLE_JOBS jobs not taken back, -EFPGA_STATUS_OFF if the library
+ *			or the handle isn't open
+ *
+ *	Returns without waiting for the device, FPGA_Complete() hands the job back.
+ */
+int FPGA_Submit(struct fpga_handle *handle, struct fpga_job *job, const int *in, int *out, size_t n)
+{
+	if (!handle->iOpen) return -EFPGA_STATUS_OFF;
+	if (handle->uPending >= FPGA_HANDLE_JOBS) return -EFPGA_BUSY;
+
+	job->handle = handle;
+	job->uPolynom = handle->uPolynom;
+	job->in = in;
+	job->out = out;
+	job->n = n;
+	job->iResult = EFPGA_NOERROR;
+	job->next = NULL;
+
+	pthread_mutex_lock(&FPGAQueueLock);
+	if ((iFPGAStatus != FPGA_STATUS_ON) || !iFPGARunning || iFPGAStop) {
+		pthread_mutex_unlock(&FPGAQueueLock);
+		return -EFPGA_STATUS_OFF;
 	}
+	if (pFPGAQueueTail != NULL) pFPGAQueueTail->next = job;
+	else pFPGAQueueHead = job;
+	pFPGAQueueTail = job;
+	__atomic_fetch_add(&uFPGABacklog, n, __ATOMIC_RELAXED);
+	pthread_cond_signal(&FPGAQueueCond);
+	pthread_mutex_unlock(&FPGAQueueLock);
 
+	handle->uPending++;
 	return EFPGA_NOERROR;
 }
 
+/**
+ *	\brief Take back a completed job
+ *	\param handle	The handle
+ *	\param iWait	Nonzero to wait for a job if none is completed yet
+ *	\return		The oldest completed job with its iResult, NULL if there is none or
+ *			no job is pending
+ *
+ *	Jobs come back in the order they were submitted. Without waiting, NULL also means
+ *	the handle's event was reset: a job completed afterwards signals it again.
+ */
+struct fpga_job *FPGA_Complete(struct fpga_handle *handle, int iWait)
+{
+	struct fpga_job *job = NULL;
+	uint64_t ullEvents = 0;
+	int iReset = 0;
+
+	while ((handle->uPending == 0) || (__atomic_load_n(&handle->uHead, __ATOMIC_ACQUIRE) == handle->uTail)) {
+		if (iWait) {
+			if (handle->uPending == 0) return NULL;
+			if ((sem_wait(&handle->ready) < 0) && (errno != EINTR)) return NULL;
+			continue;
+		}
+		//reset the event before looking once more, so no completion goes unnoticed
+		if (iReset || (handle->iEvent < 0)) return NULL;
+		if ((read(handle->iEvent, &ullEvents, sizeof(ullEvents)) < 0) && (errno != EAGAIN)) return NULL;
+		iReset = 1;
+	}
+	job = handle->done[handle->uTail % FPGA_HANDLE_JOBS];
+	handle->uTail++;
+	handle->uPending--;
+	//take the job's post, unless the device thread hasn't made it yet; a late one only
+	//makes a later wait look once more
+	sem_trywait(&handle->ready);
+	return job;
+}
+
+/**
+ *	\brief Get the event descriptor of a handle
+ *	\param handle	The handle
+ *	\return		A descriptor that becomes readable when a job of the handle is
+ *			completed, -1 if there is none (no eventfd or handle not open)
+ *
+ *	For owners with an event loop: poll the descriptor for input instead of waiting,
+ *	and call FPGA_Complete() without waiting until it returns NULL whenever it is
+ *	readable. The descriptor belongs to the handle, don't read or close it.
+ */
+int FPGA_HandleEvent(struct fpga_handle *handle)
+{
+	return handle->iOpen ? handle->iEvent : -1;
+}
+
+/**
+ *	\brief Number of words submitted and not yet scrambled
+ *	\return		The words waiting for the device, of all handles
+ */
+size_t FPGA_Backlog(void)
+{
+	return __atomic_load_n(&uFPGABacklog, __ATOMIC_RELAXED);
+}
+
 /**
  *	\}
  */
@@ -2,7 +2,7 @@
  *	\file fpgalib.h
  *	\brief FPGA access functions
  *	\author Marc Juettner, marc.juettner@juettner-itconsult.de
- *	\version 1.0
+ *	\version 1.2
  *
  */
 #if !defined _fpgalib_h_
@@ -12,7 +12,15 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 
 //DEFINES for use within the FPGA library...
 
@@ -20,6 +28,25 @@
 
 #define FPGA_DEVICEFILE		"/dev/scrambler"
 
+/** \brief Device name selecting the stand-in, see FPGA_OpenDevice(). */
+#define FPGA_STANDIN		"standin"
+
+/** \brief Words per write() and read() of FPGA_ScrambleBlock() without ring. */
+#define FPGA_BLOCK_WORDS	1024
+
+/** \brief Jobs a handle may have submitted and not yet taken back, a power of two. */
+#define FPGA_HANDLE_JOBS	16
+
+/** \brief Completion events.
+ *
+ * eventfd() is Linux specific and missing in the uClinux C library, handles can only be
+ * waited on there.
+ */
+#if defined(__linux__) && !defined(__UCLIBC__)
+#define FPGA_HAVE_EVENTFD
+#include <sys/eventfd.h>
+#endif
+
 //FPGA Library status information
 #define FPGA_STATUS_OFF		0
 #define FPGA_STATUS_ON		1
@@ -31,12 +58,62 @@
 #define EFPGA_WRITE_ERROR	3
 #define EFPGA_READ_ERROR	4
 #define EIOCTL_ERROR		5
+#define EFPGA_NOMEM		6
+#define EFPGA_BUSY		7
+
+struct fpga_handle;
+
+/**
+ *	\brief A scramble job
+ *
+ *	Owned by the caller, who must leave it and its buffers alone from FPGA_Submit()
+ *	until FPGA_Complete() hands it back.
+ */
+struct fpga_job {
+	struct fpga_handle *handle;	/**< \brief Handle the job was submitted with. */
+	unsigned int uPolynom;		/**< \brief Generator polynom of the handle at submission. */
+	const int *in;			/**< \brief Words to scramble. */
+	int *out;			/**< \brief Receives the scrambled words, may be \a in. */
+	size_t n;			/**< \brief Number of words. */
+	void *user;			/**< \brief Left to the caller. */
+	int iResult;			/**< \brief Zero or an error code, set once the job is completed. */
+	struct fpga_job *next;		/**< \brief Next job in the submission queue. */
+};
+
+/**
+ *	\brief A handle on the scrambler
+ *
+ *	Each thread using the scrambler has a handle of its own, with its own generator
+ *	polynom. Completed jobs come back through the handle's ring, which only the device
+ *	thread writes and only the owner reads. The owner either waits on the semaphore or
+ *	polls the event descriptor, see FPGA_HandleEvent().
+ */
+struct fpga_handle {
+	int iOpen;			/**< \brief Set by FPGA_OpenHandle(). */
+	unsigned int uPolynom;		/**< \brief Generator polynom of jobs submitted from now on. */
+	struct fpga_job *done[FPGA_HANDLE_JOBS];	/**< \brief Completed jobs, slot i % FPGA_HANDLE_JOBS. */
+	unsigned int uHead;		/**< \brief Jobs completed, written by the device thread. */
+	unsigned int uTail;		/**< \brief Jobs taken back, written by the owner. */
+	unsigned int uPending;		/**< \brief Jobs submitted and not taken back, owner only. */
+	sem_t ready;			/**< \brief Posted for every completed job, to wait on. */
+	int iEvent;			/**< \brief eventfd signalled for every completed job, -1 if none. */
+};
 
 //Function prototypes
 int FPGA_Open(void);
+int FPGA_OpenDevice(const char *device);
 int FPGA_Close(void);
 
 int FPGA_SetGeneratorPolynom(int GP);
 int FPGA_Scramble(int operand, int *result);
+int FPGA_ScrambleBlock(const int *in, int *out, size_t n);
+
+int FPGA_OpenHandle(struct fpga_handle *handle);
+int FPGA_CloseHandle(struct fpga_handle *handle);
+void FPGA_SetHandlePolynom(struct fpga_handle *handle, int GP);
+int FPGA_Submit(struct fpga_handle *handle, struct fpga_job *job, const int *in, int *out, size_t n);
+struct fpga_job *FPGA_Complete(struct fpga_handle *handle, int iWait);
+int FPGA_HandleEvent(struct fpga_handle *handle);
+size_t FPGA_Backlog(void);
 
 #endif //#define _fpgalib_h_
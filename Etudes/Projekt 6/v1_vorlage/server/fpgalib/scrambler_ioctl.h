@@ -12,5 +12,19 @@
 
 #define MAJORNUM 250
 #define IOCTL_INIT_POLYGEN _IOR(MAJORNUM, 0, int*)
+#define IOCTL_RING_KICK _IO(MAJORNUM, 1)
+
+/* Ring shared with drivers that support mmap() on the device file. Userspace puts
+ * words into in[] at head, advances head and calls IOCTL_RING_KICK, which returns once
+ * the driver scrambled everything up to head into the same slots of out[] and moved
+ * tail up to head. Both counters only grow, slots are taken modulo SCRAMBLER_RING_WORDS. */
+#define SCRAMBLER_RING_WORDS 4096
+
+struct scrambler_ring {
+	volatile unsigned int head;
+	volatile unsigned int tail;
+	unsigned int in[SCRAMBLER_RING_WORDS];
+	unsigned int out[SCRAMBLER_RING_WORDS];
+};
 
 #endif
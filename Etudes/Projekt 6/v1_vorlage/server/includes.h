@@ -1,15 +1,40 @@
 #if !defined _includes_h_
 #define _includes_h_
 
+// recvmmsg()/sendmmsg() and friends are GNU extensions
+#if !defined _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "../packetlib/packetlib.h"
 #include "../timeoutlib/timeoutlib.h"
 #include "7seglib/7seg.h"
-#include "vslabd.h"
+#include "uringlib/uring.h"
+#include "replycachelib/replycache.h"
+#include "resultcachelib/resultcache.h"
+#include "kernellib/kernel.h"
+#include "kernellib/fastdiv.h"
+#include "kernellib/lfsr.h"
+#include "reasmlib/reasm.h"
+#include "aggrlib/aggr.h"
+#include "fpgalib/fpgalib.h"
+#include "binloglib/binlog.h"
 
 //get required headers...
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include "vslabd.h"
+#if defined VSLD_HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
 
 #include <string.h>
 
@@ -0,0 +1,126 @@
+/**
+ *	\file fastdiv.c
+ *	\brief Division by invariant divisors
+ *	\version 1.0
+ *
+ *	\par Overview
+ *	Dividing by a known divisor can be done by multiplying with a precomputed magic
+ *	number and shifting (Granlund/Montgomery, in the form used by libdivide). Computing
+ *	the magic number costs a 64 by 32 bit division, so it only pays off for divisors
+ *	that come again: a divisor seen for the first time is remembered and divided by
+ *	with the / operator, its magic number is computed when it shows up a second time.
+ *	The lab boards' ARM7 has no divide instruction at all, there the difference is
+ *	largest.
+ *
+ *	Results equal those of the / operator on unsigned int for all operands.
+ */
+#include "fastdiv.h"
+
+/**
+ *	\ingroup kernel
+ *	\defgroup fastdiv Division by invariant divisors
+ *
+ * 	\{
+ */
+
+/**
+ *	\brief Get the position of the highest set bit
+ *	\param d	A nonzero value
+ *	\return		floor(log2(d))
+ */
+static int fdiv_log2(unsigned int d)
+{
+	int iLog = 0;
+
+	while (d >>= 1) iLog++;
+	return iLog;
+}
+
+/**
+ *	\brief Compute the magic number for a divisor
+ *	\param magic	Receives the magic number
+ *	\param d	The divisor, not zero
+ *
+ *	With l = floor(log2(d)), m = floor(2^(32+l) / d) + 1 fits into 32 bits if the
+ *	rounding error of 2^(32+l) / d is small enough; then n / d = mulhi(m, n) >> l.
+ *	Otherwise one more bit of precision is needed, which the evaluation provides by an
+ *	add-and-shift step (FDIV_ADD_MARKER). Powers of two are a plain shift.
+ */
+void fdiv_gen(struct fdiv_magic *magic, unsigned int d)
+{
+	int iLog = fdiv_log2(d);
+	unsigned long long ullNum;
+	unsigned int uProposed, uRem, uTwiceRem;
+
+	magic->uDivisor = d;
+	magic->uReady = 1;
+	if ((d & (d - 1)) == 0) {
+		magic->uMagic = 0;
+		magic->uMore = iLog;
+		return;
+	}
+
+	ullNum = (unsigned long long)1 << (32 + iLog);
+	uProposed = (unsigned int)(ullNum / d);
+	uRem = (unsigned int)(ullNum % d);
+	if (d - uRem < (1U << iLog)) magic->uMore = iLog;
+	else {
+		uProposed += uProposed;
+		uTwiceRem = uRem + uRem;
+		if ((uTwiceRem >= d) || (uTwiceRem < uRem)) uProposed++;
+		magic->uMore = iLog | FDIV_ADD_MARKER;
+	}
+	magic->uMagic = uProposed + 1;
+}
+
+/**
+ *	\brief Divide by a magic number
+ *	\param magic	Magic number computed by fdiv_gen()
+ *	\param n	The dividend
+ *	\return		n / magic->uDivisor
+ */
+unsigned int fdiv_apply(struct fdiv_magic *magic, unsigned int n)
+{
+	unsigned int q;
+
+	if (magic->uMagic == 0) return n >> magic->uMore;
+	q = (unsigned int)(((unsigned long long)magic->uMagic * n) >> 32);
+	if (magic->uMore & FDIV_ADD_MARKER) return (((n - q) >> 1) + q) >> (magic->uMore & FDIV_SHIFT_MASK);
+	return q >> magic->uMore;
+}
+
+/**
+ *	\brief Set up a divisor cache
+ *	\param cache	The cache to initialize
+ */
+void fdiv_init(struct fdiv_cache *cache)
+{
+	memset(cache, 0x00, sizeof(struct fdiv_cache));
+}
+
+/**
+ *	\brief Divide, using the cached magic number of the divisor if there is one
+ *	\param cache	The cache
+ *	\param n	The dividend
+ *	\param d	The divisor, not zero
+ *	\return		n / d
+ */
+unsigned int fdiv_divide(struct fdiv_cache *cache, unsigned int n, unsigned int d)
+{
+	struct fdiv_magic *magic = &cache->entry[((d * 0x9e3779b1U) >> 16) & (FDIV_CACHE_SIZE - 1)];
+
+	if (magic->uDivisor == d) {
+		if (!magic->uReady) fdiv_gen(magic, d);
+		cache->ulHits++;
+		return fdiv_apply(magic, n);
+	}
+	// first sight (or the entry was taken by another divisor) - remember it for next time
+	magic->uDivisor = d;
+	magic->uReady = 0;
+	cache->ulMisses++;
+	return n / d;
+}
+
+/**
+ *	\}
+ */
@@ -0,0 +1,49 @@
+/**
+ *	\file fastdiv.h
+ *	\brief Division by invariant divisors (header)
+ *	\version 1.0
+ *
+ */
+#if !defined _fastdiv_h_
+#define _fastdiv_h_
+
+#include <string.h>
+
+/** \brief Divisor cache size.
+ *
+ * Number of divisors a cache keeps magic numbers for, a power of two.
+ */
+#define FDIV_CACHE_SIZE		16
+
+/** \brief Shift field of struct fdiv_magic::uMore. */
+#define FDIV_SHIFT_MASK		0x1f
+/** \brief Set in struct fdiv_magic::uMore if the quotient needs the add-and-shift fixup. */
+#define FDIV_ADD_MARKER		0x40
+
+/**
+ *	\brief Magic number for one divisor
+ */
+struct fdiv_magic {
+	unsigned int uDivisor;		/**< \brief The divisor, zero if the entry is unused. */
+	unsigned int uMagic;		/**< \brief Multiplier, zero for powers of two. */
+	unsigned char uMore;		/**< \brief Shift and FDIV_ADD_MARKER. */
+	unsigned char uReady;		/**< \brief Set once \a uMagic and \a uMore are computed. */
+};
+
+/**
+ *	\brief A divisor cache
+ *
+ *	Direct mapped by divisor. Meant to be owned by one worker, so it needs no lock.
+ */
+struct fdiv_cache {
+	struct fdiv_magic entry[FDIV_CACHE_SIZE];	/**< \brief The divisors. */
+	unsigned long ulHits;				/**< \brief Divisions by multiplication. */
+	unsigned long ulMisses;				/**< \brief Divisions by the / operator. */
+};
+
+void fdiv_init(struct fdiv_cache *cache);
+void fdiv_gen(struct fdiv_magic *magic, unsigned int d);
+unsigned int fdiv_apply(struct fdiv_magic *magic, unsigned int n);
+unsigned int fdiv_divide(struct fdiv_cache *cache, unsigned int n, unsigned int d);
+
+#endif //#define _fastdiv_h_
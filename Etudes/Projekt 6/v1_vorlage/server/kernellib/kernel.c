@@ -0,0 +1,928 @@
+/**
+ *	\file kernel.c
+ *	\brief Vectorized arithmetic kernels
+ *	\version 1.4
+ *
+ *	\par Overview
+ *	Multiply and divide over whole arrays of operands, so batch requests are computed
+ *	several entries per instruction, and the element-wise operations, dot product and
+ *	matrix product of the bulk functions, the running sum, minimum and maximum of
+ *	the aggregation streams, and multiply and divide on the wider operands of typed
+ *	requests (64 bit integers, single and double precision), as well as the software
+ *	scrambler of lfsr.c. krn_init() picks the widest instruction set the CPU supports:
+ *	AVX2, SSE4.1 or NEON, with plain C as fallback for all other targets.
+ *
+ *	\par Division
+ *	No vector unit divides integers. Unsigned 32 bit operands are exact in double
+ *	precision, and the correctly rounded double quotient never crosses the next integer,
+ *	so flooring it gives the exact integer quotient. Zero divisors are replaced by one
+ *	and reported in a mask instead of being branched around. Floating point division is
+ *	a vector instruction everywhere but on 32 bit NEON; 64 bit integer division isn't
+ *	vectorized at all, see vsld_arith.c.
+ *
+ *	\par 64 bit multiplication
+ *	Neither SSE4.1 nor AVX2 multiply 64 bit lanes. The low 64 bits of the product are
+ *	lo(a) * lo(b) + ((hi(a) * lo(b) + lo(a) * hi(b)) << 32), three 32 x 32 -> 64 bit
+ *	multiplications per lane. NEON has no such multiplication, it uses the C kernel.
+ *
+ *	\par Scrambling
+ *	The scrambled word is the carry-less product of the word and the polynom's impulse
+ *	response, bits 31 to 62 of it (see lfsr.c). Where the CPU multiplies carry-less
+ *	(PCLMULQDQ on x86, PMULL on 64 bit ARM with the crypto extension) that is one
+ *	multiplication per word, chosen independently of the other kernels; elsewhere the
+ *	C kernel looks the four bytes of the word up in the polynom's tables.
+ *
+ *	\par Matrix product
+ *	krn_matmul() adds multiples of rows of B to rows of C (madd), which vectorizes along
+ *	the rows without gathering columns. It goes through B block by block, see KRN_BLOCK,
+ *	so each block is loaded into the cache once rather than once per row of A.
+ */
+#include "kernel.h"
+#include "lfsr.h"
+
+/**
+ *	\ingroup vslabdaemon
+ *	\defgroup kernel Arithmetic kernels
+ *
+ * 	\{
+ */
+
+/**
+ *	\brief Scalar multiply kernel
+ */
+static void krn_mul_c(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) r[i] = a[i] * b[i];
+}
+
+/**
+ *	\brief Scalar divide kernel
+ */
+static void krn_div_c(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int *mask, unsigned int n)
+{
+	unsigned int i, z;
+
+	for (i = 0; i < n; i++) {
+		z = (b[i] == 0);
+		r[i] = (a[i] / (b[i] | z)) & (z - 1);
+		mask[i] = -z;
+	}
+}
+
+/**
+ *	\brief Scalar add kernel
+ */
+static void krn_add_c(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) r[i] = a[i] + b[i];
+}
+
+/**
+ *	\brief Scalar subtract kernel
+ */
+static void krn_sub_c(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) r[i] = a[i] - b[i];
+}
+
+/**
+ *	\brief Scalar multiply-add kernel
+ */
+static void krn_madd_c(unsigned int s, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) r[i] += s * b[i];
+}
+
+/**
+ *	\brief Scalar dot product kernel
+ */
+static unsigned int krn_dot_c(const unsigned int *a, const unsigned int *b, unsigned int n)
+{
+	unsigned int i, uSum = 0;
+
+	for (i = 0; i < n; i++) uSum += a[i] * b[i];
+	return uSum;
+}
+
+/**
+ *	\brief Scalar sum, minimum and maximum kernel
+ */
+static void krn_stat_c(const unsigned int *a, unsigned int n, long long *sum, int *min, int *max)
+{
+	unsigned int i;
+	long long llSum = 0;
+	int iMin = *min, iMax = *max, v;
+
+	for (i = 0; i < n; i++) {
+		v = (int)a[i];
+		llSum += v;
+		iMin = (v < iMin) ? v : iMin;
+		iMax = (v > iMax) ? v : iMax;
+	}
+	*sum += llSum;
+	*min = iMin;
+	*max = iMax;
+}
+
+/**
+ *	\brief Scalar 64 bit multiply kernel
+ */
+static void krn_mul64_c(const long long *a, const long long *b, long long *r, unsigned int n)
+{
+	unsigned int i;
+
+	// unsigned, so overflow wraps instead of being undefined
+	for (i = 0; i < n; i++) r[i] = (long long)((unsigned long long)a[i] * (unsigned long long)b[i]);
+}
+
+/**
+ *	\brief Scalar single precision multiply kernel
+ */
+static void krn_mulf_c(const float *a, const float *b, float *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) r[i] = a[i] * b[i];
+}
+
+/**
+ *	\brief Scalar single precision divide kernel
+ */
+static void krn_divf_c(const float *a, const float *b, float *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) r[i] = a[i] / b[i];
+}
+
+/**
+ *	\brief Scalar double precision multiply kernel
+ */
+static void krn_muld_c(const double *a, const double *b, double *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) r[i] = a[i] * b[i];
+}
+
+/**
+ *	\brief Scalar double precision divide kernel
+ */
+static void krn_divd_c(const double *a, const double *b, double *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) r[i] = a[i] / b[i];
+}
+
+/**
+ *	\brief Table driven scramble kernel
+ */
+static void krn_lfsr_c(const struct lfsr_tables *l, const unsigned int *a, unsigned int *r, unsigned int n)
+{
+	unsigned int i, w;
+
+	for (i = 0; i < n; i++) {
+		w = a[i];
+		r[i] = l->table[0][w & 0xff] ^ l->table[1][(w >> 8) & 0xff] ^ l->table[2][(w >> 16) & 0xff] ^ l->table[3][w >> 24];
+	}
+}
+
+#if defined KRN_HAVE_X86
+/**
+ *	\brief SSE4.1 multiply kernel, 4 lanes
+ */
+__attribute__((target("sse4.1")))
+static void krn_mul_sse41(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+	__m128i va, vb;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		va = _mm_loadu_si128((const __m128i *)&a[i]);
+		vb = _mm_loadu_si128((const __m128i *)&b[i]);
+		_mm_storeu_si128((__m128i *)&r[i], _mm_mullo_epi32(va, vb));
+	}
+	krn_mul_c(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief SSE4.1 divide kernel, 2 lanes per double vector
+ */
+__attribute__((target("sse4.1")))
+static void krn_div_sse41(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int *mask, unsigned int n)
+{
+	unsigned int i;
+	const __m128i sign = _mm_set1_epi32((int)0x80000000U), zero = _mm_setzero_si128(), one = _mm_set1_epi32(1);
+	const __m128d bias = _mm_set1_pd(2147483648.0);
+	__m128i va, vb, vz, q;
+	__m128d qlo, qhi;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		va = _mm_loadu_si128((const __m128i *)&a[i]);
+		vb = _mm_loadu_si128((const __m128i *)&b[i]);
+		vz = _mm_cmpeq_epi32(vb, zero);
+		vb = _mm_blendv_epi8(vb, one, vz);
+		// unsigned to double: flip the sign bit, convert signed, add 2^31
+		va = _mm_xor_si128(va, sign);
+		vb = _mm_xor_si128(vb, sign);
+		qlo = _mm_div_pd(_mm_add_pd(_mm_cvtepi32_pd(va), bias), _mm_add_pd(_mm_cvtepi32_pd(vb), bias));
+		qhi = _mm_div_pd(_mm_add_pd(_mm_cvtepi32_pd(_mm_srli_si128(va, 8)), bias),
+				 _mm_add_pd(_mm_cvtepi32_pd(_mm_srli_si128(vb, 8)), bias));
+		// and back: floor, subtract 2^31, convert signed, flip the sign bit
+		qlo = _mm_sub_pd(_mm_floor_pd(qlo), bias);
+		qhi = _mm_sub_pd(_mm_floor_pd(qhi), bias);
+		q = _mm_unpacklo_epi64(_mm_cvttpd_epi32(qlo), _mm_cvttpd_epi32(qhi));
+		q = _mm_xor_si128(q, sign);
+		_mm_storeu_si128((__m128i *)&r[i], _mm_andnot_si128(vz, q));
+		_mm_storeu_si128((__m128i *)&mask[i], vz);
+	}
+	krn_div_c(&a[i], &b[i], &r[i], &mask[i], n - i);
+}
+
+/**
+ *	\brief SSE4.1 add kernel, 4 lanes
+ */
+__attribute__((target("sse4.1")))
+static void krn_add_sse41(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4)
+		_mm_storeu_si128((__m128i *)&r[i], _mm_add_epi32(_mm_loadu_si128((const __m128i *)&a[i]),
+								_mm_loadu_si128((const __m128i *)&b[i])));
+	krn_add_c(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief SSE4.1 subtract kernel, 4 lanes
+ */
+__attribute__((target("sse4.1")))
+static void krn_sub_sse41(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4)
+		_mm_storeu_si128((__m128i *)&r[i], _mm_sub_epi32(_mm_loadu_si128((const __m128i *)&a[i]),
+								_mm_loadu_si128((const __m128i *)&b[i])));
+	krn_sub_c(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief SSE4.1 multiply-add kernel, 4 lanes
+ */
+__attribute__((target("sse4.1")))
+static void krn_madd_sse41(unsigned int s, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+	const __m128i vs = _mm_set1_epi32((int)s);
+	__m128i vr;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		vr = _mm_loadu_si128((const __m128i *)&r[i]);
+		vr = _mm_add_epi32(vr, _mm_mullo_epi32(vs, _mm_loadu_si128((const __m128i *)&b[i])));
+		_mm_storeu_si128((__m128i *)&r[i], vr);
+	}
+	krn_madd_c(s, &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief SSE4.1 dot product kernel, 4 lanes
+ */
+__attribute__((target("sse4.1")))
+static unsigned int krn_dot_sse41(const unsigned int *a, const unsigned int *b, unsigned int n)
+{
+	unsigned int i, lane[4];
+	__m128i vsum = _mm_setzero_si128();
+
+	for (i = 0; i + 4 <= n; i += 4)
+		vsum = _mm_add_epi32(vsum, _mm_mullo_epi32(_mm_loadu_si128((const __m128i *)&a[i]),
+							   _mm_loadu_si128((const __m128i *)&b[i])));
+	_mm_storeu_si128((__m128i *)lane, vsum);
+	return lane[0] + lane[1] + lane[2] + lane[3] + krn_dot_c(&a[i], &b[i], n - i);
+}
+
+/**
+ *	\brief SSE4.1 sum, minimum and maximum kernel, 4 lanes
+ *
+ *	The sum is widened to two 64 bit lanes per half vector, so it can't overflow.
+ */
+__attribute__((target("sse4.1")))
+static void krn_stat_sse41(const unsigned int *a, unsigned int n, long long *sum, int *min, int *max)
+{
+	unsigned int i;
+	int j, mins[4], maxs[4];
+	long long sums[4];
+	__m128i va, vlo = _mm_setzero_si128(), vhi = _mm_setzero_si128();
+	__m128i vmin = _mm_set1_epi32(*min), vmax = _mm_set1_epi32(*max);
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		va = _mm_loadu_si128((const __m128i *)&a[i]);
+		vlo = _mm_add_epi64(vlo, _mm_cvtepi32_epi64(va));
+		vhi = _mm_add_epi64(vhi, _mm_cvtepi32_epi64(_mm_srli_si128(va, 8)));
+		vmin = _mm_min_epi32(vmin, va);
+		vmax = _mm_max_epi32(vmax, va);
+	}
+	_mm_storeu_si128((__m128i *)&sums[0], vlo);
+	_mm_storeu_si128((__m128i *)&sums[2], vhi);
+	_mm_storeu_si128((__m128i *)mins, vmin);
+	_mm_storeu_si128((__m128i *)maxs, vmax);
+	for (j = 0; j < 4; j++) {
+		*sum += sums[j];
+		*min = (mins[j] < *min) ? mins[j] : *min;
+		*max = (maxs[j] > *max) ? maxs[j] : *max;
+	}
+	krn_stat_c(&a[i], n - i, sum, min, max);
+}
+
+/**
+ *	\brief SSE4.1 64 bit multiply kernel, 2 lanes
+ */
+__attribute__((target("sse4.1")))
+static void krn_mul64_sse41(const long long *a, const long long *b, long long *r, unsigned int n)
+{
+	unsigned int i;
+	__m128i va, vb, cross;
+
+	for (i = 0; i + 2 <= n; i += 2) {
+		va = _mm_loadu_si128((const __m128i *)&a[i]);
+		vb = _mm_loadu_si128((const __m128i *)&b[i]);
+		cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(va, 32), vb), _mm_mul_epu32(va, _mm_srli_epi64(vb, 32)));
+		_mm_storeu_si128((__m128i *)&r[i], _mm_add_epi64(_mm_mul_epu32(va, vb), _mm_slli_epi64(cross, 32)));
+	}
+	krn_mul64_c(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief SSE4.1 single precision multiply kernel, 4 lanes
+ */
+__attribute__((target("sse4.1")))
+static void krn_mulf_sse41(const float *a, const float *b, float *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) _mm_storeu_ps(&r[i], _mm_mul_ps(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i])));
+	krn_mulf_c(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief SSE4.1 single precision divide kernel, 4 lanes
+ */
+__attribute__((target("sse4.1")))
+static void krn_divf_sse41(const float *a, const float *b, float *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) _mm_storeu_ps(&r[i], _mm_div_ps(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i])));
+	krn_divf_c(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief SSE4.1 double precision multiply kernel, 2 lanes
+ */
+__attribute__((target("sse4.1")))
+static void krn_muld_sse41(const double *a, const double *b, double *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 2 <= n; i += 2) _mm_storeu_pd(&r[i], _mm_mul_pd(_mm_loadu_pd(&a[i]), _mm_loadu_pd(&b[i])));
+	krn_muld_c(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief SSE4.1 double precision divide kernel, 2 lanes
+ */
+__attribute__((target("sse4.1")))
+static void krn_divd_sse41(const double *a, const double *b, double *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 2 <= n; i += 2) _mm_storeu_pd(&r[i], _mm_div_pd(_mm_loadu_pd(&a[i]), _mm_loadu_pd(&b[i])));
+	krn_divd_c(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief AVX2 multiply kernel, 8 lanes
+ */
+__attribute__((target("avx2")))
+static void krn_mul_avx2(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+	__m256i va, vb;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		va = _mm256_loadu_si256((const __m256i *)&a[i]);
+		vb = _mm256_loadu_si256((const __m256i *)&b[i]);
+		_mm256_storeu_si256((__m256i *)&r[i], _mm256_mullo_epi32(va, vb));
+	}
+	krn_mul_sse41(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief AVX2 divide kernel, 4 lanes per double vector
+ */
+__attribute__((target("avx2")))
+static void krn_div_avx2(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int *mask, unsigned int n)
+{
+	unsigned int i;
+	const __m256i sign = _mm256_set1_epi32((int)0x80000000U), zero = _mm256_setzero_si256(), one = _mm256_set1_epi32(1);
+	const __m256d bias = _mm256_set1_pd(2147483648.0);
+	__m256i va, vb, vz, q;
+	__m256d qlo, qhi;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		va = _mm256_loadu_si256((const __m256i *)&a[i]);
+		vb = _mm256_loadu_si256((const __m256i *)&b[i]);
+		vz = _mm256_cmpeq_epi32(vb, zero);
+		vb = _mm256_blendv_epi8(vb, one, vz);
+		va = _mm256_xor_si256(va, sign);
+		vb = _mm256_xor_si256(vb, sign);
+		qlo = _mm256_div_pd(_mm256_add_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(va)), bias),
+				    _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(vb)), bias));
+		qhi = _mm256_div_pd(_mm256_add_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(va, 1)), bias),
+				    _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(vb, 1)), bias));
+		qlo = _mm256_sub_pd(_mm256_floor_pd(qlo), bias);
+		qhi = _mm256_sub_pd(_mm256_floor_pd(qhi), bias);
+		q = _mm256_set_m128i(_mm256_cvttpd_epi32(qhi), _mm256_cvttpd_epi32(qlo));
+		q = _mm256_xor_si256(q, sign);
+		_mm256_storeu_si256((__m256i *)&r[i], _mm256_andnot_si256(vz, q));
+		_mm256_storeu_si256((__m256i *)&mask[i], vz);
+	}
+	krn_div_sse41(&a[i], &b[i], &r[i], &mask[i], n - i);
+}
+
+/**
+ *	\brief AVX2 add kernel, 8 lanes
+ */
+__attribute__((target("avx2")))
+static void krn_add_avx2(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= n; i += 8)
+		_mm256_storeu_si256((__m256i *)&r[i], _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)&a[i]),
+								       _mm256_loadu_si256((const __m256i *)&b[i])));
+	krn_add_sse41(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief AVX2 subtract kernel, 8 lanes
+ */
+__attribute__((target("avx2")))
+static void krn_sub_avx2(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= n; i += 8)
+		_mm256_storeu_si256((__m256i *)&r[i], _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)&a[i]),
+								       _mm256_loadu_si256((const __m256i *)&b[i])));
+	krn_sub_sse41(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief AVX2 multiply-add kernel, 8 lanes
+ */
+__attribute__((target("avx2")))
+static void krn_madd_avx2(unsigned int s, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+	const __m256i vs = _mm256_set1_epi32((int)s);
+	__m256i vr;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		vr = _mm256_loadu_si256((const __m256i *)&r[i]);
+		vr = _mm256_add_epi32(vr, _mm256_mullo_epi32(vs, _mm256_loadu_si256((const __m256i *)&b[i])));
+		_mm256_storeu_si256((__m256i *)&r[i], vr);
+	}
+	krn_madd_sse41(s, &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief AVX2 dot product kernel, 8 lanes
+ */
+__attribute__((target("avx2")))
+static unsigned int krn_dot_avx2(const unsigned int *a, const unsigned int *b, unsigned int n)
+{
+	unsigned int i, j, lane[8], uSum = 0;
+	__m256i vsum = _mm256_setzero_si256();
+
+	for (i = 0; i + 8 <= n; i += 8)
+		vsum = _mm256_add_epi32(vsum, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)&a[i]),
+								 _mm256_loadu_si256((const __m256i *)&b[i])));
+	_mm256_storeu_si256((__m256i *)lane, vsum);
+	for (j = 0; j < 8; j++) uSum += lane[j];
+	return uSum + krn_dot_sse41(&a[i], &b[i], n - i);
+}
+
+/**
+ *	\brief AVX2 sum, minimum and maximum kernel, 8 lanes
+ */
+__attribute__((target("avx2")))
+static void krn_stat_avx2(const unsigned int *a, unsigned int n, long long *sum, int *min, int *max)
+{
+	unsigned int i;
+	int j, mins[8], maxs[8];
+	long long sums[8];
+	__m256i va, vlo = _mm256_setzero_si256(), vhi = _mm256_setzero_si256();
+	__m256i vmin = _mm256_set1_epi32(*min), vmax = _mm256_set1_epi32(*max);
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		va = _mm256_loadu_si256((const __m256i *)&a[i]);
+		vlo = _mm256_add_epi64(vlo, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(va)));
+		vhi = _mm256_add_epi64(vhi, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(va, 1)));
+		vmin = _mm256_min_epi32(vmin, va);
+		vmax = _mm256_max_epi32(vmax, va);
+	}
+	_mm256_storeu_si256((__m256i *)&sums[0], vlo);
+	_mm256_storeu_si256((__m256i *)&sums[4], vhi);
+	_mm256_storeu_si256((__m256i *)mins, vmin);
+	_mm256_storeu_si256((__m256i *)maxs, vmax);
+	for (j = 0; j < 8; j++) {
+		*sum += sums[j];
+		*min = (mins[j] < *min) ? mins[j] : *min;
+		*max = (maxs[j] > *max) ? maxs[j] : *max;
+	}
+	krn_stat_sse41(&a[i], n - i, sum, min, max);
+}
+/**
+ *	\brief AVX2 64 bit multiply kernel, 4 lanes
+ */
+__attribute__((target("avx2")))
+static void krn_mul64_avx2(const long long *a, const long long *b, long long *r, unsigned int n)
+{
+	unsigned int i;
+	__m256i va, vb, cross;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		va = _mm256_loadu_si256((const __m256i *)&a[i]);
+		vb = _mm256_loadu_si256((const __m256i *)&b[i]);
+		cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(va, 32), vb), _mm256_mul_epu32(va, _mm256_srli_epi64(vb, 32)));
+		_mm256_storeu_si256((__m256i *)&r[i], _mm256_add_epi64(_mm256_mul_epu32(va, vb), _mm256_slli_epi64(cross, 32)));
+	}
+	krn_mul64_sse41(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief AVX2 single precision multiply kernel, 8 lanes
+ */
+__attribute__((target("avx2")))
+static void krn_mulf_avx2(const float *a, const float *b, float *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= n; i += 8) _mm256_storeu_ps(&r[i], _mm256_mul_ps(_mm256_loadu_ps(&a[i]), _mm256_loadu_ps(&b[i])));
+	krn_mulf_sse41(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief AVX2 single precision divide kernel, 8 lanes
+ */
+__attribute__((target("avx2")))
+static void krn_divf_avx2(const float *a, const float *b, float *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= n; i += 8) _mm256_storeu_ps(&r[i], _mm256_div_ps(_mm256_loadu_ps(&a[i]), _mm256_loadu_ps(&b[i])));
+	krn_divf_sse41(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief AVX2 double precision multiply kernel, 4 lanes
+ */
+__attribute__((target("avx2")))
+static void krn_muld_avx2(const double *a, const double *b, double *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) _mm256_storeu_pd(&r[i], _mm256_mul_pd(_mm256_loadu_pd(&a[i]), _mm256_loadu_pd(&b[i])));
+	krn_muld_sse41(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief AVX2 double precision divide kernel, 4 lanes
+ */
+__attribute__((target("avx2")))
+static void krn_divd_avx2(const double *a, const double *b, double *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) _mm256_storeu_pd(&r[i], _mm256_div_pd(_mm256_loadu_pd(&a[i]), _mm256_loadu_pd(&b[i])));
+	krn_divd_sse41(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief PCLMULQDQ scramble kernel, 4 words per round
+ *
+ *	The words are widened to 64 bit lanes, so each multiplication sees one word only.
+ *	Bits 31 to 62 of the products are shifted down and the low halves of the lanes
+ *	packed back together.
+ */
+__attribute__((target("pclmul,sse4.1")))
+static void krn_lfsr_pclmul(const struct lfsr_tables *l, const unsigned int *a, unsigned int *r, unsigned int n)
+{
+	__m128i q = _mm_cvtsi32_si128((int)l->uImpulse), w, lo, hi;
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		w = _mm_loadu_si128((const __m128i *)&a[i]);
+		lo = _mm_cvtepu32_epi64(w);
+		hi = _mm_cvtepu32_epi64(_mm_srli_si128(w, 8));
+		lo = _mm_unpacklo_epi64(_mm_clmulepi64_si128(lo, q, 0x00), _mm_clmulepi64_si128(lo, q, 0x01));
+		hi = _mm_unpacklo_epi64(_mm_clmulepi64_si128(hi, q, 0x00), _mm_clmulepi64_si128(hi, q, 0x01));
+		lo = _mm_shuffle_epi32(_mm_srli_epi64(lo, 31), _MM_SHUFFLE(3, 1, 2, 0));
+		hi = _mm_shuffle_epi32(_mm_srli_epi64(hi, 31), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm_storeu_si128((__m128i *)&r[i], _mm_unpacklo_epi64(lo, hi));
+	}
+	krn_lfsr_c(l, &a[i], &r[i], n - i);
+}
+#endif //#if defined KRN_HAVE_X86
+
+#if defined KRN_HAVE_NEON
+/**
+ *	\brief NEON multiply kernel, 4 lanes
+ */
+static void krn_mul_neon(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) vst1q_u32(&r[i], vmulq_u32(vld1q_u32(&a[i]), vld1q_u32(&b[i])));
+	krn_mul_c(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief NEON add kernel, 4 lanes
+ */
+static void krn_add_neon(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) vst1q_u32(&r[i], vaddq_u32(vld1q_u32(&a[i]), vld1q_u32(&b[i])));
+	krn_add_c(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief NEON subtract kernel, 4 lanes
+ */
+static void krn_sub_neon(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) vst1q_u32(&r[i], vsubq_u32(vld1q_u32(&a[i]), vld1q_u32(&b[i])));
+	krn_sub_c(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief NEON multiply-add kernel, 4 lanes
+ */
+static void krn_madd_neon(unsigned int s, const unsigned int *b, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) vst1q_u32(&r[i], vmlaq_n_u32(vld1q_u32(&r[i]), vld1q_u32(&b[i]), s));
+	krn_madd_c(s, &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief NEON dot product kernel, 4 lanes
+ */
+static unsigned int krn_dot_neon(const unsigned int *a, const unsigned int *b, unsigned int n)
+{
+	unsigned int i, lane[4];
+	uint32x4_t vsum = vdupq_n_u32(0);
+
+	for (i = 0; i + 4 <= n; i += 4) vsum = vmlaq_u32(vsum, vld1q_u32(&a[i]), vld1q_u32(&b[i]));
+	vst1q_u32(lane, vsum);
+	return lane[0] + lane[1] + lane[2] + lane[3] + krn_dot_c(&a[i], &b[i], n - i);
+}
+
+/**
+ *	\brief NEON sum, minimum and maximum kernel, 4 lanes
+ */
+static void krn_stat_neon(const unsigned int *a, unsigned int n, long long *sum, int *min, int *max)
+{
+	unsigned int i;
+	int j, mins[4], maxs[4];
+	int64x2_t vsum = vdupq_n_s64(0);
+	int32x4_t va, vmin = vdupq_n_s32(*min), vmax = vdupq_n_s32(*max);
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		va = vreinterpretq_s32_u32(vld1q_u32(&a[i]));
+		vsum = vpadalq_s32(vsum, va);
+		vmin = vminq_s32(vmin, va);
+		vmax = vmaxq_s32(vmax, va);
+	}
+	vst1q_s32(mins, vmin);
+	vst1q_s32(maxs, vmax);
+	*sum += vgetq_lane_s64(vsum, 0) + vgetq_lane_s64(vsum, 1);
+	for (j = 0; j < 4; j++) {
+		*min = (mins[j] < *min) ? mins[j] : *min;
+		*max = (maxs[j] > *max) ? maxs[j] : *max;
+	}
+	krn_stat_c(&a[i], n - i, sum, min, max);
+}
+
+/**
+ *	\brief NEON single precision multiply kernel, 4 lanes
+ */
+static void krn_mulf_neon(const float *a, const float *b, float *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) vst1q_f32(&r[i], vmulq_f32(vld1q_f32(&a[i]), vld1q_f32(&b[i])));
+	krn_mulf_c(&a[i], &b[i], &r[i], n - i);
+}
+
+#if defined __aarch64__
+/**
+ *	\brief NEON divide kernel, 2 lanes per double vector
+ *
+ *	Only AArch64 has vector double division, 32 bit NEON uses the scalar kernel.
+ */
+static void krn_div_neon(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int *mask, unsigned int n)
+{
+	unsigned int i;
+	uint32x4_t va, vb, vz;
+	float64x2_t qlo, qhi;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		va = vld1q_u32(&a[i]);
+		vb = vld1q_u32(&b[i]);
+		vz = vceqq_u32(vb, vdupq_n_u32(0));
+		vb = vbslq_u32(vz, vdupq_n_u32(1), vb);
+		qlo = vdivq_f64(vcvtq_f64_u64(vmovl_u32(vget_low_u32(va))), vcvtq_f64_u64(vmovl_u32(vget_low_u32(vb))));
+		qhi = vdivq_f64(vcvtq_f64_u64(vmovl_u32(vget_high_u32(va))), vcvtq_f64_u64(vmovl_u32(vget_high_u32(vb))));
+		// the conversion truncates, which is the floor for positive quotients
+		va = vcombine_u32(vmovn_u64(vcvtq_u64_f64(qlo)), vmovn_u64(vcvtq_u64_f64(qhi)));
+		vst1q_u32(&r[i], vbicq_u32(va, vz));
+		vst1q_u32(&mask[i], vz);
+	}
+	krn_div_c(&a[i], &b[i], &r[i], &mask[i], n - i);
+}
+
+/**
+ *	\brief NEON single precision divide kernel, 4 lanes
+ */
+static void krn_divf_neon(const float *a, const float *b, float *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) vst1q_f32(&r[i], vdivq_f32(vld1q_f32(&a[i]), vld1q_f32(&b[i])));
+	krn_divf_c(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief NEON double precision multiply kernel, 2 lanes
+ */
+static void krn_muld_neon(const double *a, const double *b, double *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 2 <= n; i += 2) vst1q_f64(&r[i], vmulq_f64(vld1q_f64(&a[i]), vld1q_f64(&b[i])));
+	krn_muld_c(&a[i], &b[i], &r[i], n - i);
+}
+
+/**
+ *	\brief NEON double precision divide kernel, 2 lanes
+ */
+static void krn_divd_neon(const double *a, const double *b, double *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i + 2 <= n; i += 2) vst1q_f64(&r[i], vdivq_f64(vld1q_f64(&a[i]), vld1q_f64(&b[i])));
+	krn_divd_c(&a[i], &b[i], &r[i], n - i);
+}
+#else
+#define krn_div_neon	krn_div_c
+#define krn_divf_neon	krn_divf_c
+#define krn_muld_neon	krn_muld_c
+#define krn_divd_neon	krn_divd_c
+#endif
+
+#if defined __aarch64__ && (defined __ARM_FEATURE_CRYPTO || defined __ARM_FEATURE_AES)
+/**
+ *	\brief PMULL scramble kernel, one word per multiplication
+ */
+static void krn_lfsr_pmull(const struct lfsr_tables *l, const unsigned int *a, unsigned int *r, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		r[i] = (unsigned int)(vgetq_lane_u64(vreinterpretq_u64_p128(vmull_p64(a[i], l->uImpulse)), 0) >> 31);
+}
+#define KRN_HAVE_PMULL
+#endif
+#endif //#if defined KRN_HAVE_NEON
+
+/**
+ *	\brief The selected kernels, plain C until krn_init() ran
+ */
+struct krn_ops krn = { "scalar", krn_mul_c, krn_div_c, krn_add_c, krn_sub_c, krn_madd_c, krn_dot_c, krn_stat_c,
+			krn_mul64_c, krn_mulf_c, krn_divf_c, krn_muld_c, krn_divd_c, krn_lfsr_c, 0, "tables" };
+
+/**
+ *	\brief Select the kernels for this CPU
+ *
+ *	Call once at startup, before any thread uses \a krn.
+ */
+void krn_init(void)
+{
+#if defined KRN_HAVE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		krn.name = "avx2";
+		krn.mul = krn_mul_avx2;
+		krn.div = krn_div_avx2;
+		krn.add = krn_add_avx2;
+		krn.sub = krn_sub_avx2;
+		krn.madd = krn_madd_avx2;
+		krn.dot = krn_dot_avx2;
+		krn.stat = krn_stat_avx2;
+		krn.mul64 = krn_mul64_avx2;
+		krn.mulf = krn_mulf_avx2;
+		krn.divf = krn_divf_avx2;
+		krn.muld = krn_muld_avx2;
+		krn.divd = krn_divd_avx2;
+		krn.iDivVector = 1;
+	}
+	else if (__builtin_cpu_supports("sse4.1")) {
+		krn.name = "sse4.1";
+		krn.mul = krn_mul_sse41;
+		krn.div = krn_div_sse41;
+		krn.add = krn_add_sse41;
+		krn.sub = krn_sub_sse41;
+		krn.madd = krn_madd_sse41;
+		krn.dot = krn_dot_sse41;
+		krn.stat = krn_stat_sse41;
+		krn.mul64 = krn_mul64_sse41;
+		krn.mulf = krn_mulf_sse41;
+		krn.divf = krn_divf_sse41;
+		krn.muld = krn_muld_sse41;
+		krn.divd = krn_divd_sse41;
+		krn.iDivVector = 1;
+	}
+	if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+		krn.lfsr = krn_lfsr_pclmul;
+		krn.lfsr_name = "pclmul";
+	}
+#elif defined KRN_HAVE_NEON
+	krn.name = "neon";
+	krn.mul = krn_mul_neon;
+	krn.div = krn_div_neon;
+	krn.add = krn_add_neon;
+	krn.sub = krn_sub_neon;
+	krn.madd = krn_madd_neon;
+	krn.dot = krn_dot_neon;
+	krn.stat = krn_stat_neon;
+	krn.mulf = krn_mulf_neon;
+	krn.divf = krn_divf_neon;
+	krn.muld = krn_muld_neon;
+	krn.divd = krn_divd_neon;
+#if defined __aarch64__
+	krn.iDivVector = 1;
+#endif
+#if defined KRN_HAVE_PMULL
+	krn.lfsr = krn_lfsr_pmull;
+	krn.lfsr_name = "pmull";
+#endif
+#endif
+}
+
+/**
+ *	\brief Multiply two matrices
+ *	\param a	m x k matrix, row by row
+ *	\param b	k x n matrix, row by row
+ *	\param c	Receives the m x n product, row by row
+ *	\param m	Rows of \a a
+ *	\param k	Columns of \a a, rows of \a b
+ *	\param n	Columns of \a b
+ *
+ *	Uses the kernels selected by krn_init().
+ */
+void krn_matmul(const unsigned int *a, const unsigned int *b, unsigned int *c, unsigned int m, unsigned int k, unsigned int n)
+{
+	unsigned int i, p, uK, uN, uKLen, uNLen;
+
+	memset(c, 0x00, (size_t)m * n * sizeof(unsigned int));
+	for (uK = 0; uK < k; uK += KRN_BLOCK) {
+		uKLen = (k - uK < KRN_BLOCK) ? k - uK : KRN_BLOCK;
+		for (uN = 0; uN < n; uN += KRN_BLOCK) {
+			uNLen = (n - uN < KRN_BLOCK) ? n - uN : KRN_BLOCK;
+			// the block of B rows uK.. and columns uN.. stays cached for all rows of A
+			for (i = 0; i < m; i++)
+				for (p = uK; p < uK + uKLen; p++)
+					krn.madd(a[(size_t)i * k + p], &b[(size_t)p * n + uN], &c[(size_t)i * n + uN], uNLen);
+		}
+	}
+}
+
+/**
+ *	\}
+ */
@@ -0,0 +1,82 @@
+/**
+ *	\file kernel.h
+ *	\brief Vectorized arithmetic kernels (header)
+ *	\version 1.4
+ *
+ */
+#if !defined _kernel_h_
+#define _kernel_h_
+
+#include <stdio.h>
+#include <string.h>
+
+// x86 kernels are compiled with target attributes and chosen by CPUID at run time, so
+// the daemon still runs on CPUs without AVX2
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(__UCLIBC__)
+#define KRN_HAVE_X86
+#include <immintrin.h>
+#endif
+
+// NEON is a compile time feature on ARM (-mfpu=neon), the lab boards' ARM7 has none
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define KRN_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+struct lfsr_tables;
+
+/**
+ *	\brief A set of kernels
+ *
+ *	The kernels work on arrays of \a n unsigned 32 bit operands, like the operands of
+ *	packets, unless their types say otherwise. Results equal those of the C operators
+ *	on the operand type, 64 bit products wrap like unsigned ones.
+ */
+struct krn_ops {
+	const char *name;		/**< \brief Instruction set used. */
+	/** \brief r[i] = a[i] * b[i] */
+	void (*mul)(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n);
+	/** \brief r[i] = a[i] / b[i]; zero divisors give r[i] = 0 and set mask[i] to all ones, else 0 */
+	void (*div)(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int *mask, unsigned int n);
+	/** \brief r[i] = a[i] + b[i] */
+	void (*add)(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n);
+	/** \brief r[i] = a[i] - b[i] */
+	void (*sub)(const unsigned int *a, const unsigned int *b, unsigned int *r, unsigned int n);
+	/** \brief r[i] += s * b[i] */
+	void (*madd)(unsigned int s, const unsigned int *b, unsigned int *r, unsigned int n);
+	/** \brief Sum of a[i] * b[i] */
+	unsigned int (*dot)(const unsigned int *a, const unsigned int *b, unsigned int n);
+	/** \brief Adds the a[i] as signed values to *sum, lowers *min and raises *max to them */
+	void (*stat)(const unsigned int *a, unsigned int n, long long *sum, int *min, int *max);
+	/** \brief r[i] = a[i] * b[i] on 64 bit integers */
+	void (*mul64)(const long long *a, const long long *b, long long *r, unsigned int n);
+	/** \brief r[i] = a[i] * b[i] in single precision */
+	void (*mulf)(const float *a, const float *b, float *r, unsigned int n);
+	/** \brief r[i] = a[i] / b[i] in single precision */
+	void (*divf)(const float *a, const float *b, float *r, unsigned int n);
+	/** \brief r[i] = a[i] * b[i] in double precision */
+	void (*muld)(const double *a, const double *b, double *r, unsigned int n);
+	/** \brief r[i] = a[i] / b[i] in double precision */
+	void (*divd)(const double *a, const double *b, double *r, unsigned int n);
+	/** \brief r[i] = a[i] scrambled with the polynom of \a l, see lfsr.c */
+	void (*lfsr)(const struct lfsr_tables *l, const unsigned int *a, unsigned int *r, unsigned int n);
+	int iDivVector;			/**< \brief Nonzero if \a div uses vector instructions. */
+	const char *lfsr_name;		/**< \brief Instruction set used by \a lfsr. */
+};
+
+/** \brief Matrix block size.
+ *
+ * krn_matmul() works on blocks of KRN_BLOCK x KRN_BLOCK elements of B, 16 KB that stay
+ * in the L1 cache while all rows of A pass by.
+ */
+#define KRN_BLOCK		64
+
+/**
+ *	\brief The kernels selected by krn_init()
+ */
+extern struct krn_ops krn;
+
+void krn_init(void);
+void krn_matmul(const unsigned int *a, const unsigned int *b, unsigned int *c, unsigned int m, unsigned int k, unsigned int n);
+
+#endif //#define _kernel_h_
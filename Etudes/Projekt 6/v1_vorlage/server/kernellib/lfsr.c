@@ -0,0 +1,74 @@
+/**
+ *	\file lfsr.c
+ *	\brief Software scrambler
+ *	\version 1.0
+ *
+ *	\par Overview
+ *	Scrambles words bit-exactly like the FPGA scrambler as modelled by fpgalib's
+ *	stand-in: each word on its own, most significant bit first, every output bit being
+ *	the input bit xor the parity of the preceding output bits of the word masked with
+ *	the generator polynom (bit j taps the output bit j + 1 bits back, bits above 15 are
+ *	ignored). lfsr_reference() does exactly that, one bit at a time.
+ *
+ *	\par Tables
+ *	Counting bits from the first one sent, the scrambler divides the input by
+ *	p(x) = 1 + x * g(x) over GF(2) and keeps 32 terms of the quotient, i.e. it
+ *	multiplies by the power series q(x) = 1 / p(x). That is linear, so the scrambled
+ *	word is the xor of the scrambled bytes of the word, four table lookups per word.
+ *	The tables of a polynom are built from q alone, which is the scrambled 0x80000000.
+ *	The product with q is also a single carry-less multiplication, which the PCLMULQDQ
+ *	and PMULL kernels in kernel.c use instead of the tables.
+ */
+#include "lfsr.h"
+
+/**
+ *	\ingroup kernel
+ *	\defgroup lfsr Software scrambler
+ *
+ * 	\{
+ */
+
+/**
+ *	\brief Scramble one word one bit at a time
+ *	\param uPolynom	The generator polynom
+ *	\param uWord	The word
+ *	\return		The scrambled word
+ */
+unsigned int lfsr_reference(unsigned int uPolynom, unsigned int uWord)
+{
+	unsigned int uState = 0, uBit = 0, uResult = 0;
+	int i;
+
+	for (i = 31; i >= 0; i--) {
+		uBit = ((uWord >> i) & 1) ^ __builtin_parity(uState & uPolynom & 0xffff);
+		uState = (uState << 1) | uBit;
+		uResult |= uBit << i;
+	}
+	return uResult;
+}
+
+/**
+ *	\brief Compute the tables of a generator polynom
+ *	\param l	The tables
+ *	\param uPolynom	The generator polynom
+ *
+ *	Bit i of a word scrambles to the terms of q shifted down to it, uImpulse >> (31 - i).
+ *	Each table entry is an entry with one bit less xor that bit's contribution.
+ */
+void lfsr_init(struct lfsr_tables *l, unsigned int uPolynom)
+{
+	unsigned int k, b;
+
+	l->uPolynom = uPolynom;
+	l->uImpulse = lfsr_reference(uPolynom, 0x80000000U);
+	for (k = 0; k < 4; k++) {
+		l->table[k][0] = 0;
+		for (b = 1; b < 256; b++)
+			l->table[k][b] = l->table[k][b & (b - 1)] ^ (l->uImpulse >> (31 - (8 * k + __builtin_ctz(b))));
+	}
+	l->uReady = 1;
+}
+
+/**
+ *	\}
+ */
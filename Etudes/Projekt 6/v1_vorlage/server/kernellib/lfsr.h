@@ -0,0 +1,27 @@
+/**
+ *	\file lfsr.h
+ *	\brief Software scrambler (header)
+ *	\version 1.0
+ *
+ */
+#if !defined _lfsr_h_
+#define _lfsr_h_
+
+#include <string.h>
+
+/**
+ *	\brief Tables of one generator polynom
+ *
+ *	Meant to be owned by one worker, so they need no lock.
+ */
+struct lfsr_tables {
+	unsigned int uPolynom;		/**< \brief The generator polynom. */
+	unsigned int uReady;		/**< \brief Set once the tables are computed for \a uPolynom. */
+	unsigned int uImpulse;		/**< \brief Scrambled 0x80000000, the first 32 terms of 1 / p(x). */
+	unsigned int table[4][256];	/**< \brief Scrambled word holding only byte k = b, at table[k][b]. */
+};
+
+void lfsr_init(struct lfsr_tables *l, unsigned int uPolynom);
+unsigned int lfsr_reference(unsigned int uPolynom, unsigned int uWord);
+
+#endif //#define _lfsr_h_
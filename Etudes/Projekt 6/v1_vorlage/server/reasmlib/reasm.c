@@ -0,0 +1,236 @@
+/**
+ *	\file reasm.c
+ *	\brief Reassembly of requests sent in several datagrams
+ *	\version 1.0
+ *
+ *	\par Overview
+ *	Requests larger than a datagram arrive as numbered fragments, in any order and
+ *	possibly more than once. The table collects the fragments of each message, keyed by
+ *	sender address, port and request ID, until all of them are there. A message whose
+ *	next fragment doesn't arrive within the lifetime is dropped, its job is reused.
+ *	A released job remembers its message until the lifetime is over or the job is
+ *	needed, so late duplicates of its fragments don't start the message again.
+ *
+ *	\warning A table must only be used by one thread.
+ */
+#include "reasm.h"
+
+/**
+ *	\ingroup vslabdaemon
+ *	\defgroup reasm Reassembly
+ *
+ * 	\{
+ */
+
+/**
+ *	\brief Check whether two socket addresses are the same sender
+ *	\param a	Stored address
+ *	\param b	Address of a received datagram
+ *	\return		Nonzero if family, address and port are equal
+ */
+static int ra_same(struct sockaddr_storage *a, struct sockaddr *b)
+{
+	struct sockaddr_in *a4 = (struct sockaddr_in *)a, *b4 = (struct sockaddr_in *)b;
+	struct sockaddr_in6 *a6 = (struct sockaddr_in6 *)a, *b6 = (struct sockaddr_in6 *)b;
+
+	if (a->ss_family != b->sa_family) return 0;
+	if (b->sa_family == AF_INET)
+		return (a4->sin_port == b4->sin_port) && (a4->sin_addr.s_addr == b4->sin_addr.s_addr);
+	if (b->sa_family == AF_INET6)
+		return (a6->sin6_port == b6->sin6_port) &&
+		       (memcmp(&a6->sin6_addr, &b6->sin6_addr, sizeof(struct in6_addr)) == 0);
+	return 0;
+}
+
+/**
+ *	\brief Check a fragment against the limits of the table
+ *	\param table	The table
+ *	\param frag	The fragment
+ *	\return		Nonzero if sizes and numbers of the fragment are consistent
+ */
+static int ra_valid(struct ra_table *table, const struct ra_fragment *frag)
+{
+	unsigned int uLast;
+
+	if ((frag->uSize == 0) || (frag->uSize > table->uMaxSize) || (frag->uFragSize == 0)) return 0;
+	if ((frag->uTagLen > RA_TAG_SIZE) || (frag->uSeq >= frag->uTotal)) return 0;
+	if (frag->uTotal != (frag->uSize + frag->uFragSize - 1) / frag->uFragSize) return 0;
+	uLast = frag->uSize - (frag->uTotal - 1) * frag->uFragSize;
+	return frag->uLen == ((frag->uSeq + 1 < frag->uTotal) ? frag->uFragSize : uLast);
+}
+
+/**
+ *	\brief Set up a reassembly table
+ *	\param table	The table to initialize
+ *	\param jobs	Number of messages reassembled at the same time
+ *	\param maxsize	Largest message accepted in bytes
+ *	\param lifetime	Milliseconds a message waits for its next fragment
+ *	\return		Zero if successful, an error code otherwise
+ *
+ *	Message buffers are allocated as jobs get used.
+ */
+int ra_init(struct ra_table *table, unsigned int jobs, unsigned int maxsize, unsigned long lifetime)
+{
+	memset(table, 0x00, sizeof(struct ra_table));
+
+	table->jobs = calloc(jobs, sizeof(struct ra_job));
+	if (table->jobs == NULL) return -ERA_NOMEM;
+	table->uJobs = jobs;
+	table->uMaxSize = maxsize;
+	table->ulLifetime = lifetime;
+	return ERA_NOERROR;
+}
+
+/**
+ *	\brief Free a reassembly table
+ *	\param table	A table set up by ra_init()
+ */
+void ra_free(struct ra_table *table)
+{
+	unsigned int i;
+
+	if (table->jobs == NULL) return;
+	for (i = 0; i < table->uJobs; i++) free(table->jobs[i].data);
+	free(table->jobs);
+	table->jobs = NULL;
+}
+
+/**
+ *	\brief Add a received fragment
+ *	\param table	The table
+ *	\param remote	Sender of the fragment
+ *	\param frag	The fragment
+ *	\param now	Current time, see rc_now()
+ *	\param done	Receives the job holding the complete message, NULL while fragments
+ *			are missing
+ *	\return		Zero if the fragment was taken or is a duplicate, -ERA_INVALID if it
+ *			doesn't fit its message or the limits, -ERA_BUSY if all jobs are in
+ *			use, -ERA_NOMEM if there is no memory for the message
+ *
+ *	A complete message stays in its job until ra_release() or ra_drop(), it doesn't
+ *	expire meanwhile.
+ */
+int ra_add(struct ra_table *table, struct sockaddr *remote, const struct ra_fragment *frag, unsigned long now,
+	   struct ra_job **done)
+{
+	struct ra_job *job = NULL, *free_job = NULL, *done_job = NULL;
+	unsigned int i, uNeed;
+	unsigned char *map;
+	char *data;
+
+	*done = NULL;
+	if (!ra_valid(table, frag)) return -ERA_INVALID;
+
+	for (i = 0; i < table->uJobs; i++) {
+		if (table->jobs[i].remote.ss_family == AF_UNSPEC) {
+			if (free_job == NULL) free_job = &table->jobs[i];
+			continue;
+		}
+		if (((long)(now - table->jobs[i].ulExpiry) >= 0) &&
+		    (table->jobs[i].iDone || (table->jobs[i].uReceived < table->jobs[i].uTotal))) {
+			// a message that stopped arriving, its job can be reused
+			if (!table->jobs[i].iDone) table->ulExpired++;
+			table->jobs[i].remote.ss_family = AF_UNSPEC;
+			if (free_job == NULL) free_job = &table->jobs[i];
+			continue;
+		}
+		if ((table->jobs[i].uRequestId == frag->uRequestId) && ra_same(&table->jobs[i].remote, remote)) {
+			job = &table->jobs[i];
+			break;
+		}
+		if (table->jobs[i].iDone && (done_job == NULL)) done_job = &table->jobs[i];
+	}
+	// released jobs are taken only if there is no unused one
+	if (free_job == NULL) free_job = done_job;
+
+	// a late duplicate of a message already handed out
+	if ((job != NULL) && job->iDone) return ERA_NOERROR;
+
+	if (job == NULL) {
+		if (free_job == NULL) return -ERA_BUSY;
+		job = free_job;
+		uNeed = frag->uSize + (frag->uTotal + 7) / 8;
+		if (job->uCapacity < uNeed) {
+			data = realloc(job->data, uNeed);
+			if (data == NULL) return -ERA_NOMEM;
+			job->data = data;
+			job->uCapacity = uNeed;
+		}
+		memset(&job->data[frag->uSize], 0x00, (frag->uTotal + 7) / 8);
+		memset(&job->remote, 0x00, sizeof(job->remote));
+		memcpy(&job->remote, remote, (remote->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+		job->uRequestId = frag->uRequestId;
+		job->uTotal = frag->uTotal;
+		job->uReceived = 0;
+		job->iDone = 0;
+		job->uSize = frag->uSize;
+		job->uTagLen = frag->uTagLen;
+		memcpy(job->tag, frag->tag, frag->uTagLen);
+	}
+	else if ((job->uTotal != frag->uTotal) || (job->uSize != frag->uSize) || (job->uTagLen != frag->uTagLen) ||
+		 (memcmp(job->tag, frag->tag, frag->uTagLen) != 0)) return -ERA_INVALID;
+
+	job->ulExpiry = now + table->ulLifetime;
+	map = (unsigned char *)&job->data[job->uSize];
+	if (map[frag->uSeq / 8] & (1 << (frag->uSeq % 8))) return ERA_NOERROR;
+	map[frag->uSeq / 8] |= 1 << (frag->uSeq % 8);
+	memcpy(&job->data[frag->uSeq * frag->uFragSize], frag->data, frag->uLen);
+
+	if (++job->uReceived == job->uTotal) {
+		table->ulCompleted++;
+		*done = job;
+	}
+	return ERA_NOERROR;
+}
+
+/**
+ *	\brief Find a released message
+ *	\param table	The table
+ *	\param remote	Sender of the message
+ *	\param uRequestId	Request ID of the message
+ *	\param now	Current time, see rc_now()
+ *	\return		The job, NULL if the message isn't complete or was dropped
+ *
+ *	The message's lifetime starts again.
+ */
+struct ra_job *ra_find(struct ra_table *table, struct sockaddr *remote, unsigned int uRequestId, unsigned long now)
+{
+	struct ra_job *job;
+	unsigned int i;
+
+	for (i = 0; i < table->uJobs; i++) {
+		job = &table->jobs[i];
+		if ((job->remote.ss_family == AF_UNSPEC) || !job->iDone || (job->uRequestId != uRequestId)) continue;
+		if ((long)(now - job->ulExpiry) >= 0) continue;
+		if (!ra_same(&job->remote, remote)) continue;
+		job->ulExpiry = now + table->ulLifetime;
+		return job;
+	}
+	return NULL;
+}
+
+/**
+ *	\brief Release the job of a complete message
+ *	\param job	A job returned by ra_add()
+ *
+ *	The job can be reused at once, until then it swallows duplicates of the message.
+ */
+void ra_release(struct ra_job *job)
+{
+	job->iDone = 1;
+}
+
+/**
+ *	\brief Drop a message
+ *	\param job	A job returned by ra_add()
+ *
+ *	The job is free at once, fragments of the message start it again.
+ */
+void ra_drop(struct ra_job *job)
+{
+	job->remote.ss_family = AF_UNSPEC;
+}
+
+/**
+ *	\}
+ */
@@ -0,0 +1,83 @@
+/**
+ *	\file reasm.h
+ *	\brief Reassembly of requests sent in several datagrams (header)
+ *	\version 1.0
+ *
+ */
+#if !defined _reasm_h_
+#define _reasm_h_
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+//ERROR CODES for reassembly functions
+#define ERA_NOERROR		0
+#define ERA_NOMEM		1
+#define ERA_BUSY		2
+#define ERA_INVALID		3
+
+/** \brief Tag size.
+ *
+ * Maximum number of bytes all fragments of a message have to agree on.
+ */
+#define RA_TAG_SIZE		32
+
+/**
+ *	\brief A received fragment
+ */
+struct ra_fragment {
+	unsigned int uRequestId;	/**< \brief Request ID, the same for all fragments of a message. */
+	unsigned int uSeq;		/**< \brief Number of the fragment, from zero. */
+	unsigned int uTotal;		/**< \brief Number of fragments of the message. */
+	unsigned int uFragSize;		/**< \brief Size of every fragment but the last. */
+	unsigned int uSize;		/**< \brief Size of the whole message. */
+	const void *tag;		/**< \brief Bytes all fragments of the message agree on. */
+	unsigned int uTagLen;		/**< \brief Number of bytes at \a tag, at most RA_TAG_SIZE. */
+	const char *data;		/**< \brief The fragment's bytes. */
+	unsigned int uLen;		/**< \brief Number of bytes at \a data. */
+};
+
+/**
+ *	\brief A message being reassembled
+ */
+struct ra_job {
+	struct sockaddr_storage remote;	/**< \brief Sender, family AF_UNSPEC if the job is unused. */
+	unsigned int uRequestId;	/**< \brief Request ID. */
+	unsigned int uTotal;		/**< \brief Number of fragments. */
+	unsigned int uReceived;		/**< \brief Number of different fragments received. */
+	int iDone;			/**< \brief Set by ra_release(), the job only catches duplicates. */
+	unsigned int uSize;		/**< \brief Size of the message. */
+	unsigned char tag[RA_TAG_SIZE];	/**< \brief Tag of the first fragment. */
+	unsigned int uTagLen;		/**< \brief Bytes used in \a tag. */
+	unsigned long ulExpiry;		/**< \brief Milliseconds timestamp the job is dropped at. */
+	unsigned int uCapacity;		/**< \brief Size of the buffer at \a data. */
+	char *data;			/**< \brief The message, followed by one bit per received fragment. */
+};
+
+/**
+ *	\brief A reassembly table
+ *
+ *	A fixed number of jobs, so memory is bounded by jobs times maximum message size
+ *	whatever the number of senders.
+ */
+struct ra_table {
+	struct ra_job *jobs;		/**< \brief The jobs. */
+	unsigned int uJobs;		/**< \brief Number of jobs. */
+	unsigned int uMaxSize;		/**< \brief Largest message accepted. */
+	unsigned long ulLifetime;	/**< \brief Milliseconds a job waits for its next fragment. */
+	unsigned long ulCompleted;	/**< \brief Messages reassembled. */
+	unsigned long ulExpired;	/**< \brief Messages dropped incomplete. */
+};
+
+int ra_init(struct ra_table *table, unsigned int jobs, unsigned int maxsize, unsigned long lifetime);
+void ra_free(struct ra_table *table);
+int ra_add(struct ra_table *table, struct sockaddr *remote, const struct ra_fragment *frag, unsigned long now,
+	   struct ra_job **done);
+struct ra_job *ra_find(struct ra_table *table, struct sockaddr *remote, unsigned int uRequestId, unsigned long now);
+void ra_release(struct ra_job *job);
+void ra_drop(struct ra_job *job);
+
+#endif //#define _reasm_h_
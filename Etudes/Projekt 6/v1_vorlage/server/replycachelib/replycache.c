@@ -0,0 +1,190 @@
+/**
+ *	\file replycache.c
+ *	\brief Reply cache for retransmitted requests
+ *	\version 1.0
+ *
+ *	\par Overview
+ *	A client that lost a reply sends its request again with the same request ID. The
+ *	cache keeps recent replies by client address, port and request ID, so such a
+ *	retransmission is answered with the stored reply instead of executing the request a
+ *	second time. Replies expire after a fixed lifetime; requests with request ID zero
+ *	can't be told apart and are never cached.
+ *
+ *	\warning A cache must only be used by one thread.
+ */
+#include "replycache.h"
+
+/**
+ *	\ingroup vslabdaemon
+ *	\defgroup replycache Reply cache
+ *
+ * 	\{
+ */
+
+/**
+ *	\brief Check whether two socket addresses are the same client
+ *	\param a	Stored address
+ *	\param b	Address of a received datagram
+ *	\return		Nonzero if family, address and port are equal
+ */
+static int rc_same(struct sockaddr_storage *a, struct sockaddr *b)
+{
+	struct sockaddr_in *a4 = (struct sockaddr_in *)a, *b4 = (struct sockaddr_in *)b;
+	struct sockaddr_in6 *a6 = (struct sockaddr_in6 *)a, *b6 = (struct sockaddr_in6 *)b;
+
+	if (a->ss_family != b->sa_family) return 0;
+	if (b->sa_family == AF_INET)
+		return (a4->sin_port == b4->sin_port) && (a4->sin_addr.s_addr == b4->sin_addr.s_addr);
+	if (b->sa_family == AF_INET6)
+		return (a6->sin6_port == b6->sin6_port) &&
+		       (memcmp(&a6->sin6_addr, &b6->sin6_addr, sizeof(struct in6_addr)) == 0);
+	return 0;
+}
+
+/**
+ *	\brief Get the set a request belongs to
+ *	\param cache	The cache
+ *	\param remote	Client address
+ *	\param rid	Request ID
+ *	\return		Pointer to the first entry of the set
+ */
+static struct rc_entry *rc_set(struct rc_cache *cache, struct sockaddr *remote, unsigned int rid)
+{
+	unsigned int uHash = rid * 0x9e3779b1U, i;
+	unsigned char *key = NULL;
+	unsigned int uKeyLen = 0;
+
+	if (remote->sa_family == AF_INET) {
+		key = (unsigned char *)&((struct sockaddr_in *)remote)->sin_addr;
+		uKeyLen = sizeof(struct in_addr);
+		uHash ^= ((struct sockaddr_in *)remote)->sin_port;
+	}
+	else if (remote->sa_family == AF_INET6) {
+		key = (unsigned char *)&((struct sockaddr_in6 *)remote)->sin6_addr;
+		uKeyLen = sizeof(struct in6_addr);
+		uHash ^= ((struct sockaddr_in6 *)remote)->sin6_port;
+	}
+	// FNV-1a over the address
+	for (i = 0; i < uKeyLen; i++) uHash = (uHash ^ key[i]) * 16777619U;
+	uHash ^= uHash >> 16;
+
+	return &cache->entries[(uHash & cache->uSetMask) * RC_WAYS];
+}
+
+/**
+ *	\brief Set up a reply cache
+ *	\param cache	The cache to initialize
+ *	\param entries	Maximum number of stored replies, rounded up to RC_WAYS times a power of two
+ *	\param lifetime	Milliseconds a reply is kept
+ *	\return		Zero if successful, an error code otherwise
+ *
+ *	Reply buffers are allocated as entries get used.
+ */
+int rc_init(struct rc_cache *cache, unsigned int entries, unsigned long lifetime)
+{
+	unsigned int uSets = 1;
+
+	memset(cache, 0x00, sizeof(struct rc_cache));
+	while (uSets * RC_WAYS < entries) uSets <<= 1;
+
+	cache->entries = calloc(uSets * RC_WAYS, sizeof(struct rc_entry));
+	if (cache->entries == NULL) return -ERC_NOMEM;
+	cache->uSetMask = uSets - 1;
+	cache->ulLifetime = lifetime;
+	return ERC_NOERROR;
+}
+
+/**
+ *	\brief Free a reply cache
+ *	\param cache	A cache set up by rc_init()
+ */
+void rc_free(struct rc_cache *cache)
+{
+	unsigned int i;
+
+	if (cache->entries == NULL) return;
+	for (i = 0; i < (cache->uSetMask + 1) * RC_WAYS; i++) free(cache->entries[i].reply);
+	free(cache->entries);
+	cache->entries = NULL;
+}
+
+/**
+ *	\brief Get the current time for rc_lookup() and rc_store()
+ *	\return		Milliseconds of a monotonic clock
+ */
+unsigned long rc_now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long)now.tv_sec * 1000UL + now.tv_nsec / 1000000L;
+}
+
+/**
+ *	\brief Look up the reply to a request
+ *	\param cache	The cache
+ *	\param remote	Address the request came from
+ *	\param rid	Request ID, not zero
+ *	\param now	Current time, see rc_now()
+ *	\param reply	Receives the stored reply, PL_MAX_DATAGRAM bytes
+ *	\return		Length of the reply, zero if the request isn't known
+ */
+int rc_lookup(struct rc_cache *cache, struct sockaddr *remote, unsigned int rid, unsigned long now, char *reply)
+{
+	struct rc_entry *set = rc_set(cache, remote, rid);
+	int i;
+
+	for (i = 0; i < RC_WAYS; i++) {
+		if ((set[i].uRequestId == rid) && (set[i].ulExpiry > now) && rc_same(&set[i].remote, remote)) {
+			memcpy(reply, set[i].reply, set[i].uLen);
+			cache->ulHits++;
+			return set[i].uLen;
+		}
+	}
+	cache->ulMisses++;
+	return 0;
+}
+
+/**
+ *	\brief Store the reply to a request
+ *	\param cache	The cache
+ *	\param remote	Address the request came from
+ *	\param rid	Request ID, not zero
+ *	\param now	Current time, see rc_now()
+ *	\param reply	The reply
+ *	\param len	Length of the reply
+ *
+ *	The reply takes an expired entry of its set or replaces the one closest to expiry.
+ *	Out of memory the reply is just not stored.
+ */
+void rc_store(struct rc_cache *cache, struct sockaddr *remote, unsigned int rid, unsigned long now,
+	      char *reply, unsigned int len)
+{
+	struct rc_entry *set = rc_set(cache, remote, rid), *entry = &set[0];
+	char *buf;
+	int i;
+
+	for (i = 1; (i < RC_WAYS) && (entry->ulExpiry > now); i++) {
+		if (set[i].ulExpiry < entry->ulExpiry) entry = &set[i];
+	}
+
+	if (entry->uSize < len) {
+		buf = realloc(entry->reply, len);
+		if (buf == NULL) {
+			entry->ulExpiry = 0;
+			return;
+		}
+		entry->reply = buf;
+		entry->uSize = len;
+	}
+	memcpy(entry->reply, reply, len);
+	entry->uLen = len;
+	entry->uRequestId = rid;
+	entry->ulExpiry = now + cache->ulLifetime;
+	memset(&entry->remote, 0x00, sizeof(entry->remote));
+	memcpy(&entry->remote, remote, (remote->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+}
+
+/**
+ *	\}
+ */
@@ -0,0 +1,62 @@
+/**
+ *	\file replycache.h
+ *	\brief Reply cache for retransmitted requests (header)
+ *	\version 1.0
+ *
+ */
+#if !defined _replycache_h_
+#define _replycache_h_
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+//ERROR CODES for reply cache functions
+#define ERC_NOERROR		0
+#define ERC_NOMEM		1
+
+/** \brief Entries per set.
+ *
+ * A request may be stored in any of this many entries, the oldest one is replaced.
+ */
+#define RC_WAYS			4
+
+/**
+ *	\brief A stored reply
+ *
+ *	Identified by the client's address and port and the request ID it chose.
+ */
+struct rc_entry {
+	struct sockaddr_storage remote;	/**< \brief Client address, family AF_UNSPEC if unused. */
+	unsigned int uRequestId;	/**< \brief Request ID. */
+	unsigned int uLen;		/**< \brief Length of the reply. */
+	unsigned int uSize;		/**< \brief Size of the buffer at \a reply. */
+	unsigned long ulExpiry;		/**< \brief Milliseconds timestamp the entry expires at. */
+	char *reply;			/**< \brief The reply datagram. */
+};
+
+/**
+ *	\brief A reply cache
+ *
+ *	Set associative with RC_WAYS entries per set, so memory is bounded by the number of
+ *	entries whatever the number of clients.
+ */
+struct rc_cache {
+	struct rc_entry *entries;	/**< \brief The entries, set after set. */
+	unsigned int uSetMask;		/**< \brief Number of sets minus one, a power of two minus one. */
+	unsigned long ulLifetime;	/**< \brief Milliseconds a reply is kept. */
+	unsigned long ulHits;		/**< \brief Retransmissions answered from the cache. */
+	unsigned long ulMisses;		/**< \brief Requests not found in the cache. */
+};
+
+int rc_init(struct rc_cache *cache, unsigned int entries, unsigned long lifetime);
+void rc_free(struct rc_cache *cache);
+unsigned long rc_now(void);
+int rc_lookup(struct rc_cache *cache, struct sockaddr *remote, unsigned int rid, unsigned long now, char *reply);
+void rc_store(struct rc_cache *cache, struct sockaddr *remote, unsigned int rid, unsigned long now,
+	      char *reply, unsigned int len);
+
+#endif //#define _replycache_h_
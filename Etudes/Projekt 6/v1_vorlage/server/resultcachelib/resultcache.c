@@ -0,0 +1,140 @@
+/**
+ *	\file resultcache.c
+ *	\brief Result cache for pure functions
+ *	\version 1.0
+ *
+ *	\par Overview
+ *	Functions whose result only depends on function id and operands need not be
+ *	executed again for a request seen before. The cache maps (fid, op1, op2) to the
+ *	resulting packet type and operand in a table of fixed size allocated once, so a
+ *	lookup costs a hash and a few compares and no allocation ever happens on the packet
+ *	path.
+ *
+ *	\warning A cache must only be used by one thread.
+ */
+#include "resultcache.h"
+
+/**
+ *	\ingroup vslabdaemon
+ *	\defgroup resultcache Result cache
+ *
+ * 	\{
+ */
+
+/**
+ *	\brief Get the hash position of a key
+ *	\param cache	The cache
+ *	\param fid	Function id
+ *	\param op1	First operand
+ *	\param op2	Second operand
+ *	\return		Index of the first entry of the key's probe window
+ */
+static unsigned int res_hash(struct res_cache *cache, unsigned int fid, unsigned int op1, unsigned int op2)
+{
+	unsigned int uHash = fid * 0x9e3779b1U;
+
+	uHash = (uHash ^ op1) * 0x85ebca6bU;
+	uHash = (uHash ^ op2) * 0xc2b2ae35U;
+	uHash ^= uHash >> 16;
+	return uHash & cache->uMask;
+}
+
+/**
+ *	\brief Set up a result cache
+ *	\param cache	The cache to initialize
+ *	\param entries	Number of entries, rounded up to a power of two of at least RES_PROBE
+ *	\return		Zero if successful, an error code otherwise
+ */
+int res_init(struct res_cache *cache, unsigned int entries)
+{
+	unsigned int uSize = RES_PROBE;
+
+	memset(cache, 0x00, sizeof(struct res_cache));
+	while (uSize < entries) uSize <<= 1;
+
+	cache->entries = calloc(uSize, sizeof(struct res_entry));
+	if (cache->entries == NULL) return -ERES_NOMEM;
+	cache->uMask = uSize - 1;
+	return ERES_NOERROR;
+}
+
+/**
+ *	\brief Free a result cache
+ *	\param cache	A cache set up by res_init()
+ */
+void res_free(struct res_cache *cache)
+{
+	free(cache->entries);
+	cache->entries = NULL;
+}
+
+/**
+ *	\brief Look up a result
+ *	\param cache	The cache
+ *	\param fid	Function id, not zero
+ *	\param op1	First operand
+ *	\param op2	Second operand
+ *	\return		The entry holding the result, NULL if it isn't cached
+ *
+ *	Entries are never removed, only replaced, so the first unused entry ends the search.
+ */
+struct res_entry *res_lookup(struct res_cache *cache, unsigned int fid, unsigned int op1, unsigned int op2)
+{
+	unsigned int i, uPos = res_hash(cache, fid, op1, op2);
+	struct res_entry *entry;
+
+	cache->uClock++;
+	for (i = 0; i < RES_PROBE; i++) {
+		entry = &cache->entries[(uPos + i) & cache->uMask];
+		if (entry->uFid == 0) break;
+		if ((entry->uFid == fid) && (entry->uOp1 == op1) && (entry->uOp2 == op2)) {
+			entry->uStamp = cache->uClock;
+			cache->ulHits++;
+			return entry;
+		}
+	}
+	cache->ulMisses++;
+	return NULL;
+}
+
+/**
+ *	\brief Store a result
+ *	\param cache	The cache
+ *	\param fid	Function id, not zero
+ *	\param op1	First operand
+ *	\param op2	Second operand
+ *	\param type	Packet type of the result
+ *	\param result	Result or error code
+ *	\param status	Display status of the result
+ *
+ *	Takes the first unused entry of the probe window, or replaces the one used longest ago.
+ */
+void res_store(struct res_cache *cache, unsigned int fid, unsigned int op1, unsigned int op2,
+	       unsigned int type, unsigned int result, char status)
+{
+	unsigned int i, uPos = res_hash(cache, fid, op1, op2);
+	struct res_entry *entry, *victim = NULL;
+
+	for (i = 0; i < RES_PROBE; i++) {
+		entry = &cache->entries[(uPos + i) & cache->uMask];
+		if (entry->uFid == 0) {
+			victim = entry;
+			break;
+		}
+		// the clock wraps, so compare ages rather than stamps
+		if ((victim == NULL) || (cache->uClock - entry->uStamp > cache->uClock - victim->uStamp)) victim = entry;
+	}
+	if (victim->uFid != 0) cache->ulEvictions++;
+
+	victim->uFid = fid;
+	victim->uOp1 = op1;
+	victim->uOp2 = op2;
+	victim->uType = type;
+	victim->uResult = result;
+	victim->uStamp = cache->uClock;
+	victim->cStatus = status;
+}
+
+/**
+ *	\}
+ */
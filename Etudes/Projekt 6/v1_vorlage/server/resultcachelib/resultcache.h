@@ -0,0 +1,59 @@
+/**
+ *	\file resultcache.h
+ *	\brief Result cache for pure functions (header)
+ *	\version 1.0
+ *
+ */
+#if !defined _resultcache_h_
+#define _resultcache_h_
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+//ERROR CODES for result cache functions
+#define ERES_NOERROR		0
+#define ERES_NOMEM		1
+
+/** \brief Probe window.
+ *
+ * A key is stored in one of this many consecutive entries from its hash position.
+ */
+#define RES_PROBE		8
+
+/**
+ *	\brief A cached result
+ */
+struct res_entry {
+	unsigned int uFid;		/**< \brief Function id, zero if the entry is unused. */
+	unsigned int uOp1;		/**< \brief First operand. */
+	unsigned int uOp2;		/**< \brief Second operand. */
+	unsigned int uType;		/**< \brief Packet type of the result, response or error. */
+	unsigned int uResult;		/**< \brief Result or error code. */
+	unsigned int uStamp;		/**< \brief Clock of the last use. */
+	char cStatus;			/**< \brief Display status of the result. */
+};
+
+/**
+ *	\brief A result cache
+ *
+ *	Open addressing in a fixed table; when the probe window of a key is full, the least
+ *	recently used entry of the window is replaced, which approximates LRU over the whole
+ *	table without any lists.
+ */
+struct res_cache {
+	struct res_entry *entries;	/**< \brief The table. */
+	unsigned int uMask;		/**< \brief Table size minus one, a power of two minus one. */
+	unsigned int uClock;		/**< \brief Advanced by every lookup. */
+	unsigned long ulHits;		/**< \brief Lookups that found the result. */
+	unsigned long ulMisses;		/**< \brief Lookups that didn't. */
+	unsigned long ulEvictions;	/**< \brief Results replaced by others. */
+};
+
+int res_init(struct res_cache *cache, unsigned int entries);
+void res_free(struct res_cache *cache);
+struct res_entry *res_lookup(struct res_cache *cache, unsigned int fid, unsigned int op1, unsigned int op2);
+void res_store(struct res_cache *cache, unsigned int fid, unsigned int op1, unsigned int op2,
+	       unsigned int type, unsigned int result, char status);
+
+#endif //#define _resultcache_h_
@@ -0,0 +1,302 @@
+/**
+ *	\file uring.c
+ *	\brief Minimal io_uring access
+ *	\version 1.0
+ *
+ *	\par Overview
+ *	Just the parts of io_uring vslabd needs, talking to the kernel by system calls and
+ *	shared memory directly so no liburing is required: ring setup, submission and
+ *	completion handling and provided buffer rings. Preparing submission entries is left
+ *	to the caller.
+ *
+ *	\warning An instance must only be used by one thread.
+ */
+#include "uring.h"
+
+#if defined URING_AVAILABLE
+
+/**
+ *	\ingroup vslabdaemon
+ *	\defgroup uring io_uring access
+ *
+ * 	\{
+ */
+
+/**
+ *	\brief Check for multishot recvmsg with provided buffers
+ *	\param ring	A fresh instance, nothing queued
+ *	\return		Zero if the kernel supports it, an error code otherwise
+ *
+ *	The headers may know more than the running kernel: provided buffer rings came
+ *	with Linux 5.19, multishot recvmsg only with 6.0. A kernel without it rejects the
+ *	request while preparing it (-EINVAL), one with it only fails to look up the
+ *	invalid descriptor the probe uses, so no socket is needed.
+ */
+static int uring_probe_recv(struct uring *ring)
+{
+	struct io_uring_sqe *sqe = uring_get_sqe(ring);
+	struct io_uring_cqe *cqe;
+	struct msghdr hdr;
+	int iRes;
+
+	memset(&hdr, 0x00, sizeof(hdr));
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = -1;
+	sqe->addr = (unsigned long)&hdr;
+	sqe->len = 1;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+
+	iRes = uring_submit_and_wait(ring, 1);
+	while ((cqe = uring_peek_cqe(ring)) == NULL) {
+		if ((iRes < 0) && (iRes != -EINTR)) return -EURING_NOSUPPORT;
+		iRes = uring_submit_and_wait(ring, 1);
+	}
+	iRes = cqe->res;
+	uring_cqe_seen(ring);
+	return (iRes == -EINVAL) ? -EURING_NOSUPPORT : EURING_NOERROR;
+}
+
+/**
+ *	\brief Set up an io_uring instance
+ *	\param ring	The instance to initialize
+ *	\param entries	Number of submission entries, rounded up to a power of two by the kernel
+ *	\return		Zero if successful, an error code otherwise, -EURING_NOSUPPORT if the
+ *			kernel lacks multishot recvmsg
+ */
+int uring_init(struct uring *ring, unsigned entries)
+{
+	struct io_uring_params p;
+	unsigned i;
+	char *sq, *cq;
+
+	memset(ring, 0x00, sizeof(struct uring));
+	memset(&p, 0x00, sizeof(p));
+
+	ring->fd = syscall(__NR_io_uring_setup, entries, &p);
+	if (ring->fd < 0) return -EURING_SETUP;
+
+	ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	ring->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+		ring->cq_ring_size = ring->sq_ring_size;
+	}
+
+	ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			     ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ring == MAP_FAILED) {
+		close(ring->fd);
+		return -EURING_MMAP;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP) ring->cq_ring = ring->sq_ring;
+	else {
+		ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+				     ring->fd, IORING_OFF_CQ_RING);
+		if (ring->cq_ring == MAP_FAILED) {
+			munmap(ring->sq_ring, ring->sq_ring_size);
+			close(ring->fd);
+			return -EURING_MMAP;
+		}
+	}
+	ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			  ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED) {
+		if (ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+		munmap(ring->sq_ring, ring->sq_ring_size);
+		close(ring->fd);
+		return -EURING_MMAP;
+	}
+
+	sq = (char *)ring->sq_ring;
+	cq = (char *)ring->cq_ring;
+	ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+	ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+	ring->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+	ring->sq_entries = p.sq_entries;
+	ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+	ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+	ring->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+	// submission entries are used in ring order, so the index array is the identity
+	for (i = 0; i < p.sq_entries; i++) ((unsigned *)(sq + p.sq_off.array))[i] = i;
+	ring->sqe_head = ring->sqe_tail = *ring->sq_tail;
+
+	if (uring_probe_recv(ring) < 0) {
+		uring_exit(ring);
+		return -EURING_NOSUPPORT;
+	}
+	return EURING_NOERROR;
+}
+
+/**
+ *	\brief Tear down an io_uring instance
+ *	\param ring	An instance set up by uring_init()
+ */
+void uring_exit(struct uring *ring)
+{
+	munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+	munmap(ring->sq_ring, ring->sq_ring_size);
+	close(ring->fd);
+}
+
+/**
+ *	\brief Get a free submission entry
+ *	\param ring	The instance
+ *	\return		A cleared submission entry, NULL if the submission ring is full
+ *
+ *	The entry is handed to the kernel by the next uring_submit_and_wait().
+ */
+struct io_uring_sqe *uring_get_sqe(struct uring *ring)
+{
+	struct io_uring_sqe *sqe;
+	unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+	if (ring->sqe_tail - head >= ring->sq_entries) return NULL;
+	sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+	ring->sqe_tail++;
+	memset(sqe, 0x00, sizeof(struct io_uring_sqe));
+	return sqe;
+}
+
+/**
+ *	\brief Submit queued entries and wait for completions
+ *	\param ring	The instance
+ *	\param wait_nr	Number of completions to wait for, zero to only submit
+ *	\return		Number of entries submitted, an error code (-errno) otherwise
+ *
+ *	Both happen in a single io_uring_enter() system call.
+ */
+int uring_submit_and_wait(struct uring *ring, unsigned wait_nr)
+{
+	unsigned submit = ring->sqe_tail - ring->sqe_head;
+	int iReturn;
+
+	__atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+	ring->sqe_head = ring->sqe_tail;
+
+	iReturn = syscall(__NR_io_uring_enter, ring->fd, submit, wait_nr,
+			  wait_nr ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	return (iReturn < 0) ? -errno : iReturn;
+}
+
+/**
+ *	\brief Get the next completion
+ *	\param ring	The instance
+ *	\return		The oldest unseen completion, NULL if there is none
+ */
+struct io_uring_cqe *uring_peek_cqe(struct uring *ring)
+{
+	unsigned head = *ring->cq_head;
+
+	if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) return NULL;
+	return &ring->cqes[head & ring->cq_mask];
+}
+
+/**
+ *	\brief Release the completion returned by uring_peek_cqe()
+ *	\param ring	The instance
+ */
+void uring_cqe_seen(struct uring *ring)
+{
+	__atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ *	\brief Set up and register a provided buffer ring
+ *	\param ring	The instance to register with
+ *	\param br	The buffer ring to initialize
+ *	\param bgid	Buffer group id used in submission entries
+ *	\param entries	Number of buffers, a power of two
+ *	\param bufsize	Size of each buffer
+ *	\return		Zero if successful, an error code otherwise
+ *
+ *	All buffers are handed to the kernel right away.
+ */
+int uring_bufring_init(struct uring *ring, struct uring_bufring *br, unsigned short bgid,
+		       unsigned entries, unsigned bufsize)
+{
+	struct io_uring_buf_reg reg;
+	unsigned i;
+
+	memset(br, 0x00, sizeof(struct uring_bufring));
+	br->entries = entries;
+	br->bufsize = bufsize;
+	br->bgid = bgid;
+
+	// the ring has to be page aligned
+	br->ring = mmap(NULL, entries * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+			MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (br->ring == MAP_FAILED) return -EURING_MMAP;
+	br->mem = malloc((size_t)entries * bufsize);
+	if (br->mem == NULL) {
+		munmap(br->ring, entries * sizeof(struct io_uring_buf));
+		return -EURING_NOMEM;
+	}
+
+	memset(&reg, 0x00, sizeof(reg));
+	reg.ring_addr = (unsigned long)br->ring;
+	reg.ring_entries = entries;
+	reg.bgid = bgid;
+	if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+		free(br->mem);
+		munmap(br->ring, entries * sizeof(struct io_uring_buf));
+		return -EURING_REGISTER;
+	}
+
+	for (i = 0; i < entries; i++) uring_bufring_add(br, i);
+	uring_bufring_publish(br);
+	return EURING_NOERROR;
+}
+
+/**
+ *	\brief Unregister and free a provided buffer ring
+ *	\param ring	The instance the buffer ring is registered with
+ *	\param br	The buffer ring
+ */
+void uring_bufring_free(struct uring *ring, struct uring_bufring *br)
+{
+	struct io_uring_buf_reg reg;
+
+	memset(&reg, 0x00, sizeof(reg));
+	reg.bgid = br->bgid;
+	syscall(__NR_io_uring_register, ring->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+	free(br->mem);
+	munmap(br->ring, br->entries * sizeof(struct io_uring_buf));
+}
+
+/**
+ *	\brief Give a buffer back to the kernel
+ *	\param br	The buffer ring
+ *	\param bid	Buffer id as reported by a completion
+ *
+ *	The buffer becomes visible to the kernel with the next uring_bufring_publish(), so a
+ *	whole batch of buffers costs a single memory barrier.
+ */
+void uring_bufring_add(struct uring_bufring *br, unsigned short bid)
+{
+	struct io_uring_buf *buf = &br->ring->bufs[br->tail & (br->entries - 1)];
+
+	buf->addr = (unsigned long)URING_BUFFER(br, bid);
+	buf->len = br->bufsize;
+	buf->bid = bid;
+	br->tail++;
+}
+
+/**
+ *	\brief Publish buffers added by uring_bufring_add()
+ *	\param br	The buffer ring
+ */
+void uring_bufring_publish(struct uring_bufring *br)
+{
+	__atomic_store_n(&br->ring->tail, br->tail, __ATOMIC_RELEASE);
+}
+
+/**
+ *	\}
+ */
+
+#endif //#if defined URING_AVAILABLE
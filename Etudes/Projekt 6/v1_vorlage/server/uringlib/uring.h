@@ -0,0 +1,104 @@
+/**
+ *	\file uring.h
+ *	\brief Minimal io_uring access (header)
+ *	\version 1.0
+ *
+ */
+#if !defined _uring_h_
+#define _uring_h_
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+// io_uring needs Linux 6.0 headers (multishot receive) and a C library that exposes
+// the system call numbers, the uClinux toolchain has neither
+#if defined(__linux__) && !defined(__UCLIBC__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#if defined(IORING_RECV_MULTISHOT) && defined(__NR_io_uring_setup)
+#define URING_AVAILABLE
+#endif
+#endif
+#endif
+
+//ERROR CODES for uring library functions
+#define EURING_NOERROR		0
+#define EURING_SETUP		1
+#define EURING_MMAP		2
+#define EURING_REGISTER		3
+#define EURING_NOMEM		4
+#define EURING_NOSUPPORT	5
+
+#if defined URING_AVAILABLE
+
+/**
+ *	\brief An io_uring instance
+ *
+ *	Pointers into the rings shared with the kernel plus the submission entries queued
+ *	by uring_get_sqe() but not yet handed to the kernel.
+ */
+struct uring {
+	int fd;				/**< \brief The ring file descriptor. */
+	unsigned *sq_head;		/**< \brief Submission ring head, advanced by the kernel. */
+	unsigned *sq_tail;		/**< \brief Submission ring tail, advanced by us. */
+	unsigned sq_mask;		/**< \brief Submission ring index mask. */
+	unsigned sq_entries;		/**< \brief Submission ring size. */
+	unsigned sqe_tail;		/**< \brief Tail including entries not yet submitted. */
+	unsigned sqe_head;		/**< \brief Tail as last published to the kernel. */
+	struct io_uring_sqe *sqes;	/**< \brief Submission entries. */
+	unsigned *cq_head;		/**< \brief Completion ring head, advanced by us. */
+	unsigned *cq_tail;		/**< \brief Completion ring tail, advanced by the kernel. */
+	unsigned cq_mask;		/**< \brief Completion ring index mask. */
+	struct io_uring_cqe *cqes;	/**< \brief Completion entries. */
+	void *sq_ring;			/**< \brief Mapped submission ring. */
+	void *cq_ring;			/**< \brief Mapped completion ring, may equal sq_ring. */
+	size_t sq_ring_size;		/**< \brief Size of the submission ring mapping. */
+	size_t cq_ring_size;		/**< \brief Size of the completion ring mapping. */
+	size_t sqes_size;		/**< \brief Size of the submission entry mapping. */
+};
+
+/**
+ *	\brief A provided buffer ring
+ *
+ *	The kernel picks a buffer from the ring for every received datagram and reports its
+ *	id in the completion, so receive data lands directly in application memory.
+ */
+struct uring_bufring {
+	struct io_uring_buf_ring *ring;	/**< \brief The buffer ring shared with the kernel. */
+	char *mem;			/**< \brief entries * bufsize bytes of buffer memory. */
+	unsigned entries;		/**< \brief Number of buffers, a power of two. */
+	unsigned bufsize;		/**< \brief Size of each buffer. */
+	unsigned short bgid;		/**< \brief Buffer group id. */
+	unsigned short tail;		/**< \brief Tail including buffers not yet published. */
+};
+
+int uring_init(struct uring *ring, unsigned entries);
+void uring_exit(struct uring *ring);
+struct io_uring_sqe *uring_get_sqe(struct uring *ring);
+int uring_submit_and_wait(struct uring *ring, unsigned wait_nr);
+struct io_uring_cqe *uring_peek_cqe(struct uring *ring);
+void uring_cqe_seen(struct uring *ring);
+
+int uring_bufring_init(struct uring *ring, struct uring_bufring *br, unsigned short bgid,
+		       unsigned entries, unsigned bufsize);
+void uring_bufring_free(struct uring *ring, struct uring_bufring *br);
+void uring_bufring_add(struct uring_bufring *br, unsigned short bid);
+void uring_bufring_publish(struct uring_bufring *br);
+
+/**
+ *	\brief Get the address of a provided buffer
+ *	\param br	The buffer ring
+ *	\param bid	Buffer id as reported by a completion
+ *	\return		The buffer's address
+ */
+#define URING_BUFFER(br, bid)	(&(br)->mem[(size_t)(bid) * (br)->bufsize])
+
+#endif //#if defined URING_AVAILABLE
+
+#endif //#define _uring_h_
@@ -10,27 +10,1617 @@
  */
 #include "includes.h"
 
-int main(void)
+/**
+ *	\brief The function registry
+ *
+ *	Indexed by function id. Filled by the modules at startup, before any worker runs, so
+ *	workers only read it and need no lock.
+ */
+static struct vsld_function vsld_functions[VSLD_MAX_FID];
+
+/**
+ *	\brief Register a function
+ *	\param fid	Function id
+ *	\param func	Description of the function, copied into the registry
+ *	\return		Zero if successful, an error code otherwise
+ *
+ *	Called by the modules' registration functions (vsld_arith_register() etc.) at startup.
+ */
+int vsld_register(unsigned int fid, const struct vsld_function *func)
+{
+	if ((fid == 0) || (fid >= VSLD_MAX_FID) || (func->handler == NULL) || (func->uArity > PL_OPERAND_COUNT)) return -EREGISTER;
+	if (vsld_functions[fid].handler != NULL) {
+		printf("vslabd: Function id %u registered twice (%s, %s).\n", fid, vsld_functions[fid].name, func->name);
+		return -EREGISTER;
+	}
+	vsld_functions[fid] = *func;
+	return 0;
+}
+
+/**
+ *	\brief Look up a function
+ *	\param fid	Function id
+ *	\return		The registered function, NULL if there is none
+ */
+static struct vsld_function *vsld_function(unsigned int fid)
+{
+	if ((fid >= VSLD_MAX_FID) || (vsld_functions[fid].handler == NULL)) return NULL;
+	return &vsld_functions[fid];
+}
+
+/**
+ *	\brief Turn a request into its response or error packet
+ *	\param worker	The worker executing the request
+ *	\param func	The function requested
+ *	\param data	The request
+ *	\param op	Its operands, zero beyond the arity
+ *	\param uError	Zero or the PL_ERR_XXX code returned by the handler
+ *	\param uResult	The handler's result
+ *
+ *	Shows the status and keeps the result of a pure function in the result cache.
+ */
+static void vsld_conclude(struct vsld_worker *worker, struct vsld_function *func, struct pl_data *data, const unsigned int *op,
+			  unsigned int uError, unsigned int uResult)
+{
+	char cStatus = 0;
+
+	if (uError != 0) {
+		pl_create_error(data, uError);
+		cStatus = 'E';
+	}
+	else {
+		pl_create_response(data);
+		data->data[0] = uResult;
+		cStatus = func->cStatus;
+	}
+	// report status to 7seg display	
+	sevenseg_setch(cStatus);
+
+	if (func->iPure && (worker->results.entries != NULL))
+		res_store(&worker->results, data->function_id, op[0], op[1], data->type, data->data[0], cStatus);
+}
+
+/**
+ *	\brief Execute one requested operation
+ *	\param worker	The worker executing the request
+ *	\param data	A pointer to a struct pl_data holding a checked request. The 
+ *			structure is turned into the corresponding response or error packet.
+ *
+ *	This is our core job - look up the requested function id and call its handler.
+ *	Results of pure functions are looked up in the worker's result cache first. With a
+ *	deferred request offered, the handler works on the operands and result kept there
+ *	and may defer the result; \a data is left as it is then, see vsld_resume().
+ */
+static void vsld_execute(struct vsld_worker *worker, struct pl_data *data)
+{
+	struct vsld_function *func = vsld_function(data->function_id);
+	struct vsld_deferred *d = worker->defer;
+	unsigned int op[PL_OPERAND_COUNT], uResult = 0, uError = 0, i;
+	unsigned int *in = op, *out = &uResult;
+	struct res_entry *hit;
+
+	if (func == NULL) {
+		// function is not implemented - create an error packet
+		pl_create_error(data, PL_ERR_NOSUCHFUNCTION);
+		// report status to 7seg display	
+		sevenseg_setch('F');
+		return;
+	}
+	// operands beyond the function's arity don't matter, not even for the cache
+	for (i = 0; i < PL_OPERAND_COUNT; i++) op[i] = (i < func->uArity) ? data->data[i] : 0;
+
+	if (func->iPure && (worker->results.entries != NULL)) {
+		hit = res_lookup(&worker->results, data->function_id, op[0], op[1]);
+		if (hit != NULL) {
+			if (hit->uType == PL_PTYPE_RSP) pl_create_response(data);
+			else pl_create_error(data, hit->uResult);
+			data->data[0] = hit->uResult;
+			sevenseg_setch(hit->cStatus);
+			return;
+		}
+	}
+
+	if (d != NULL) {
+		memcpy(d->op1, op, sizeof(op));
+		in = d->op1;
+		out = d->result;
+	}
+	BL_LOG(BL_TRACE, "vslabd: Calculating %s(%d, %d)...\n", func->name, op[0], op[1]);
+	uError = func->handler(worker, in, out);
+	if ((d != NULL) && (d->uJobs > 0)) {
+		d->error[0] = uError;
+		return;
+	}
+	vsld_conclude(worker, func, data, op, uError, *out);
+}
+
+/**
+ *	\brief Execute one request with payload
+ *	\param worker	The worker executing the request
+ *	\param data	A pointer to a struct pl_data holding a checked request, turned into
+ *			the response or error packet like by vsld_execute()
+ *	\param payload	The bytes following the request ID
+ *	\param len	Number of bytes in \a payload, not zero
+ *
+ *	Functions without payload handler ignore the payload. Results aren't cached, the
+ *	payload is part of the request.
+ */
+static void vsld_execute_payload(struct vsld_worker *worker, struct pl_data *data, const unsigned char *payload, unsigned int len)
+{
+	struct vsld_function *func = vsld_function(data->function_id);
+	unsigned int op[PL_OPERAND_COUNT], uResult = 0, uDetail = 0, uError = 0, i;
+
+	if ((func == NULL) || (func->payload == NULL)) {
+		vsld_execute(worker, data);
+		return;
+	}
+	for (i = 0; i < PL_OPERAND_COUNT; i++) op[i] = (i < func->uArity) ? data->data[i] : 0;
+
+	BL_LOG(BL_TRACE, "vslabd: Calculating %s(%d, %d) with %u bytes...\n", func->name, op[0], op[1], len);
+	uError = func->payload(worker, op, payload, len, &uResult, &uDetail);
+	if (uError != 0) {
+		pl_create_error(data, uError);
+		sevenseg_setch('E');
+	}
+	else {
+		pl_create_response(data);
+		data->data[0] = uResult;
+		sevenseg_setch(func->cStatus);
+	}
+	data->data[1] = uDetail;
+}
+
+/**
+ *	\brief Scatter the results of a run of batch entries
+ *	\param func	The function of all entries of the run
+ *	\param entry	First entry of the run, turned into response or error entries
+ *	\param result	The results
+ *	\param error	Zero or the PL_ERR_XXX code of each entry
+ *	\param iCount	Number of entries in the run
+ *
+ *	Entries end up exactly as vsld_execute() would leave them; the display shows the
+ *	status of the run's last entry.
+ */
+static void vsld_conclude_run(struct vsld_function *func, struct pl_batch_entry *entry, const unsigned int *result,
+			      const unsigned int *error, int iCount)
+{
+	int i;
+
+	// failed entries become error entries without a branch
+	for (i = 0; i < iCount; i++) {
+		entry[i].type = PL_PTYPE_RSP ^ ((PL_PTYPE_RSP ^ PL_PTYPE_ERR) & -(error[i] != 0));
+		entry[i].data[0] = result[i] | error[i];
+	}
+	sevenseg_setch(error[iCount - 1] ? 'E' : func->cStatus);
+}
+
+/**
+ *	\brief Execute a run of batch entries with the function's batch kernel
+ *	\param worker	The worker executing the request
+ *	\param func	The function of all entries of the run
+ *	\param batch	A pointer to the struct pl_batch holding the run
+ *	\param iFirst	Index of the run's first entry
+ *	\param iCount	Number of entries in the run, all requests with the same function id
+ *
+ *	Operands are gathered into arrays for the kernel and the results scattered back.
+ *	With a deferred request offered, the arrays are those kept there at the run's
+ *	entries, and a run whose kernel deferred its results is marked there instead.
+ */
+static void vsld_execute_run(struct vsld_worker *worker, struct vsld_function *func, struct pl_batch *batch, int iFirst, int iCount)
+{
+	unsigned int op1[PL_BATCH_MAX_ENTRIES], op2[PL_BATCH_MAX_ENTRIES];
+	unsigned int result[PL_BATCH_MAX_ENTRIES], error[PL_BATCH_MAX_ENTRIES];
+	unsigned int *in1 = op1, *in2 = op2, *out = result, *err = error, uJobs = 0;
+	struct pl_batch_entry *entry = &batch->entry[iFirst];
+	struct vsld_deferred *d = worker->defer;
+	int i;
+
+	if (d != NULL) {
+		in1 = &d->op1[iFirst];
+		in2 = &d->op2[iFirst];
+		out = &d->result[iFirst];
+		err = &d->error[iFirst];
+		uJobs = d->uJobs;
+	}
+	for (i = 0; i < iCount; i++) {
+		in1[i] = entry[i].data[0];
+		in2[i] = (func->uArity > 1) ? entry[i].data[1] : 0;
+	}
+
+	BL_LOG(BL_TRACE, "vslabd: Calculating %d x %s...\n", iCount, func->name);
+	func->batch(worker, in1, in2, out, err, iCount);
+
+	if ((d != NULL) && (d->uJobs > uJobs)) d->run[iFirst] = iCount;
+	else vsld_conclude_run(func, entry, out, err, iCount);
+}
+
+/**
+ *	\brief Process a batch request
+ *	\param worker	The worker executing the request
+ *	\param batch	A pointer to a struct pl_batch holding an extracted batch request. 
+ *			Every entry is executed in place and the structure is turned into 
+ *			the batch response.
+ *
+ *	Each entry is checked and executed like a single request packet, so one failing 
+ *	entry only sets that entry's type to PL_PTYPE_ERR. Runs of at least VSLD_KERNEL_MIN
+ *	requests for a function with a batch kernel go through the kernel instead. Only
+ *	those may defer their results, entries executed one by one are answered at once.
+ */
+static void vsld_execute_batch(struct vsld_worker *worker, struct pl_batch *batch)
+{
+	unsigned int i = 0, j = 0, k = 0;
+	struct pl_data entry_data;
+	struct vsld_function *func;
+	struct vsld_deferred *d = worker->defer;
+
+	if (d != NULL) memset(d->run, 0x00, batch->count * sizeof(unsigned int));
+	for (i = 0; i < batch->count; i = k) {
+		// find the run of requests with the function id of entry i
+		for (k = i; k < batch->count; k++) {
+			if ((batch->entry[k].type != PL_PTYPE_REQ) || (batch->entry[k].function_id != batch->entry[i].function_id)) break;
+		}
+		func = vsld_function(batch->entry[i].function_id);
+		if ((k - i >= VSLD_KERNEL_MIN) && (func != NULL) && (func->batch != NULL)) {
+			vsld_execute_run(worker, func, batch, i, k - i);
+			continue;
+		}
+		if (k == i) k = i + 1;
+
+		worker->defer = NULL;
+		for (; i < k; i++) {
+			entry_data.type = batch->entry[i].type;
+			entry_data.mode = batch->mode;
+			entry_data.function_id = batch->entry[i].function_id;
+			for (j = 0; j < PL_OPERAND_COUNT; j++) PLM_OPERAND(entry_data, j) = batch->entry[i].data[j];
+
+			if (PLM_PACKET_TYPE(entry_data) != PL_PTYPE_REQ) pl_create_error(&entry_data, PL_ERR_INVALIDTYPE);
+			else vsld_execute(worker, &entry_data);
+
+			batch->entry[i].type = PLM_PACKET_TYPE(entry_data);
+			for (j = 0; j < PL_OPERAND_COUNT; j++) batch->entry[i].data[j] = PLM_OPERAND(entry_data, j);
+		}
+		worker->defer = d;
+	}
+	pl_create_batch_response(batch);
+}
+
+/**
+ *	\brief Operands or results of a run of typed entries, one array per operand type
+ */
+union vsld_lanes {
+	int i32[PL_TYPED_MAX_ENTRIES];		/**< \brief PL_OTYPE_INT32 */
+	long long i64[PL_TYPED_MAX_ENTRIES];	/**< \brief PL_OTYPE_INT64 */
+	float f32[PL_TYPED_MAX_ENTRIES];	/**< \brief PL_OTYPE_FLOAT32 */
+	double f64[PL_TYPED_MAX_ENTRIES];	/**< \brief PL_OTYPE_FLOAT64 */
+};
+
+/** \brief Names of the operand types for the trace output. */
+static const char *vsld_otypes[PL_OTYPE_COUNT] = { "", "int32", "int64", "float32", "float64" };
+
+/**
+ *	\brief Gather one operand of a run of typed entries
+ *	\param otype	Operand type, PL_OTYPE_XXX
+ *	\param entry	First entry of the run
+ *	\param n	Number of entries
+ *	\param j	Index of the operand
+ *	\param lanes	Receives the operands
+ */
+static void vsld_typed_gather(unsigned int otype, const struct pl_typed_entry *entry, unsigned int n, unsigned int j,
+			      union vsld_lanes *lanes)
+{
+	unsigned int i;
+
+	switch (otype) {
+		case PL_OTYPE_INT32:	for (i = 0; i < n; i++) lanes->i32[i] = entry[i].data[j].i32; break;
+		case PL_OTYPE_INT64:	for (i = 0; i < n; i++) lanes->i64[i] = entry[i].data[j].i64; break;
+		case PL_OTYPE_FLOAT32:	for (i = 0; i < n; i++) lanes->f32[i] = entry[i].data[j].f32; break;
+		default:		for (i = 0; i < n; i++) lanes->f64[i] = entry[i].data[j].f64; break;
+	}
+}
+
+/**
+ *	\brief Scatter the results of a run of typed entries
+ *	\param otype	Operand type, PL_OTYPE_XXX
+ *	\param entry	First entry of the run, turned into response or error entries
+ *	\param n	Number of entries
+ *	\param lanes	The results
+ *	\param error	Zero or the PL_ERR_XXX code of each entry
+ */
+static void vsld_typed_scatter(unsigned int otype, struct pl_typed_entry *entry, unsigned int n,
+			       const union vsld_lanes *lanes, const unsigned int *error)
 {
-	int iReturn = 0, iResult = 0;
-	int iVSLSocket = 0;
-	int iRcvLen = 0, iSndLen = 0;
 	unsigned int i;
-	
+
+	for (i = 0; i < n; i++) {
+		memset(entry[i].data, 0x00, sizeof(entry[i].data));
+		entry[i].type = PL_PTYPE_RSP ^ ((PL_PTYPE_RSP ^ PL_PTYPE_ERR) & -(error[i] != 0));
+	}
+	switch (otype) {
+		case PL_OTYPE_INT32:	for (i = 0; i < n; i++) entry[i].data[0].i32 = lanes->i32[i]; break;
+		case PL_OTYPE_INT64:	for (i = 0; i < n; i++) entry[i].data[0].i64 = lanes->i64[i]; break;
+		case PL_OTYPE_FLOAT32:	for (i = 0; i < n; i++) entry[i].data[0].f32 = lanes->f32[i]; break;
+		default:		for (i = 0; i < n; i++) entry[i].data[0].f64 = lanes->f64[i]; break;
+	}
+	// error entries carry the error code as int32, like single error packets
+	for (i = 0; i < n; i++) {
+		if (error[i] == 0) continue;
+		memset(entry[i].data, 0x00, sizeof(entry[i].data));
+		entry[i].data[0].i32 = (int)error[i];
+	}
+}
+
+/**
+ *	\brief Process a typed request
+ *	\param worker	The worker executing the request
+ *	\param typed	A pointer to a struct pl_typed holding an extracted typed request with
+ *			a valid operand type. Every entry is executed in place and the
+ *			structure is turned into the typed response.
+ *
+ *	Runs of requests with the same function id are gathered into arrays of the operand
+ *	type and handed to the function's kernel for that type, whatever their length. An
+ *	entry that isn't a request, or whose function has no kernel for the type, becomes
+ *	an error entry on its own. Results aren't cached, the result cache only knows
+ *	32 bit operands.
+ */
+static void vsld_execute_typed(struct vsld_worker *worker, struct pl_typed *typed)
+{
+	union vsld_lanes op1, op2, result;
+	unsigned int error[PL_TYPED_MAX_ENTRIES];
+	unsigned int i = 0, k = 0, uError = 0;
+	struct vsld_function *func;
+	vsld_typed kernel;
+
+	for (i = 0; i < typed->count; i = k) {
+		// find the run of requests with the function id of entry i
+		for (k = i; k < typed->count; k++) {
+			if ((typed->entry[k].type != PL_PTYPE_REQ) || (typed->entry[k].function_id != typed->entry[i].function_id)) break;
+		}
+		func = vsld_function(typed->entry[i].function_id);
+		kernel = ((func != NULL) && (func->typed != NULL)) ? func->typed[typed->otype] : NULL;
+
+		if ((k > i) && (kernel != NULL)) {
+			vsld_typed_gather(typed->otype, &typed->entry[i], k - i, 0, &op1);
+			if (func->uArity > 1) vsld_typed_gather(typed->otype, &typed->entry[i], k - i, 1, &op2);
+			else memset(&op2, 0x00, sizeof(op2));
+
+			BL_LOG(BL_TRACE, "vslabd: Calculating %u x %s on %s...\n", k - i, func->name, vsld_otypes[typed->otype]);
+			kernel(worker, &op1, &op2, &result, error, k - i);
+			vsld_typed_scatter(typed->otype, &typed->entry[i], k - i, &result, error);
+			sevenseg_setch(error[k - i - 1] ? 'E' : func->cStatus);
+			continue;
+		}
+
+		// entries that can't be executed fail on their own
+		uError = (k == i) ? PL_ERR_INVALIDTYPE : PL_ERR_NOSUCHFUNCTION;
+		if (k == i) k = i + 1;
+		for (; i < k; i++) {
+			typed->entry[i].type = PL_PTYPE_ERR;
+			memset(typed->entry[i].data, 0x00, sizeof(typed->entry[i].data));
+			typed->entry[i].data[0].i32 = (int)uError;
+		}
+		sevenseg_setch((uError == PL_ERR_NOSUCHFUNCTION) ? 'F' : 'E');
+	}
+	pl_create_typed_response(typed);
+}
+
+/**
+ *	\brief Process one received datagram
+ *	\param worker		The worker that received the datagram
+ *	\param rcvpacket	A pointer to the received datagram
+ *	\param iRcvLen		The length of the received datagram
+ *	\param sndpacket	A pointer to a buffer of PL_MAX_DATAGRAM bytes for the reply
+ *	\return			The number of reply bytes in \a sndpacket
+ *
+ *	Batch requests are answered with one batch response, typed requests with one typed
+ *	response, anything else with a single response or error packet. Replies echo the
+ *	request ID and have the size of the request, so clients sending packets without
+ *	request ID get such packets back. Bytes following the request ID of a single
+ *	request are the payload of its function, e.g. the code of a program. A request
+ *	whose function deferred results is kept in the deferred request offered and gets
+ *	no reply yet.
+ */
+static int vsld_process(struct vsld_worker *worker, char *rcvpacket, int iRcvLen, char *sndpacket)
+{
+	int iReturn = 0;
 	struct pl_data vsld_data;
-	
-	struct sockaddr_in vsld_remote, vsld_local;
-	char sndpacket[PL_PACKETSIZE];
-	char rcvpacket[PL_PACKETSIZE];
+	struct pl_batch vsld_batch;
+	struct pl_typed vsld_typed;
+	struct vsld_deferred *d = worker->defer;
 
-	// introducing myself...
-	printf("VSLab server daemon, version %s, build %s %s\n", VSLD_VERSION, __DATE__, __TIME__);
+	memset(&vsld_data, 0x00, sizeof(vsld_data));
 
-	// initializing 7seg display driver
-	sevenseg_open();
+	// batch requests carry several operations - execute all of them and send
+	// one batch response
+	iReturn = pl_peek_type(rcvpacket, iRcvLen);
+	if (iReturn == PL_PTYPE_BREQ) {
+		PLM_REQUEST_ID(vsld_batch) = 0;
+		iReturn = pl_extr_batch(rcvpacket, &vsld_batch, iRcvLen);
+		if ((iReturn == E_PL_NOERROR) && (vsld_batch.mode == PL_MODE_CLN)) {
+			vsld_execute_batch(worker, &vsld_batch);
+			if ((d != NULL) && (d->uJobs > 0)) {
+				d->iType = PL_PTYPE_BREQ;
+				d->batch = vsld_batch;
+				return 0;
+			}
+			pl_make_batch(&vsld_batch, sndpacket, PL_MAX_DATAGRAM);
+			return PL_BATCH_PACKETSIZE(PLM_BATCH_COUNT(vsld_batch));
+		}
+		// malformed batch requests are answered with a single error packet
+		PLM_REQUEST_ID(vsld_data) = PLM_REQUEST_ID(vsld_batch);
+		pl_create_error(&vsld_data, (iReturn < 0) ? PL_ERR_GENERALERROR : PL_ERR_INVALIDMODE);
+	}
+	// typed requests work like batch requests on operands of one type
+	else if (iReturn == PL_PTYPE_TREQ) {
+		PLM_REQUEST_ID(vsld_typed) = 0;
+		iReturn = pl_extr_typed(rcvpacket, &vsld_typed, iRcvLen);
+		if ((iReturn == E_PL_NOERROR) && (vsld_typed.mode == PL_MODE_CLN)) {
+			vsld_execute_typed(worker, &vsld_typed);
+			pl_make_typed(&vsld_typed, sndpacket, PL_MAX_DATAGRAM);
+			return PL_TYPED_PACKETSIZE(vsld_typed.count);
+		}
+		PLM_REQUEST_ID(vsld_data) = PLM_REQUEST_ID(vsld_typed);
+		if (iReturn == -E_PL_INVALIDTYPE) pl_create_error(&vsld_data, PL_ERR_NOSUCHTYPE);
+		else pl_create_error(&vsld_data, (iReturn < 0) ? PL_ERR_GENERALERROR : PL_ERR_INVALIDMODE);
+	}
+	// extract incoming packet		
+	else if ((iReturn = pl_extr_packet(rcvpacket, &vsld_data, iRcvLen)) < 0) {
+		// error during packet extraction
+		pl_create_error(&vsld_data, PL_ERR_GENERALERROR);
+	}
+	// check packet type
+	else if (PLM_PACKET_TYPE(vsld_data) != PL_PTYPE_REQ) {
+		pl_create_error(&vsld_data, PL_ERR_INVALIDTYPE);
+	}
+	// check packet mode. We're a server, so we won't accept server packets!
+	else if (PLM_PACKET_MODE(vsld_data) != PL_MODE_CLN) {
+		pl_create_error(&vsld_data, PL_ERR_INVALIDMODE);
+	}
+	// anything behind the request ID is the payload of the function
+	else if (iRcvLen > (int)PL_PACKETSIZE)
+		vsld_execute_payload(worker, &vsld_data, (unsigned char *)rcvpacket + PL_PACKETSIZE, iRcvLen - PL_PACKETSIZE);
+	// this is our core job - execute the requested function
+	else vsld_execute(worker, &vsld_data);
+
+	if ((d != NULL) && (d->uJobs > 0)) {
+		d->iType = PL_PTYPE_REQ;
+		d->data = vsld_data;
+		d->iSndLen = (iRcvLen < (int)PL_PACKETSIZE) ? PL_PACKETSIZE_V1 : PL_PACKETSIZE;
+		return 0;
+	}
+	// convert packet
+	pl_make_packet(&vsld_data, sndpacket, PL_PACKETSIZE);
+	return (iRcvLen < (int)PL_PACKETSIZE) ? PL_PACKETSIZE_V1 : PL_PACKETSIZE;
+}
+
+/**
+ *	\brief Print the cache counters of a worker
+ *	\param worker	The worker
+ *
+ *	Called when the worker went idle, and only if its caches were used since the last
+ *	report, so a quiet server stays quiet.
+ */
+static void vsld_report(struct vsld_worker *worker)
+{
+	unsigned long ulLookups = worker->results.ulHits + worker->results.ulMisses + worker->cache.ulHits + worker->cache.ulMisses;
+
+	if (ulLookups == worker->ulReported) return;
+	worker->ulReported = ulLookups;
+	BL_LOG(BL_INFO, "vslabd: Worker %d: result cache %lu hits, %lu misses, %lu evictions; reply cache %lu hits, %lu misses.\n",
+	       worker->iId, worker->results.ulHits, worker->results.ulMisses, worker->results.ulEvictions,
+	       worker->cache.ulHits, worker->cache.ulMisses);
+}
+
+/**
+ *	\brief Send a datagram of a result stream
+ *	\param iSocket	The socket to send from, blocking or not
+ *	\param remote	The receiver
+ *	\param packet	The datagram
+ *	\param iLen	Its length
+ *	\return		Zero if successful, -1 if the datagram couldn't be sent
+ *
+ *	A full socket send buffer is waited for up to VSLD_STREAM_WAIT_MS, so a long stream
+ *	doesn't lose fragments just because it outpaces the network interface.
+ */
+static int vsld_stream(int iSocket, struct sockaddr *remote, char *packet, int iLen)
+{
+	socklen_t iAddrLen = (remote->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+	struct pollfd pfd;
+
+	while (sendto(iSocket, packet, iLen, 0, remote, iAddrLen) < 0) {
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != ENOBUFS) && (errno != EINTR)) return -1;
+		pfd.fd = iSocket;
+		pfd.events = POLLOUT;
+		if (poll(&pfd, 1, VSLD_STREAM_WAIT_MS) <= 0) return -1;
+	}
+	return 0;
+}
+
+/**
+ *	\brief Stream the results of a vector request
+ *	\param iSocket	The socket the request came from
+ *	\param remote	The sender
+ *	\param hdr	Header of a fragment of the request
+ *	\param result	The results
+ *	\param uResults	Number of results
+ *	\param ack	Bitmap of the fragments the client has, NULL to send all
+ *	\param sndpacket	A buffer of PL_MAX_DATAGRAM bytes for the fragments
+ */
+static void vsld_bulk_stream(int iSocket, struct sockaddr *remote, struct pl_vector *hdr, const unsigned int *result,
+			     unsigned int uResults, const unsigned int *ack, char *sndpacket)
+{
+	struct pl_vector rsp;
+
+	memcpy(&rsp, hdr, sizeof(struct pl_vector));
+	rsp.type = PL_PTYPE_VRSP;
+	rsp.mode = PL_MODE_SRV;
+	rsp.total = PL_VEC_FRAGMENTS(uResults);
+	for (rsp.seq = 0; rsp.seq < rsp.total; rsp.seq++) {
+		if ((ack != NULL) && (ack[rsp.seq / 32] & (1U << (rsp.seq % 32)))) continue;
+		rsp.count = (rsp.seq + 1 < rsp.total) ? PL_VEC_WORDS : uResults - rsp.seq * PL_VEC_WORDS;
+		pl_make_vector(&rsp, &result[rsp.seq * PL_VEC_WORDS], sndpacket, PL_MAX_DATAGRAM);
+		if (vsld_stream(iSocket, remote, sndpacket, PL_VEC_PACKETSIZE(rsp.count)) < 0) {
+			BL_LOG(BL_DEBUG, "vslabd: Result stream of request %u broken off.\n", rsp.request_id);
+			break;
+		}
+	}
+}
+
+/**
+ *	\brief Execute a reassembled vector request and stream the results
+ *	\param worker	The worker executing the request
+ *	\param func	The function requested
+ *	\param hdr	Header of the request's last fragment
+ *	\param job	The reassembled operands, A followed by B, in network byte order
+ *	\param uA	Number of elements of A
+ *	\param uResults	Number of results
+ *	\param iSocket	The socket the request came from
+ *	\param remote	The sender
+ *	\param sndpacket	A buffer of PL_MAX_DATAGRAM bytes for the fragments
+ *	\return		Zero if the results were sent or deferred, a PL_ERR_XXX code otherwise
+ *
+ *	The operands are converted in place. The results stay with the job, which is
+ *	released before they go out, for acknowledgments asking for lost fragments. If the
+ *	kernel deferred them, the job is kept in the deferred request offered until
+ *	vsld_resume() streams them.
+ */
+static unsigned int vsld_bulk_run(struct vsld_worker *worker, struct vsld_function *func, struct pl_vector *hdr,
+				  struct ra_job *job, unsigned int uA, unsigned int uResults, int iSocket,
+				  struct sockaddr *remote, char *sndpacket)
+{
+	unsigned int *op = (unsigned int *)job->data, *result;
+	unsigned int i, uError = 0, uWords = job->uSize / 4, uJob = job - worker->fragments.jobs;
+	struct vsld_deferred *d = worker->defer;
+
+	if (worker->uBulkSize[uJob] < uResults) {
+		result = realloc(worker->bulk[uJob], uResults * sizeof(unsigned int));
+		if (result == NULL) {
+			// drop the message, a retransmission may find memory
+			ra_drop(job);
+			return PL_ERR_BUSY;
+		}
+		worker->bulk[uJob] = result;
+		worker->uBulkSize[uJob] = uResults;
+	}
+	for (i = 0; i < uWords; i++) op[i] = ntohl(op[i]);
+
+	BL_LOG(BL_TRACE, "vslabd: Calculating %s(%u x %u x %u)...\n", func->name, hdr->dim[0], hdr->dim[1], hdr->dim[2]);
+	uError = func->bulk(worker, hdr->dim, op, op + uA, worker->bulk[uJob]);
+	if (uError != 0) {
+		// nothing to keep for acknowledgments, a retransmission starts over
+		ra_drop(job);
+		return uError;
+	}
+	if ((d != NULL) && (d->uJobs > 0)) {
+		d->iType = PL_PTYPE_VREQ;
+		d->hdr = *hdr;
+		d->job = job;
+		d->uResults = uResults;
+		return 0;
+	}
+	ra_release(job);
+	sevenseg_setch(func->cStatus);
+
+	vsld_bulk_stream(iSocket, remote, hdr, worker->bulk[uJob], uResults, NULL, sndpacket);
+	return 0;
+}
+
+/**
+ *	\brief Send the result fragments a client is missing
+ *	\param worker	The worker that received the acknowledgment
+ *	\param hdr	Header of the acknowledgment
+ *	\param uResults	Number of results of the request
+ *	\param iSocket	The socket the acknowledgment came from
+ *	\param remote	The sender
+ *	\param rcvpacket	The acknowledgment
+ *	\param iRcvLen		Its length
+ *	\param sndpacket	A buffer of PL_MAX_DATAGRAM bytes for the fragments
+ *
+ *	Acknowledgments of requests that aren't complete or whose results are gone are
+ *	dropped, the client's retransmission of the operands resolves the former.
+ */
+static void vsld_bulk_ack(struct vsld_worker *worker, struct pl_vector *hdr, unsigned int uResults, int iSocket,
+			  struct sockaddr *remote, char *rcvpacket, int iRcvLen, char *sndpacket)
+{
+	unsigned int ack[PL_VEC_WORDS], tag[1 + PL_VEC_DIMS];
+	struct ra_job *job;
+
+	if ((hdr->total != PL_VEC_FRAGMENTS(uResults)) || (hdr->count != (hdr->total + 31) / 32)) return;
+	job = ra_find(&worker->fragments, remote, hdr->request_id, rc_now());
+	if (job == NULL) return;
+	tag[0] = hdr->function_id;
+	memcpy(&tag[1], hdr->dim, sizeof(hdr->dim));
+	if ((job->uTagLen != sizeof(tag)) || (memcmp(job->tag, tag, sizeof(tag)) != 0)) return;
+
+	pl_extr_vector(rcvpacket, hdr, ack, iRcvLen);
+	BL_LOG(BL_DEBUG, "vslabd: Resending results of request %u.\n", hdr->request_id);
+	vsld_bulk_stream(iSocket, remote, hdr, worker->bulk[job - worker->fragments.jobs], uResults, ack, sndpacket);
+}
+
+/**
+ *	\brief Take a fragment of a vector request
+ *	\param worker	The worker that received the fragment
+ *	\param iSocket	The socket the fragment came from
+ *	\param remote	The sender
+ *	\param rcvpacket	The fragment
+ *	\param iRcvLen		Its length
+ *	\param sndpacket	A buffer of PL_MAX_DATAGRAM bytes for the reply
+ *	\return			Number of reply bytes in \a sndpacket, zero if there is nothing
+ *				to send (yet)
+ *
+ *	Fragments are collected in the worker's reassembly table. The fragment completing a
+ *	request runs the function's bulk kernel, whose results are streamed back right away.
+ *	A fragment that can't be taken is answered with an error packet. Acknowledgments
+ *	are passed to vsld_bulk_ack().
+ */
+static int vsld_bulk_serve(struct vsld_worker *worker, int iSocket, struct sockaddr *remote, char *rcvpacket,
+			   int iRcvLen, char *sndpacket)
+{
+	struct vsld_function *func = NULL;
+	struct pl_vector hdr;
+	struct pl_data vsld_data;
+	struct ra_fragment frag;
+	struct ra_job *job;
+	unsigned int uA = 0, uB = 0, uResults = 0, uError = 0, tag[1 + PL_VEC_DIMS];
+	int iReturn = 0;
+
+	memset(&hdr, 0x00, sizeof(hdr));
+	memset(&vsld_data, 0x00, sizeof(vsld_data));
+
+	if (pl_extr_vector(rcvpacket, &hdr, NULL, iRcvLen) < 0) uError = PL_ERR_GENERALERROR;
+	else if (hdr.mode != PL_MODE_CLN) uError = PL_ERR_INVALIDMODE;
+	else if (((func = vsld_function(hdr.function_id)) == NULL) || (func->bulk == NULL)) uError = PL_ERR_NOSUCHFUNCTION;
+	else if ((pl_vector_size(hdr.function_id, hdr.dim, &uA, &uB, &uResults) < 0) || (uA + uB > worker->uBulkWords)
+		 || (uResults > worker->uBulkWords) || (worker->fragments.jobs == NULL)) uError = PL_ERR_INVALIDSHAPE;
+	else if (hdr.type == PL_PTYPE_VACK) {
+		vsld_bulk_ack(worker, &hdr, uResults, iSocket, remote, rcvpacket, iRcvLen, sndpacket);
+		return 0;
+	}
+	else {
+		tag[0] = hdr.function_id;
+		memcpy(&tag[1], hdr.dim, sizeof(hdr.dim));
+		frag.uRequestId = hdr.request_id;
+		frag.uSeq = hdr.seq;
+		frag.uTotal = hdr.total;
+		frag.uFragSize = PL_VEC_WORDS * 4;
+		frag.uSize = (uA + uB) * 4;
+		frag.tag = tag;
+		frag.uTagLen = sizeof(tag);
+		frag.data = rcvpacket + PL_VEC_HDRSIZE;
+		frag.uLen = hdr.count * 4;
+
+		iReturn = ra_add(&worker->fragments, remote, &frag, rc_now(), &job);
+		if (iReturn == -ERA_INVALID) uError = PL_ERR_INVALIDSHAPE;
+		else if (iReturn < 0) uError = PL_ERR_BUSY;
+		else if (job == NULL) return 0;
+		else uError = vsld_bulk_run(worker, func, &hdr, job, uA, uResults, iSocket, remote, sndpacket);
+		if (uError == 0) return 0;
+	}
+
+	// the error goes back as single packet, it carries the request ID like any reply
+	PLM_FUNCTION_ID(vsld_data) = hdr.function_id;
+	PLM_REQUEST_ID(vsld_data) = hdr.request_id;
+	pl_create_error(&vsld_data, uError);
+	sevenseg_setch('E');
+	pl_make_packet(&vsld_data, sndpacket, PL_PACKETSIZE);
+	return PL_PACKETSIZE;
+}
+
+/**
+ *	\brief Find a free deferred request to offer to the next request served
+ *	\param worker	The worker
+ *	\return		The deferred request, NULL if the worker's loop waits for the
+ *			scrambler or all are taken
+ */
+static struct vsld_deferred *vsld_offer(struct vsld_worker *worker)
+{
+	int i;
+
+	if (worker->deferred == NULL) return NULL;
+	for (i = 0; i < VSLD_DEFERRED; i++) {
+		if (worker->deferred[i].iType != 0) continue;
+		worker->deferred[i].uJobs = 0;
+		return &worker->deferred[i];
+	}
+	return NULL;
+}
+
+/**
+ *	\brief Withdraw the deferred request offered, noting where its reply goes if it was taken
+ *	\param worker	The worker
+ *	\param iSocket	The socket the request came from
+ *	\param remote	The sender
+ *	\param uRequestId	Request ID to cache the reply under, zero for none
+ *	\return		Nonzero if the request took the deferred request
+ */
+static int vsld_take(struct vsld_worker *worker, int iSocket, struct sockaddr *remote, unsigned int uRequestId)
+{
+	struct vsld_deferred *d = worker->defer;
+
+	worker->defer = NULL;
+	if ((d == NULL) || (d->iType == 0)) return 0;
+	d->iSocket = iSocket;
+	memset(&d->remote, 0x00, sizeof(d->remote));
+	memcpy(&d->remote, remote, (remote->sa_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+	d->uRequestId = uRequestId;
+	return 1;
+}
+
+/**
+ *	\brief Answer one received datagram
+ *	\param worker	The worker that received the datagram
+ *	\param iSocket	The socket the datagram came from, result streams are sent on it
+ *	\param remote	The sender
+ *	\param rcvpacket	A pointer to the received datagram
+ *	\param iRcvLen		The length of the received datagram
+ *	\param sndpacket	A pointer to a buffer of PL_MAX_DATAGRAM bytes for the reply
+ *	\return			The number of reply bytes in \a sndpacket, zero if there is
+ *				nothing to send
+ *
+ *	Vector requests are handed to vsld_bulk_serve(), they are answered by a stream of
+ *	their own, and packets of aggregation streams to vsld_aggregate_serve(). A request
+ *	whose reply is still in the worker's reply cache was retransmitted by the
+ *	client, it gets the stored reply instead of being executed again. Since SO_REUSEPORT
+ *	hashes every client to the same worker, per-worker caches see all retransmissions.
+ *	In the epoll and io_uring loops, requests are offered a deferred request, see struct
+ *	vsld_deferred; one that takes it is answered later by vsld_resume().
+ */
+static int vsld_serve(struct vsld_worker *worker, int iSocket, struct sockaddr *remote, char *rcvpacket, int iRcvLen, char *sndpacket)
+{
+	unsigned int uRequestId = 0;
+	unsigned long ulNow = 0;
+	int iSndLen = 0;
+
+	iSndLen = pl_peek_type(rcvpacket, iRcvLen);
+	if ((iSndLen == PL_PTYPE_VREQ) || (iSndLen == PL_PTYPE_VACK)) {
+		worker->defer = vsld_offer(worker);
+		iSndLen = vsld_bulk_serve(worker, iSocket, remote, rcvpacket, iRcvLen, sndpacket);
+		vsld_take(worker, iSocket, remote, 0);
+		return iSndLen;
+	}
+	if ((iSndLen >= PL_PTYPE_SOPEN) && (iSndLen <= PL_PTYPE_SRSP))
+		return vsld_aggregate_serve(worker, remote, rcvpacket, iRcvLen, sndpacket);
+	if (worker->cache.entries != NULL) uRequestId = pl_peek_request_id(rcvpacket, iRcvLen);
+	if (uRequestId != 0) {
+		ulNow = rc_now();
+		iSndLen = rc_lookup(&worker->cache, remote, uRequestId, ulNow, sndpacket);
+		if (iSndLen > 0) {
+			BL_LOG(BL_DEBUG, "vslabd: Replaying reply to request %u.\n", uRequestId);
+			return iSndLen;
+		}
+	}
+
+	worker->defer = vsld_offer(worker);
+	iSndLen = vsld_process(worker, rcvpacket, iRcvLen, sndpacket);
+	if (vsld_take(worker, iSocket, remote, uRequestId)) return 0;
+	if (uRequestId != 0) rc_store(&worker->cache, remote, uRequestId, ulNow, sndpacket, iSndLen);
+	return iSndLen;
+}
+
+/**
+ *	\brief Classic main loop: one recvfrom() and one sendto() per datagram
+ *	\param worker	The worker to run the loop for, only its first socket is served
+ *
+ *	The SIGALRM based timeout is process-wide, so workers running in parallel use a
+ *	socket receive timeout instead. Nothing is deferred here: a request for the
+ *	scrambler blocks the loop until its jobs are back, which is acceptable for a loop
+ *	that serves one datagram at a time anyway.
+ */
+static void vsld_loop(struct vsld_worker *worker)
+{
+	int iRcvLen = 0, iSndLen = 0;
+	socklen_t i;
+	struct timeval tv;
+	struct sockaddr_storage vsld_remote;
+	char sndpacket[PL_MAX_DATAGRAM];
+	char rcvpacket[PL_MAX_DATAGRAM];
+
+	// the client description structure will be populated by recvfrom() calls
+	memset(&vsld_remote, 0x00, sizeof(vsld_remote));
+
+	if (worker->iSockTimeout) {
+		tv.tv_sec = VSLD_TIMEOUT_SECS;
+		tv.tv_usec = 0;
+		setsockopt(worker->iSocket[0], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	}
+
+	for (;;) {
+		// wait for incoming requests
+		i = sizeof(vsld_remote);
+		if (worker->iSockTimeout) {
+			iRcvLen = recvfrom(worker->iSocket[0], &rcvpacket, PL_MAX_DATAGRAM, 0, (struct sockaddr*)&vsld_remote, &i);
+			if (iRcvLen < 0) {
+				if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+					BL_LOG(BL_INFO, "vslabd: Got a timeout. Restarting.\n");
+					vsld_report(worker);
+				}
+				continue;
+			}
+		}
+		else {
+			tol_start_timeout(VSLD_TIMEOUT_SECS);
+			iRcvLen = recvfrom(worker->iSocket[0], &rcvpacket, PL_MAX_DATAGRAM, 0, (struct sockaddr*)&vsld_remote, &i);
+			tol_stop_timeout();
+			if (tol_is_timed_out()) {
+				tol_reset_timeout();
+				BL_LOG(BL_INFO, "vslabd: Got a timeout. Restarting.\n");
+				vsld_report(worker);
+				continue;
+			}
+			if (iRcvLen < 0) continue;
+		}
+
+		// process and send packet
+		iSndLen = vsld_serve(worker, worker->iSocket[0], (struct sockaddr*)&vsld_remote, rcvpacket, iRcvLen, sndpacket);
+		if (iSndLen > 0) iSndLen = sendto(worker->iSocket[0], &sndpacket, iSndLen, 0, (struct sockaddr*)&vsld_remote, i);
+	}
+}
+
+#if defined VSLD_HAVE_MMSG
+/**
+ *	\brief Message buffers for batched socket I/O
+ */
+struct vsld_burst {
+	int iCount;				/**< \brief Capacity in datagrams. */
+	struct mmsghdr *rcvmsgs;		/**< \brief Receive message headers. */
+	struct mmsghdr *sndmsgs;		/**< \brief Send message headers. */
+	struct iovec *rcviov;			/**< \brief Receive buffer descriptors. */
+	struct iovec *sndiov;			/**< \brief Send buffer descriptors. */
+	struct sockaddr_storage *remotes;	/**< \brief Sender of each datagram. */
+	char *rcvpackets;			/**< \brief iCount receive buffers. */
+	char *sndpackets;			/**< \brief iCount send buffers. */
+};
+
+/**
+ *	\brief Free message buffers
+ *	\param burst	Buffers allocated by vsld_burst_alloc(), may be NULL
+ */
+static void vsld_burst_free(struct vsld_burst *burst)
+{
+	if (burst == NULL) return;
+	free(burst->rcvmsgs); free(burst->sndmsgs); free(burst->rcviov); free(burst->sndiov);
+	free(burst->remotes); free(burst->rcvpackets); free(burst->sndpackets);
+	free(burst);
+}
+
+/**
+ *	\brief Allocate message buffers
+ *	\param iCount	Number of datagrams per burst
+ *	\return		The buffers, NULL if out of memory
+ */
+static struct vsld_burst *vsld_burst_alloc(int iCount)
+{
+	struct vsld_burst *burst = calloc(1, sizeof(struct vsld_burst));
+
+	if (burst == NULL) return NULL;
+	burst->iCount = iCount;
+	burst->rcvmsgs = calloc(iCount, sizeof(struct mmsghdr));
+	burst->sndmsgs = calloc(iCount, sizeof(struct mmsghdr));
+	burst->rcviov = calloc(iCount, sizeof(struct iovec));
+	burst->sndiov = calloc(iCount, sizeof(struct iovec));
+	burst->remotes = calloc(iCount, sizeof(struct sockaddr_storage));
+	burst->rcvpackets = malloc(iCount * PL_MAX_DATAGRAM);
+	burst->sndpackets = malloc(iCount * PL_MAX_DATAGRAM);
+	if (!burst->rcvmsgs || !burst->sndmsgs || !burst->rcviov || !burst->sndiov || !burst->remotes
+	    || !burst->rcvpackets || !burst->sndpackets) {
+		printf("vslabd: Out of memory for %d message buffers.\n", iCount);
+		vsld_burst_free(burst);
+		return NULL;
+	}
+	return burst;
+}
+
+/**
+ *	\brief Receive, process and answer one burst of datagrams
+ *	\param worker	The worker owning the socket
+ *	\param burst	Message buffers
+ *	\param iSocket	The socket to serve
+ *	\param iFlags	recvmmsg() flags, MSG_WAITFORONE to block for the first datagram 
+ *			or MSG_DONTWAIT to take only what is queued
+ *	\return		Number of datagrams served, negative if recvmmsg() failed
+ *
+ *	Each reply goes back to the address its request came from.
+ */
+static int vsld_burst_serve(struct vsld_worker *worker, struct vsld_burst *burst, int iSocket, int iFlags)
+{
+	int iRcvCnt = 0, iSndCnt = 0, iReplies = 0, iReturn = 0;
+	int i;
+
+	// (re)initialize receive headers, recvmmsg() overwrites name and length fields
+	for (i = 0; i < burst->iCount; i++) {
+		burst->rcviov[i].iov_base = &burst->rcvpackets[i * PL_MAX_DATAGRAM];
+		burst->rcviov[i].iov_len = PL_MAX_DATAGRAM;
+		burst->rcvmsgs[i].msg_hdr.msg_iov = &burst->rcviov[i];
+		burst->rcvmsgs[i].msg_hdr.msg_iovlen = 1;
+		burst->rcvmsgs[i].msg_hdr.msg_name = &burst->remotes[i];
+		burst->rcvmsgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+	}
+
+	// wait for incoming requests
+	iRcvCnt = recvmmsg(iSocket, burst->rcvmsgs, burst->iCount, iFlags, NULL);
+	if (iRcvCnt <= 0) return iRcvCnt;
+
+	// process all requests of this burst, requests without reply (e.g. vector
+	// fragments) get no send header
+	for (i = 0; i < iRcvCnt; i++) {
+		burst->sndiov[iReplies].iov_base = &burst->sndpackets[iReplies * PL_MAX_DATAGRAM];
+		burst->sndiov[iReplies].iov_len = vsld_serve(worker, iSocket, (struct sockaddr *)&burst->remotes[i], burst->rcviov[i].iov_base,
+							     burst->rcvmsgs[i].msg_len, burst->sndiov[iReplies].iov_base);
+		if (burst->sndiov[iReplies].iov_len == 0) continue;
+		burst->sndmsgs[iReplies].msg_hdr.msg_iov = &burst->sndiov[iReplies];
+		burst->sndmsgs[iReplies].msg_hdr.msg_iovlen = 1;
+		burst->sndmsgs[iReplies].msg_hdr.msg_name = &burst->remotes[i];
+		burst->sndmsgs[iReplies].msg_hdr.msg_namelen = burst->rcvmsgs[i].msg_hdr.msg_namelen;
+		iReplies++;
+	}
+
+	// send replies, sendmmsg() may stop early if the socket buffer is full
+	for (iSndCnt = 0; iSndCnt < iReplies; iSndCnt += iReturn) {
+		iReturn = sendmmsg(iSocket, &burst->sndmsgs[iSndCnt], iReplies - iSndCnt, 0);
+		if (iReturn <= 0) break;
+	}
+	return iRcvCnt;
+}
+
+/**
+ *	\brief Batched main loop: one recvmmsg() and one sendmmsg() per burst
+ *	\param worker	The worker to run the loop for, only its first socket is served
+ *	\return		Zero if the loop could not be started, it won't return otherwise
+ *
+ *	recvmmsg() blocks until the first datagram arrives and then collects whatever else 
+ *	is already queued (MSG_WAITFORONE), so a lightly loaded server answers every request 
+ *	immediately while a loaded one pays two system calls per burst. The idle timeout is 
+ *	a socket option here and costs no system calls per packet. Like the classic loop,
+ *	it waits for the scrambler's jobs of a request before it serves the next one.
+ */
+static int vsld_loop_mmsg(struct vsld_worker *worker)
+{
+	struct timeval tv;
+	struct vsld_burst *burst = vsld_burst_alloc(worker->iMsgCount);
+
+	if (burst == NULL) return 0;
+
+	// idle timeout
+	tv.tv_sec = VSLD_TIMEOUT_SECS;
+	tv.tv_usec = 0;
+	setsockopt(worker->iSocket[0], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	for (;;) {
+		if ((vsld_burst_serve(worker, burst, worker->iSocket[0], MSG_WAITFORONE) < 0)
+		    && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+			BL_LOG(BL_INFO, "vslabd: Got a timeout. Restarting.\n");
+			vsld_report(worker);
+		}
+	}
+	vsld_burst_free(burst);
+	return 0;
+}
+#endif
+
+#if defined VSLD_HAVE_EPOLL
+/**
+ *	\brief Answer a deferred request whose jobs are all back
+ *	\param worker	The worker
+ *	\param d	The deferred request, free again on return; its socket and sender stay
+ *			valid until the next request is served
+ *	\param sndpacket	A buffer of PL_MAX_DATAGRAM bytes for the reply
+ *	\return		Number of reply bytes in \a sndpacket, for the sender of \a d; zero if
+ *			there is nothing to send, vector requests stream their results here
+ *
+ *	Finishes what vsld_process() or vsld_bulk_run() left undone, including the caches.
+ */
+static int vsld_resume(struct vsld_worker *worker, struct vsld_deferred *d, char *sndpacket)
+{
+	unsigned int i = 0, uJob = 0;
+	int iSndLen = 0;
+
+	if (d->iType == PL_PTYPE_VREQ) {
+		uJob = d->job - worker->fragments.jobs;
+		ra_release(d->job);
+		sevenseg_setch(vsld_function(d->hdr.function_id)->cStatus);
+		vsld_bulk_stream(d->iSocket, (struct sockaddr *)&d->remote, &d->hdr, worker->bulk[uJob], d->uResults, NULL, sndpacket);
+	}
+	else if (d->iType == PL_PTYPE_BREQ) {
+		for (i = 0; i < d->batch.count; i += (d->run[i] > 0) ? d->run[i] : 1) {
+			if (d->run[i] == 0) continue;
+			vsld_conclude_run(vsld_function(d->batch.entry[i].function_id), &d->batch.entry[i], &d->result[i], &d->error[i],
+					  d->run[i]);
+		}
+		pl_make_batch(&d->batch, sndpacket, PL_MAX_DATAGRAM);
+		iSndLen = PL_BATCH_PACKETSIZE(d->batch.count);
+	}
+	else {
+		vsld_conclude(worker, vsld_function(d->data.function_id), &d->data, d->op1, d->error[0], d->result[0]);
+		pl_make_packet(&d->data, sndpacket, PL_PACKETSIZE);
+		iSndLen = d->iSndLen;
+	}
+	if ((d->uRequestId != 0) && (iSndLen > 0))
+		rc_store(&worker->cache, (struct sockaddr *)&d->remote, d->uRequestId, rc_now(), sndpacket, iSndLen);
+	d->iType = 0;
+	return iSndLen;
+}
+
+/**
+ *	\brief Answer the deferred requests whose jobs came back
+ *	\param worker	The worker, its scrambler handle's event was signalled
+ *	\param iWait	Nonzero to wait for the jobs still at the scrambler, so no deferred
+ *			request is left
+ */
+static void vsld_resume_ready(struct vsld_worker *worker, int iWait)
+{
+	struct vsld_deferred *d;
+	char sndpacket[PL_MAX_DATAGRAM];
+	int iSndLen = 0;
+
+	while ((d = vsld_scramble_done(worker, iWait)) != NULL) {
+		iSndLen = vsld_resume(worker, d, sndpacket);
+		if (iSndLen > 0)
+			sendto(d->iSocket, sndpacket, iSndLen, 0, (struct sockaddr *)&d->remote,
+			       (d->remote.ss_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+	}
+}
+
+/**
+ *	\brief Serve what is queued on a readable socket
+ *	\param worker	The worker owning the socket
+ *	\param burst	Message buffers, NULL to receive one datagram per system call
+ *	\param iSocket	A non-blocking socket reported readable
+ *	\return		Number of datagrams served
+ *
+ *	At most VSLD_DRAIN_BUDGET datagrams are taken from one socket before control goes 
+ *	back to the reactor, so a flooded port can't starve the others.
+ */
+static int vsld_drain(struct vsld_worker *worker, void *burst, int iSocket)
+{
+	int iServed = 0, iRcvLen = 0, iSndLen = 0;
+	socklen_t i;
+	struct sockaddr_storage vsld_remote;
+	char sndpacket[PL_MAX_DATAGRAM];
+	char rcvpacket[PL_MAX_DATAGRAM];
+
+#if defined VSLD_HAVE_MMSG
+	if (burst != NULL) {
+		while (iServed < VSLD_DRAIN_BUDGET) {
+			iRcvLen = vsld_burst_serve(worker, (struct vsld_burst *)burst, iSocket, MSG_DONTWAIT);
+			if (iRcvLen <= 0) break;
+			iServed += iRcvLen;
+			if (iRcvLen < ((struct vsld_burst *)burst)->iCount) break;
+		}
+		return iServed;
+	}
+#endif
+	while (iServed < VSLD_DRAIN_BUDGET) {
+		i = sizeof(vsld_remote);
+		iRcvLen = recvfrom(iSocket, &rcvpacket, PL_MAX_DATAGRAM, MSG_DONTWAIT, (struct sockaddr*)&vsld_remote, &i);
+		if (iRcvLen < 0) break;
+		iSndLen = vsld_serve(worker, iSocket, (struct sockaddr*)&vsld_remote, rcvpacket, iRcvLen, sndpacket);
+		if (iSndLen > 0) iSndLen = sendto(iSocket, &sndpacket, iSndLen, 0, (struct sockaddr*)&vsld_remote, i);
+		iServed++;
+	}
+	return iServed;
+}
+
+/**
+ *	\brief Reactor main loop: epoll over all sockets of a worker and an idle timer
+ *	\param worker	The worker to run the loop for
+ *	\return		Zero if the loop could not be started or failed, it won't return otherwise;
+ *			the sockets block again then
+ *
+ *	The idle timer is a periodic timerfd armed once; an expiration without any datagram 
+ *	served since the previous one is reported as timeout. Thus, apart from the epoll_wait() 
+ *	per wakeup, the packet path costs only the receive and send calls - no signals, no 
+ *	re-arming. Requests for the scrambler don't wait for it: the event of the worker's
+ *	handle is watched like a socket and their replies go out once their jobs are back.
+ */
+static int vsld_loop_epoll(struct vsld_worker *worker)
+{
+	int iEpoll = -1, iTimer = -1, iEvent = -1, iEvents = 0;
+	int i;
+	unsigned long ulServed = 0;
+	void *burst = NULL;
+	struct epoll_event ev, events[VSLD_MAX_SOCKETS + 2];
+
+	iEpoll = epoll_create(VSLD_MAX_SOCKETS + 2);
+	iTimer = tol_timer_open(VSLD_TIMEOUT_SECS);
+	if ((iEpoll < 0) || (iTimer < 0)) {
+		printf("vslabd: Could not set up reactor, using classic loop.\n");
+		if (iEpoll >= 0) close(iEpoll);
+		tol_timer_close(iTimer);
+		return 0;
+	}
+#if defined VSLD_HAVE_MMSG
+	if (worker->iMsgCount > 1) burst = vsld_burst_alloc(worker->iMsgCount);
+#endif
+
+	ev.events = EPOLLIN;
+	ev.data.fd = iTimer;
+	epoll_ctl(iEpoll, EPOLL_CTL_ADD, iTimer, &ev);
+	iEvent = FPGA_HandleEvent(&worker->fpga);
+	if (iEvent >= 0) worker->deferred = calloc(VSLD_DEFERRED, sizeof(struct vsld_deferred));
+	if (worker->deferred != NULL) {
+		ev.events = EPOLLIN;
+		ev.data.fd = iEvent;
+		epoll_ctl(iEpoll, EPOLL_CTL_ADD, iEvent, &ev);
+	}
+	for (i = 0; i < worker->iSocketCount; i++) {
+		fcntl(worker->iSocket[i], F_SETFL, fcntl(worker->iSocket[i], F_GETFL) | O_NONBLOCK);
+		ev.events = EPOLLIN;
+		ev.data.fd = worker->iSocket[i];
+		epoll_ctl(iEpoll, EPOLL_CTL_ADD, worker->iSocket[i], &ev);
+	}
+
+	for (;;) {
+		iEvents = epoll_wait(iEpoll, events, worker->iSocketCount + 2, -1);
+		if (iEvents < 0) {
+			if (errno == EINTR) continue;
+			perror("vslabd: epoll_wait failed.\n");
+			break;
+		}
+		for (i = 0; i < iEvents; i++) {
+			if (events[i].data.fd == iTimer) {
+				tol_timer_expired(iTimer);
+				if (ulServed == 0) {
+					BL_LOG(BL_INFO, "vslabd: Got a timeout. Restarting.\n");
+					vsld_report(worker);
+				}
+				ulServed = 0;
+			}
+			else if ((events[i].data.fd == iEvent) && (worker->deferred != NULL)) vsld_resume_ready(worker, 0);
+			else ulServed += vsld_drain(worker, burst, events[i].data.fd);
+		}
+	}
+
+	// the loop the worker falls back to waits, nothing may be left deferred
+	if (worker->deferred != NULL) vsld_resume_ready(worker, 1);
+	free(worker->deferred);
+	worker->deferred = NULL;
+	// ... and blocks in its receive calls
+	for (i = 0; i < worker->iSocketCount; i++)
+		fcntl(worker->iSocket[i], F_SETFL, fcntl(worker->iSocket[i], F_GETFL) & ~O_NONBLOCK);
+#if defined VSLD_HAVE_MMSG
+	vsld_burst_free((struct vsld_burst *)burst);
+#endif
+	tol_timer_close(iTimer);
+	close(iEpoll);
+	return 0;
+}
+#endif
+
+#if defined VSLD_HAVE_IO_URING
+// io_uring user_data tags, the low bits carry a socket or send slot index
+#define VSLD_UD_RECV		(1ULL << 32)
+#define VSLD_UD_SEND		(2ULL << 32)
+#define VSLD_UD_TIMEOUT		(3ULL << 32)
+#define VSLD_UD_EVENT		(4ULL << 32)
+#define VSLD_UD_TAG(x)		((x) & (0xffffffffULL << 32))
+#define VSLD_UD_INDEX(x)	((unsigned)((x) & 0xffffffffULL))
+
+/**
+ *	\brief Receive buffer size: recvmsg header, sender address and the datagram itself
+ */
+#define VSLD_URING_BUFSIZE	(sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_storage) + PL_MAX_DATAGRAM)
+
+/**
+ *	\brief A reply in flight
+ *
+ *	Everything referenced by the sendmsg submission has to stay valid until its
+ *	completion arrives.
+ */
+struct vsld_uring_send {
+	struct msghdr hdr;			/**< \brief Message header. */
+	struct iovec iov;			/**< \brief Buffer descriptor. */
+	struct sockaddr_storage remote;		/**< \brief Reply address. */
+	int iNextFree;				/**< \brief Free list link. */
+	char sndpacket[PL_MAX_DATAGRAM];	/**< \brief The reply. */
+};
+
+/**
+ *	\brief State of the io_uring backend of one worker
+ */
+struct vsld_uring {
+	struct uring ring;				/**< \brief The io_uring instance. */
+	struct uring_bufring bufs;			/**< \brief Provided receive buffers. */
+	struct msghdr rcvhdr[VSLD_MAX_SOCKETS];		/**< \brief Multishot receive templates. */
+	struct __kernel_timespec idle;			/**< \brief Idle timer period. */
+	struct vsld_uring_send *sends;			/**< \brief VSLD_URING_SENDS reply slots. */
+	int iFreeSend;					/**< \brief First free reply slot, -1 if none. */
+	int iRequeued[VSLD_MAX_SOCKETS];		/**< \brief Receives queued again since the last datagram. */
+};
+
+/**
+ *	\brief Get a submission entry, flushing the submission ring if it is full
+ *	\param u	Backend state
+ *	\return		A cleared submission entry
+ */
+static struct io_uring_sqe *vsld_uring_sqe(struct vsld_uring *u)
+{
+	struct io_uring_sqe *sqe;
+
+	while ((sqe = uring_get_sqe(&u->ring)) == NULL) uring_submit_and_wait(&u->ring, 0);
+	return sqe;
+}
+
+/**
+ *	\brief Queue a multishot receive on a socket
+ *	\param u	Backend state
+ *	\param worker	The worker owning the socket
+ *	\param i	Socket index
+ *
+ *	One submission keeps delivering datagrams into provided buffers until the kernel 
+ *	ends it, e.g. when it ran out of buffers; then it has to be queued again.
+ */
+static void vsld_uring_recv(struct vsld_uring *u, struct vsld_worker *worker, int i)
+{
+	struct io_uring_sqe *sqe = vsld_uring_sqe(u);
+
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = worker->iSocket[i];
+	sqe->addr = (unsigned long)&u->rcvhdr[i];
+	sqe->len = 1;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = u->bufs.bgid;
+	sqe->user_data = VSLD_UD_RECV | i;
+}
+
+/**
+ *	\brief Queue the idle timer
+ *	\param u	Backend state
+ */
+static void vsld_uring_timeout(struct vsld_uring *u)
+{
+	struct io_uring_sqe *sqe = vsld_uring_sqe(u);
+
+	sqe->opcode = IORING_OP_TIMEOUT;
+	sqe->fd = -1;
+	sqe->addr = (unsigned long)&u->idle;
+	sqe->len = 1;
+	sqe->user_data = VSLD_UD_TIMEOUT;
+}
+
+/**
+ *	\brief Queue a poll of the scrambler handle's event
+ *	\param u	Backend state
+ *	\param iEvent	The event descriptor, see FPGA_HandleEvent()
+ */
+static void vsld_uring_event(struct vsld_uring *u, int iEvent)
+{
+	struct io_uring_sqe *sqe = vsld_uring_sqe(u);
+
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = iEvent;
+	sqe->poll32_events = POLLIN;
+	sqe->user_data = VSLD_UD_EVENT;
+}
+
+/**
+ *	\brief Queue the reply built in the first free send slot
+ *	\param u	Backend state
+ *	\param iSocket	The socket to send from
+ *	\param namelen	Length of the reply address in the slot
+ */
+static void vsld_uring_send(struct vsld_uring *u, int iSocket, socklen_t namelen)
+{
+	struct vsld_uring_send *slot = &u->sends[u->iFreeSend];
+	struct io_uring_sqe *sqe;
+
+	u->iFreeSend = slot->iNextFree;
+	memset(&slot->hdr, 0x00, sizeof(struct msghdr));
+	slot->hdr.msg_name = &slot->remote;
+	slot->hdr.msg_namelen = namelen;
+	slot->hdr.msg_iov = &slot->iov;
+	slot->hdr.msg_iovlen = 1;
+
+	sqe = vsld_uring_sqe(u);
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = iSocket;
+	sqe->addr = (unsigned long)&slot->hdr;
+	sqe->len = 1;
+	sqe->user_data = VSLD_UD_SEND | (slot - u->sends);
+}
+
+/**
+ *	\brief Process a received datagram and queue its reply
+ *	\param u	Backend state
+ *	\param worker	The worker owning the socket
+ *	\param iSocket	The socket the datagram came from
+ *	\param rcvhdr	The receive template used for the socket
+ *	\param buf	The provided buffer holding the datagram
+ *	\param iLen	Number of bytes the kernel put into \a buf
+ *
+ *	The reply is built into a free send slot. If all slots are in flight it is sent 
+ *	synchronously instead of being dropped.
+ */
+static void vsld_uring_reply(struct vsld_uring *u, struct vsld_worker *worker, int iSocket, struct msghdr *rcvhdr, char *buf, int iLen)
+{
+	struct io_uring_recvmsg_out *out = (struct io_uring_recvmsg_out *)buf;
+	struct vsld_uring_send *slot;
+	char *rcvpacket, sndpacket[PL_MAX_DATAGRAM];
+	unsigned int iOffset = sizeof(struct io_uring_recvmsg_out) + rcvhdr->msg_namelen + rcvhdr->msg_controllen;
+	int iSndLen;
+
+	// ignore truncated datagrams and senders whose address didn't fit
+	if ((iLen < (int)iOffset) || (out->flags & MSG_TRUNC) || (out->namelen > rcvhdr->msg_namelen)) return;
+	rcvpacket = buf + iOffset;
+
+	if (u->iFreeSend < 0) {
+		iSndLen = vsld_serve(worker, iSocket, (struct sockaddr *)(out + 1), rcvpacket, out->payloadlen, sndpacket);
+		if (iSndLen > 0) sendto(iSocket, sndpacket, iSndLen, 0, (struct sockaddr *)(out + 1), out->namelen);
+		return;
+	}
+
+	slot = &u->sends[u->iFreeSend];
+	memcpy(&slot->remote, out + 1, out->namelen);
+	slot->iov.iov_base = slot->sndpacket;
+	slot->iov.iov_len = vsld_serve(worker, iSocket, (struct sockaddr *)&slot->remote, rcvpacket, out->payloadlen, slot->sndpacket);
+	// nothing to send, the slot stays free
+	if (slot->iov.iov_len == 0) return;
+	vsld_uring_send(u, iSocket, out->namelen);
+}
+
+/**
+ *	\brief Answer the deferred requests whose jobs came back
+ *	\param u	Backend state
+ *	\param worker	The worker, its scrambler handle's event was signalled
+ *
+ *	Like vsld_resume_ready(), with the replies queued in send slots.
+ */
+static void vsld_uring_resume(struct vsld_uring *u, struct vsld_worker *worker)
+{
+	struct vsld_deferred *d;
+	struct vsld_uring_send *slot;
+	socklen_t namelen;
+	char sndpacket[PL_MAX_DATAGRAM];
+	int iSndLen;
+
+	while ((d = vsld_scramble_done(worker, 0)) != NULL) {
+		namelen = (d->remote.ss_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+		if (u->iFreeSend < 0) {
+			iSndLen = vsld_resume(worker, d, sndpacket);
+			if (iSndLen > 0) sendto(d->iSocket, sndpacket, iSndLen, 0, (struct sockaddr *)&d->remote, namelen);
+			continue;
+		}
+		slot = &u->sends[u->iFreeSend];
+		slot->iov.iov_base = slot->sndpacket;
+		slot->iov.iov_len = vsld_resume(worker, d, slot->sndpacket);
+		if (slot->iov.iov_len == 0) continue;
+		memcpy(&slot->remote, &d->remote, namelen);
+		vsld_uring_send(u, d->iSocket, namelen);
+	}
+}
+
+/**
+ *	\brief io_uring main loop
+ *	\param worker	The worker to run the loop for
+ *	\return		Zero if the kernel lacks support, it won't return otherwise
+ *
+ *	Support is probed by uring_init(). Should the kernel still end a receive with an error
+ *	before any datagram came in, or keep ending it without one, the loop gives up as
+ *	well, so the worker serves its sockets by epoll instead of spinning. Every socket has one multishot recvmsg outstanding that fills buffers from a 
+ *	provided buffer ring, so datagrams are processed right where the kernel put them and
+ *	no receive needs to be queued per packet. Replies are queued as sendmsg submissions 
+ *	and go to the kernel together with the wait for the next completions - a single 
+ *	io_uring_enter() per loop iteration, however many datagrams it covers. The buffers of 
+ *	a pass are returned to the kernel with a single barrier. As in the epoll loop,
+ *	requests for the scrambler are answered once a poll of the handle's event completes.
+ */
+static int vsld_loop_uring(struct vsld_worker *worker)
+{
+	struct vsld_uring *u;
+	struct io_uring_cqe *cqe;
+	unsigned long long ud;
+	unsigned long ulServed = 0, ulTotal = 0;
+	unsigned int uFlags;
+	int i, iRes, iEvent = -1, iFailed = 0;
+
+	u = calloc(1, sizeof(struct vsld_uring));
+	if (u == NULL) return 0;
+	u->sends = calloc(VSLD_URING_SENDS, sizeof(struct vsld_uring_send));
+	if ((u->sends == NULL) || (uring_init(&u->ring, VSLD_URING_ENTRIES) < 0)) {
+		printf("vslabd: io_uring not available, falling back.\n");
+		free(u->sends);
+		free(u);
+		return 0;
+	}
+	if (uring_bufring_init(&u->ring, &u->bufs, 0, VSLD_URING_BUFFERS, VSLD_URING_BUFSIZE) < 0) {
+		printf("vslabd: io_uring lacks provided buffer rings, falling back.\n");
+		uring_exit(&u->ring);
+		free(u->sends);
+		free(u);
+		return 0;
+	}
+	for (i = 0; i < VSLD_URING_SENDS; i++) u->sends[i].iNextFree = i + 1;
+	u->sends[VSLD_URING_SENDS - 1].iNextFree = -1;
+	u->iFreeSend = 0;
+
+	for (i = 0; i < worker->iSocketCount; i++) {
+		u->rcvhdr[i].msg_namelen = sizeof(struct sockaddr_storage);
+		vsld_uring_recv(u, worker, i);
+	}
+	u->idle.tv_sec = VSLD_TIMEOUT_SECS;
+	vsld_uring_timeout(u);
+	iEvent = FPGA_HandleEvent(&worker->fpga);
+	if (iEvent >= 0) worker->deferred = calloc(VSLD_DEFERRED, sizeof(struct vsld_deferred));
+	if (worker->deferred != NULL) vsld_uring_event(u, iEvent);
+
+	for (;;) {
+		iRes = uring_submit_and_wait(&u->ring, 1);
+		if ((iRes < 0) && (iRes != -EINTR) && (iRes != -EAGAIN) && (iRes != -EBUSY)) {
+			printf("vslabd: io_uring_enter failed (%d).\n", iRes);
+			break;
+		}
+
+		while ((cqe = uring_peek_cqe(&u->ring)) != NULL) {
+			ud = cqe->user_data;
+			iRes = cqe->res;
+			uFlags = cqe->flags;
+
+			switch (VSLD_UD_TAG(ud)) {
+				case VSLD_UD_RECV:
+					i = VSLD_UD_INDEX(ud);
+					if (uFlags & IORING_CQE_F_BUFFER) {
+						if (iRes > 0) {
+							vsld_uring_reply(u, worker, worker->iSocket[i], &u->rcvhdr[i],
+									 URING_BUFFER(&u->bufs, uFlags >> IORING_CQE_BUFFER_SHIFT), iRes);
+							ulServed++;
+							ulTotal++;
+							u->iRequeued[i] = 0;
+						}
+						uring_bufring_add(&u->bufs, uFlags >> IORING_CQE_BUFFER_SHIFT);
+					}
+					if (uFlags & IORING_CQE_F_MORE) break;
+					// the multishot receive ended (e.g. -ENOBUFS) - queue it again, unless the 
+					// kernel refuses it before the first datagram or keeps ending it without one
+					if (((iRes < 0) && (iRes != -ENOBUFS) && (iRes != -EINTR) && (ulTotal == 0)) ||
+					    (++u->iRequeued[i] > VSLD_URING_REQUEUES)) {
+						printf("vslabd: io_uring receive failed (%d), falling back.\n", iRes);
+						iFailed = 1;
+						break;
+					}
+					vsld_uring_recv(u, worker, i);
+					break;
+				case VSLD_UD_SEND:
+					i = VSLD_UD_INDEX(ud);
+					u->sends[i].iNextFree = u->iFreeSend;
+					u->iFreeSend = i;
+					break;
+				case VSLD_UD_TIMEOUT:
+					if (ulServed == 0) {
+						BL_LOG(BL_INFO, "vslabd: Got a timeout. Restarting.\n");
+						vsld_report(worker);
+					}
+					ulServed = 0;
+					vsld_uring_timeout(u);
+					break;
+				case VSLD_UD_EVENT:
+					vsld_uring_resume(u, worker);
+					vsld_uring_event(u, iEvent);
+					break;
+			}
+			uring_cqe_seen(&u->ring);
+		}
+		uring_bufring_publish(&u->bufs);
+		if (iFailed) break;
+	}
+
+	// the loop the worker falls back to waits, nothing may be left deferred
+	if (worker->deferred != NULL) vsld_resume_ready(worker, 1);
+	free(worker->deferred);
+	worker->deferred = NULL;
+	uring_bufring_free(&u->ring, &u->bufs);
+	uring_exit(&u->ring);
+	free(u->sends);
+	free(u);
+	return 0;
+}
+#endif
+
+/**
+ *	\brief Run the main loop selected for a worker
+ *	\param arg	A pointer to the struct vsld_worker to run
+ *	\return		NULL
+ *
+ *	This is the worker thread entry point. It pins the thread to its CPU if requested
+ *	and sets up the worker's reply cache in its own thread. Backends that fail to start
+ *	fall back to the next simpler one: io_uring to epoll, epoll to the classic loop. As
+ *	that serves a single socket, a worker with more sockets ends the daemon instead.
+ */
+static void *vsld_worker_main(void *arg)
+{
+	struct vsld_worker *worker = (struct vsld_worker *)arg;
+	int i, iRcvBuf = VSLD_BULK_RCVBUF;
+#if defined VSLD_HAVE_AFFINITY
+	cpu_set_t cpus;
+
+	if (worker->iCpu >= 0) {
+		CPU_ZERO(&cpus);
+		CPU_SET(worker->iCpu, &cpus);
+		if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0)
+			printf("vslabd: Could not pin worker %d to CPU %d.\n", worker->iId, worker->iCpu);
+	}
+#endif
+
+	if ((worker->uCacheEntries > 0) && (rc_init(&worker->cache, worker->uCacheEntries, worker->ulCacheLifetime) < 0))
+		printf("vslabd: No memory for the reply cache of worker %d.\n", worker->iId);
+	fdiv_init(&worker->divisors);
+	if ((worker->uResultEntries > 0) && (res_init(&worker->results, worker->uResultEntries) < 0))
+		printf("vslabd: No memory for the result cache of worker %d.\n", worker->iId);
+	if ((worker->uBulkWords > 0) && (ra_init(&worker->fragments, VSLD_BULK_JOBS, worker->uBulkWords * 4, VSLD_BULK_LIFETIME_MS) < 0))
+		printf("vslabd: No memory for the vector requests of worker %d.\n", worker->iId);
+	if ((worker->uStreams > 0) && (ag_init(&worker->streams, worker->uStreams, PL_STREAM_MAX_BUCKETS, VSLD_AGG_LIFETIME_MS) < 0))
+		printf("vslabd: No memory for the aggregation streams of worker %d.\n", worker->iId);
+	if (FPGA_OpenHandle(&worker->fpga) < 0)
+		printf("vslabd: No scrambler handle for worker %d, it scrambles in software.\n", worker->iId);
+	for (i = 0; (worker->uBulkWords > 0) && (i < worker->iSocketCount); i++)
+		setsockopt(worker->iSocket[i], SOL_SOCKET, SO_RCVBUF, &iRcvBuf, sizeof(iRcvBuf));
+
+#if defined VSLD_HAVE_IO_URING
+	if (worker->iBackend == VSLD_IO_URING) vsld_loop_uring(worker);
+#endif
+#if defined VSLD_HAVE_EPOLL
+	if ((worker->iBackend == VSLD_IO_EPOLL) || (worker->iBackend == VSLD_IO_URING)) vsld_loop_epoll(worker);
+#endif
+	// the loops below serve the first socket only, the others must not go silent
+	if (worker->iSocketCount > 1) {
+		printf("vslabd: Worker %d can't serve %d sockets without epoll, exiting.\n", worker->iId, worker->iSocketCount);
+		exit(-EBACKEND);
+	}
+#if defined VSLD_HAVE_MMSG
+	if (worker->iMsgCount > 1) vsld_loop_mmsg(worker);
+#endif
+	vsld_loop(worker);
+	rc_free(&worker->cache);
+	res_free(&worker->results);
+	ra_free(&worker->fragments);
+	ag_free(&worker->streams);
+	FPGA_CloseHandle(&worker->fpga);
+	for (i = 0; i < VSLD_BULK_JOBS; i++) free(worker->bulk[i]);
+	free(worker->prog);
+	return NULL;
+}
+
+/**
+ *	\brief Create and bind a server socket
+ *	\param iFamily		AF_INET or AF_INET6
+ *	\param iPort		The port to bind to
+ *	\param iReusePort	Nonzero to allow several sockets on the port (SO_REUSEPORT)
+ *	\return			The socket descriptor if successful, an error code otherwise
+ *
+ *	With SO_REUSEPORT the kernel spreads incoming datagrams across all sockets bound to 
+ *	the port by hashing the sender's address, so one client always talks to one worker.
+ *	IPv6 sockets are restricted to IPv6 so they can coexist with the IPv4 socket on the 
+ *	same port.
+ */
+static int vsld_open_socket(int iFamily, int iPort, int iReusePort)
+{
+	int iReturn = 0, iOn = 1;
+	int iVSLSocket = 0;
+	socklen_t iAddrLen = 0;
+	struct sockaddr_storage vsld_local;
+	struct sockaddr_in *local4 = (struct sockaddr_in *)&vsld_local;
+	struct sockaddr_in6 *local6 = (struct sockaddr_in6 *)&vsld_local;
 
 	// get a socket descriptor from OS
-	iVSLSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	iVSLSocket = socket(iFamily, SOCK_DGRAM, IPPROTO_UDP);
 
 	if (iVSLSocket < 0)
 	{
@@ -38,21 +1628,33 @@ int main(void)
 		return -ESOCKET;
 	}
 
+#if defined SO_REUSEPORT
+	if (iReusePort && (setsockopt(iVSLSocket, SOL_SOCKET, SO_REUSEPORT, &iOn, sizeof(iOn)) < 0))
+	{
+		perror("vslabd: Error setting SO_REUSEPORT.\n");
+		close(iVSLSocket);
+		return -ESOCKET;
+	}
+#endif
+
 	// initialize server description structure - that's me
-   	vsld_local.sin_family = AF_INET;			// Ethernet
-   	vsld_local.sin_addr.s_addr = htonl(INADDR_ANY);		// automatically insert own address
-   	vsld_local.sin_port = htons(VSLD_PORT);			// set vslab server port
-   	memset(&(vsld_local.sin_zero), 0x00, 8);		// set remaining bytes to 0x0
-
-	// initialize client description structure - in fact we don't need to do this as this struct
-	// will be populated by recvfrom() calls.
-	vsld_remote.sin_family = AF_INET;			// Ethernet
-	vsld_remote.sin_addr.s_addr = htonl(INADDR_ANY);
-	vsld_remote.sin_port = htons(VSLD_PORT);
-	memset(&(vsld_remote.sin_zero), 0x00, 8);
+	memset(&vsld_local, 0x00, sizeof(vsld_local));
+	if (iFamily == AF_INET6) {
+		setsockopt(iVSLSocket, IPPROTO_IPV6, IPV6_V6ONLY, &iOn, sizeof(iOn));
+		local6->sin6_family = AF_INET6;
+		local6->sin6_addr = in6addr_any;		// automatically insert own address
+		local6->sin6_port = htons(iPort);		// set vslab server port
+		iAddrLen = sizeof(struct sockaddr_in6);
+	}
+	else {
+	   	local4->sin_family = AF_INET;			// Ethernet
+	   	local4->sin_addr.s_addr = htonl(INADDR_ANY);	// automatically insert own address
+	   	local4->sin_port = htons(iPort);		// set vslab server port
+		iAddrLen = sizeof(struct sockaddr_in);
+	}
 
 	// bind socket
-	iReturn = bind(iVSLSocket, (struct sockaddr *)&vsld_local, sizeof(struct sockaddr));
+	iReturn = bind(iVSLSocket, (struct sockaddr *)&vsld_local, iAddrLen);
 	if (iReturn < 0)
 	{
 		perror("vslabd: Error binding to socket.\n");
@@ -60,78 +1662,242 @@ int main(void)
 		return -EBIND;
 	}
 
-	// report status to 7seg display	
-	sevenseg_setch('0');
+	return iVSLSocket;
+}
 
-	// main loop
-	for (;;) {
-		// wait for incoming requests
-		i = sizeof(struct sockaddr);
-		tol_start_timeout(VSLD_TIMEOUT_SECS);
-		iRcvLen = recvfrom(iVSLSocket, &rcvpacket, PL_PACKETSIZE, 0, (struct sockaddr*)&vsld_remote, &i);
-		tol_stop_timeout();
-		if (tol_is_timed_out()) {
-			tol_reset_timeout();
-			printf("vslabd: Got a timeout. Restarting.\n");
-			continue;
-		}
+/**
+ *	\brief Print command line usage
+ *	\param name	The program name
+ */
+static void vsld_usage(char *name)
+{
+	printf("Usage: %s [-i backend] [-m count] [-t threads [-c]] [-p port]... [-6] [-r count] [-e ms] [-k count] [-v words] [-s count] [-f device] [-q]\n", name);
+#if defined VSLD_HAVE_IO_URING
+	printf("  -i backend I/O backend: classic, epoll (default) or uring\n");
+#elif defined VSLD_HAVE_EPOLL
+	printf("  -i backend I/O backend: classic or epoll (default)\n");
+#else
+	printf("  -i backend I/O backend: classic (default)\n");
+#endif
+#if defined VSLD_HAVE_MMSG
+	printf("  -m count   receive and reply up to count datagrams per system call (1..%d)\n", VSLD_MMSG_MAX);
+#else
+	printf("  -m count   not supported by this build\n");
+#endif
+#if defined SO_REUSEPORT
+	printf("  -t threads serve the ports with threads workers, each with its own sockets (1..%d)\n", VSLD_MAX_WORKERS);
+#else
+	printf("  -t threads not supported by this build\n");
+#endif
+#if defined VSLD_HAVE_AFFINITY
+	printf("  -c         pin worker n to CPU n\n");
+#else
+	printf("  -c         not supported by this build\n");
+#endif
+	printf("  -p port    serve port, may be given up to %d times (default %d, not with classic backend)\n", VSLD_MAX_PORTS, VSLD_PORT);
+	printf("  -6         serve IPv6 as well (not with classic backend)\n");
+	printf("  -r count   keep the replies to count requests per worker for retransmissions, 0 for none (default %d)\n", VSLD_REPLY_CACHE);
+	printf("  -e ms      keep replies for ms milliseconds (default %d)\n", VSLD_REPLY_LIFETIME_MS);
+	printf("  -k count   cache the results of count multiplications and divisions per worker, 0 for none (default %d)\n", VSLD_RESULT_CACHE);
+	printf("  -v words   accept vector requests of up to words operand words, 0 for none (default %d)\n", VSLD_BULK_WORDS);
+	printf("  -s count   aggregate up to count streams per worker at the same time, 0 for none (default %d)\n", VSLD_AGG_STREAMS);
+	printf("  -f device  scramble with the FPGA at device, %s for fpgalib's stand-in, in software while it is missing or busy (default %s)\n", FPGA_STANDIN, FPGA_DEVICEFILE);
+	printf("  -q         don't log every request\n");
+}
 
-		// extract incoming packet		
-		iReturn = pl_extr_packet(rcvpacket, &vsld_data, iRcvLen);
+int main(int argc, char **argv)
+{
+	int iReturn = 0;
+	int iMsgCount = 1, iWorkers = 1, iPin = 0, iCpus = 1, iIPv6 = 0;
+	int iPorts[VSLD_MAX_PORTS], iPortCount = 0;
+	int iBackend = VSLD_IO_DEFAULT;
+	int iCacheEntries = VSLD_REPLY_CACHE, iCacheLifetime = VSLD_REPLY_LIFETIME_MS;
+	int iResultEntries = VSLD_RESULT_CACHE, iBulkWords = VSLD_BULK_WORDS, iStreams = VSLD_AGG_STREAMS;
+	char *pScrambler = FPGA_DEVICEFILE;
+	int i, j;
+	struct vsld_worker *workers;
 
-		// check for error during packet extraction
-		if(iReturn < 0) {
-			pl_create_error(&vsld_data, PL_ERR_GENERALERROR);
-		}
-		// check packet type
-		else if (PLM_PACKET_TYPE(vsld_data) != PL_PTYPE_REQ) {
-			pl_create_error(&vsld_data, PL_ERR_INVALIDTYPE);
-		}
-		// check packet mode. We're a server, so we won't accept server packets!
- 		else if (PLM_PACKET_MODE(vsld_data) != PL_MODE_CLN) {
-			pl_create_error(&vsld_data, PL_ERR_INVALIDMODE);
-		}
-		// this is our core job - switch to the requested function id...
-		else switch(PLM_FUNCTION_ID(vsld_data)) {
-			case PL_FID_MUL:
-				// multiply operands 0 and 1 of the received packet
-				printf("vslabd: Calculating %d * %d...\n", PLM_OPERAND(vsld_data,0), PLM_OPERAND(vsld_data,1));
-				iResult = PLM_OPERAND(vsld_data,0) * PLM_OPERAND(vsld_data,1);
-				pl_create_response(&vsld_data);
-				PLM_OPERAND(vsld_data, 0) = iResult;
-				// Report status to 7seg display	
-				sevenseg_setch('1');
+	// introducing myself...
+	printf("VSLab server daemon, version %s, build %s %s\n", VSLD_VERSION, __DATE__, __TIME__);
+
+	// check command line parameters
+	while ((iReturn = getopt(argc, argv, "i:m:t:p:6r:e:k:v:s:f:cq")) != -1) {
+		switch (iReturn) {
+			case 'i':
+				if (strcmp(optarg, "classic") == 0) iBackend = VSLD_IO_CLASSIC;
+#if defined VSLD_HAVE_EPOLL
+				else if (strcmp(optarg, "epoll") == 0) iBackend = VSLD_IO_EPOLL;
+#endif
+#if defined VSLD_HAVE_IO_URING
+				else if (strcmp(optarg, "uring") == 0) iBackend = VSLD_IO_URING;
+#endif
+				else {
+					vsld_usage(argv[0]);
+					return -EARGS;
+				}
 				break;
-			case PL_FID_DIV:
-				// divide operand 0 by operand 1 of the received packet
-				printf("vslabd: Calculating %d / %d...\n", PLM_OPERAND(vsld_data,0), PLM_OPERAND(vsld_data,1));
-				// check if divisor is 0
-				if (PLM_OPERAND(vsld_data,1) == 0) {
-					pl_create_error(&vsld_data, PL_ERR_FUNCEXECERROR);
-					// report status to 7seg display	
-					sevenseg_setch('E');
+			case 'm':
+				iMsgCount = atoi(optarg);
+				if ((iMsgCount < 1) || (iMsgCount > VSLD_MMSG_MAX)) {
+					vsld_usage(argv[0]);
+					return -EARGS;
 				}
-				else {
-					iResult = PLM_OPERAND(vsld_data,0) / PLM_OPERAND(vsld_data,1);
-					pl_create_response(&vsld_data);
-					PLM_OPERAND(vsld_data, 0) = iResult;
-					// report status to 7seg display	
-					sevenseg_setch('2');
+				break;
+			case 't':
+				iWorkers = atoi(optarg);
+				if ((iWorkers < 1) || (iWorkers > VSLD_MAX_WORKERS)) {
+					vsld_usage(argv[0]);
+					return -EARGS;
 				}
+#if !defined SO_REUSEPORT
+				if (iWorkers > 1) {
+					vsld_usage(argv[0]);
+					return -EARGS;
+				}
+#endif
 				break;
-			default:
-				// function is not implemented - create an error packet
-				pl_create_error(&vsld_data, PL_ERR_NOSUCHFUNCTION);
-				// report status to 7seg display	
-				sevenseg_setch('F');
+			case 'p':
+				if ((iPortCount == VSLD_MAX_PORTS) || (atoi(optarg) < 1) || (atoi(optarg) > 65535)) {
+					vsld_usage(argv[0]);
+					return -EARGS;
+				}
+				iPorts[iPortCount++] = atoi(optarg);
+				break;
+			case '6':
+				iIPv6 = 1;
+				break;
+			case 'r':
+				iCacheEntries = atoi(optarg);
+				if ((iCacheEntries < 0) || (iCacheEntries > VSLD_REPLY_CACHE_MAX)) {
+					vsld_usage(argv[0]);
+					return -EARGS;
+				}
+				break;
+			case 'e':
+				iCacheLifetime = atoi(optarg);
+				if (iCacheLifetime < 1) {
+					vsld_usage(argv[0]);
+					return -EARGS;
+				}
+				break;
+			case 'k':
+				iResultEntries = atoi(optarg);
+				if ((iResultEntries < 0) || (iResultEntries > VSLD_RESULT_CACHE_MAX)) {
+					vsld_usage(argv[0]);
+					return -EARGS;
+				}
+				break;
+			case 'v':
+				iBulkWords = atoi(optarg);
+				if ((iBulkWords < 0) || (iBulkWords > VSLD_BULK_WORDS_MAX)) {
+					vsld_usage(argv[0]);
+					return -EARGS;
+				}
+				break;
+			case 's':
+				iStreams = atoi(optarg);
+				if ((iStreams < 0) || (iStreams > VSLD_AGG_STREAMS_MAX)) {
+					vsld_usage(argv[0]);
+					return -EARGS;
+				}
+				break;
+			case 'f':
+				pScrambler = optarg;
+				break;
+			case 'c':
+				iPin = 1;
+				break;
+			case 'q':
+				bl_set_level(BL_INFO);
 				break;
+			default:
+				vsld_usage(argv[0]);
+				return -EARGS;
 		}
+	}
+	if (iPortCount == 0) iPorts[iPortCount++] = VSLD_PORT;
+	// the classic loop can't watch more than one socket
+	if (((iPortCount > 1) || iIPv6) && (iBackend == VSLD_IO_CLASSIC)) {
+		vsld_usage(argv[0]);
+		return -EARGS;
+	}
+
+	workers = calloc(iWorkers, sizeof(struct vsld_worker));
+	if (workers == NULL) return -ENOMEMORY;
+#if defined VSLD_HAVE_AFFINITY
+	iCpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (iCpus < 1) iCpus = 1;
+#endif
+
+	// messages of the workers are printed by the log thread
+	bl_open();
+	// initializing 7seg display driver
+	sevenseg_open();
+	// the modules register their functions
+	if ((vsld_arith_register() < 0) || (vsld_prog_register() < 0) || (vsld_vector_register() < 0) ||
+	    (vsld_scramble_register(pScrambler) < 0)) {
+		vsld_scramble_close();
+		sevenseg_close();
+		bl_close();
+		free(workers);
+		return -EREGISTER;
+	}
+
+	// open all sockets before starting any worker so bind errors show up at once
+	for (i = 0; i < iWorkers; i++) {
+		workers[i].iId = i;
+		workers[i].iCpu = iPin ? (i % iCpus) : -1;
+		workers[i].iBackend = iBackend;
+		workers[i].iMsgCount = iMsgCount;
+		workers[i].iSockTimeout = (iWorkers > 1);
+		workers[i].uCacheEntries = iCacheEntries;
+		workers[i].ulCacheLifetime = iCacheLifetime;
+		workers[i].uResultEntries = iResultEntries;
+		workers[i].uBulkWords = iBulkWords;
+		workers[i].uStreams = iStreams;
+		for (j = 0; j < iPortCount * (iIPv6 ? 2 : 1); j++) {
+			iReturn = vsld_open_socket((j < iPortCount) ? AF_INET : AF_INET6, iPorts[j % iPortCount], iWorkers > 1);
+			if (iReturn < 0) break;
+			workers[i].iSocket[workers[i].iSocketCount++] = iReturn;
+		}
+		if (iReturn < 0) {
+			for (; i >= 0; i--) {
+				for (j = 0; j < workers[i].iSocketCount; j++) close(workers[i].iSocket[j]);
+			}
+			vsld_scramble_close();
+			sevenseg_close();
+			bl_close();
+			free(workers);
+			return iReturn;
+		}
+	}
+
+	// report status to 7seg display	
+	sevenseg_setch('0');
+
+	// main loop - a single worker runs in the main thread
+	if (iWorkers == 1) vsld_worker_main(&workers[0]);
+	else {
+		for (i = 0; i < iWorkers; i++) {
+			if (pthread_create(&workers[i].thread, NULL, vsld_worker_main, &workers[i]) != 0) {
+				printf("vslabd: Could not start worker %d.\n", i);
+				for (j = 0; j < workers[i].iSocketCount; j++) close(workers[i].iSocket[j]);
+				workers[i].iSocketCount = 0;
+			}
+		}
+		printf("vslabd: %d workers serving %d sockets each.\n", iWorkers, workers[0].iSocketCount);
+		for (i = 0; i < iWorkers; i++) {
+			if (workers[i].iSocketCount > 0) pthread_join(workers[i].thread, NULL);
+		}
+	}
 
-		// convert and send packet
-		pl_make_packet(&vsld_data, sndpacket, PL_PACKETSIZE);
-		iSndLen = sendto(iVSLSocket, &sndpacket, PL_PACKETSIZE, 0, (struct sockaddr*)&vsld_remote, sizeof(struct sockaddr));
+	for (i = 0; i < iWorkers; i++) {
+		for (j = 0; j < workers[i].iSocketCount; j++) close(workers[i].iSocket[j]);
 	}
+	free(workers);
+	vsld_scramble_close();
 	sevenseg_close();
+	bl_close();
 	return 0;
 }
 
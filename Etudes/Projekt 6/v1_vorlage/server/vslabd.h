@@ -29,6 +29,216 @@
  */
 #define VSLD_TIMEOUT_SECS		10
 
+/** \brief Maximum burst size. 
+ *
+ * Maximum number of datagrams received or sent by one recvmmsg()/sendmmsg() call.
+ */
+#define VSLD_MMSG_MAX			64
+
+/** \brief Maximum number of workers. 
+ *
+ * Maximum number of worker threads, each serving VSLD_PORT with its own socket.
+ */
+#define VSLD_MAX_WORKERS		64
+
+/** \brief Maximum number of ports. 
+ *
+ * Maximum number of ports served at the same time (option -p).
+ */
+#define VSLD_MAX_PORTS			8
+
+/** \brief Maximum number of sockets per worker. 
+ *
+ * One IPv4 and one IPv6 socket per port.
+ */
+#define VSLD_MAX_SOCKETS		(2*VSLD_MAX_PORTS)
+
+/** \brief Reactor fairness limit. 
+ *
+ * Maximum number of datagrams served from one socket before the reactor looks at
+ * the other sockets again.
+ */
+#define VSLD_DRAIN_BUDGET		256
+
+
+/** \brief Reply cache size. 
+ *
+ * Default number of replies each worker keeps for retransmitted requests (option -r).
+ */
+#define VSLD_REPLY_CACHE		1024
+
+/** \brief Maximum reply cache size. 
+ *
+ * Upper limit for option -r.
+ */
+#define VSLD_REPLY_CACHE_MAX		(1 << 20)
+
+/** \brief Reply lifetime. 
+ *
+ * Default number of milliseconds a reply is kept (option -e), should cover the time
+ * clients keep retransmitting.
+ */
+#define VSLD_REPLY_LIFETIME_MS		5000
+
+/** \brief Result cache size. 
+ *
+ * Default number of results of pure functions each worker keeps (option -k).
+ */
+#define VSLD_RESULT_CACHE		1024
+
+/** \brief Maximum result cache size. 
+ *
+ * Upper limit for option -k.
+ */
+#define VSLD_RESULT_CACHE_MAX		(1 << 24)
+
+/** \brief Minimum kernel run. 
+ *
+ * Batch requests use a function's batch kernel for runs of at least this many entries,
+ * shorter runs aren't worth gathering the operands.
+ */
+#define VSLD_KERNEL_MIN			4
+
+/** \brief Function id limit. 
+ *
+ * Size of the function registry, function ids must be smaller.
+ */
+#define VSLD_MAX_FID			256
+
+/** \brief Program instruction budget. 
+ *
+ * Maximum number of instructions a program request may execute.
+ */
+#define VSLD_PROG_BUDGET		65536
+
+/** \brief Bulk request size limit. 
+ *
+ * Default maximum number of operand words of a vector request (option -v).
+ */
+#define VSLD_BULK_WORDS			(1 << 18)
+
+/** \brief Maximum bulk request size. 
+ *
+ * Upper limit for option -v.
+ */
+#define VSLD_BULK_WORDS_MAX		(1 << 24)
+
+/** \brief Concurrent bulk requests. 
+ *
+ * Number of vector requests each worker reassembles at the same time. Results are kept
+ * with their request until its job is needed again, for clients missing fragments.
+ */
+#define VSLD_BULK_JOBS			4
+
+/** \brief Fragment lifetime. 
+ *
+ * Milliseconds a partly received vector request waits for its next fragment.
+ */
+#define VSLD_BULK_LIFETIME_MS		1000
+
+/** \brief Socket receive buffer for vector requests. 
+ *
+ * Requested receive buffer size in bytes of sockets accepting vector requests, it has
+ * to take the fragments of a request arriving back to back. The system may grant less.
+ */
+#define VSLD_BULK_RCVBUF		(4 << 20)
+
+/** \brief Result stream wait. 
+ *
+ * Milliseconds the result stream waits for room in the socket send buffer before the
+ * remaining fragments are dropped.
+ */
+#define VSLD_STREAM_WAIT_MS		100
+
+/** \brief Aggregation streams. 
+ *
+ * Default number of aggregation streams each worker serves at the same time (option -s).
+ */
+#define VSLD_AGG_STREAMS		16
+
+/** \brief Maximum number of aggregation streams. 
+ *
+ * Upper limit for option -s.
+ */
+#define VSLD_AGG_STREAMS_MAX		4096
+
+/** \brief Aggregation stream lifetime. 
+ *
+ * Milliseconds a stream waits for its next packet, also the time a closed stream keeps
+ * its result for repeated close requests.
+ */
+#define VSLD_AGG_LIFETIME_MS		10000
+
+/** \brief Scrambler backlog.
+ *
+ * Words queued for the FPGA's scrambler, of all workers, beyond which a worker
+ * scrambles in software rather than queue more.
+ */
+#define VSLD_SCRAMBLE_BACKLOG		(4 * FPGA_BLOCK_WORDS)
+
+/** \brief Deferred requests.
+ *
+ * Number of requests a worker of the epoll or io_uring backend may have waiting for the
+ * scrambler, see struct vsld_deferred. Every one has a job at least.
+ */
+#define VSLD_DEFERRED			FPGA_HANDLE_JOBS
+
+
+// I/O backends
+/** \brief Blocking receive loop on one socket with SIGALRM or socket timeout. */
+#define VSLD_IO_CLASSIC			0
+/** \brief epoll reactor over all sockets with a timerfd idle timer. */
+#define VSLD_IO_EPOLL			1
+/** \brief io_uring with multishot receive into provided buffers. */
+#define VSLD_IO_URING			2
+
+/** \brief io_uring submission ring size. */
+#define VSLD_URING_ENTRIES		512
+/** \brief Number of provided receive buffers per worker, a power of two. */
+#define VSLD_URING_BUFFERS		256
+/** \brief Number of replies a worker may have in flight. */
+#define VSLD_URING_SENDS		256
+/** \brief Receives a socket may queue again in a row without getting a datagram. */
+#define VSLD_URING_REQUEUES		16
+
+
+// optional features
+/** \brief Batched socket I/O. 
+ *
+ * recvmmsg()/sendmmsg() are available on Linux hosts with glibc, the uClinux toolchain
+ * of the lab boards doesn't provide them.
+ */
+#if defined(__linux__) && !defined(__UCLIBC__) && defined(MSG_WAITFORONE)
+#define VSLD_HAVE_MMSG
+#endif
+
+/** \brief epoll reactor. 
+ *
+ * epoll and timerfd are Linux specific and missing in the uClinux C library.
+ */
+#if defined(__linux__) && !defined(__UCLIBC__) && defined(TOL_HAVE_TIMERFD)
+#define VSLD_HAVE_EPOLL
+#define VSLD_IO_DEFAULT			VSLD_IO_EPOLL
+#else
+#define VSLD_IO_DEFAULT			VSLD_IO_CLASSIC
+#endif
+
+/** \brief io_uring backend. 
+ *
+ * Needs the raw io_uring interface, see uringlib/uring.h.
+ */
+#if defined URING_AVAILABLE && defined VSLD_HAVE_EPOLL
+#define VSLD_HAVE_IO_URING
+#endif
+
+/** \brief CPU pinning. 
+ *
+ * pthread_setaffinity_np() is a glibc extension.
+ */
+#if defined(__linux__) && !defined(__UCLIBC__)
+#define VSLD_HAVE_AFFINITY
+#endif
+
 
 // error codes
 /** \brief Socket error. 
@@ -43,5 +253,185 @@
  */
 #define EBIND				2
 
+/** \brief Argument error. 
+ *
+ * Invalid command line arguments.
+ */
+#define EARGS				3
+
+/** \brief Memory error. 
+ *
+ * Not enough memory to start the daemon.
+ */
+#define ENOMEMORY			4
+
+/** \brief Registration error. 
+ *
+ * A function id is out of range or registered twice.
+ */
+#define EREGISTER			5
+
+/** \brief Backend error. 
+ *
+ * A worker with several sockets lost its reactor.
+ */
+#define EBACKEND			6
+
+
+// daemon structures
+struct vsld_prog;
+
+/**
+ *	\brief A request whose reply waits for the scrambler
+ *
+ *	The epoll and io_uring loops offer a free one to every request they serve (\a defer
+ *	of struct vsld_worker). A function queueing jobs for the request instead of waiting
+ *	for them sets their user to it and counts them in \a uJobs; it is answered by
+ *	vsld_resume() once the last one is back. The function's operands and results stay
+ *	here meanwhile, those of vector requests in their reassembly job.
+ */
+struct vsld_deferred {
+	int iType;				/**< \brief PL_PTYPE_REQ, PL_PTYPE_BREQ or PL_PTYPE_VREQ, zero if free. */
+	unsigned int uJobs;			/**< \brief Jobs not back yet. */
+	int iSocket;				/**< \brief The socket the request came from. */
+	struct sockaddr_storage remote;		/**< \brief The sender. */
+	unsigned int uRequestId;		/**< \brief Request ID of the reply cache, zero if not cached. */
+	struct pl_data data;			/**< \brief A single request, still unanswered. */
+	int iSndLen;				/**< \brief Size of its reply. */
+	struct pl_batch batch;			/**< \brief A batch request, answered but for the deferred runs. */
+	unsigned int run[PL_BATCH_MAX_ENTRIES];	/**< \brief Length of the deferred run starting at an entry, or zero. */
+	unsigned int op1[PL_BATCH_MAX_ENTRIES];	/**< \brief Operands of a single request, first operands of a run. */
+	unsigned int op2[PL_BATCH_MAX_ENTRIES];	/**< \brief Second operands of a run. */
+	unsigned int result[PL_BATCH_MAX_ENTRIES];	/**< \brief Results, of the entries of a run. */
+	unsigned int error[PL_BATCH_MAX_ENTRIES];	/**< \brief Errors of the entries of a run. */
+	struct pl_vector hdr;			/**< \brief Header of the last fragment of a vector request. */
+	struct ra_job *job;			/**< \brief Reassembly job of the vector request, released on reply. */
+	unsigned int uResults;			/**< \brief Number of results of the vector request. */
+	struct fpga_job jobs[FPGA_HANDLE_JOBS];	/**< \brief The scrambler's jobs, see vsld_scramble.c. */
+};
+
+/**
+ *	\brief Worker description
+ *
+ *	Every worker owns its sockets and its packet buffers (the latter live on the stack 
+ *	or heap of its loop), so workers share nothing on the packet path.
+ */
+struct vsld_worker {
+	int iId;				/**< \brief Worker number. */
+	int iSocket[VSLD_MAX_SOCKETS];		/**< \brief The worker's own server sockets. */
+	int iSocketCount;			/**< \brief Number of sockets in \a iSocket. */
+	int iCpu;				/**< \brief CPU the worker is pinned to, -1 for none. */
+	int iBackend;				/**< \brief I/O backend, one of VSLD_IO_XXX. */
+	int iMsgCount;				/**< \brief Datagrams per system call. */
+	int iSockTimeout;			/**< \brief Idle timeout via SO_RCVTIMEO instead of SIGALRM. */
+	unsigned int uCacheEntries;		/**< \brief Reply cache size, zero for none. */
+	unsigned long ulCacheLifetime;		/**< \brief Milliseconds replies are cached. */
+	struct rc_cache cache;			/**< \brief Replies to recent requests. */
+	struct fdiv_cache divisors;		/**< \brief Magic numbers of recent divisors. */
+	unsigned int uResultEntries;		/**< \brief Result cache size, zero for none. */
+	struct res_cache results;		/**< \brief Results of pure functions. */
+	struct vsld_prog *prog;			/**< \brief Scratch space of program requests, see vsld_prog.c. */
+	unsigned int uBulkWords;		/**< \brief Operand words of a vector request, zero for none. */
+	struct ra_table fragments;		/**< \brief Vector requests being reassembled. */
+	unsigned int *bulk[VSLD_BULK_JOBS];	/**< \brief Results of each job of \a fragments. */
+	unsigned int uBulkSize[VSLD_BULK_JOBS];	/**< \brief Number of words at \a bulk. */
+	unsigned int uStreams;			/**< \brief Number of aggregation streams, zero for none. */
+	struct ag_table streams;		/**< \brief Aggregation streams. */
+	struct lfsr_tables scrambler;		/**< \brief Software scrambler, see vsld_scramble.c. */
+	struct fpga_handle fpga;		/**< \brief The worker's handle on the FPGA's scrambler. */
+	struct vsld_deferred *deferred;		/**< \brief VSLD_DEFERRED requests, NULL in loops that wait. */
+	struct vsld_deferred *defer;		/**< \brief Offered to the request being served, NULL if it can't wait. */
+	unsigned long ulReported;		/**< \brief Cache lookups at the last vsld_report(). */
+	pthread_t thread;			/**< \brief The worker thread. */
+};
+
+/**
+ *	\brief Function handler
+ *	\param worker	The worker executing the request, for per-worker state
+ *	\param op	The operands, PL_OPERAND_COUNT of them, zero beyond the arity
+ *	\param result	Receives the result
+ *	\return		Zero if successful, a PL_ERR_XXX code otherwise
+ */
+typedef unsigned int (*vsld_handler)(struct vsld_worker *worker, unsigned int *op, unsigned int *result);
+
+/**
+ *	\brief Batch kernel
+ *	\param worker	The worker executing the request
+ *	\param op1	First operands
+ *	\param op2	Second operands, zero for functions of arity one
+ *	\param result	Receives the results, zero where an entry failed
+ *	\param error	Receives zero or the PL_ERR_XXX code of each entry
+ *	\param n	Number of entries
+ */
+typedef void (*vsld_batch)(struct vsld_worker *worker, const unsigned int *op1, const unsigned int *op2,
+			   unsigned int *result, unsigned int *error, unsigned int n);
+
+/**
+ *	\brief Handler of requests with payload
+ *	\param worker	The worker executing the request
+ *	\param op	The operands, PL_OPERAND_COUNT of them, zero beyond the arity
+ *	\param payload	The bytes following the request ID
+ *	\param len	Number of bytes in \a payload
+ *	\param result	Receives the result
+ *	\param detail	Receives operand 1 of the reply
+ *	\return		Zero if successful, a PL_ERR_XXX code otherwise
+ */
+typedef unsigned int (*vsld_payload)(struct vsld_worker *worker, unsigned int *op, const unsigned char *payload,
+				     unsigned int len, unsigned int *result, unsigned int *detail);
+
+/**
+ *	\brief Bulk kernel
+ *	\param worker	The worker executing the request
+ *	\param dim	PL_VEC_DIMS dimensions, checked by pl_vector_size()
+ *	\param a	Elements of operand A
+ *	\param b	Elements of operand B
+ *	\param result	Receives the results
+ *	\return		Zero if successful, a PL_ERR_XXX code otherwise
+ */
+typedef unsigned int (*vsld_bulk)(struct vsld_worker *worker, const unsigned int *dim, const unsigned int *a,
+				  const unsigned int *b, unsigned int *result);
+
+/**
+ *	\brief Typed kernel
+ *	\param worker	The worker executing the request
+ *	\param op1	First operands, an array of the kernel's operand type
+ *	\param op2	Second operands, zero for functions of arity one
+ *	\param result	Receives the results, zero where an entry failed
+ *	\param error	Receives zero or the PL_ERR_XXX code of each entry
+ *	\param n	Number of entries
+ */
+typedef void (*vsld_typed)(struct vsld_worker *worker, const void *op1, const void *op2, void *result,
+			   unsigned int *error, unsigned int n);
+
+/**
+ *	\brief A function served by the daemon
+ *
+ *	Registered by its module at startup with vsld_register().
+ */
+struct vsld_function {
+	const char *name;			/**< \brief Name for trace output. */
+	vsld_handler handler;			/**< \brief Executes one request. */
+	vsld_batch batch;			/**< \brief Executes many requests, NULL if there is no kernel. */
+	unsigned int uArity;			/**< \brief Number of operands used. */
+	int iPure;				/**< \brief Set if the result only depends on the operands. */
+	char cStatus;				/**< \brief Display status after success, errors show 'E'. */
+	vsld_payload payload;			/**< \brief Executes requests with payload, NULL if there are none. */
+	vsld_bulk bulk;				/**< \brief Executes vector requests, NULL if there are none. */
+	const vsld_typed *typed;		/**< \brief Typed kernels indexed by PL_OTYPE_XXX, NULL if there are none. */
+};
+
+int vsld_register(unsigned int fid, const struct vsld_function *func);
+
+// function modules
+int vsld_arith_register(void);
+int vsld_prog_register(void);
+int vsld_vector_register(void);
+int vsld_scramble_register(const char *device);
+void vsld_scramble_close(void);
+struct vsld_deferred *vsld_scramble_done(struct vsld_worker *worker, int iWait);
+
+// aggregation streams, see vsld_aggregate.c
+int vsld_aggregate_serve(struct vsld_worker *worker, struct sockaddr *remote, char *rcvpacket, int iRcvLen, char *sndpacket);
+
 
 #endif //#define _vslabd_h_
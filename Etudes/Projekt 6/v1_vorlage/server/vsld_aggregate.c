@@ -0,0 +1,143 @@
+/**
+ *	\file vsld_aggregate.c
+ *	\brief The VSLab daemon: aggregation streams
+ *	\version 1.0
+ *
+ *	Count, sum, minimum, maximum and histogram of values streamed in any number of
+ *	chunks (PL_FID_AGGREGATE). The protocol is described in packetlib.h; the streams
+ *	are kept in the worker's aggregation table, see aggr.c.
+ */
+#include "includes.h"
+
+#if AG_WINDOW < PL_STREAM_WINDOW
+#error "aggregation window smaller than the protocol's window"
+#endif
+
+/**
+ *	\ingroup vslabdaemon
+ *	\defgroup vsld_aggregate Aggregation streams
+ *	\{
+ */
+
+/**
+ *	\brief Build the acknowledgment of a stream packet
+ *	\param hdr	Header of the packet, turned into the acknowledgment's header
+ *	\param stream	The stream
+ *	\param sndpacket	A buffer of PL_MAX_DATAGRAM bytes for the reply
+ *	\return		Number of reply bytes
+ */
+static int vsld_aggregate_ack(struct pl_stream *hdr, struct ag_stream *stream, char *sndpacket)
+{
+	hdr->type = PL_PTYPE_SACK;
+	hdr->mode = PL_MODE_SRV;
+	hdr->seq = stream->uBase;
+	hdr->count = PL_STREAM_WINDOW / 32;
+	pl_make_stream(hdr, stream->map, sndpacket, PL_MAX_DATAGRAM);
+	return PL_STREAM_PACKETSIZE(hdr->count);
+}
+
+/**
+ *	\brief Build the result of a closed stream
+ *	\param hdr	Header of the close request, turned into the result's header
+ *	\param stream	The stream
+ *	\param sndpacket	A buffer of PL_MAX_DATAGRAM bytes for the reply
+ *	\return		Number of reply bytes
+ */
+static int vsld_aggregate_result(struct pl_stream *hdr, struct ag_stream *stream, char *sndpacket)
+{
+	struct pl_aggregate agg;
+	unsigned int words[PL_STREAM_WORDS];
+
+	agg.count = stream->ullCount;
+	agg.sum = stream->llSum;
+	agg.min = stream->iMin;
+	agg.max = stream->iMax;
+	agg.lo = stream->iLo;
+	agg.width = stream->uWidth;
+	agg.buckets = stream->uBuckets;
+	agg.below = stream->ullBelow;
+	agg.above = stream->ullAbove;
+	memcpy(agg.hist, stream->hist, stream->uBuckets * sizeof(unsigned long long));
+
+	hdr->type = PL_PTYPE_SRSP;
+	hdr->mode = PL_MODE_SRV;
+	hdr->count = pl_pack_aggregate(&agg, words);
+	pl_make_stream(hdr, words, sndpacket, PL_MAX_DATAGRAM);
+	return PL_STREAM_PACKETSIZE(hdr->count);
+}
+
+/**
+ *	\brief Answer a stream packet
+ *	\param worker	The worker that received the packet
+ *	\param remote	The sender
+ *	\param rcvpacket	The packet
+ *	\param iRcvLen		Its length
+ *	\param sndpacket	A buffer of PL_MAX_DATAGRAM bytes for the reply
+ *	\return			Number of reply bytes in \a sndpacket, zero if there is nothing
+ *				to send
+ *
+ *	Chunks are folded into their stream as they arrive; only the last chunk of a window
+ *	and the one completing it are acknowledged, see packetlib.h. A close request whose
+ *	chunks all arrived gets the result, otherwise an acknowledgment telling which are
+ *	missing. Everything else that can't be served gets an error packet.
+ */
+int vsld_aggregate_serve(struct vsld_worker *worker, struct sockaddr *remote, char *rcvpacket, int iRcvLen, char *sndpacket)
+{
+	struct pl_stream hdr;
+	struct pl_data vsld_data;
+	struct ag_stream *stream = NULL;
+	unsigned int uError = 0, words[PL_STREAM_WORDS];
+	unsigned long ulNow = rc_now();
+	int iReturn = 0;
+
+	memset(&hdr, 0x00, sizeof(hdr));
+	memset(&vsld_data, 0x00, sizeof(vsld_data));
+
+	if (pl_extr_stream(rcvpacket, &hdr, words, iRcvLen) < 0) uError = PL_ERR_GENERALERROR;
+	else if (hdr.mode != PL_MODE_CLN) uError = PL_ERR_INVALIDMODE;
+	else if ((hdr.function_id != PL_FID_AGGREGATE) || (worker->streams.streams == NULL)) uError = PL_ERR_NOSUCHFUNCTION;
+	else if (hdr.type == PL_PTYPE_SOPEN) {
+		if (hdr.count != PL_STREAM_OPEN_WORDS) uError = PL_ERR_INVALIDSHAPE;
+		else {
+			iReturn = ag_open(&worker->streams, remote, hdr.stream_id, (int)words[0], words[1], words[2], ulNow, &stream);
+			if (iReturn == -EAG_INVALID) uError = PL_ERR_INVALIDSHAPE;
+			else if (iReturn < 0) uError = PL_ERR_BUSY;
+			else {
+				BL_LOG(BL_DEBUG, "vslabd: Opened stream %u with %u buckets.\n", hdr.stream_id, words[2]);
+				return vsld_aggregate_ack(&hdr, stream, sndpacket);
+			}
+		}
+	}
+	else if ((hdr.type != PL_PTYPE_SDATA) && (hdr.type != PL_PTYPE_SCLOSE)) uError = PL_ERR_INVALIDTYPE;
+	else if ((stream = ag_find(&worker->streams, remote, hdr.stream_id, ulNow)) == NULL) uError = PL_ERR_NOSUCHSTREAM;
+	else if (hdr.type == PL_PTYPE_SDATA) {
+		if (stream->iDone) return vsld_aggregate_ack(&hdr, stream, sndpacket);
+		iReturn = ag_add(&worker->streams, stream, hdr.seq, words, hdr.count, ulNow);
+		if ((hdr.seq + 1 == hdr.end) || (iReturn < 0) || ((iReturn > 0) && ((int)(stream->uBase - hdr.end) >= 0)))
+			return vsld_aggregate_ack(&hdr, stream, sndpacket);
+		return 0;
+	}
+	// a close request
+	else if (stream->iDone || (stream->uBase == hdr.seq)) {
+		if (!stream->iDone) {
+			ag_close(&worker->streams, stream);
+			BL_LOG(BL_DEBUG, "vslabd: Closed stream %u after %llu values.\n", hdr.stream_id, stream->ullCount);
+			sevenseg_setch('9');
+		}
+		return vsld_aggregate_result(&hdr, stream, sndpacket);
+	}
+	else if ((int)(stream->uBase - hdr.seq) < 0) return vsld_aggregate_ack(&hdr, stream, sndpacket);
+	else uError = PL_ERR_INVALIDSHAPE;
+
+	// the error goes back as single packet, it carries the request ID like any reply
+	PLM_FUNCTION_ID(vsld_data) = hdr.function_id;
+	PLM_REQUEST_ID(vsld_data) = hdr.request_id;
+	pl_create_error(&vsld_data, uError);
+	sevenseg_setch('E');
+	pl_make_packet(&vsld_data, sndpacket, PL_PACKETSIZE);
+	return PL_PACKETSIZE;
+}
+
+/**
+ *	\}
+ */
@@ -0,0 +1,193 @@
+/**
+ *	\file vsld_arith.c
+ *	\brief The VSLab daemon: arithmetic functions
+ *	\version 1.0
+ *
+ *	Multiplication (PL_FID_MUL) and division (PL_FID_DIV) of two unsigned operands, with
+ *	the vector kernels of kernellib for batch requests, and of typed operands in typed
+ *	requests. Integer division of typed operands is signed and fails for a zero divisor
+ *	or an overflowing quotient; floating point division follows IEEE 754, dividing by
+ *	zero gives an infinity or NaN.
+ */
+#include "includes.h"
+
+/**
+ *	\ingroup vslabdaemon
+ *	\defgroup vsld_arith Arithmetic functions
+ *	\{
+ */
+
+/**
+ *	\brief Multiply operands 0 and 1
+ */
+static unsigned int vsld_mul(struct vsld_worker *worker, unsigned int *op, unsigned int *result)
+{
+	*result = op[0] * op[1];
+	return 0;
+}
+
+/**
+ *	\brief Divide operand 0 by operand 1
+ *
+ *	Repeated divisors are divided by multiplication, see fastdiv.c.
+ */
+static unsigned int vsld_div(struct vsld_worker *worker, unsigned int *op, unsigned int *result)
+{
+	// check if divisor is 0
+	if (op[1] == 0) return PL_ERR_FUNCEXECERROR;
+	*result = fdiv_divide(&worker->divisors, op[0], op[1]);
+	return 0;
+}
+
+/**
+ *	\brief Multiply many operand pairs
+ */
+static void vsld_mul_batch(struct vsld_worker *worker, const unsigned int *op1, const unsigned int *op2,
+			   unsigned int *result, unsigned int *error, unsigned int n)
+{
+	krn.mul(op1, op2, result, n);
+	memset(error, 0x00, n * sizeof(unsigned int));
+}
+
+/**
+ *	\brief Divide many operand pairs
+ *
+ *	Zero divisors come back from the kernel as mask, which turns into the error code
+ *	without a branch. Without a vector divide kernel the quotients come from the
+ *	worker's divisor cache.
+ */
+static void vsld_div_batch(struct vsld_worker *worker, const unsigned int *op1, const unsigned int *op2,
+			   unsigned int *result, unsigned int *error, unsigned int n)
+{
+	unsigned int i;
+
+	if (krn.iDivVector) krn.div(op1, op2, result, error, n);
+	else {
+		for (i = 0; i < n; i++) {
+			error[i] = -(op2[i] == 0);
+			result[i] = error[i] ? 0 : fdiv_divide(&worker->divisors, op1[i], op2[i]);
+		}
+	}
+	for (i = 0; i < n; i++) error[i] &= PL_ERR_FUNCEXECERROR;
+}
+
+/**
+ *	\brief Multiply int32 operands
+ *
+ *	The low 32 bits of a product are the same for signed and unsigned operands.
+ */
+static void vsld_mul_i32(struct vsld_worker *worker, const void *op1, const void *op2, void *result,
+			 unsigned int *error, unsigned int n)
+{
+	krn.mul((const unsigned int *)op1, (const unsigned int *)op2, (unsigned int *)result, n);
+	memset(error, 0x00, n * sizeof(unsigned int));
+}
+
+/**
+ *	\brief Multiply int64 operands
+ */
+static void vsld_mul_i64(struct vsld_worker *worker, const void *op1, const void *op2, void *result,
+			 unsigned int *error, unsigned int n)
+{
+	krn.mul64((const long long *)op1, (const long long *)op2, (long long *)result, n);
+	memset(error, 0x00, n * sizeof(unsigned int));
+}
+
+/**
+ *	\brief Multiply float32 operands
+ */
+static void vsld_mul_f32(struct vsld_worker *worker, const void *op1, const void *op2, void *result,
+			 unsigned int *error, unsigned int n)
+{
+	krn.mulf((const float *)op1, (const float *)op2, (float *)result, n);
+	memset(error, 0x00, n * sizeof(unsigned int));
+}
+
+/**
+ *	\brief Multiply float64 operands
+ */
+static void vsld_mul_f64(struct vsld_worker *worker, const void *op1, const void *op2, void *result,
+			 unsigned int *error, unsigned int n)
+{
+	krn.muld((const double *)op1, (const double *)op2, (double *)result, n);
+	memset(error, 0x00, n * sizeof(unsigned int));
+}
+
+/**
+ *	\brief Divide int32 operands
+ *
+ *	No vector unit divides integers and doubles only help unsigned ones, so this stays
+ *	scalar.
+ */
+static void vsld_div_i32(struct vsld_worker *worker, const void *op1, const void *op2, void *result,
+			 unsigned int *error, unsigned int n)
+{
+	const int *a = op1, *b = op2;
+	int *r = result;
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		error[i] = ((b[i] == 0) || ((a[i] == INT_MIN) && (b[i] == -1))) ? PL_ERR_FUNCEXECERROR : 0;
+		r[i] = error[i] ? 0 : a[i] / b[i];
+	}
+}
+
+/**
+ *	\brief Divide int64 operands
+ */
+static void vsld_div_i64(struct vsld_worker *worker, const void *op1, const void *op2, void *result,
+			 unsigned int *error, unsigned int n)
+{
+	const long long *a = op1, *b = op2;
+	long long *r = result;
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		error[i] = ((b[i] == 0) || ((a[i] == LLONG_MIN) && (b[i] == -1))) ? PL_ERR_FUNCEXECERROR : 0;
+		r[i] = error[i] ? 0 : a[i] / b[i];
+	}
+}
+
+/**
+ *	\brief Divide float32 operands
+ */
+static void vsld_div_f32(struct vsld_worker *worker, const void *op1, const void *op2, void *result,
+			 unsigned int *error, unsigned int n)
+{
+	krn.divf((const float *)op1, (const float *)op2, (float *)result, n);
+	memset(error, 0x00, n * sizeof(unsigned int));
+}
+
+/**
+ *	\brief Divide float64 operands
+ */
+static void vsld_div_f64(struct vsld_worker *worker, const void *op1, const void *op2, void *result,
+			 unsigned int *error, unsigned int n)
+{
+	krn.divd((const double *)op1, (const double *)op2, (double *)result, n);
+	memset(error, 0x00, n * sizeof(unsigned int));
+}
+
+/**
+ *	\brief Register the arithmetic functions
+ *	\return		Zero if successful, an error code otherwise
+ *
+ *	Also picks the vector kernels for this CPU.
+ */
+int vsld_arith_register(void)
+{
+	static const vsld_typed mul_typed[PL_OTYPE_COUNT] = { NULL, vsld_mul_i32, vsld_mul_i64, vsld_mul_f32, vsld_mul_f64 };
+	static const vsld_typed div_typed[PL_OTYPE_COUNT] = { NULL, vsld_div_i32, vsld_div_i64, vsld_div_f32, vsld_div_f64 };
+	static const struct vsld_function mul = { "mul", vsld_mul, vsld_mul_batch, 2, 1, '1', NULL, NULL, mul_typed };
+	static const struct vsld_function div = { "div", vsld_div, vsld_div_batch, 2, 1, '2', NULL, NULL, div_typed };
+
+	krn_init();
+	printf("vslabd: Using %s kernels for batch requests.\n", krn.name);
+
+	if (vsld_register(PL_FID_MUL, &mul) < 0) return -EREGISTER;
+	return vsld_register(PL_FID_DIV, &div);
+}
+
+/**
+ *	\}
+ */
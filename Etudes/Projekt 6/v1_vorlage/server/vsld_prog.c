@@ -0,0 +1,402 @@
+/**
+ *	\file vsld_prog.c
+ *	\brief The VSLab daemon: programs
+ *	\version 1.0
+ *
+ *	\par Overview
+ *	A program request (PL_FID_PROGRAM) carries a small stack machine program behind its
+ *	operands, see PL_OP_XXX in packetlib.h, so a client can have a whole expression
+ *	computed in one round trip instead of one request per operation.
+ *
+ *	\par Execution
+ *	The code is checked and translated once per request: every instruction is decoded
+ *	into a struct vsld_insn with its immediate and jump target resolved, and the stack
+ *	depth at every reachable instruction is computed like a class file verifier does.
+ *	Programs that could underflow or overflow the stack, jump into an immediate or
+ *	reach an instruction with differing depths are rejected before they run, so the
+ *	interpreter loop only checks the instruction budget and the divisors.
+ *
+ *	With GCC the interpreter is threaded: every instruction ends with a jump through a
+ *	table of label addresses to its successor's code, which gives each instruction its
+ *	own branch prediction instead of one shared switch. Other compilers get the switch.
+ */
+#include "includes.h"
+
+/**
+ *	\ingroup vslabdaemon
+ *	\defgroup vsld_prog Programs
+ *	\{
+ */
+
+#if defined __GNUC__
+#define VSLD_PROG_THREADED
+#endif
+
+// instructions after decoding, both pushes become VP_PUSH
+#define VP_HALT		0
+#define VP_PUSH		1
+#define VP_LOAD		2
+#define VP_STORE	3
+#define VP_DUP		4
+#define VP_DROP		5
+#define VP_SWAP		6
+#define VP_OVER		7
+#define VP_ADD		8
+#define VP_SUB		9
+#define VP_MUL		10
+#define VP_DIV		11
+#define VP_MOD		12
+#define VP_AND		13
+#define VP_OR		14
+#define VP_XOR		15
+#define VP_SHL		16
+#define VP_SHR		17
+#define VP_LT		18
+#define VP_EQ		19
+#define VP_JMP		20
+#define VP_JZ		21
+#define VP_JNZ		22
+#define VP_COUNT	23
+
+/** \brief No instruction starts at this code offset. */
+#define VP_NONE		0xffff
+
+/**
+ *	\brief Encoding of an opcode
+ */
+struct vsld_opcode {
+	unsigned char uLen;		/**< \brief Size including the immediate, zero for invalid opcodes. */
+	unsigned char uOp;		/**< \brief Decoded instruction, VP_XXX. */
+};
+
+/**
+ *	\brief Stack effect of a decoded instruction
+ */
+struct vsld_effect {
+	unsigned char uPop;		/**< \brief Values taken from the stack. */
+	unsigned char uPush;		/**< \brief Values put on the stack. */
+};
+
+/**
+ *	\brief A decoded instruction
+ */
+struct vsld_insn {
+	unsigned int uOp;		/**< \brief VP_XXX. */
+	unsigned int uArg;		/**< \brief Immediate, register or index of the jump target. */
+	unsigned int uPc;		/**< \brief Code offset, reported with errors. */
+};
+
+/**
+ *	\brief Scratch space of the translation
+ *
+ *	Allocated once per worker, it is too big for the small thread stacks on the boards.
+ */
+struct vsld_prog {
+	struct vsld_insn insn[PL_PROG_MAX_CODE + 1];	/**< \brief The instructions and a final halt. */
+	unsigned short index[PL_PROG_MAX_CODE + 1];	/**< \brief Instruction at each code offset or VP_NONE. */
+	short depth[PL_PROG_MAX_CODE + 1];		/**< \brief Stack depth before each instruction, -1 if unreached. */
+	unsigned short work[PL_PROG_MAX_CODE + 1];	/**< \brief Instructions left to check. */
+};
+
+static const struct vsld_opcode vsld_opcodes[256] = {
+	[PL_OP_HALT] = { 1, VP_HALT },	[PL_OP_PUSH] = { 5, VP_PUSH },	[PL_OP_PUSHB] = { 2, VP_PUSH },
+	[PL_OP_LOAD] = { 2, VP_LOAD },	[PL_OP_STORE] = { 2, VP_STORE },
+	[PL_OP_DUP] = { 1, VP_DUP },	[PL_OP_DROP] = { 1, VP_DROP },	[PL_OP_SWAP] = { 1, VP_SWAP },
+	[PL_OP_OVER] = { 1, VP_OVER },
+	[PL_OP_ADD] = { 1, VP_ADD },	[PL_OP_SUB] = { 1, VP_SUB },	[PL_OP_MUL] = { 1, VP_MUL },
+	[PL_OP_DIV] = { 1, VP_DIV },	[PL_OP_MOD] = { 1, VP_MOD },	[PL_OP_AND] = { 1, VP_AND },
+	[PL_OP_OR] = { 1, VP_OR },	[PL_OP_XOR] = { 1, VP_XOR },	[PL_OP_SHL] = { 1, VP_SHL },
+	[PL_OP_SHR] = { 1, VP_SHR },	[PL_OP_LT] = { 1, VP_LT },	[PL_OP_EQ] = { 1, VP_EQ },
+	[PL_OP_JMP] = { 3, VP_JMP },	[PL_OP_JZ] = { 3, VP_JZ },	[PL_OP_JNZ] = { 3, VP_JNZ },
+};
+
+static const struct vsld_effect vsld_effects[VP_COUNT] = {
+	[VP_HALT] = { 0, 0 },	[VP_PUSH] = { 0, 1 },	[VP_LOAD] = { 0, 1 },	[VP_STORE] = { 1, 0 },
+	[VP_DUP] = { 1, 2 },	[VP_DROP] = { 1, 0 },	[VP_SWAP] = { 2, 2 },	[VP_OVER] = { 2, 3 },
+	[VP_ADD] = { 2, 1 },	[VP_SUB] = { 2, 1 },	[VP_MUL] = { 2, 1 },	[VP_DIV] = { 2, 1 },
+	[VP_MOD] = { 2, 1 },	[VP_AND] = { 2, 1 },	[VP_OR] = { 2, 1 },	[VP_XOR] = { 2, 1 },
+	[VP_SHL] = { 2, 1 },	[VP_SHR] = { 2, 1 },	[VP_LT] = { 2, 1 },	[VP_EQ] = { 2, 1 },
+	[VP_JMP] = { 0, 0 },	[VP_JZ] = { 1, 0 },	[VP_JNZ] = { 1, 0 },
+};
+
+/**
+ *	\brief Decode a program
+ *	\param prog	Scratch space, receives the instructions
+ *	\param code	The code
+ *	\param len	Size of the code, at most PL_PROG_MAX_CODE
+ *	\param pc	Receives the offset of the offending instruction on error
+ *	\return		Number of instructions including the final halt, zero on error
+ */
+static unsigned int vsld_prog_decode(struct vsld_prog *prog, const unsigned char *code, unsigned int len, unsigned int *pc)
+{
+	const struct vsld_opcode *opcode;
+	struct vsld_insn *insn;
+	unsigned int n = 0, uPos = 0, i;
+
+	memset(prog->index, 0xff, (len + 1) * sizeof(prog->index[0]));
+	for (uPos = 0; uPos < len; uPos += opcode->uLen) {
+		*pc = uPos;
+		opcode = &vsld_opcodes[code[uPos]];
+		if ((opcode->uLen == 0) || (uPos + opcode->uLen > len)) return 0;
+
+		insn = &prog->insn[n];
+		insn->uOp = opcode->uOp;
+		insn->uPc = uPos;
+		insn->uArg = 0;
+		for (i = 1; i < opcode->uLen; i++) insn->uArg = (insn->uArg << 8) | code[uPos + i];
+		if (((insn->uOp == VP_LOAD) || (insn->uOp == VP_STORE)) && (insn->uArg >= PL_PROG_REGISTERS)) return 0;
+		prog->index[uPos] = n++;
+	}
+	// running off the end halts
+	prog->index[len] = n;
+	prog->insn[n].uOp = VP_HALT;
+	prog->insn[n].uArg = 0;
+	prog->insn[n].uPc = len;
+	n++;
+
+	// jump targets become instruction indices
+	for (i = 0; i < n; i++) {
+		insn = &prog->insn[i];
+		if ((insn->uOp != VP_JMP) && (insn->uOp != VP_JZ) && (insn->uOp != VP_JNZ)) continue;
+		*pc = insn->uPc;
+		if ((insn->uArg > len) || (prog->index[insn->uArg] == VP_NONE)) return 0;
+		insn->uArg = prog->index[insn->uArg];
+	}
+	return n;
+}
+
+/**
+ *	\brief Check the stack depths of a decoded program
+ *	\param prog	Scratch space holding the instructions
+ *	\param n	Number of instructions
+ *	\param pc	Receives the offset of the offending instruction on error
+ *	\return		Zero if the stack stays within 0 and PL_PROG_STACK, -1 otherwise
+ *
+ *	Walks all paths from the first instruction; an instruction reached again must find
+ *	the depth it was first reached with.
+ */
+static int vsld_prog_verify(struct vsld_prog *prog, unsigned int n, unsigned int *pc)
+{
+	const struct vsld_effect *effect;
+	struct vsld_insn *insn;
+	unsigned int i, uNext[2], uCount, uWork = 0;
+	int iDepth;
+
+	memset(prog->depth, 0xff, n * sizeof(prog->depth[0]));
+	prog->depth[0] = 0;
+	prog->work[uWork++] = 0;
+	while (uWork > 0) {
+		i = prog->work[--uWork];
+		insn = &prog->insn[i];
+		effect = &vsld_effects[insn->uOp];
+		*pc = insn->uPc;
+		iDepth = prog->depth[i];
+		if (iDepth < effect->uPop) return -1;
+		iDepth += effect->uPush - effect->uPop;
+		if (iDepth > PL_PROG_STACK) return -1;
+
+		// successors: none after a halt, the target of a jump, the next instruction and
+		// the target of a conditional jump
+		uCount = 0;
+		if ((insn->uOp != VP_HALT) && (insn->uOp != VP_JMP)) uNext[uCount++] = i + 1;
+		if ((insn->uOp == VP_JMP) || (insn->uOp == VP_JZ) || (insn->uOp == VP_JNZ)) uNext[uCount++] = insn->uArg;
+		while (uCount > 0) {
+			i = uNext[--uCount];
+			if (prog->depth[i] < 0) {
+				prog->depth[i] = iDepth;
+				prog->work[uWork++] = i;
+			}
+			else if (prog->depth[i] != iDepth) return -1;
+		}
+	}
+	return 0;
+}
+
+#if defined VSLD_PROG_THREADED
+#define VP_CASE(x)	op_##x
+#define VP_NEXT		do { if (uBudget-- == 0) goto exhausted; goto *vsld_labels[ip->uOp]; } while (0)
+#else
+#define VP_CASE(x)	case x
+#define VP_NEXT		continue
+#endif
+
+/** \brief Pop b and a, push \a expr */
+#define VP_BINARY(expr)		b = *--sp; a = sp[-1]; sp[-1] = (expr); ip++; VP_NEXT
+
+/**
+ *	\brief Run a checked program
+ *	\param worker	The worker executing the request
+ *	\param prog	Scratch space holding the checked instructions
+ *	\param reg	The registers, PL_PROG_REGISTERS of them
+ *	\param result	Receives the result
+ *	\param detail	Receives the number of instructions executed, or the offset of the
+ *			failing instruction on error
+ *	\return		Zero if successful, a PL_ERR_XXX code otherwise
+ */
+static unsigned int vsld_prog_run(struct vsld_worker *worker, struct vsld_prog *prog, unsigned int *reg,
+				  unsigned int *result, unsigned int *detail)
+{
+	unsigned int stack[PL_PROG_STACK], *sp = stack, a, b, uBudget = VSLD_PROG_BUDGET;
+	const struct vsld_insn *ip = prog->insn;
+#if defined VSLD_PROG_THREADED
+	static const void *vsld_labels[VP_COUNT] = {
+		[VP_HALT] = &&op_VP_HALT,	[VP_PUSH] = &&op_VP_PUSH,	[VP_LOAD] = &&op_VP_LOAD,
+		[VP_STORE] = &&op_VP_STORE,	[VP_DUP] = &&op_VP_DUP,		[VP_DROP] = &&op_VP_DROP,
+		[VP_SWAP] = &&op_VP_SWAP,	[VP_OVER] = &&op_VP_OVER,	[VP_ADD] = &&op_VP_ADD,
+		[VP_SUB] = &&op_VP_SUB,		[VP_MUL] = &&op_VP_MUL,		[VP_DIV] = &&op_VP_DIV,
+		[VP_MOD] = &&op_VP_MOD,		[VP_AND] = &&op_VP_AND,		[VP_OR] = &&op_VP_OR,
+		[VP_XOR] = &&op_VP_XOR,		[VP_SHL] = &&op_VP_SHL,		[VP_SHR] = &&op_VP_SHR,
+		[VP_LT] = &&op_VP_LT,		[VP_EQ] = &&op_VP_EQ,		[VP_JMP] = &&op_VP_JMP,
+		[VP_JZ] = &&op_VP_JZ,		[VP_JNZ] = &&op_VP_JNZ,
+	};
+
+	VP_NEXT;
+#else
+	for (;;) {
+		if (uBudget-- == 0) goto exhausted;
+		switch (ip->uOp) {
+#endif
+	VP_CASE(VP_HALT):
+		*result = (sp > stack) ? sp[-1] : reg[0];
+		*detail = VSLD_PROG_BUDGET - uBudget;
+		return 0;
+	VP_CASE(VP_PUSH):
+		*sp++ = ip->uArg;
+		ip++;
+		VP_NEXT;
+	VP_CASE(VP_LOAD):
+		*sp++ = reg[ip->uArg];
+		ip++;
+		VP_NEXT;
+	VP_CASE(VP_STORE):
+		reg[ip->uArg] = *--sp;
+		ip++;
+		VP_NEXT;
+	VP_CASE(VP_DUP):
+		sp[0] = sp[-1];
+		sp++;
+		ip++;
+		VP_NEXT;
+	VP_CASE(VP_DROP):
+		sp--;
+		ip++;
+		VP_NEXT;
+	VP_CASE(VP_SWAP):
+		a = sp[-1];
+		sp[-1] = sp[-2];
+		sp[-2] = a;
+		ip++;
+		VP_NEXT;
+	VP_CASE(VP_OVER):
+		sp[0] = sp[-2];
+		sp++;
+		ip++;
+		VP_NEXT;
+	VP_CASE(VP_ADD):
+		VP_BINARY(a + b);
+	VP_CASE(VP_SUB):
+		VP_BINARY(a - b);
+	VP_CASE(VP_MUL):
+		VP_BINARY(a * b);
+	VP_CASE(VP_DIV):
+		if (sp[-1] == 0) goto failed;
+		b = *--sp;
+		sp[-1] = fdiv_divide(&worker->divisors, sp[-1], b);
+		ip++;
+		VP_NEXT;
+	VP_CASE(VP_MOD):
+		if (sp[-1] == 0) goto failed;
+		b = *--sp;
+		sp[-1] %= b;
+		ip++;
+		VP_NEXT;
+	VP_CASE(VP_AND):
+		VP_BINARY(a & b);
+	VP_CASE(VP_OR):
+		VP_BINARY(a | b);
+	VP_CASE(VP_XOR):
+		VP_BINARY(a ^ b);
+	VP_CASE(VP_SHL):
+		VP_BINARY(a << (b & 31));
+	VP_CASE(VP_SHR):
+		VP_BINARY(a >> (b & 31));
+	VP_CASE(VP_LT):
+		VP_BINARY(a < b);
+	VP_CASE(VP_EQ):
+		VP_BINARY(a == b);
+	VP_CASE(VP_JMP):
+		ip = &prog->insn[ip->uArg];
+		VP_NEXT;
+	VP_CASE(VP_JZ):
+		ip = (*--sp == 0) ? &prog->insn[ip->uArg] : ip + 1;
+		VP_NEXT;
+	VP_CASE(VP_JNZ):
+		ip = (*--sp != 0) ? &prog->insn[ip->uArg] : ip + 1;
+		VP_NEXT;
+#if !defined VSLD_PROG_THREADED
+		}
+	}
+#endif
+
+exhausted:
+	*detail = ip->uPc;
+	return PL_ERR_BUDGET;
+failed:
+	*detail = ip->uPc;
+	return PL_ERR_FUNCEXECERROR;
+}
+
+/**
+ *	\brief Check and run a program
+ *	\param worker	The worker executing the request
+ *	\param op	Initial values of registers 0 and 1
+ *	\param payload	The code
+ *	\param len	Size of the code
+ *	\param result	Receives the result
+ *	\param detail	Receives the number of instructions executed, or the offset of the
+ *			failing instruction on error
+ *	\return		Zero if successful, a PL_ERR_XXX code otherwise
+ */
+static unsigned int vsld_prog_code(struct vsld_worker *worker, unsigned int *op, const unsigned char *payload,
+				   unsigned int len, unsigned int *result, unsigned int *detail)
+{
+	unsigned int reg[PL_PROG_REGISTERS], n, i;
+
+	*detail = 0;
+	if (len > PL_PROG_MAX_CODE) return PL_ERR_INVALIDPROGRAM;
+	if (worker->prog == NULL) {
+		worker->prog = malloc(sizeof(struct vsld_prog));
+		if (worker->prog == NULL) return PL_ERR_GENERALERROR;
+	}
+	n = vsld_prog_decode(worker->prog, payload, len, detail);
+	if ((n == 0) || (vsld_prog_verify(worker->prog, n, detail) < 0)) return PL_ERR_INVALIDPROGRAM;
+
+	for (i = 0; i < PL_PROG_REGISTERS; i++) reg[i] = (i < PL_OPERAND_COUNT) ? op[i] : 0;
+	return vsld_prog_run(worker, worker->prog, reg, result, detail);
+}
+
+/**
+ *	\brief Run a program request without code
+ *
+ *	The empty program just halts, its result is operand 0.
+ */
+static unsigned int vsld_prog(struct vsld_worker *worker, unsigned int *op, unsigned int *result)
+{
+	*result = op[0];
+	return 0;
+}
+
+/**
+ *	\brief Register the program function
+ *	\return		Zero if successful, an error code otherwise
+ */
+int vsld_prog_register(void)
+{
+	static const struct vsld_function prog = { "program", vsld_prog, NULL, 2, 0, '3', vsld_prog_code };
+
+	return vsld_register(PL_FID_PROGRAM, &prog);
+}
+
+/**
+ *	\}
+ */
@@ -0,0 +1,239 @@
+/**
+ *	\file vsld_scramble.c
+ *	\brief The VSLab daemon: scrambling
+ *	\version 1.2
+ *
+ *	Scrambling (PL_FID_SCRAMBLE): operand 0 with the generator polynom in operand 1 for
+ *	single and batch requests, a vector of words with the polynom as only element of
+ *	operand B for vector requests. Runs of words go to the FPGA's scrambler as one
+ *	job each, through the worker's own handle with its own generator polynom; fpgalib's
+ *	device thread runs the jobs of all workers in turn, see FPGA_Submit(). A batch
+ *	request submits all its runs at once.
+ *
+ *	The epoll and io_uring loops don't wait for the jobs: they belong to the deferred
+ *	request the loop offered (struct vsld_deferred), which is answered when the loop
+ *	finds the last of them back through vsld_scramble_done(). Without a free deferred
+ *	request these loops scramble in software. The classic and mmsg loops offer none and
+ *	wait for the jobs of a request before they serve the next one.
+ *
+ *	While more than VSLD_SCRAMBLE_BACKLOG words wait for the scrambler, a worker
+ *	doesn't queue more but scrambles in software, see lfsr.c, with tables of its own
+ *	that are computed again when the polynom changes. The results are the same bit for
+ *	bit. Jobs the scrambler failed are scrambled in software as well, and without a
+ *	scrambler all of them are. Being the same either way, results of single requests
+ *	are kept in the worker's result cache like those of the arithmetic functions.
+ */
+#include "includes.h"
+
+/**
+ *	\ingroup vslabdaemon
+ *	\defgroup vsld_scramble Scrambling
+ *	\{
+ */
+
+/** \brief Nonzero if the scrambler was opened, set before the workers start. */
+static int iScrambler = 0;
+
+/**
+ *	\brief Scramble a block of words in software
+ *	\param worker	The worker, owning the software scrambler's tables
+ *	\param uPolynom	Generator polynom
+ *	\param in	Words to scramble
+ *	\param out	Receives the scrambled words
+ *	\param n	Number of words
+ */
+static void vsld_scramble_soft(struct vsld_worker *worker, unsigned int uPolynom, const unsigned int *in, unsigned int *out,
+			       unsigned int n)
+{
+	if (!worker->scrambler.uReady || (worker->scrambler.uPolynom != uPolynom)) lfsr_init(&worker->scrambler, uPolynom);
+	krn.lfsr(&worker->scrambler, in, out, n);
+}
+
+/**
+ *	\brief Queue a block of words for the scrambler
+ *	\param worker	The worker
+ *	\param job	The job
+ *	\param uPolynom	Generator polynom
+ *	\param in	Words to scramble
+ *	\param out	Receives the scrambled words
+ *	\param n	Number of words
+ *	\return		Zero if the job was queued, nonzero if the block is to be scrambled in
+ *			software
+ */
+static int vsld_scramble_submit(struct vsld_worker *worker, struct fpga_job *job, unsigned int uPolynom,
+				const unsigned int *in, unsigned int *out, unsigned int n)
+{
+	if (!iScrambler || (FPGA_Backlog() > VSLD_SCRAMBLE_BACKLOG)) return -1;
+	FPGA_SetHandlePolynom(&worker->fpga, (int)uPolynom);
+	return FPGA_Submit(&worker->fpga, job, (const int *)in, (int *)out, n);
+}
+
+/**
+ *	\brief Queue a block of words for the scrambler as a job of the deferred request
+ *	\param worker	The worker, offering a deferred request
+ *	\param uPolynom	Generator polynom
+ *	\param in	Words to scramble, kept in the deferred request or its reassembly job
+ *	\param out	Receives the scrambled words, likewise
+ *	\param n	Number of words
+ *	\return		Zero if the job was queued, nonzero if the block is to be scrambled in
+ *			software
+ */
+static int vsld_scramble_defer(struct vsld_worker *worker, unsigned int uPolynom, const unsigned int *in, unsigned int *out,
+			       unsigned int n)
+{
+	struct vsld_deferred *d = worker->defer;
+	struct fpga_job *job = NULL;
+
+	if (d->uJobs >= FPGA_HANDLE_JOBS) return -1;
+	job = &d->jobs[d->uJobs];
+	if (vsld_scramble_submit(worker, job, uPolynom, in, out, n) != 0) return -1;
+	job->user = d;
+	d->uJobs++;
+	return 0;
+}
+
+/**
+ *	\brief Wait for the worker's scramble jobs
+ *	\param worker	The worker, in a loop without deferred requests
+ *
+ *	Blocks the worker's loop until the scrambler is done, only the classic and mmsg loops
+ *	get here. Jobs the scrambler failed are scrambled in software.
+ */
+static void vsld_scramble_complete(struct vsld_worker *worker)
+{
+	struct fpga_job *job = NULL;
+
+	while ((job = FPGA_Complete(&worker->fpga, 1)) != NULL)
+		if (job->iResult < 0)
+			vsld_scramble_soft(worker, job->uPolynom, (const unsigned int *)job->in, (unsigned int *)job->out, job->n);
+}
+
+/**
+ *	\brief Scramble a block of words
+ *	\param worker	The worker
+ *	\param uPolynom	Generator polynom
+ *	\param in	Words to scramble
+ *	\param out	Receives the scrambled words, deferred if the worker offers a deferred
+ *			request
+ *	\param n	Number of words
+ *	\return		Zero
+ */
+static unsigned int vsld_scramble_block(struct vsld_worker *worker, unsigned int uPolynom, const unsigned int *in,
+					unsigned int *out, unsigned int n)
+{
+	struct fpga_job job;
+
+	if (worker->defer != NULL) {
+		if (vsld_scramble_defer(worker, uPolynom, in, out, n) != 0) vsld_scramble_soft(worker, uPolynom, in, out, n);
+	}
+	// a loop that defers doesn't wait, not even when it has no deferred request left
+	else if ((worker->deferred != NULL) || (vsld_scramble_submit(worker, &job, uPolynom, in, out, n) != 0))
+		vsld_scramble_soft(worker, uPolynom, in, out, n);
+	else vsld_scramble_complete(worker);
+	return 0;
+}
+
+/**
+ *	\brief Scramble operand 0 with generator polynom operand 1
+ */
+static unsigned int vsld_scramble(struct vsld_worker *worker, unsigned int *op, unsigned int *result)
+{
+	return vsld_scramble_block(worker, op[1], &op[0], result, 1);
+}
+
+/**
+ *	\brief Scramble many operands
+ *
+ *	Entries with the same polynom in a row go to the scrambler as one job. Runs beyond
+ *	FPGA_HANDLE_JOBS, or refused, are scrambled in software while the scrambler works
+ *	on the others. The errors are set at once, they are zero.
+ */
+static void vsld_scramble_batch(struct vsld_worker *worker, const unsigned int *op1, const unsigned int *op2,
+				unsigned int *result, unsigned int *error, unsigned int n)
+{
+	struct fpga_job jobs[FPGA_HANDLE_JOBS];
+	unsigned int i = 0, k = 0, uJobs = 0;
+
+	for (i = 0; i < n; i = k) {
+		for (k = i + 1; (k < n) && (op2[k] == op2[i]); k++);
+		if (worker->defer != NULL) {
+			if (vsld_scramble_defer(worker, op2[i], &op1[i], &result[i], k - i) == 0) continue;
+		}
+		else if ((worker->deferred == NULL) && (uJobs < FPGA_HANDLE_JOBS) &&
+			 (vsld_scramble_submit(worker, &jobs[uJobs], op2[i], &op1[i], &result[i], k - i) == 0)) {
+			uJobs++;
+			continue;
+		}
+		vsld_scramble_soft(worker, op2[i], &op1[i], &result[i], k - i);
+	}
+	if (uJobs > 0) vsld_scramble_complete(worker);
+	memset(error, 0x00, n * sizeof(unsigned int));
+}
+
+/**
+ *	\brief Scramble a vector of dim[0] words with generator polynom b[0]
+ */
+static unsigned int vsld_scramble_bulk(struct vsld_worker *worker, const unsigned int *dim, const unsigned int *a,
+				       const unsigned int *b, unsigned int *result)
+{
+	return vsld_scramble_block(worker, b[0], a, result, dim[0]);
+}
+
+/**
+ *	\brief Take back the jobs of deferred requests
+ *	\param worker	The worker
+ *	\param iWait	Nonzero to wait for the jobs still at the scrambler
+ *	\return		A deferred request whose last job just came back, NULL if no other job
+ *			is back (yet)
+ *
+ *	Called by the epoll and io_uring loops whenever the event of the worker's handle is
+ *	signalled, until it returns NULL, which resets the event. Jobs the scrambler failed
+ *	are scrambled in software.
+ */
+struct vsld_deferred *vsld_scramble_done(struct vsld_worker *worker, int iWait)
+{
+	struct fpga_job *job = NULL;
+	struct vsld_deferred *d = NULL;
+
+	while ((job = FPGA_Complete(&worker->fpga, iWait)) != NULL) {
+		if (job->iResult < 0)
+			vsld_scramble_soft(worker, job->uPolynom, (const unsigned int *)job->in, (unsigned int *)job->out, job->n);
+		d = (struct vsld_deferred *)job->user;
+		if (--d->uJobs == 0) return d;
+	}
+	return NULL;
+}
+
+/**
+ *	\brief Open the scrambler and register the scramble function
+ *	\param device	Device file of the scrambler, FPGA_STANDIN for fpgalib's stand-in
+ *	\return		Zero if successful, an error code otherwise
+ *
+ *	Without scrambler the function is served in software. Call after
+ *	vsld_arith_register(), which selects the kernels.
+ */
+int vsld_scramble_register(const char *device)
+{
+	static const struct vsld_function scramble = { "scramble", vsld_scramble, vsld_scramble_batch, 2, 1, 'A', NULL, vsld_scramble_bulk };
+
+	if (FPGA_OpenDevice(device) < 0) printf("vslabd: No scrambler at %s, scrambling in software (%s).\n", device, krn.lfsr_name);
+	else {
+		iScrambler = 1;
+		printf("vslabd: Scrambler at %s, scrambling in software (%s) while it is busy.\n", device, krn.lfsr_name);
+	}
+	return vsld_register(PL_FID_SCRAMBLE, &scramble);
+}
+
+/**
+ *	\brief Close the scrambler
+ *
+ *	Called after all workers have ended and closed their handles.
+ */
+void vsld_scramble_close(void)
+{
+	FPGA_Close();
+}
+
+/**
+ *	\}
+ */
@@ -0,0 +1,149 @@
+/**
+ *	\file vsld_vector.c
+ *	\brief The VSLab daemon: vector and matrix functions
+ *	\version 1.0
+ *
+ *	Element-wise sum, difference and product of two vectors (PL_FID_VADD, PL_FID_VSUB,
+ *	PL_FID_VMUL), their dot product (PL_FID_VDOT) and the product of two matrices
+ *	(PL_FID_MATMUL). The operands arrive as vector packets, see packetlib.h; a single
+ *	request computes the function for vectors and matrices of one element.
+ */
+#include "includes.h"
+
+/**
+ *	\ingroup vslabdaemon
+ *	\defgroup vsld_vector Vector and matrix functions
+ *	\{
+ */
+
+/**
+ *	\brief Add operands 0 and 1
+ */
+static unsigned int vsld_vadd(struct vsld_worker *worker, unsigned int *op, unsigned int *result)
+{
+	*result = op[0] + op[1];
+	return 0;
+}
+
+/**
+ *	\brief Subtract operand 1 from operand 0
+ */
+static unsigned int vsld_vsub(struct vsld_worker *worker, unsigned int *op, unsigned int *result)
+{
+	*result = op[0] - op[1];
+	return 0;
+}
+
+/**
+ *	\brief Multiply operands 0 and 1, the product, dot product and matrix product of one element
+ */
+static unsigned int vsld_vmul(struct vsld_worker *worker, unsigned int *op, unsigned int *result)
+{
+	*result = op[0] * op[1];
+	return 0;
+}
+
+/**
+ *	\brief Add many operand pairs
+ */
+static void vsld_vadd_batch(struct vsld_worker *worker, const unsigned int *op1, const unsigned int *op2,
+			    unsigned int *result, unsigned int *error, unsigned int n)
+{
+	krn.add(op1, op2, result, n);
+	memset(error, 0x00, n * sizeof(unsigned int));
+}
+
+/**
+ *	\brief Subtract many operand pairs
+ */
+static void vsld_vsub_batch(struct vsld_worker *worker, const unsigned int *op1, const unsigned int *op2,
+			    unsigned int *result, unsigned int *error, unsigned int n)
+{
+	krn.sub(op1, op2, result, n);
+	memset(error, 0x00, n * sizeof(unsigned int));
+}
+
+/**
+ *	\brief Multiply many operand pairs
+ */
+static void vsld_vmul_batch(struct vsld_worker *worker, const unsigned int *op1, const unsigned int *op2,
+			    unsigned int *result, unsigned int *error, unsigned int n)
+{
+	krn.mul(op1, op2, result, n);
+	memset(error, 0x00, n * sizeof(unsigned int));
+}
+
+/**
+ *	\brief Element-wise sum of two vectors of dim[0] elements
+ */
+static unsigned int vsld_vadd_bulk(struct vsld_worker *worker, const unsigned int *dim, const unsigned int *a,
+				   const unsigned int *b, unsigned int *result)
+{
+	krn.add(a, b, result, dim[0]);
+	return 0;
+}
+
+/**
+ *	\brief Element-wise difference of two vectors of dim[0] elements
+ */
+static unsigned int vsld_vsub_bulk(struct vsld_worker *worker, const unsigned int *dim, const unsigned int *a,
+				   const unsigned int *b, unsigned int *result)
+{
+	krn.sub(a, b, result, dim[0]);
+	return 0;
+}
+
+/**
+ *	\brief Element-wise product of two vectors of dim[0] elements
+ */
+static unsigned int vsld_vmul_bulk(struct vsld_worker *worker, const unsigned int *dim, const unsigned int *a,
+				   const unsigned int *b, unsigned int *result)
+{
+	krn.mul(a, b, result, dim[0]);
+	return 0;
+}
+
+/**
+ *	\brief Dot product of two vectors of dim[0] elements
+ */
+static unsigned int vsld_vdot_bulk(struct vsld_worker *worker, const unsigned int *dim, const unsigned int *a,
+				   const unsigned int *b, unsigned int *result)
+{
+	result[0] = krn.dot(a, b, dim[0]);
+	return 0;
+}
+
+/**
+ *	\brief Product of a dim[0] x dim[1] and a dim[1] x dim[2] matrix
+ *
+ *	Blocked so a block of B stays in the data cache, see krn_matmul().
+ */
+static unsigned int vsld_matmul_bulk(struct vsld_worker *worker, const unsigned int *dim, const unsigned int *a,
+				     const unsigned int *b, unsigned int *result)
+{
+	krn_matmul(a, b, result, dim[0], dim[1], dim[2]);
+	return 0;
+}
+
+/**
+ *	\brief Register the vector and matrix functions
+ *	\return		Zero if successful, an error code otherwise
+ *
+ *	The kernels are picked by vsld_arith_register(), which has to run first.
+ */
+int vsld_vector_register(void)
+{
+	static const struct vsld_function vadd = { "vadd", vsld_vadd, vsld_vadd_batch, 2, 1, '4', NULL, vsld_vadd_bulk };
+	static const struct vsld_function vsub = { "vsub", vsld_vsub, vsld_vsub_batch, 2, 1, '5', NULL, vsld_vsub_bulk };
+	static const struct vsld_function vmul = { "vmul", vsld_vmul, vsld_vmul_batch, 2, 1, '6', NULL, vsld_vmul_bulk };
+	static const struct vsld_function vdot = { "vdot", vsld_vmul, vsld_vmul_batch, 2, 1, '7', NULL, vsld_vdot_bulk };
+	static const struct vsld_function matmul = { "matmul", vsld_vmul, vsld_vmul_batch, 2, 1, '8', NULL, vsld_matmul_bulk };
+
+	if ((vsld_register(PL_FID_VADD, &vadd) < 0) || (vsld_register(PL_FID_VSUB, &vsub) < 0) ||
+	    (vsld_register(PL_FID_VMUL, &vmul) < 0) || (vsld_register(PL_FID_VDOT, &vdot) < 0)) return -EREGISTER;
+	return vsld_register(PL_FID_MATMUL, &matmul);
+}
+
+/**
+ *	\}
+ */
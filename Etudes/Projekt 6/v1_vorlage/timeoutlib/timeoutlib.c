@@ -3,7 +3,7 @@
  *	\brief Function definitions for timeout handling
  *	\author Marc Juettner, marc.juettner@juettner-itconsult.de
  *	\author Manuel Gaiser, manuel.gaiser@hs-pforzheim.de
- *	\version 1.1
+ *	\version 1.2
  *
  */
 #include "timeoutlib.h"
@@ -28,7 +28,7 @@ void tol_handle_timeout(int signum) {
  *	\brief Start timer
  *	\param seconds	Number of seconds until timeout elapses.
  */
-inline void tol_start_timeout(int seconds) {
+void tol_start_timeout(int seconds) {
 	// set signal handler for timeout
 	signal(SIGALRM, tol_handle_timeout);
 	// terminate recvfrom if a timeout occurs
@@ -42,7 +42,7 @@ inline void tol_start_timeout(int seconds) {
  *	\brief Stop timer
  *	\param
 */
-inline void tol_stop_timeout(void) {
+void tol_stop_timeout(void) {
 	alarm(0);
 	signal(SIGALRM, SIG_IGN);
 }
@@ -51,7 +51,7 @@ inline void tol_stop_timeout(void) {
  *	\brief Check if timeout occurred
  *	\return True if timeout occurred, false otherwise.
  */
-inline int tol_is_timed_out(void) {
+int tol_is_timed_out(void) {
 	return (cTimeoutFlag == TOL_TIMEOUT_OCCURRED);
 }
 
@@ -59,11 +59,61 @@ inline int tol_is_timed_out(void) {
  *	\brief Reset timeout flag
  *	\param
  */
-inline void tol_reset_timeout(void) {
+void tol_reset_timeout(void) {
 	cTimeoutFlag = TOL_TIMEOUT_NONE;
 	return;
 }
 
+#if defined TOL_HAVE_TIMERFD
+/** 
+ *	\brief Open a periodic timer
+ *	\param seconds	Timer period in seconds.
+ *	\return		A file descriptor that becomes readable whenever the period elapsed,
+ *			a negative value on error.
+ *
+ *	Unlike tol_start_timeout() the timer involves no signals and no process-wide state,
+ *	so it can be waited for with select(), poll() or epoll together with sockets and may
+ *	be used by several threads. Being periodic, it has to be armed only once; callers 
+ *	detect idle periods by checking whether anything happened between two expirations.
+ */
+int tol_timer_open(int seconds) {
+	int fd;
+	struct itimerspec its;
+
+	fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0) return -1;
+
+	its.it_value.tv_sec = seconds;
+	its.it_value.tv_nsec = 0;
+	its.it_interval = its.it_value;
+	if (timerfd_settime(fd, 0, &its, NULL) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/** 
+ *	\brief Acknowledge timer expirations
+ *	\param fd	A timer opened by tol_timer_open()
+ *	\return		Number of periods elapsed since the last call, zero if none.
+ */
+int tol_timer_expired(int fd) {
+	unsigned long long expirations = 0;
+
+	if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) return 0;
+	return (int)expirations;
+}
+
+/** 
+ *	\brief Close a timer
+ *	\param fd	A timer opened by tol_timer_open()
+ */
+void tol_timer_close(int fd) {
+	if (fd >= 0) close(fd);
+}
+#endif
+
 /**
  *	\}
  */
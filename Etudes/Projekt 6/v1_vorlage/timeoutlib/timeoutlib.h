@@ -3,7 +3,7 @@
  *	\brief Predefined values for timeout handling
  *	\author Marc Juettner, marc.juettner@juettner-itconsult.de
  *	\author Manuel Gaiser, manuel.gaiser@hs-pforzheim.de
- *	\version 1.0
+ *	\version 1.2
  *
  */
 #if !defined _timeoutlib_h_
@@ -17,10 +17,23 @@
 #define TOL_TIMEOUT_OCCURRED	1
 #define TOL_TIMEOUT_SECS	10
 
+// timerfd based timers need Linux and a C library that knows them, the uClinux
+// toolchain doesn't
+#if defined(__linux__) && !defined(__UCLIBC__)
+#define TOL_HAVE_TIMERFD
+#include <sys/timerfd.h>
+#endif
 
-inline void tol_start_timeout(int seconds);
-inline void tol_stop_timeout(void);
-inline void tol_reset_timeout(void);
-inline int tol_is_timed_out(void);
+
+void tol_start_timeout(int seconds);
+void tol_stop_timeout(void);
+void tol_reset_timeout(void);
+int tol_is_timed_out(void);
+
+#if defined TOL_HAVE_TIMERFD
+int tol_timer_open(int seconds);
+int tol_timer_expired(int fd);
+void tol_timer_close(int fd);
+#endif
 
 #endif //#define _timeoutlib_h_